@@ -73,6 +73,12 @@ void ac_thread_wait_ns(ac_u64 nanosecs);
  */
 void ac_thread_wait_ticks(ac_u64 ticks);
 
+/**
+ * Get current thread handle
+ *
+ */
+ac_thread_hdl_t ac_thread_get_cur_hdl(void);
+
 
 /**
  * Create a thread and invoke the entry passing entry_arg. If
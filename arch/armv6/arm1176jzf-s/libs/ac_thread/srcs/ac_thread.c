@@ -416,6 +416,13 @@ void ac_thread_wait_ticks(ac_u64 ticks) {
   // TODO: Not implemented
 }
 
+/**
+ * Get current thread handle
+ */
+ac_thread_hdl_t ac_thread_get_cur_hdl(void) {
+  return (ac_thread_hdl_t)pready;
+}
+
 
 /**
  * Early initialization of this module
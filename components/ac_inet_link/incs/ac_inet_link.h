@@ -83,57 +83,15 @@ typedef struct {
 
 
 /**
- * For AC_INET_SEND_PACKET_PROTOCOL define:
- *   AC_INET_SEND_PACKET_CMD
- *   AC_INET_SEND_PACKET_REQ
- *   AC_INET_SEND_PACKET_RSP
- */
-#define AC_INET_LINK_PROTOCOL                0x1234
-#define AC_INET_LINK_PROTOCOL_EXTRA_MAX_LEN  256
-
-#define AC_INET_SEND_PACKET_CMD AC_OP(AC_INET_LINK_PROTOCOL, AC_OPTYPE_CMD, 0x1)
-#define AC_INET_SEND_PACKET_REQ AC_OP(AC_INET_LINK_PROTOCOL, AC_OPTYPE_REQ, 0x1)
-#define AC_INET_SEND_PACKET_RSP AC_OP(AC_INET_LINK_PROTOCOL, AC_OPTYPE_RSP, 0x1)
-
-/**
- * AcInetSendPacketExtra contains the destination protocol information
- * and a set of io_vecs. To allow the io_vecs to be used in a generalized
- * way the location of the first used io_vec is defined by io_vecs_first_idx
- * and the number used is io_vecs_cnt.
+ * Large enough for the protocol address of all known protocols
  */
 #define DST_PROTO_ADDR_MAX_LEN     AC_IPV6_ADDR_LEN
-typedef struct {
-  AcU16     dst_proto;          ///< Protocol such as AC_ETHER_PROTO_ARP in Host order
-  AcU16     dst_proto_addr_len; ///< Length of the protocol address in Host order
-  AcU8      dst_proto_addr[DST_PROTO_ADDR_MAX_LEN]; ///< Protocol address,
-                                                    ///< large enough for all known protocols
-                                ///< such as IPv6.
-  ac_u32    io_vecs_first_idx;  ///< io_vecs[io_vecs_first_idx] is first used io_vec
-  ac_u32    io_vecs_cnt;        ///< Number of io_vecs used
-  AcIoVec   io_vecs[8];         ///< Array of AcIoVecs
-} AcInetSendPacketExtra;
-
-ac_static_assert(sizeof(AcInetSendPacketExtra) <= AC_INET_LINK_PROTOCOL_EXTRA_MAX_LEN,
-    L"sizeof(AcInetSendPacketExtra) > AC_INET_LINK_PROTOCOL_EXTRA_MAX_LEN");
-
-#define AC_INET_SEND_ARP_CMD AC_OP(AC_INET_LINK_PROTOCOL, AC_OPTYPE_CMD, 0x2)
-#define AC_INET_SEND_ARP_REQ AC_OP(AC_INET_LINK_PROTOCOL, AC_OPTYPE_REQ, 0x2)
-#define AC_INET_SEND_ARP_RSP AC_OP(AC_INET_LINK_PROTOCOL, AC_OPTYPE_RSP, 0x2)
 
 /**
- * AcInetSendArpPacketData is either AC_INET_SEND_PACKET_CMD or _REQ.
- * If _REQ is sent then _RSP must be sent as reply. For _CMD the _RSP
- * may be sent as reply, for instance when an error occurs, usually
- * detected a reply may be sent.
+ * The AC_INET_LINK_PROTOCOL operations, their extras and handlers,
+ * generated from ac_inet_link.protocol
  */
-typedef struct {
-  AcU16     proto;          ///< Protocol such as AC_ETHER_PROTO_ARP in Host order
-  AcU16     proto_addr_len; ///< Length of the protocol address in Host order
-  AcU8      proto_addr[DST_PROTO_ADDR_MAX_LEN]; ///< Protocol address,
-                                                ///< large enough for all known protocols
-} AcInetSendArpExtra;
-ac_static_assert(sizeof(AcInetSendArpExtra) <= AC_INET_LINK_PROTOCOL_EXTRA_MAX_LEN,
-    L"sizeof(AcInetSendArpExtra) > AC_INET_LINK_PROTOCOL_EXTRA_MAX_LEN");
+#include <ac_inet_link_protocol.h>
 
 /**
  * Name of the IPV4 link component
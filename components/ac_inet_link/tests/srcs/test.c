@@ -18,6 +18,8 @@
 
 #include <ac_comp_mgr.h>
 #include <ac_memset.h>
+#include <ac_msg_pool.h>
+#include <ac_msg_pool_set.h>
 #include <ac_printf.h>
 #include <ac_receptor.h>
 #include <ac_thread.h>
@@ -216,6 +218,61 @@ ac_bool test_AcInetSendPacket(void) {
   return error;
 }
 
+static ac_bool test_handler(AcComp* comp, AcMsg* msg) {
+  return AC_TRUE;
+}
+
+/**
+ * Test the helpers generated from ac_inet_link.protocol
+ */
+ac_bool test_AcInetLinkProtocol(void) {
+  ac_bool error = AC_FALSE;
+
+  // Classes of 32, 64, 128 and 256 bytes, messages come from the smallest that fits
+  AcMsgPoolSet mps;
+  const AcU32 msg_counts[] = { 2, 2, 2, 2 };
+  error |= AC_TEST(AcMsgPoolSet_init(&mps, 32, AC_INET_LINK_PROTOCOL_EXTRA_MAX_LEN,
+        msg_counts) == AC_STATUS_OK);
+  if (!error) {
+    AcMsg* msg = AcInetSendArpReq_get_msg(&mps);
+    error |= AC_TEST(msg != AC_NULL);
+    error |= AC_TEST(msg->op == AC_INET_SEND_ARP_REQ);
+    error |= AC_TEST(msg->len_extra == 32);
+    error |= AC_TEST((AcU8*)AcInetSendArp_extra(msg) == msg->extra);
+    AcMsgPool_ret_msg(msg);
+
+    msg = AcInetSendArpRsp_get_msg(&mps);
+    error |= AC_TEST(msg != AC_NULL);
+    error |= AC_TEST(msg->op == AC_INET_SEND_ARP_RSP);
+    error |= AC_TEST(msg->len_extra == 32);
+    AcMsgPool_ret_msg(msg);
+
+    msg = AcInetSendPacketCmd_get_msg(&mps);
+    error |= AC_TEST(msg != AC_NULL);
+    error |= AC_TEST(msg->op == AC_INET_SEND_PACKET_CMD);
+    error |= AC_TEST(msg->len_extra == 256);
+    error |= AC_TEST((AcU8*)AcInetSendPacket_extra(msg) == msg->extra);
+    AcMsgPool_ret_msg(msg);
+
+    AcMsgPoolSet_deinit(&mps);
+  }
+
+  // Only the handlers which aren't AC_NULL are added
+  AcCompHandlers handlers = { 0 };
+  AcInetLinkHandlers h = {
+    .send_arp_req = test_handler,
+    .send_packet_rsp = test_handler,
+  };
+  error |= AC_TEST(AcInetLink_add_handlers(&handlers, &h) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompHandlers_get(&handlers, AC_INET_SEND_ARP_REQ) == test_handler);
+  error |= AC_TEST(AcCompHandlers_get(&handlers, AC_INET_SEND_PACKET_RSP) == test_handler);
+  error |= AC_TEST(AcCompHandlers_get(&handlers, AC_INET_SEND_ARP_CMD) == AC_NULL);
+  error |= AC_TEST(AcCompHandlers_get(&handlers, AC_INET_SEND_PACKET_REQ) == AC_NULL);
+  AcCompHandlers_deinit(&handlers);
+
+  return error;
+}
+
 /**
  * Main routine
  */
@@ -229,6 +286,7 @@ int main(void) {
   error |= test_hton_ntoh_le();
   error |= test_AcInetIpv4FragmentOffset();
   error |= test_AcInetSendPacket();
+  error |= test_AcInetLinkProtocol();
 #else
   ac_thread_init(4);
   AcReceptor_init(256);
@@ -243,6 +301,7 @@ int main(void) {
   error |= test_hton_ntoh_le();
   error |= test_AcInetIpv4FragmentOffset();
   error |= test_AcInetSendPacket();
+  error |= test_AcInetLinkProtocol();
 
   AcCompMgr_deinit(&cm);
 #endif
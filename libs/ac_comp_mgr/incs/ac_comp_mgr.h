@@ -22,8 +22,10 @@
 #ifndef SADIE_LIBS_AC_COMP_MGR_INCS_AC_COMP_MGR_H
 #define SADIE_LIBS_AC_COMP_MGR_INCS_AC_COMP_MGR_H
 
+#include <ac_bits.h>
 #include <ac_inttypes.h>
 #include <ac_msg.h>
+#include <ac_receptor.h>
 #include <ac_status.h>
 
 #include <ac_comp_mgr_internal.h>
@@ -48,7 +50,7 @@ typedef struct AcCompInfo AcCompInfo;
  *
  * @return AC_FALSE if the message was NOT fully handled in which
  * case the parent component will be called, otherwise processing
- * is complete. TODO: Add support for Hierarchical Processing
+ * is complete, see AcCompParams.parent.
  */
 typedef AcBool (*AcCompMsgProcessor)(AcComp* this, AcMsg* msg);
 
@@ -62,7 +64,77 @@ typedef struct AcComp {
 } AcComp;
 
 /**
- * Find a component
+ * Index of an operation in AcCompProtocolHandlers.handlers, the
+ * optype is included so a request and its response can have
+ * different handlers.
+ */
+#define AC_COMP_HANDLER_IDX(op) \
+  ((AcU32)AC_GET_BITS(AcU64, op, 16, 0) << 2 | (AcU32)AC_GET_BITS(AcU64, op, 2, 16))
+
+/**
+ * The handlers for the operations of one protocol
+ */
+typedef struct AcCompProtocolHandlers {
+  AcU64 protocol;                  ///< The protocol, AcOp.protocol
+  AcU32 count;                     ///< Number of elements in handlers
+  AcCompMsgProcessor* handlers;    ///< Indexed by AC_COMP_HANDLER_IDX, AC_NULL if none
+} AcCompProtocolHandlers;
+
+/**
+ * A component's handlers for individual operations, which the
+ * dispatcher calls directly rather than a process_msg deciding
+ * what to do with each operation, see AcCompParams.handlers.
+ * Initialize to zero, add handlers with AcCompHandlers_add and
+ * don't change them while a component using them is managed.
+ * Components handle a few protocols so they're searched in turn,
+ * the handler is then an index into a dense table.
+ */
+typedef struct AcCompHandlers {
+  AcU32 protocol_count;            ///< Number of elements in protocols
+  AcCompProtocolHandlers* protocols;
+} AcCompHandlers;
+
+/**
+ * Get the handler for an operation
+ *
+ * @param: handlers are a component's handlers
+ * @param: op is the operation, AcMsg.op
+ *
+ * @return: the handler or AC_NULL if there is none
+ */
+static inline AcCompMsgProcessor AcCompHandlers_get(const AcCompHandlers* handlers,
+    AcU64 op) {
+  AcU64 protocol = AC_GET_BITS(AcU64, op, 44, 20);
+  for (AcU32 i = 0; i < handlers->protocol_count; i++) {
+    AcCompProtocolHandlers* ph = &handlers->protocols[i];
+    if (ph->protocol == protocol) {
+      AcU32 idx = AC_COMP_HANDLER_IDX(op);
+      return (idx < ph->count) ? ph->handlers[idx] : AC_NULL;
+    }
+  }
+  return AC_NULL;
+}
+
+/**
+ * Add the handler for an operation, replacing any previous handler.
+ *
+ * @param: handlers are a component's handlers
+ * @param: op is the operation, an AC_OP
+ * @param: handler processes messages with this operation
+ *
+ * @return: AC_STATUS_OK if added, AC_STATUS_BAD_PARAM if a parameter
+ * is AC_NULL or AC_STATUS_OUT_OF_MEMORY.
+ */
+AcStatus AcCompHandlers_add(AcCompHandlers* handlers, AcU64 op, AcCompMsgProcessor handler);
+
+/**
+ * Free the tables of handlers, no component may still be using them
+ */
+void AcCompHandlers_deinit(AcCompHandlers* handlers);
+
+/**
+ * Find a component by its exact name, this is a lookup in a
+ * hash index so is independent of the number of components.
  *
  * @param: mgr is a component manager
  * @param: name is the name of the component
@@ -74,7 +146,8 @@ AcComp* AcCompMgr_find_comp(AcCompMgr* mgr, ac_u8* name);
 /**
  * Add a component to be managed, it is the responsibility of the
  * caller to guarantee that he AcComp data structure does not change
- * or move.
+ * or move. It's placed on the least loaded thread, see
+ * AcCompMgr_get_thread_load.
  *
  * @param: mgr is a component manager
  * @param: comp the component to add with name and process_msg fields initialized
@@ -84,7 +157,75 @@ AcComp* AcCompMgr_find_comp(AcCompMgr* mgr, ac_u8* name);
 AcStatus AcCompMgr_add_comp(AcCompMgr* mgr, AcComp* comp);
 
 /**
- * Remove a component being managed
+ * Add a component to be managed whose queue is bounded. When capacity
+ * messages are queued or being processed AcCompMgr_send_msg returns
+ * AC_STATUS_QUEUE_FULL, providing back pressure to the senders.
+ *
+ * @param: mgr is a component manager
+ * @param: comp the component to add with name and process_msg fields initialized
+ * @param: capacity is the maximum number of messages, 0 is unbounded
+ * @param: low_water is the number of messages at which senders passed to
+ *         AcCompMgr_send_msg_or_notify are signaled, must be < capacity
+ *
+ * @return: returns AC_STATUS_OK if successful and AcComp.ci initialized
+ */
+AcStatus AcCompMgr_add_comp_bounded(AcCompMgr* mgr, AcComp* comp, AcU32 capacity,
+    AcU32 low_water);
+
+/**
+ * Add a component to be managed with the given parameters,
+ * see AcDispatcher_add_comp_params for their meaning.
+ *
+ * @param: mgr is a component manager
+ * @param: comp the component to add with name and process_msg fields initialized
+ * @param: params for the component, AC_NULL for the defaults
+ *
+ * @return: returns AC_STATUS_OK if successful and AcComp.ci initialized
+ */
+AcStatus AcCompMgr_add_comp_params(AcCompMgr* mgr, AcComp* comp, const AcCompParams* params);
+
+/**
+ * Add a component to be managed pinned to a particular thread rather
+ * than the least loaded one.
+ *
+ * @param: mgr is a component manager
+ * @param: comp the component to add with name and process_msg fields initialized
+ * @param: thread is the index of the thread, < max_component_threads
+ * @param: params for the component, AC_NULL for the defaults
+ *
+ * @return: returns AC_STATUS_OK if successful and AcComp.ci initialized,
+ * AC_STATUS_BAD_PARAM if thread is out of range or AC_STATUS_NOT_AVAILABLE
+ * if the thread has no room.
+ */
+AcStatus AcCompMgr_add_comp_on_thread(AcCompMgr* mgr, AcComp* comp, AcU32 thread,
+    const AcCompParams* params);
+
+/**
+ * A handle to a component, unlike a pointer to the AcComp it can be
+ * kept after the component is removed. Sending through it then fails
+ * cleanly rather than using the removed component, see
+ * AcCompMgr_send_msg_hdl.
+ */
+typedef struct AcCompHandle {
+  AcU32 slot;             ///< Index of the component in its manager
+  AcU32 gen;              ///< Generation of the slot when the component was added
+} AcCompHandle;
+
+/**
+ * Get a handle to a component
+ *
+ * @param: comp is a component which has been added
+ * @param: hdl is filled in
+ *
+ * @return: AC_STATUS_OK or AC_STATUS_BAD_PARAM if comp isn't managed
+ */
+AcStatus AcCompMgr_get_handle(AcComp* comp, AcCompHandle* hdl);
+
+/**
+ * Remove a component being managed. Once removal starts handles to
+ * the component are stale. Messages sent to it by components before
+ * then are processed before it's sent AC_DEINIT_CMD, so removal waits
+ * for each other dispatch thread to finish what it's dispatching.
  *
  * @param: mgr is a component manager
  * @param: info an AcCompInfo returned by AcCompMgr_add_comp.
@@ -95,14 +236,234 @@ AcStatus AcCompMgr_rmv_comp(AcComp* comp);
 
 /**
  * Send a message to the comp
+ *
+ * @return: AC_STATUS_OK or AC_STATUS_QUEUE_FULL if comp was added
+ * with AcCompMgr_add_comp_bounded and is full, in which case the
+ * caller still owns msg.
  */
-void AcCompMgr_send_msg(AcComp* comp, AcMsg* msg);
+AcStatus AcCompMgr_send_msg(AcComp* comp, AcMsg* msg);
+
+/**
+ * Send a message to the component hdl is a handle to. Checking the
+ * handle is a load and compare of the slot's generation. A component
+ * may send through a handle while the component it refers to is
+ * being removed, other threads must only send through a handle
+ * before or after its removal.
+ *
+ * @return: AC_STATUS_OK, AC_STATUS_STALE_HANDLE if the component has
+ * been removed or AC_STATUS_QUEUE_FULL as for AcCompMgr_send_msg.
+ * Unless AC_STATUS_OK the caller still owns msg.
+ */
+AcStatus AcCompMgr_send_msg_hdl(AcCompMgr* mgr, AcCompHandle hdl, AcMsg* msg);
+
+/**
+ * Send a request to comp whose response is to be sent to reply_to.
+ * The request is kept in reply_to's table of outstanding requests
+ * and msg->tag has its entry's index and generation, AcMsg_reply
+ * checks it's still outstanding and restores msg->tag
+ * so the response has the requester's tag. Nothing waits for the
+ * response, a component may have max_requests_per_comp requests
+ * outstanding, see AcCompMgrParams, and matches the responses
+ * by their tags as they arrive.
+ *
+ * @param: comp is the component to send the request to
+ * @param: msg is the request, msg->op is normally an AC_OPTYPE_REQ
+ * @param: reply_to is the component to send the response to
+ *
+ * @return: AC_STATUS_OK, AC_STATUS_BAD_PARAM if reply_to isn't managed
+ * or AC_STATUS_QUEUE_FULL if reply_to has max_requests_per_comp
+ * outstanding or comp is full. Unless AC_STATUS_OK the caller still
+ * owns msg and msg->tag is unchanged.
+ */
+AcStatus AcCompMgr_request(AcComp* comp, AcMsg* msg, AcComp* reply_to);
+
+/**
+ * Reply to a request sent with AcCompMgr_request, which must be
+ * replied to once, with an error status if nothing else, or its
+ * entry stays outstanding, see AcCompMgr_cancel_requests. Once called
+ * the request is no longer outstanding whatever is returned.
+ * The request becomes the response in place, its
+ * optype is AC_OPTYPE_RSP, msg->status is status and msg->tag is the
+ * requester's, and it's sent to the reply_to through its handle, see
+ * AcCompMgr_send_msg_hdl, without allocating.
+ *
+ * @param: msg is the request
+ * @param: status of the request
+ *
+ * @return: AC_STATUS_OK, AC_STATUS_BAD_PARAM if msg->tag isn't a
+ * request's, AC_STATUS_STALE_HANDLE if it's been replied to, was
+ * cancelled or the reply_to has been removed, or AC_STATUS_QUEUE_FULL
+ * if the reply_to is full. Unless AC_STATUS_OK the caller still owns
+ * msg and it's unchanged.
+ */
+AcStatus AcMsg_reply(AcMsg* msg, AcStatus status);
+
+/**
+ * Free the entries of the requests outstanding with comp as the
+ * reply_to, for when their receivers won't reply. Replies to them
+ * return AC_STATUS_STALE_HANDLE. Removing comp frees them too.
+ *
+ * @return: the number freed, 0 if comp isn't managed
+ */
+AcU32 AcCompMgr_cancel_requests(AcComp* comp);
+
+/**
+ * Return the number of requests outstanding with comp as the
+ * reply_to, 0 if comp isn't managed.
+ */
+AcU32 AcCompMgr_get_outstanding(AcComp* comp);
+
+/**
+ * Send a message to a lane of the comp, e.g. AC_LANE_CONTROL
+ * so it is processed before any messages in lower lanes.
+ *
+ * @return: AC_STATUS_OK or AC_STATUS_QUEUE_FULL if sent to
+ * AC_LANE_NORMAL of a bounded component which is full.
+ */
+AcStatus AcCompMgr_send_msg_lane(AcComp* comp, AcMsg* msg, AcU32 lane);
+
+/**
+ * Send a message to the comp and if its queue is full arrange for
+ * space_available to be signaled once it has drained to its low_water.
+ * The caller would typically wait on space_available and then resend.
+ * Must not be used to wait from a component on the same thread as comp.
+ *
+ * @return: AC_STATUS_OK or AC_STATUS_QUEUE_FULL in which case the
+ * caller still owns msg and space_available will be signaled once.
+ */
+AcStatus AcCompMgr_send_msg_or_notify(AcComp* comp, AcMsg* msg, AcReceptor* space_available);
+
+/**
+ * Get the counters of a component, such as how often it ran
+ * out of the msg_budget or tsc_budget in its AcCompParams.
+ *
+ * @return: AC_STATUS_OK or AC_STATUS_BAD_PARAM if comp hasn't been added
+ */
+AcStatus AcCompMgr_get_counters(AcComp* comp, AcCompCounters* counters);
+
+/**
+ * The load of a dispatch thread, measured over the most recent
+ * AC_COMP_MGR_LOAD_WINDOW_NS.
+ */
+typedef struct AcCompMgrThreadLoad {
+  AcU64 msgs_per_sec;     ///< Messages processed per second
+  AcU32 busy_permille;    ///< Thousandths of the time spent processing messages
+  AcU32 comp_count;       ///< Number of components on the thread
+} AcCompMgrThreadLoad;
+
+/** Time over which a dispatch thread's load is measured */
+#define AC_COMP_MGR_LOAD_WINDOW_NS (10 * 1000000ll)
+
+/**
+ * Get the load of a dispatch thread. AcCompMgr_add_comp places a
+ * component on the thread whose busy_permille is lowest, those within
+ * AC_COMP_MGR_LOAD_BAND_PERMILLE of each other are equally busy and
+ * the one with the fewest components is chosen.
+ *
+ * @param: mgr is a component manager
+ * @param: thread is the index of the thread, < max_component_threads
+ * @param: load is filled in
+ *
+ * @return: AC_STATUS_OK or AC_STATUS_BAD_PARAM if thread is out of range
+ */
+AcStatus AcCompMgr_get_thread_load(AcCompMgr* mgr, AcU32 thread, AcCompMgrThreadLoad* load);
+
+/** Difference in busy_permille below which threads are equally busy */
+#define AC_COMP_MGR_LOAD_BAND_PERMILLE 50
+
+/**
+ * Called from a dispatch thread when comp has been moved from
+ * from_thread to to_thread, where peer is, because they were
+ * sending each other msgs_per_sec. It should return quickly.
+ */
+typedef void (*AcCompMgrColocated)(AcCompMgr* mgr, AcComp* comp, AcComp* peer,
+    AcU32 from_thread, AcU32 to_thread, AcU64 msgs_per_sec);
+
+/** Default AcCompMgrParams.colocate_max_busy_permille */
+#define AC_COMP_MGR_COLOCATE_MAX_BUSY_PERMILLE 800
+
+/**
+ * Statistics of the sends between components, only sends made by
+ * components while processing a message are counted. They're
+ * estimated from a sample of the sends and only kept if colocating.
+ */
+typedef struct AcCompMgrColocateStats {
+  AcU64 local_sends;      ///< Sends to a component on the same thread
+  AcU64 cross_sends;      ///< Sends to a component on another thread
+  AcU64 colocations;      ///< Components moved to be with a peer
+} AcCompMgrColocateStats;
+
+/**
+ * Get the statistics of the sends between components, comparing
+ * them before and after shows if colocating is reducing the sends
+ * between threads.
+ *
+ * @return: AC_STATUS_OK or AC_STATUS_BAD_PARAM if stats is AC_NULL
+ */
+AcStatus AcCompMgr_get_colocate_stats(AcCompMgr* mgr, AcCompMgrColocateStats* stats);
 
 /**
  * Deinitialize a AcCompMsg
  */
 void AcCompMgr_deinit(AcCompMgr* mgr);
 
+/**
+ * Parameters for AcCompMgr_init_params
+ */
+typedef struct AcCompMgrParams {
+  ac_u32 max_component_threads;     ///< Maximum number of threads to manage
+  ac_u32 max_components_per_thread; ///< Maximum number of components per thread
+  ac_u32 stack_size;                ///< Bytes for a threads stack, 0 for the default
+  AcU64 spin_ns;                    ///< Maximum an idle thread spins before parking
+  AcBool adaptive_spin;             ///< Adapt the spin to recent idle times
+  AcU64 steal_after_ns;             ///< Steal from threads busy this long, 0 never
+  AcU64 colocate_ns;                ///< Regroup components this often, 0 never
+  AcU32 colocate_max_busy_permille; ///< Don't regroup onto threads this busy, 0 default
+  AcU64 colocate_min_msgs_per_sec;  ///< Don't regroup components sending less than this
+  AcCompMgrColocated colocated;     ///< Called for each component regrouped, may be AC_NULL
+  AcU32 max_requests_per_comp;      ///< Requests each component may have outstanding, 0 none
+} AcCompMgrParams;
+
+/**
+ * Initialize a component manager with the given parameters.
+ *
+ * When a dispatch thread runs out of messages it parks until another
+ * is sent, waking it costs the sender a signal and the message the
+ * time for the thread to be scheduled. With spin_ns != 0 the thread
+ * first spins for up to spin_ns looking for messages, trading CPU for
+ * latency when messages arrive close together. With adaptive_spin
+ * the spin is twice the moving average of how long the thread has
+ * been idle, so it stops spinning when the gaps are longer than
+ * spin_ns and starts again when they're shorter.
+ *
+ * With steal_after_ns != 0 an idle dispatch thread steals a component
+ * with messages waiting from a sibling which has been busy for at
+ * least steal_after_ns and has other components waiting too. A busy
+ * thread wakes a parked sibling to do so at most every steal_after_ns.
+ * The component then stays on its new thread, components added with
+ * AcCompMgr_add_comp_on_thread are never stolen.
+ *
+ * With colocate_ns != 0 a sample of the messages sent by each
+ * component is used to find the peer it sends to most. Every
+ * colocate_ns each dispatch thread looks at its components and if
+ * one sends at least colocate_min_msgs_per_sec to a peer on another
+ * thread one of them is moved so they're on the same thread. It's
+ * moved to the less loaded of the two threads unless that thread is
+ * colocate_max_busy_permille busy, and isn't moved away from a peer
+ * on its thread it sends more to. Pinned components are never moved.
+ * Each move is reported to colocated, see AcCompMgr_get_colocate_stats.
+ *
+ * With max_requests_per_comp != 0 each component has a table of that
+ * many entries for the requests it's the reply_to of, allocated with
+ * the manager so requests and responses don't allocate, see
+ * AcCompMgr_request. At most 256 managers may have tables and each
+ * at most 2^24 entries, else AC_STATUS_NOT_AVAILABLE or
+ * AC_STATUS_BAD_PARAM is returned.
+ *
+ * @return: 0 (AC_STATUS_OK) if successsful
+ */
+AcStatus AcCompMgr_init_params(AcCompMgr* mgr, const AcCompMgrParams* params);
+
 /**
  * Initialize a component manager
  *
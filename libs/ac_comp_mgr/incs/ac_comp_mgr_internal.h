@@ -31,6 +31,29 @@ typedef struct DispatchThreadParams DispatchThreadParams;
 typedef struct AcCompMgr AcCompMgr;
 typedef struct AcComp AcComp;
 
+/** Number of peers a component's sends are recorded for */
+#define AC_COMP_MGR_COLOCATE_PEERS 4
+
+/**
+ * A component sent to, and how many of the sampled sends were to it
+ */
+typedef struct AcCompPeer {
+  AcComp* comp;
+  AcU32 count;
+} AcCompPeer;
+
+/**
+ * An entry for a request, see AcCompMgr_request. The tag of the
+ * request has the entry's index, its manager's request_id and gen
+ * so AcMsg_reply can check it's still outstanding.
+ */
+typedef struct AcCompRequest {
+  AcU64 tag;                  // The requester's tag, restored in the response
+  AcU32 slot;                 // Handle of the reply_to
+  AcU32 slot_gen;
+  AcU32 gen;                  // Odd while outstanding, bumped when taken and freed
+} AcCompRequest;
+
 /**
  * A opaque component info for an AcComp
  */
@@ -39,7 +62,13 @@ typedef struct AcCompInfo {
   //AcComp* comp;
   AcDispatchableComp* dc;
   ac_u32 comp_idx;
+  AcU32 gen;                  // Generation of AcCompMgr.gens[comp_idx] when added
+  AcU32 name_hash;            // Hash of the name in AcCompMgr.index
   DispatchThreadParams* dtp;
+  ac_bool pinned;             // Added with AcCompMgr_add_comp_on_thread
+  AcU32 sends;                // Messages sent to us, if colocating
+  AcCompPeer peers[AC_COMP_MGR_COLOCATE_PEERS]; // Who we've sent to, if colocating
+  AcU32 next_request;         // Where to look for a free entry in our requests
 } AcCompInfo;
 
 /**
@@ -50,12 +79,37 @@ typedef struct DispatchThreadParams {
   ac_thread_hdl_t thread_hdl;
   AcDispatcher* d;
   ac_u32 max_comps;
-  AcComp*** comps;
-  ac_u32 comp_idx;
   AcReceptor* done;
   AcReceptor* ready;
   AcReceptor* waiting;
   ac_bool stop_processing_msgs;
+  ac_bool parked;             // Thread is, or is about to, wait on waiting
+  AcU64 doorbells;            // Times waiting was signaled by senders
+  AcU64 parks;                // Times the thread waited on waiting
+  AcU64 spin_max_ticks;       // Longest spin before parking
+  AcU64 spin_ticks;           // Current spin before parking
+  AcU64 avg_idle_ticks;       // Moving average of the time idle, if adaptive_spin
+  ac_bool adaptive_spin;      // Adjust spin_ticks from avg_idle_ticks
+  AcU64 spin_wakeups;         // Times a message arrived while spinning
+  AcU32 comp_count;           // Components on this thread
+  AcU64 load_window_ticks;    // Duration of a load window
+  AcU64 busy_since;           // Sampled while dispatching, 0 when idle
+  AcU64 window_start;         // Start of the current load window
+  AcU64 window_idle_ticks;    // Ticks idle in the current window
+  AcU64 window_start_msgs;    // AcDispatcher_get_msgs at window_start
+  AcU64 load_tsc;             // When msgs_per_sec and busy_permille were updated
+  AcU64 msgs_per_sec;         // Messages per second in the last window
+  AcU32 busy_permille;        // Thousandths busy in the last window
+  AcCompMgr* mgr;             // Manager of this thread
+  AcU64 steal_after_ticks;    // Steal from siblings busy this long, 0 never
+  AcU64 thief_woken;          // When a parked sibling was last woken to steal
+  AcU32 stealers;             // Siblings stealing from, or waking, us
+  AcU64 steals;               // Components stolen from siblings
+  AcU64 colocated;            // When our components were last regrouped
+  AcU64 local_sends;          // Sampled sends by our components to this thread
+  AcU64 cross_sends;          // Sampled sends by our components to other threads
+  AcU64 colocations;          // Components we've moved to be with a peer
+  AcU64 quiescent;            // Incremented between dispatches, see wait_for_senders
 } DispatchThreadParams;
 
 /**
@@ -65,9 +119,23 @@ typedef struct AcCompMgr {
   AcComp** comps;            // Array of AcComp pointer objects being managed
                               // across all of the threads
   AcU32 comps_max_count;      // Number of elements in comps array
+  AcU32* gens;                // Generation of each comps element, changes when removed
   DispatchThreadParams* dtps; // Array of DispathThreadParams, one for each thread
   AcU32 max_dtps;             // Number of threads in the dtps array
   AcU32 next_dtps;            // Next thread
+  AcComp** index;             // Open addressed hash of the comps by name
+  AcU32 index_mask;           // Number of elements in index - 1
+  AcU32 index_seq;            // Odd while entries of index are being moved
+  AcBool index_busy;          // Held while index is being changed
+  AcU64 colocate_ticks;       // Time between regrouping, 0 never
+  AcU32 colocate_max_busy_permille; // Don't move components to threads this busy
+  AcU64 colocate_min_msgs_per_sec;  // Don't move components sending less than this
+  // Reports each move, may be AC_NULL, an AcCompMgrColocated
+  void (*colocated)(AcCompMgr* mgr, AcComp* comp, AcComp* peer,
+      AcU32 from_thread, AcU32 to_thread, AcU64 msgs_per_sec);
+  AcCompRequest* requests;    // max_requests outstanding requests for each of comps
+  AcU32 max_requests;         // Requests a component may have outstanding
+  AcU32 request_id;           // Our index in the managers with requests
 } AcCompMgr;
 
 #endif
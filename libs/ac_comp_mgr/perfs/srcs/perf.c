@@ -0,0 +1,903 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define NDEBUG
+
+#include <ac_comp_mgr.h>
+
+#include <ac_assert.h>
+#include <ac_debug_printf.h>
+#include <ac_histogram.h>
+#include <ac_intmath.h>
+#include <ac_memmgr.h>
+#include <ac_msg.h>
+#include <ac_msg_pool.h>
+#include <ac_printf.h>
+#include <ac_receptor.h>
+#include <ac_test.h>
+#include <ac_time.h>
+#include <ac_tsc.h>
+#include <ac_thread.h>
+
+#define DATA_MSG_COUNT 1024
+#define CONTROL_SAMPLES 200
+
+#define DATA_CMD        AC_OP(0, AC_OPTYPE_CMD, 1)
+#define CONTROL_CMD     AC_OP(0, AC_OPTYPE_CMD, 2)
+#define PING_REQ        AC_OP(0, AC_OPTYPE_REQ, 3)
+#define PING_RSP        AC_OP(0, AC_OPTYPE_RSP, 3)
+#define START_CMD       AC_OP(0, AC_OPTYPE_CMD, 4)
+
+typedef struct LaneComp {
+  AcComp comp;
+  AcU64 work_ticks;               ///< Time spent processing each DATA_CMD
+  AcU32 sample_count;             ///< Number of samples, written by the comp
+  AcU64 samples[CONTROL_SAMPLES]; ///< CONTROL_CMD latencies in ticks
+  AcReceptor* done;
+} LaneComp;
+
+static AcBool lane_comp_process_msg(AcComp* ac, AcMsg* msg) {
+  LaneComp* this = (LaneComp*)ac;
+
+  if (msg->op == DATA_CMD) {
+    AcU64 start = ac_tscrd();
+    while ((ac_tscrd() - start) < this->work_ticks) {
+    }
+  } else if (msg->op == CONTROL_CMD) {
+    AcU64 sent = *(AcU64*)msg->extra;
+    AcU32 count = __atomic_load_n(&this->sample_count, __ATOMIC_RELAXED);
+    if (count < CONTROL_SAMPLES) {
+      this->samples[count] = ac_tscrd() - sent;
+      __atomic_store_n(&this->sample_count, count + 1, __ATOMIC_RELEASE);
+      if ((count + 1) == CONTROL_SAMPLES) {
+        AcReceptor_signal(this->done);
+      }
+    }
+  }
+
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+/**
+ * Sort samples in place, there are only a few
+ */
+static void sort_samples(AcU64* samples, AcU32 count) {
+  for (AcU32 i = 1; i < count; i++) {
+    AcU64 v = samples[i];
+    AcU32 j = i;
+    for (; (j > 0) && (samples[j - 1] > v); j--) {
+      samples[j] = samples[j - 1];
+    }
+    samples[j] = v;
+  }
+}
+
+/**
+ * Keep the data lane of a component saturated with DATA_CMD's and
+ * measure the latency of CONTROL_CMD's sent to AC_LANE_CONTROL. With
+ * lane_count == 1 the control messages wait behind the data.
+ */
+AcBool lane_latency_perf(AcCompMgr* cm, AcU32 lane_count, AcU64 work_ns) {
+  AcBool error = AC_FALSE;
+  AcMsgPool data_mp;
+  AcMsgPool control_mp;
+  AcU64 data_sent = 0;
+
+  ac_debug_printf("lane_latency_perf:+lane_count=%d work_ns=%lu\n", lane_count, work_ns);
+
+  LaneComp* lc = ac_malloc(sizeof(LaneComp));
+  error |= AC_TEST(lc != AC_NULL);
+  if (error) {
+    goto done;
+  }
+  lc->comp.name = (AcU8*)"lane_comp";
+  lc->comp.process_msg = lane_comp_process_msg;
+  lc->work_ticks = (work_ns * ac_tsc_freq()) / AC_SEC_IN_NS;
+  lc->sample_count = 0;
+  lc->done = AcReceptor_get();
+
+  error |= AC_TEST(AcMsgPool_init(&data_mp, DATA_MSG_COUNT, 0) == AC_STATUS_OK);
+  error |= AC_TEST(AcMsgPool_init(&control_mp, 1, sizeof(AcU64)) == AC_STATUS_OK);
+  AcCompParams params = { .lane_count = lane_count };
+  error |= AC_TEST(AcCompMgr_add_comp_params(cm, &lc->comp, &params) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  while (__atomic_load_n(&lc->sample_count, __ATOMIC_ACQUIRE) < CONTROL_SAMPLES) {
+    // Top up the data lane
+    AcMsg* msg;
+    while ((msg = AcMsgPool_get_msg(&data_mp)) != AC_NULL) {
+      msg->op = DATA_CMD;
+      AcCompMgr_send_msg(&lc->comp, msg);
+      data_sent += 1;
+    }
+
+    // Send the next control message once the previous one is back
+    msg = AcMsgPool_get_msg(&control_mp);
+    if (msg != AC_NULL) {
+      msg->op = CONTROL_CMD;
+      *(AcU64*)msg->extra = ac_tscrd();
+      AcCompMgr_send_msg_lane(&lc->comp, msg, AC_LANE_CONTROL);
+    }
+    ac_thread_yield();
+  }
+  AcReceptor_wait(lc->done);
+
+  error |= AC_TEST(AcCompMgr_rmv_comp(&lc->comp) == AC_STATUS_OK);
+
+  sort_samples(lc->samples, CONTROL_SAMPLES);
+  ac_printf("lane_latency_perf: lanes=%d work=%ldns data_sent=%lu control latency"
+            " min=%.9t p50=%.9t p99=%.9t max=%.9t\n",
+      lane_count, work_ns, data_sent, lc->samples[0],
+      lc->samples[CONTROL_SAMPLES / 2], lc->samples[(CONTROL_SAMPLES * 99) / 100],
+      lc->samples[CONTROL_SAMPLES - 1]);
+
+  AcMsgPool_deinit(&control_mp);
+  AcMsgPool_deinit(&data_mp);
+  AcReceptor_ret(lc->done);
+
+done:
+  ac_free(lc);
+
+  ac_debug_printf("lane_latency_perf:-error=%d\n", error);
+  return error;
+}
+
+typedef struct PingComp {
+  AcComp comp;
+  AcComp* peer;               ///< The PongComp
+  AcMsgPool* mp;              ///< Pool for PING_REQ's
+  AcU64 remaining;            ///< Round trips left to do
+  AcHistogram latency;        ///< Round trip ticks
+  AcReceptor* done;
+} PingComp;
+
+typedef struct PongComp {
+  AcComp comp;
+  AcComp* peer;               ///< The PingComp
+  AcMsgPool* mp;              ///< Pool for PING_RSP's
+} PongComp;
+
+/**
+ * Send a PING_REQ to the PongComp stamped with the current tsc
+ */
+static void send_ping(PingComp* this) {
+  AcMsg* msg = AcMsgPool_get_msg(this->mp);
+  ac_assert(msg != AC_NULL);
+  msg->op = PING_REQ;
+  *(AcU64*)msg->extra = ac_tscrd();
+  AcCompMgr_send_msg(this->peer, msg);
+}
+
+static AcBool ping_comp_process_msg(AcComp* ac, AcMsg* msg) {
+  PingComp* this = (PingComp*)ac;
+
+  if (msg->op == PING_RSP) {
+    AcHistogram_record(&this->latency, ac_tscrd() - *(AcU64*)msg->extra);
+    this->remaining -= 1;
+    if (this->remaining == 0) {
+      AcReceptor_signal(this->done);
+    } else {
+      send_ping(this);
+    }
+  } else if (msg->op == START_CMD) {
+    send_ping(this);
+  }
+
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+static AcBool pong_comp_process_msg(AcComp* ac, AcMsg* msg) {
+  PongComp* this = (PongComp*)ac;
+
+  if (msg->op == PING_REQ) {
+    AcMsg* rsp = AcMsgPool_get_msg(this->mp);
+    ac_assert(rsp != AC_NULL);
+    rsp->op = PING_RSP;
+    *(AcU64*)rsp->extra = *(AcU64*)msg->extra;
+    AcCompMgr_send_msg(this->peer, rsp);
+  }
+
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+static AcBool idle_comp_process_msg(AcComp* ac, AcMsg* msg) {
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+/**
+ * Measure the round trip of a message from a PingComp to a PongComp
+ * and back. Each trip gets a message from a pool, sends it, the
+ * dispatch thread is woken and dispatches it, the PongComp replies
+ * with another message which is dispatched back to the PingComp.
+ * With threads == 1 both components are on the same dispatch thread
+ * otherwise they are on different ones. The idle_comps components
+ * never receive a message but share the dispatch threads. Idle
+ * dispatch threads spin for up to spin_ns before parking, adapting
+ * the spin to the idle times if adaptive_spin.
+ */
+AcBool ping_pong_perf(AcU32 threads, AcU32 idle_comps, AcU64 spin_ns,
+    AcBool adaptive_spin, AcU64 round_trips) {
+  AcBool error = AC_FALSE;
+  AcCompMgr cm;
+  AcMsgPool ping_mp;
+  AcMsgPool pong_mp;
+
+  ac_debug_printf("ping_pong_perf:+threads=%d idle_comps=%d spin_ns=%lu adaptive_spin=%d"
+      " round_trips=%lu\n", threads, idle_comps, spin_ns, adaptive_spin, round_trips);
+
+  PingComp* ping = ac_malloc(sizeof(PingComp));
+  PongComp* pong = ac_malloc(sizeof(PongComp));
+  AcComp* idle = ac_malloc((idle_comps + 1) * sizeof(AcComp));
+  error |= AC_TEST(ping != AC_NULL);
+  error |= AC_TEST(pong != AC_NULL);
+  error |= AC_TEST(idle != AC_NULL);
+  error |= AC_TEST(AcMsgPool_init(&ping_mp, 2, sizeof(AcU64)) == AC_STATUS_OK);
+  error |= AC_TEST(AcMsgPool_init(&pong_mp, 2, sizeof(AcU64)) == AC_STATUS_OK);
+  AcCompMgrParams params = {
+    .max_component_threads = threads,
+    .max_components_per_thread = (2 + idle_comps) / threads,
+    .spin_ns = spin_ns,
+    .adaptive_spin = adaptive_spin,
+  };
+  error |= AC_TEST(AcCompMgr_init_params(&cm, &params) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  // Added first so the dispatcher passes over them to reach ping and pong
+  for (AcU32 i = 0; i < idle_comps; i++) {
+    idle[i].name = (AcU8*)"idle";
+    idle[i].process_msg = idle_comp_process_msg;
+    error |= AC_TEST(AcCompMgr_add_comp(&cm, &idle[i]) == AC_STATUS_OK);
+  }
+
+  ping->comp.name = (AcU8*)"ping";
+  ping->comp.process_msg = ping_comp_process_msg;
+  ping->peer = &pong->comp;
+  ping->mp = &ping_mp;
+  ping->remaining = round_trips;
+  AcHistogram_init(&ping->latency);
+  ping->done = AcReceptor_get();
+
+  pong->comp.name = (AcU8*)"pong";
+  pong->comp.process_msg = pong_comp_process_msg;
+  pong->peer = &ping->comp;
+  pong->mp = &pong_mp;
+
+  // AcCompMgr_add_comp round robins over the threads
+  error |= AC_TEST(AcCompMgr_add_comp(&cm, &ping->comp) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_add_comp(&cm, &pong->comp) == AC_STATUS_OK);
+  error |= AC_TEST((threads == 1) == (ping->comp.ci.dtp == pong->comp.ci.dtp));
+  if (!error) {
+    DispatchThreadParams* dtp = pong->comp.ci.dtp;
+    AcMsg* msg = AcMsgPool_get_msg(&ping_mp);
+    msg->op = START_CMD;
+    AcCompMgr_send_msg(&ping->comp, msg);
+    AcReceptor_wait(ping->done);
+
+    AcU64 spin_wakeups = __atomic_load_n(&dtp->spin_wakeups, __ATOMIC_RELAXED);
+    AcU64 parks = __atomic_load_n(&dtp->parks, __ATOMIC_RELAXED);
+    ac_printf("ping_pong_perf: %s idle=%-4d spin=%-5lu%s", (threads == 1) ? "same thread     " :
+        "different thread", idle_comps, spin_ns, adaptive_spin ? "a" : " ");
+    AcHistogram_print_summary("", &ping->latency);
+    ac_printf("ping_pong_perf:  pong thread spin_wakeups=%lu parks=%lu\n",
+        spin_wakeups, parks);
+  }
+
+  AcCompMgr_rmv_comp(&ping->comp);
+  AcCompMgr_rmv_comp(&pong->comp);
+  for (AcU32 i = 0; i < idle_comps; i++) {
+    AcCompMgr_rmv_comp(&idle[i]);
+  }
+  AcCompMgr_deinit(&cm);
+  AcReceptor_ret(ping->done);
+  AcMsgPool_deinit(&pong_mp);
+  AcMsgPool_deinit(&ping_mp);
+
+done:
+  ac_free(idle);
+  ac_free(pong);
+  ac_free(ping);
+
+  ac_debug_printf("ping_pong_perf:-error=%d\n", error);
+  return error;
+}
+
+typedef struct CountComp {
+  AcComp comp;
+  AcU64 count;                ///< Messages processed
+  AcU64 expected;             ///< Signal done when count reaches expected
+  AcReceptor* done;
+} CountComp;
+
+static AcBool count_comp_process_msg(AcComp* ac, AcMsg* msg) {
+  CountComp* this = (CountComp*)ac;
+
+  if (msg->op == DATA_CMD) {
+    this->count += 1;
+    if (this->count == this->expected) {
+      AcReceptor_signal(this->done);
+    }
+  }
+
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+/**
+ * Send msg_count messages in bursts of burst to a component on its own
+ * dispatch thread, waiting for each burst to be processed so the thread
+ * parks between them. Reports the time to send each message and how
+ * often the sender had to signal the dispatch thread, each signal being
+ * a system call on Posix, and how often the dispatch thread parked.
+ */
+AcBool doorbell_perf(AcU32 burst, AcU64 msg_count) {
+  AcBool error = AC_FALSE;
+  AcCompMgr cm;
+  AcMsgPool mp;
+  CountComp cc;
+
+  ac_debug_printf("doorbell_perf:+burst=%d msg_count=%lu\n", burst, msg_count);
+
+  cc.comp.name = (AcU8*)"count";
+  cc.comp.process_msg = count_comp_process_msg;
+  cc.count = 0;
+  cc.done = AcReceptor_get();
+
+  error |= AC_TEST(AcMsgPool_init(&mp, 1024, 0) == AC_STATUS_OK);
+  error |= AC_TEST(burst <= 1024);
+  error |= AC_TEST(AcCompMgr_init(&cm, 1, 1, 0) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+  error |= AC_TEST(AcCompMgr_add_comp(&cm, &cc.comp) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  AcU64 send_ticks = 0;
+  DispatchThreadParams* dtp = cc.comp.ci.dtp;
+  AcU64 doorbells = __atomic_load_n(&dtp->doorbells, __ATOMIC_RELAXED);
+  AcU64 parks = __atomic_load_n(&dtp->parks, __ATOMIC_RELAXED);
+  for (AcU64 sent = 0; sent < msg_count; sent += burst) {
+    cc.expected = sent + burst;
+    AcU64 start = ac_tscrd();
+    for (AcU32 i = 0; i < burst; i++) {
+      AcMsg* msg = AcMsgPool_get_msg(&mp);
+      msg->op = DATA_CMD;
+      AcCompMgr_send_msg(&cc.comp, msg);
+    }
+    send_ticks += ac_tscrd() - start;
+    AcReceptor_wait(cc.done);
+  }
+  doorbells = __atomic_load_n(&dtp->doorbells, __ATOMIC_RELAXED) - doorbells;
+  parks = __atomic_load_n(&dtp->parks, __ATOMIC_RELAXED) - parks;
+
+  ac_printf("doorbell_perf: burst=%-4d send=%.3Sns/msg doorbells/msg=%lu.%03lu"
+      " parks/msg=%lu.%03lu\n", burst, (send_ticks * AC_SEC_IN_NS) / msg_count,
+      doorbells / msg_count, ((doorbells * 1000) / msg_count) % 1000,
+      parks / msg_count, ((parks * 1000) / msg_count) % 1000);
+
+  AcCompMgr_rmv_comp(&cc.comp);
+  AcCompMgr_deinit(&cm);
+  AcMsgPool_deinit(&mp);
+
+done:
+  AcReceptor_ret(cc.done);
+
+  ac_debug_printf("doorbell_perf:-error=%d\n", error);
+  return error;
+}
+
+typedef struct HotComp {
+  AcComp comp;
+  AcMsgPool mp;
+  AcU64 work_ticks;           ///< Ticks of work per message
+  AcU64 remaining;            ///< Messages left to process
+  AcReceptor* done;
+} HotComp;
+
+/**
+ * Work for work_ticks per message then send another to ourself until
+ * remaining is exhausted. Messages sent to ourself go to whichever
+ * thread we're on, so a stolen HotComp stays stolen.
+ */
+static AcBool hot_comp_process_msg(AcComp* ac, AcMsg* msg) {
+  HotComp* this = (HotComp*)ac;
+
+  if (msg->op == DATA_CMD) {
+    AcU64 start = ac_tscrd();
+    while ((ac_tscrd() - start) < this->work_ticks) {
+    }
+    this->remaining -= 1;
+    if (this->remaining == 0) {
+      AcReceptor_signal(this->done);
+    } else {
+      AcMsg* next = AcMsgPool_get_msg(&this->mp);
+      next->op = DATA_CMD;
+      AcCompMgr_send_msg(ac, next);
+    }
+  }
+
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+/**
+ * Skewed load, hot_comps components each process msgs_per_comp
+ * messages of work_ns while as many cold components are idle. The
+ * components are added hot, cold, hot, cold ... so the hot ones all
+ * land on thread 0 of 2. Reports the throughput, how many components
+ * were stolen and where the hot components ended up.
+ */
+AcBool steal_perf(AcU32 hot_comps, AcU64 work_ns, AcU64 msgs_per_comp, AcU64 steal_after_ns) {
+  AcBool error = AC_FALSE;
+  AcCompMgr cm;
+  AcReceptor* done = AcReceptor_get();
+
+  ac_debug_printf("steal_perf:+hot_comps=%d work_ns=%lu msgs_per_comp=%lu steal_after_ns=%lu\n",
+      hot_comps, work_ns, msgs_per_comp, steal_after_ns);
+
+  HotComp* hot = ac_calloc(hot_comps, sizeof(HotComp));
+  AcComp* cold = ac_calloc(hot_comps, sizeof(AcComp));
+  error |= AC_TEST(hot != AC_NULL);
+  error |= AC_TEST(cold != AC_NULL);
+  AcCompMgrParams mgr_params = {
+    .max_component_threads = 2,
+    .max_components_per_thread = 2 * hot_comps,
+    .steal_after_ns = steal_after_ns,
+  };
+  error |= AC_TEST(AcCompMgr_init_params(&cm, &mgr_params) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  AcCompParams params = { .msg_budget = 16 };
+  for (AcU32 i = 0; i < hot_comps; i++) {
+    hot[i].comp.name = (AcU8*)"hot";
+    hot[i].comp.process_msg = hot_comp_process_msg;
+    hot[i].work_ticks = (work_ns * ac_tsc_freq()) / AC_SEC_IN_NS;
+    hot[i].remaining = msgs_per_comp;
+    hot[i].done = done;
+    error |= AC_TEST(AcMsgPool_init(&hot[i].mp, 2, 0) == AC_STATUS_OK);
+    error |= AC_TEST(AcCompMgr_add_comp_params(&cm, &hot[i].comp, &params) == AC_STATUS_OK);
+    error |= AC_TEST(hot[i].comp.ci.dtp == &cm.dtps[0]);
+
+    cold[i].name = (AcU8*)"cold";
+    cold[i].process_msg = idle_comp_process_msg;
+    error |= AC_TEST(AcCompMgr_add_comp(&cm, &cold[i]) == AC_STATUS_OK);
+    error |= AC_TEST(cold[i].ci.dtp == &cm.dtps[1]);
+  }
+
+  if (!error) {
+    AcU64 start = ac_tscrd();
+    for (AcU32 i = 0; i < hot_comps; i++) {
+      AcMsg* msg = AcMsgPool_get_msg(&hot[i].mp);
+      msg->op = DATA_CMD;
+      AcCompMgr_send_msg(&hot[i].comp, msg);
+    }
+    for (AcU32 i = 0; i < hot_comps; i++) {
+      AcReceptor_wait(done);
+    }
+    AcU64 ticks = ac_tscrd() - start;
+
+    AcU32 moved = 0;
+    for (AcU32 i = 0; i < hot_comps; i++) {
+      if (hot[i].comp.ci.dtp != &cm.dtps[0]) {
+        moved += 1;
+      }
+    }
+    AcU64 msgs = hot_comps * msgs_per_comp;
+    ac_printf("steal_perf: steal_after=%-7lu hot=%d work=%luns msgs=%lu time=%.6t"
+        " msgs/sec=%lu steals=%lu hot on thread 1=%d\n", steal_after_ns, hot_comps,
+        work_ns, msgs, ticks, (msgs * ac_tsc_freq()) / ticks,
+        __atomic_load_n(&cm.dtps[1].steals, __ATOMIC_RELAXED)
+          + __atomic_load_n(&cm.dtps[0].steals, __ATOMIC_RELAXED), moved);
+  }
+
+  for (AcU32 i = 0; i < hot_comps; i++) {
+    AcCompMgr_rmv_comp(&cold[i]);
+    AcCompMgr_rmv_comp(&hot[i].comp);
+    AcMsgPool_deinit(&hot[i].mp);
+  }
+  AcCompMgr_deinit(&cm);
+
+done:
+  ac_free(cold);
+  ac_free(hot);
+  AcReceptor_ret(done);
+
+  ac_debug_printf("steal_perf:-error=%d\n", error);
+  return error;
+}
+
+typedef struct PairComp {
+  AcComp comp;
+  AcComp* peer;
+  AcReceptor* done;
+} PairComp;
+
+/**
+ * Send the message back to our peer until its tag counts down to 0
+ */
+static AcBool pair_comp_process_msg(AcComp* ac, AcMsg* msg) {
+  PairComp* this = (PairComp*)ac;
+
+  if (msg->op == DATA_CMD) {
+    if (msg->tag == 0) {
+      AcMsgPool_ret_msg(msg);
+      AcReceptor_signal(this->done);
+    } else {
+      msg->tag -= 1;
+      AcCompMgr_send_msg(this->peer, msg);
+    }
+  } else {
+    AcMsgPool_ret_msg(msg);
+  }
+  return AC_TRUE;
+}
+
+/**
+ * Chatty pairs, each of pairs pairs of components bounces a message
+ * between them msgs_per_pair times. They're added a, b, a, b ... so
+ * each pair starts out split across the 2 threads, pairs must be a
+ * power of 2. Reports the throughput and, if colocating, the estimated
+ * sends within and across threads and how many components were moved.
+ */
+AcBool colocate_perf(AcU32 pairs, AcU64 msgs_per_pair, AcU64 colocate_ns) {
+  AcBool error = AC_FALSE;
+  AcCompMgr cm;
+  AcMsgPool mp;
+  AcReceptor* done = AcReceptor_get();
+
+  ac_debug_printf("colocate_perf:+pairs=%d msgs_per_pair=%lu colocate_ns=%lu\n",
+      pairs, msgs_per_pair, colocate_ns);
+
+  PairComp* a = ac_calloc(pairs, sizeof(PairComp));
+  PairComp* b = ac_calloc(pairs, sizeof(PairComp));
+  error |= AC_TEST(a != AC_NULL);
+  error |= AC_TEST(b != AC_NULL);
+  AcCompMgrParams mgr_params = {
+    .max_component_threads = 2,
+    .max_components_per_thread = 2 * pairs,
+    .colocate_ns = colocate_ns,
+  };
+  error |= AC_TEST(AcMsgPool_init(&mp, pairs, 0) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_init_params(&cm, &mgr_params) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  for (AcU32 i = 0; i < pairs; i++) {
+    a[i].comp.name = (AcU8*)"a";
+    a[i].comp.process_msg = pair_comp_process_msg;
+    a[i].peer = &b[i].comp;
+    a[i].done = done;
+    b[i].comp.name = (AcU8*)"b";
+    b[i].comp.process_msg = pair_comp_process_msg;
+    b[i].peer = &a[i].comp;
+    b[i].done = done;
+    error |= AC_TEST(AcCompMgr_add_comp(&cm, &a[i].comp) == AC_STATUS_OK);
+    error |= AC_TEST(AcCompMgr_add_comp(&cm, &b[i].comp) == AC_STATUS_OK);
+    error |= AC_TEST(a[i].comp.ci.dtp != b[i].comp.ci.dtp);
+  }
+
+  if (!error) {
+    AcU64 start = ac_tscrd();
+    for (AcU32 i = 0; i < pairs; i++) {
+      AcMsg* msg = AcMsgPool_get_msg(&mp);
+      msg->op = DATA_CMD;
+      msg->tag = msgs_per_pair;
+      AcCompMgr_send_msg(&a[i].comp, msg);
+    }
+    for (AcU32 i = 0; i < pairs; i++) {
+      AcReceptor_wait(done);
+    }
+    AcU64 ticks = ac_tscrd() - start;
+
+    AcU32 together = 0;
+    for (AcU32 i = 0; i < pairs; i++) {
+      if (a[i].comp.ci.dtp == b[i].comp.ci.dtp) {
+        together += 1;
+      }
+    }
+    AcCompMgrColocateStats stats;
+    AcCompMgr_get_colocate_stats(&cm, &stats);
+    AcU64 msgs = pairs * msgs_per_pair;
+    ac_printf("colocate_perf: colocate=%-7lu pairs=%d msgs=%lu time=%.6t msgs/sec=%lu"
+        " local=%lu cross=%lu colocations=%lu pairs together=%d\n", colocate_ns, pairs,
+        msgs, ticks, (msgs * ac_tsc_freq()) / ticks, stats.local_sends, stats.cross_sends,
+        stats.colocations, together);
+  }
+
+  for (AcU32 i = 0; i < pairs; i++) {
+    AcCompMgr_rmv_comp(&a[i].comp);
+    AcCompMgr_rmv_comp(&b[i].comp);
+  }
+  AcCompMgr_deinit(&cm);
+  AcMsgPool_deinit(&mp);
+
+done:
+  ac_free(b);
+  ac_free(a);
+  AcReceptor_ret(done);
+
+  ac_debug_printf("colocate_perf:-error=%d\n", error);
+  return error;
+}
+
+typedef struct NamedComp {
+  AcComp comp;
+  AcU8 name_buf[16];
+} NamedComp;
+
+/**
+ * Look up each of comp_count registered components by name, and as
+ * many names which aren't registered, rounds times and report the
+ * average time of a lookup.
+ */
+AcBool find_perf(AcU32 comp_count, AcU32 rounds) {
+  AcBool error = AC_FALSE;
+  AcCompMgr cm;
+  const AcU32 threads = 4;
+
+  ac_debug_printf("find_perf:+comp_count=%d rounds=%d\n", comp_count, rounds);
+
+  NamedComp* comps = ac_calloc(comp_count, sizeof(NamedComp));
+  NamedComp* missing = ac_calloc(comp_count, sizeof(NamedComp));
+  error |= AC_TEST(comps != AC_NULL);
+  error |= AC_TEST(missing != AC_NULL);
+  error |= AC_TEST(AcCompMgr_init(&cm, threads, AC_U32_DIV_ROUND_UP(comp_count, threads), 0)
+      == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  for (AcU32 i = 0; i < comp_count; i++) {
+    ac_snprintf(comps[i].name_buf, sizeof(comps[i].name_buf), "comp%d", i);
+    ac_snprintf(missing[i].name_buf, sizeof(missing[i].name_buf), "missing%d", i);
+    comps[i].comp.name = comps[i].name_buf;
+    comps[i].comp.process_msg = idle_comp_process_msg;
+    error |= AC_TEST(AcCompMgr_add_comp(&cm, &comps[i].comp) == AC_STATUS_OK);
+  }
+
+  if (!error) {
+    AcU64 start = ac_tscrd();
+    for (AcU32 r = 0; r < rounds; r++) {
+      for (AcU32 i = 0; i < comp_count; i++) {
+        error |= (AcCompMgr_find_comp(&cm, comps[i].name_buf) != &comps[i].comp);
+      }
+    }
+    AcU64 hit_ticks = ac_tscrd() - start;
+
+    start = ac_tscrd();
+    for (AcU32 r = 0; r < rounds; r++) {
+      for (AcU32 i = 0; i < comp_count; i++) {
+        error |= (AcCompMgr_find_comp(&cm, missing[i].name_buf) != AC_NULL);
+      }
+    }
+    AcU64 miss_ticks = ac_tscrd() - start;
+    error |= AC_TEST(!error);
+
+    AcU64 lookups = (AcU64)comp_count * rounds;
+    ac_printf("find_perf: comps=%-5d lookups=%lu hit=%.9t miss=%.9t per lookup\n",
+        comp_count, lookups, hit_ticks / lookups, miss_ticks / lookups);
+  }
+
+  for (AcU32 i = 0; i < comp_count; i++) {
+    AcCompMgr_rmv_comp(&comps[i].comp);
+  }
+  AcCompMgr_deinit(&cm);
+
+done:
+  ac_free(missing);
+  ac_free(comps);
+
+  ac_debug_printf("find_perf:-error=%d\n", error);
+  return error;
+}
+
+#define OPS_PROTOCOL 0x20
+#define OPS_START_CMD AC_OP(OPS_PROTOCOL + 1, AC_OPTYPE_CMD, 1)
+#define OPS_MAX 64
+#define OPS_BURST 256
+
+/** The operations, opcodes aren't consecutive as in most protocols */
+static AcU64 ops_cmds[OPS_MAX];
+static AcU32 ops_count;
+
+typedef struct OpsComp {
+  AcComp comp;
+  AcCompHandlers handlers;
+  AcMsgPool mp;
+  AcU64 remaining;            ///< Messages of the burst left to process
+  AcU64 start;                ///< Time the burst was queued
+  AcU64 ticks;                ///< Time processing bursts
+  AcReceptor* done;
+} OpsComp;
+
+static inline AcBool ops_comp_count(OpsComp* this, AcMsg* msg) {
+  AcMsgPool_ret_msg(msg);
+  this->remaining -= 1;
+  if (this->remaining == 0) {
+    this->ticks += ac_tscrd() - this->start;
+    AcReceptor_signal(this->done);
+  }
+  return AC_TRUE;
+}
+
+static AcBool ops_comp_handler(AcComp* ac, AcMsg* msg) {
+  return ops_comp_count((OpsComp*)ac, msg);
+}
+
+/**
+ * On OPS_START_CMD queue a burst of messages to ourself,
+ * cycling through the operations.
+ */
+static AcBool ops_comp_other(AcComp* ac, AcMsg* msg) {
+  OpsComp* this = (OpsComp*)ac;
+
+  if (msg->op == OPS_START_CMD) {
+    for (AcU32 i = 0; i < OPS_BURST; i++) {
+      AcMsg* burst_msg = AcMsgPool_get_msg(&this->mp);
+      burst_msg->op = ops_cmds[i % ops_count];
+      AcCompMgr_send_msg(&this->comp, burst_msg);
+    }
+    this->remaining = OPS_BURST;
+    this->start = ac_tscrd();
+  }
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+/**
+ * Compare each operation in turn, as a process_msg without handlers does
+ */
+static AcBool ops_comp_process_msg(AcComp* ac, AcMsg* msg) {
+  for (AcU32 i = 0; i < ops_count; i++) {
+    if (msg->op == ops_cmds[i]) {
+      return ops_comp_count((OpsComp*)ac, msg);
+    }
+  }
+  return ops_comp_other(ac, msg);
+}
+
+/**
+ * Have a component queue bursts of messages to itself, cycling through
+ * op_count operations, and find what to do with each either with
+ * handlers or by comparing operations in its process_msg. Reports the
+ * time taken to process each message.
+ */
+AcBool handlers_perf(AcBool use_handlers, AcU32 op_count, AcU32 bursts) {
+  AcBool error = AC_FALSE;
+  AcCompMgr cm;
+  AcMsgPool mp;
+  OpsComp oc = {
+    .comp.name = (AcU8*)"ops",
+    .comp.process_msg = use_handlers ? ops_comp_other : ops_comp_process_msg,
+    .done = AcReceptor_get(),
+  };
+
+  ac_debug_printf("handlers_perf:+use_handlers=%d op_count=%d bursts=%d\n",
+      use_handlers, op_count, bursts);
+
+  error |= AC_TEST(op_count <= OPS_MAX);
+  ops_count = (op_count <= OPS_MAX) ? op_count : OPS_MAX;
+  for (AcU32 i = 0; i < ops_count; i++) {
+    ops_cmds[i] = AC_OP(OPS_PROTOCOL, AC_OPTYPE_CMD, (i * 3) + 1);
+    if (use_handlers) {
+      error |= AC_TEST(AcCompHandlers_add(&oc.handlers, ops_cmds[i], ops_comp_handler)
+          == AC_STATUS_OK);
+    }
+  }
+  error |= AC_TEST(AcMsgPool_init(&mp, 1, 0) == AC_STATUS_OK);
+  error |= AC_TEST(AcMsgPool_init(&oc.mp, OPS_BURST, 0) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_init(&cm, 1, 1, 0) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+  AcCompParams params = { .handlers = use_handlers ? &oc.handlers : AC_NULL };
+  error |= AC_TEST(AcCompMgr_add_comp_params(&cm, &oc.comp, &params) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  for (AcU32 i = 0; i < bursts; i++) {
+    AcMsg* msg = AcMsgPool_get_msg(&mp);
+    msg->op = OPS_START_CMD;
+    AcCompMgr_send_msg(&oc.comp, msg);
+    AcReceptor_wait(oc.done);
+  }
+
+  AcU64 msgs = (AcU64)bursts * OPS_BURST;
+  ac_printf("handlers_perf: %s ops=%-2d msgs=%lu process=%.3Sns/msg\n",
+      use_handlers ? "handlers   " : "process_msg", ops_count, msgs,
+      (oc.ticks * AC_SEC_IN_NS) / msgs);
+
+  AcCompMgr_rmv_comp(&oc.comp);
+  AcCompMgr_deinit(&cm);
+  AcMsgPool_deinit(&oc.mp);
+  AcMsgPool_deinit(&mp);
+
+done:
+  AcCompHandlers_deinit(&oc.handlers);
+  AcReceptor_ret(oc.done);
+
+  ac_debug_printf("handlers_perf:-error=%d\n", error);
+  return error;
+}
+
+/**
+ * main
+ */
+int main(void) {
+  AcBool error = AC_FALSE;
+
+  // Room for a second set of dispatch threads, exited threads
+  // release their slot shortly after AcCompMgr_deinit returns.
+  ac_thread_init(10);
+  AcReceptor_init(50);
+  AcTime_init();
+
+  AcCompMgr cm;
+  error |= AC_TEST(AcCompMgr_init(&cm, 1, 1, 0) == AC_STATUS_OK);
+
+  if (!error) {
+    error |= lane_latency_perf(&cm, 1, 1000);
+    error |= lane_latency_perf(&cm, 2, 1000);
+
+    AcCompMgr_deinit(&cm);
+  }
+
+  error |= ping_pong_perf(1, 0, 0, AC_FALSE, 1000000);
+  error |= ping_pong_perf(2, 0, 0, AC_FALSE, 100000);
+  error |= ping_pong_perf(1, 64, 0, AC_FALSE, 100000);
+  error |= ping_pong_perf(1, 256, 0, AC_FALSE, 100000);
+
+  error |= ping_pong_perf(2, 0, 20000, AC_FALSE, 100000);
+  error |= ping_pong_perf(2, 0, 20000, AC_TRUE, 100000);
+
+  error |= doorbell_perf(1, 100000);
+  error |= doorbell_perf(16, 1000000);
+  error |= doorbell_perf(256, 1000000);
+
+  error |= steal_perf(4, 5000, 2000, 0);
+  error |= steal_perf(4, 5000, 2000, 1000000);
+  error |= steal_perf(4, 5000, 2000, 100000);
+
+  error |= colocate_perf(4, 100000, 0);
+  error |= colocate_perf(4, 100000, 1000000);
+
+  error |= find_perf(16, 10000);
+  error |= find_perf(10000, 100);
+
+  error |= handlers_perf(AC_FALSE, 4, 4096);
+  error |= handlers_perf(AC_TRUE, 4, 4096);
+  error |= handlers_perf(AC_FALSE, 64, 4096);
+  error |= handlers_perf(AC_TRUE, 64, 4096);
+
+  if (!error) {
+    ac_printf("OK\n");
+  }
+
+  return error;
+}
@@ -29,11 +29,282 @@
 #include <ac_status.h>
 #include <ac_string.h>
 #include <ac_thread.h>
+#include <ac_time.h>
+#include <ac_tsc.h>
 
 #if AC_PLATFORM == pc_x86_64
 extern void remove_zombies(void);
 #endif
 
+/**
+ * The managers with request tables, AcMsg_reply finds the manager of
+ * a request by its request_id. A request's tag is the gen of its
+ * entry in the high 32 bits, the request_id in the next 8 and the
+ * entry's index in mgr->requests in the low 24.
+ */
+#define REQUEST_MGRS 256
+#define REQUEST_MAX_ENTRIES (1 << 24)
+#define REQUEST_TAG(id, idx, gen) (((AcU64)(gen) << 32) | ((AcU64)(id) << 24) | (idx))
+#define REQUEST_TAG_GEN(tag) ((AcU32)((tag) >> 32))
+#define REQUEST_TAG_ID(tag) ((AcU32)(((tag) >> 24) & 0xFF))
+#define REQUEST_TAG_IDX(tag) ((AcU32)((tag) & (REQUEST_MAX_ENTRIES - 1)))
+static AcCompMgr* request_mgrs[REQUEST_MGRS];
+
+/**
+ * Free the entry of a request taken with gen, only one of the reply,
+ * a cancel or the requester's removal does so.
+ *
+ * @return: AC_TRUE if we freed it
+ */
+static inline ac_bool rmv_request(AcCompRequest* req, AcU32 gen) {
+  return __atomic_compare_exchange_n(&req->gen, &gen, gen + 1, AC_FALSE,
+      __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+/**
+ * Free the outstanding requests of the component in slot
+ *
+ * @return: the number freed
+ */
+static AcU32 rmv_requests(AcCompMgr* mgr, AcU32 slot) {
+  AcU32 count = 0;
+  AcCompRequest* requests = &mgr->requests[slot * mgr->max_requests];
+  for (AcU32 i = 0; i < mgr->max_requests; i++) {
+    AcU32 gen = __atomic_load_n(&requests[i].gen, __ATOMIC_ACQUIRE);
+    if (((gen & 1) != 0) && rmv_request(&requests[i], gen)) {
+      count += 1;
+    }
+  }
+  return count;
+}
+
+/**
+ * Wake the dispatch thread if it's parked. Only the sender which
+ * clears parked signals so waiting isn't signaled more than once.
+ * The loads of parked are SEQ_CST like those of the dispatcher so
+ * either the sender sees parked set or the dispatch thread sees the
+ * message when it looks again after setting parked.
+ */
+static inline void ring_doorbell(DispatchThreadParams* dtp) {
+  if (__atomic_load_n(&dtp->parked, __ATOMIC_SEQ_CST)
+      && __atomic_exchange_n(&dtp->parked, AC_FALSE, __ATOMIC_SEQ_CST)) {
+    __atomic_fetch_add(&dtp->doorbells, 1, __ATOMIC_RELAXED);
+    AcReceptor_signal(dtp->waiting);
+  }
+}
+
+/**
+ * Hint to the cpu that we're spinning
+ */
+static inline void cpu_relax(void) {
+#if defined(x86)
+  __builtin_ia32_pause();
+#endif
+}
+
+/**
+ * Return the dispatch thread we're running on or AC_NULL
+ */
+static DispatchThreadParams* cur_dtp(AcCompMgr* mgr) {
+  ac_thread_hdl_t hdl = ac_thread_get_cur_hdl();
+  for (AcU32 i = 0; (hdl != 0) && (i < mgr->max_dtps); i++) {
+    if (mgr->dtps[i].thread_hdl == hdl) {
+      return &mgr->dtps[i];
+    }
+  }
+  return AC_NULL;
+}
+
+/**
+ * Update the average idle time and the spin from it. The spin is
+ * twice the average so most arrivals are caught, unless that's more
+ * than spin_max_ticks in which case spinning isn't worthwhile.
+ */
+static void adapt_spin(DispatchThreadParams* params, AcU64 idle_ticks) {
+  AcS64 diff = (AcS64)idle_ticks - (AcS64)params->avg_idle_ticks;
+  params->avg_idle_ticks = (AcU64)((AcS64)params->avg_idle_ticks + (diff / 8));
+  AcU64 spin = params->avg_idle_ticks * 2;
+  params->spin_ticks = (spin <= params->spin_max_ticks) ? spin : 0;
+}
+
+/**
+ * Return AC_TRUE if comp is still managed by mgr, a peer may have
+ * been removed since it was recorded.
+ */
+static ac_bool is_managed(AcCompMgr* mgr, AcComp* comp) {
+  return (__atomic_load_n(&comp->ci.mgr, __ATOMIC_ACQUIRE) == mgr)
+    && (__atomic_load_n(&mgr->comps[comp->ci.comp_idx], __ATOMIC_ACQUIRE) == comp)
+    && (__atomic_load_n(&mgr->gens[comp->ci.comp_idx], __ATOMIC_ACQUIRE) == comp->ci.gen);
+}
+
+/**
+ * Components added with AcCompMgr_add_comp_on_thread stay put, nor
+ * is one being removed stolen as its generation has been bumped
+ */
+static AcBool can_steal(AcComp* comp) {
+  AcCompMgr* mgr = __atomic_load_n(&comp->ci.mgr, __ATOMIC_ACQUIRE);
+  return !comp->ci.pinned && (mgr != AC_NULL) && is_managed(mgr, comp);
+}
+
+/**
+ * Steal a component from a sibling which has been busy for at least
+ * steal_after_ticks and has others waiting. While we're stealing from
+ * it the victim's stealers is non zero so it won't return its
+ * dispatcher, see dispatch_thread.
+ *
+ * @return: AC_TRUE if a component was stolen
+ */
+static ac_bool steal(DispatchThreadParams* params) {
+  AcCompMgr* mgr = params->mgr;
+  AcU32 self = params - mgr->dtps;
+  AcU64 now = ac_tscrd();
+  AcComp* comp = AC_NULL;
+
+  for (AcU32 n = 1; (comp == AC_NULL) && (n < mgr->max_dtps); n++) {
+    DispatchThreadParams* victim = &mgr->dtps[(self + n) % mgr->max_dtps];
+    AcU64 busy_since = __atomic_load_n(&victim->busy_since, __ATOMIC_RELAXED);
+    if ((busy_since == 0) || ((now - busy_since) < params->steal_after_ticks)) {
+      continue;
+    }
+
+    __atomic_fetch_add(&victim->stealers, 1, __ATOMIC_SEQ_CST);
+    AcDispatcher* d = __atomic_load_n(&victim->d, __ATOMIC_ACQUIRE);
+    if ((d != AC_NULL)
+        && !__atomic_load_n(&victim->stop_processing_msgs, __ATOMIC_SEQ_CST)
+        && (AcDispatcher_ready_count(d) >= 2)) {
+      comp = AcDispatcher_steal(d, params->d, can_steal);
+      if (comp != AC_NULL) {
+        // If it's being removed the remover may have seen either
+        // dtp, but the counts are only a hint for placement
+        __atomic_store_n(&comp->ci.dtp, params, __ATOMIC_SEQ_CST);
+        __atomic_sub_fetch(&victim->comp_count, 1, __ATOMIC_RELEASE);
+        __atomic_add_fetch(&params->comp_count, 1, __ATOMIC_RELEASE);
+        __atomic_store_n(&params->steals, params->steals + 1, __ATOMIC_RELAXED);
+        ac_debug_printf("steal: %s from %d to %d\n", comp->name, victim - mgr->dtps, self);
+      }
+    }
+    __atomic_fetch_sub(&victim->stealers, 1, __ATOMIC_SEQ_CST);
+  }
+
+  return comp != AC_NULL;
+}
+
+/**
+ * We've been busy for steal_after_ticks with other components
+ * waiting, wake a parked sibling so it can steal one. This is
+ * done at most once every steal_after_ticks.
+ */
+static void wake_thief(DispatchThreadParams* params, AcU64 now) {
+  if ((params->steal_after_ticks == 0)
+      || ((now - params->busy_since) < params->steal_after_ticks)
+      || ((now - params->thief_woken) < params->steal_after_ticks)
+      || (AcDispatcher_ready_count(params->d) < 2)) {
+    return;
+  }
+  params->thief_woken = now;
+
+  // Like stealing we're a stealer so the sibling
+  // doesn't return its waiting receptor while we signal it
+  AcCompMgr* mgr = params->mgr;
+  AcU32 self = params - mgr->dtps;
+  ac_bool woken = AC_FALSE;
+  for (AcU32 n = 1; !woken && (n < mgr->max_dtps); n++) {
+    DispatchThreadParams* sibling = &mgr->dtps[(self + n) % mgr->max_dtps];
+    if (__atomic_load_n(&sibling->parked, __ATOMIC_SEQ_CST)) {
+      __atomic_fetch_add(&sibling->stealers, 1, __ATOMIC_SEQ_CST);
+      if (!__atomic_load_n(&sibling->stop_processing_msgs, __ATOMIC_SEQ_CST)) {
+        ring_doorbell(sibling);
+        woken = AC_TRUE;
+      }
+      __atomic_fetch_sub(&sibling->stealers, 1, __ATOMIC_SEQ_CST);
+    }
+  }
+}
+
+/**
+ * There are no messages, steal some or spin for a while if so
+ * configured and then park until a sender rings the doorbell.
+ */
+static void idle(DispatchThreadParams* params) {
+  if ((params->steal_after_ticks != 0) && steal(params)) {
+    return;
+  }
+
+  AcU64 start = ac_tscrd();
+
+  if (params->spin_ticks != 0) {
+    AcU64 now = start;
+    while ((now - start) < params->spin_ticks) {
+      if (AcDispatcher_ready(params->d)
+          || __atomic_load_n(&params->stop_processing_msgs, __ATOMIC_ACQUIRE)) {
+        __atomic_store_n(&params->spin_wakeups, params->spin_wakeups + 1,
+            __ATOMIC_RELAXED);
+        if (params->adaptive_spin) {
+          adapt_spin(params, now - start);
+        }
+        return;
+      }
+      cpu_relax();
+      now = ac_tscrd();
+    }
+  }
+
+  // Park, then look again for messages sent by
+  // senders which didn't see we were parked
+  __atomic_store_n(&params->parked, AC_TRUE, __ATOMIC_SEQ_CST);
+  if (AcDispatcher_dispatch(params->d)) {
+    // A sender may have seen we were parked, if so consume its signal
+    if (!__atomic_exchange_n(&params->parked, AC_FALSE, __ATOMIC_SEQ_CST)) {
+      AcReceptor_wait(params->waiting);
+    }
+  } else {
+    ac_debug_printf("dispatch_thread: waiting\n");
+    __atomic_store_n(&params->parks, params->parks + 1, __ATOMIC_RELAXED);
+    AcReceptor_wait(params->waiting);
+    __atomic_store_n(&params->parked, AC_FALSE, __ATOMIC_RELAXED);
+    ac_debug_printf("dispatch_thread: continuing\n");
+  }
+  if (params->adaptive_spin) {
+    adapt_spin(params, ac_tscrd() - start);
+  }
+}
+
+/** Dispatches between reading the tsc while there are messages */
+#define LOAD_SAMPLE_DISPATCHES 256
+
+/**
+ * If the load window has ended update msgs_per_sec and
+ * busy_permille and start a new one.
+ */
+static void update_load(DispatchThreadParams* params, AcU64 now) {
+  AcU64 elapsed = now - params->window_start;
+  if (elapsed >= params->load_window_ticks) {
+    AcU64 msgs = AcDispatcher_get_msgs(params->d);
+    AcU64 idle = (params->window_idle_ticks < elapsed) ? params->window_idle_ticks : elapsed;
+    AcU64 busy = ((elapsed - idle) * 1000) / elapsed;
+    __atomic_store_n(&params->msgs_per_sec,
+        ((msgs - params->window_start_msgs) * ac_tsc_freq()) / elapsed, __ATOMIC_RELAXED);
+    __atomic_store_n(&params->busy_permille, busy, __ATOMIC_RELAXED);
+    __atomic_store_n(&params->load_tsc, now, __ATOMIC_RELEASE);
+    params->window_start = now;
+    params->window_idle_ticks = 0;
+    params->window_start_msgs = msgs;
+  }
+}
+
+static void colocate(DispatchThreadParams* params, AcU64 now);
+static void index_rmv(AcCompMgr* mgr, AcComp* comp);
+
+/**
+ * If it's time regroup our components with their peers
+ */
+static inline void maybe_colocate(DispatchThreadParams* params, AcU64 now) {
+  AcU64 colocate_ticks = params->mgr->colocate_ticks;
+  if ((colocate_ticks != 0) && ((now - params->colocated) >= colocate_ticks)) {
+    colocate(params, now);
+  }
+}
+
 /**
  * A thread which dispatches message to its components.
  */
@@ -53,27 +324,65 @@ static void* dispatch_thread(void *param) {
   params->waiting = AcReceptor_get();
   ac_assert(params->waiting != AC_NULL);
   __atomic_store_n(&params->stop_processing_msgs, AC_FALSE, __ATOMIC_RELEASE);
+  __atomic_store_n(&params->parked, AC_FALSE, __ATOMIC_RELEASE);
+  params->window_start = ac_tscrd();
+  params->window_idle_ticks = 0;
+  params->window_start_msgs = 0;
+  __atomic_store_n(&params->load_tsc, params->window_start, __ATOMIC_RELEASE);
+  params->colocated = params->window_start;
+  params->thread_hdl = ac_thread_get_cur_hdl();
 
   // Signal dispatch_thread is ready
   AcReceptor_signal(params->ready);
 
   // Continuously dispatch messages until we're told to stop
+  // The time idle is measured, the rest is busy, so while there are
+  // messages the tsc is only read every LOAD_SAMPLE_DISPATCHES
+  // unless we're looking for thieves
+  AcU32 dispatches = 0;
+  __atomic_store_n(&params->busy_since, params->window_start, __ATOMIC_RELAXED);
   while (__atomic_load_n(&params->stop_processing_msgs, __ATOMIC_ACQUIRE) == AC_FALSE) {
-    if (!AcDispatcher_dispatch(params->d)) {
-      ac_debug_printf("dispatch_thread: waiting\n");
-      AcReceptor_wait(params->waiting);
-      ac_debug_printf("dispatch_thread: continuing\n");
+    __atomic_store_n(&params->quiescent, params->quiescent + 1, __ATOMIC_SEQ_CST);
+    if (AcDispatcher_dispatch(params->d)) {
+      if ((params->steal_after_ticks != 0) || ((++dispatches % LOAD_SAMPLE_DISPATCHES) == 0)) {
+        AcU64 now = ac_tscrd();
+        update_load(params, now);
+        wake_thief(params, now);
+        maybe_colocate(params, now);
+      }
+    } else {
+      __atomic_store_n(&params->busy_since, 0, __ATOMIC_RELAXED);
+      AcU64 idle_start = ac_tscrd();
+      idle(params);
+      AcU64 now = ac_tscrd();
+      __atomic_store_n(&params->busy_since, now, __ATOMIC_RELAXED);
+      params->window_idle_ticks += now - idle_start;
+      update_load(params, now);
+      maybe_colocate(params, now);
     }
   }
 
-  // Cleanup
-  for (ac_u32 j = 0; j < params->max_comps; j++) {
-    AcComp** pcomp = params->comps[j];
+  // Wait for siblings stealing from us, they see we're stopping
+  // after this so they won't start again
+  while (__atomic_load_n(&params->stealers, __ATOMIC_SEQ_CST) != 0) {
+    ac_thread_yield();
+  }
+
+  // Cleanup the components on this thread, which may have been
+  // stolen so aren't necessarily in our params->comps
+  AcCompMgr* mgr = params->mgr;
+  for (ac_u32 j = 0; j < mgr->comps_max_count; j++) {
+    AcComp** pcomp = &mgr->comps[j];
     AcComp* comp = __atomic_load_n(pcomp, __ATOMIC_ACQUIRE);
-    if ((comp != AC_NULL) &&
-        __atomic_compare_exchange_n(pcomp, &comp, AC_NULL, AC_TRUE, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+    AcU32 gen = (comp != AC_NULL) ? comp->ci.gen : 0;
+    if ((comp != AC_NULL)
+        && (__atomic_load_n(&comp->ci.dtp, __ATOMIC_SEQ_CST) == params)
+        && __atomic_compare_exchange_n(&mgr->gens[j], &gen, gen + 1, AC_FALSE,
+              __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
       ac_debug_printf("disptach_thread: call AcDispatcher_rmv_comp(%s)\n", comp->name);
-      AcDispatcher_rmv_comp(comp->ci.dtp->d, comp);
+      index_rmv(mgr, comp);
+      AcDispatcher_rmv_comp(params->d, comp);
+      __atomic_store_n(pcomp, AC_NULL, __ATOMIC_RELEASE);
     }
   }
   AcReceptor_ret(params->waiting);
@@ -93,30 +402,210 @@ done:
   return AC_NULL;
 }
 
+/**
+ * see ac_comp_mgr.h
+ */
+AcStatus AcCompHandlers_add(AcCompHandlers* handlers, AcU64 op, AcCompMsgProcessor handler) {
+  ac_debug_printf("AcCompHandlers_add:+handlers=%p op=%lx\n", handlers, op);
+  AcStatus status;
+
+  if ((handlers == AC_NULL) || (handler == AC_NULL)) {
+    status = AC_STATUS_BAD_PARAM;
+    goto done;
+  }
+
+  // Find the protocol's table, adding it if this is its first handler
+  AcU64 protocol = AC_GET_BITS(AcU64, op, 44, 20);
+  AcCompProtocolHandlers* ph = AC_NULL;
+  for (AcU32 i = 0; i < handlers->protocol_count; i++) {
+    if (handlers->protocols[i].protocol == protocol) {
+      ph = &handlers->protocols[i];
+      break;
+    }
+  }
+  if (ph == AC_NULL) {
+    AcU32 count = handlers->protocol_count;
+    AcCompProtocolHandlers* protocols = ac_malloc((count + 1) * sizeof(AcCompProtocolHandlers));
+    if (protocols == AC_NULL) {
+      status = AC_STATUS_OUT_OF_MEMORY;
+      goto done;
+    }
+    for (AcU32 i = 0; i < count; i++) {
+      protocols[i] = handlers->protocols[i];
+    }
+    ac_free(handlers->protocols);
+    handlers->protocols = protocols;
+    handlers->protocol_count = count + 1;
+    ph = &protocols[count];
+    ph->protocol = protocol;
+    ph->count = 0;
+    ph->handlers = AC_NULL;
+  }
+
+  // Grow the table so it covers op
+  AcU32 idx = AC_COMP_HANDLER_IDX(op);
+  if (idx >= ph->count) {
+    AcCompMsgProcessor* table = ac_calloc(idx + 1, sizeof(AcCompMsgProcessor));
+    if (table == AC_NULL) {
+      status = AC_STATUS_OUT_OF_MEMORY;
+      goto done;
+    }
+    for (AcU32 i = 0; i < ph->count; i++) {
+      table[i] = ph->handlers[i];
+    }
+    ac_free(ph->handlers);
+    ph->handlers = table;
+    ph->count = idx + 1;
+  }
+  ph->handlers[idx] = handler;
+  status = AC_STATUS_OK;
+
+done:
+  ac_debug_printf("AcCompHandlers_add:-handlers=%p op=%lx status=%u\n",
+      handlers, op, status);
+  return status;
+}
+
+/**
+ * see ac_comp_mgr.h
+ */
+void AcCompHandlers_deinit(AcCompHandlers* handlers) {
+  if (handlers != AC_NULL) {
+    for (AcU32 i = 0; i < handlers->protocol_count; i++) {
+      ac_free(handlers->protocols[i].handlers);
+    }
+    ac_free(handlers->protocols);
+    handlers->protocols = AC_NULL;
+    handlers->protocol_count = 0;
+  }
+}
+
+/**
+ * FNV-1a hash of name
+ *
+ * @param: len is set to the length of name
+ */
+static AcU32 hash_name(const ac_u8* name, ac_u32* len) {
+  AcU32 hash = 2166136261u;
+  ac_u32 i;
+  for (i = 0; name[i] != 0; i++) {
+    hash = (hash ^ name[i]) * 16777619u;
+  }
+  *len = i;
+  return hash;
+}
+
+/**
+ * Take index_busy, only one thread changes the index at a time
+ * while AcCompMgr_find_comp doesn't wait.
+ */
+static void index_lock(AcCompMgr* mgr) {
+  while (__atomic_test_and_set(&mgr->index_busy, __ATOMIC_ACQUIRE)) {
+    ac_thread_yield();
+  }
+}
+
+/**
+ * Release index_busy
+ */
+static void index_unlock(AcCompMgr* mgr) {
+  __atomic_clear(&mgr->index_busy, __ATOMIC_RELEASE);
+}
+
+/**
+ * Add comp to the index, taking the first empty entry. There's
+ * always one as the index has at least twice as many entries as
+ * mgr->comps and removal leaves no markers behind.
+ */
+static void index_add(AcCompMgr* mgr, AcComp* comp) {
+  ac_u32 len;
+  comp->ci.name_hash = hash_name(comp->name, &len);
+  index_lock(mgr);
+  for (AcU32 i = comp->ci.name_hash; ; i++) {
+    AcComp** pentry = &mgr->index[i & mgr->index_mask];
+    if (__atomic_load_n(pentry, __ATOMIC_RELAXED) == AC_NULL) {
+      __atomic_store_n(pentry, comp, __ATOMIC_RELEASE);
+      break;
+    }
+  }
+  index_unlock(mgr);
+}
+
+/**
+ * Remove comp from the index with backward shift deletion, entries
+ * after it which may be moved closer to their hash are, so the index
+ * never fills with removed entries and lookups stop at the first
+ * empty one. index_seq is odd meanwhile as a lookup may miss an
+ * entry being moved, see AcCompMgr_find_comp.
+ */
+static void index_rmv(AcCompMgr* mgr, AcComp* comp) {
+  index_lock(mgr);
+  AcU32 mask = mgr->index_mask;
+  AcU32 hole = comp->ci.name_hash & mask;
+  for (AcU32 n = 0; n <= mask; n++, hole = (hole + 1) & mask) {
+    AcComp* entry = __atomic_load_n(&mgr->index[hole], __ATOMIC_RELAXED);
+    if (entry == AC_NULL) {
+      // Not in the index
+      index_unlock(mgr);
+      return;
+    }
+    if (entry == comp) {
+      break;
+    }
+  }
+
+  __atomic_store_n(&mgr->index_seq, mgr->index_seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  for (AcU32 i = (hole + 1) & mask; ; i = (i + 1) & mask) {
+    AcComp* entry = __atomic_load_n(&mgr->index[i], __ATOMIC_RELAXED);
+    if (entry == AC_NULL) {
+      break;
+    }
+    // Leave entry if its hash is in (hole, i] as it'd be before hole
+    AcU32 home = entry->ci.name_hash & mask;
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      __atomic_store_n(&mgr->index[hole], entry, __ATOMIC_RELAXED);
+      hole = i;
+    }
+  }
+  __atomic_store_n(&mgr->index[hole], AC_NULL, __ATOMIC_RELAXED);
+  __atomic_store_n(&mgr->index_seq, mgr->index_seq + 1, __ATOMIC_RELEASE);
+  index_unlock(mgr);
+}
+
 /**
  * see ac_comp_mgr.h
  */
 AcComp* AcCompMgr_find_comp(AcCompMgr* mgr, ac_u8* name) {
   ac_debug_printf("AcCompMgr_find_comp:+name=%s\n", name);
   AcComp* comp = AC_NULL;
-  ac_bool found = AC_FALSE;
 
-  // Search the list CompInfos for the name
-  for (ac_u32 i = 0; i < mgr->comps_max_count; i++) {
-    comp = mgr->comps[i];
-    if (comp != AC_NULL) {
-      if (ac_strncmp((const char*)name,
-            (const char*)comp->name, ac_strlen((const char*)comp->name)) == 0) {
+  ac_u32 len;
+  AcU32 hash = hash_name(name, &len);
+  AcU32 seq;
+  do {
+    // Look again if entries were moved while we looked, see index_rmv
+    seq = __atomic_load_n(&mgr->index_seq, __ATOMIC_ACQUIRE);
+    if ((seq & 1) != 0) {
+      ac_thread_yield();
+      continue;
+    }
+    comp = AC_NULL;
+    for (AcU32 i = hash, n = 0; n <= mgr->index_mask; i++, n++) {
+      AcComp* entry = __atomic_load_n(&mgr->index[i & mgr->index_mask], __ATOMIC_ACQUIRE);
+      if (entry == AC_NULL) {
+        break;
+      }
+      if ((entry->ci.name_hash == hash)
+          && (ac_strncmp((const char*)name, (const char*)entry->name, len + 1) == 0)) {
         ac_debug_printf("AcCompMgr_find_comp: name=%s, found\n", name);
-        found = AC_TRUE;
+        comp = entry;
         break;
       }
     }
-  }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while ((seq & 1) || (__atomic_load_n(&mgr->index_seq, __ATOMIC_RELAXED) != seq));
 
-  if (!found) {
-    comp = AC_NULL;
-  }
   ac_debug_printf("AcCompMgr_find_comp:-name=%s comp=%p\n", name, comp);
   return comp;
 }
@@ -125,51 +614,474 @@ AcComp* AcCompMgr_find_comp(AcCompMgr* mgr, ac_u8* name) {
  * see ac_comp_mgr.h
  */
 AcStatus AcCompMgr_add_comp(AcCompMgr* mgr, AcComp* comp) {
-  AcStatus status = AC_STATUS_ERR;
-  ac_bool found = AC_FALSE;
-
-  for (ac_u32 thrd = 0; !found && (thrd < mgr->max_dtps); thrd++) {
-    // Search the dtps
-    ac_u32 idx = __atomic_fetch_add(&mgr->next_dtps, 1, __ATOMIC_RELEASE);
-    idx %= mgr->max_dtps;
-
-    DispatchThreadParams* dtp = &mgr->dtps[idx];
-    ac_debug_printf("AcCompMgr_add_comp:+comp=%p idx=%d dtp=%p dtp->d=%p dtp->max_comps=%d\n",
-        comp, idx, dtp, dtp->d, dtp->max_comps);
-
-    // Search the list Comps for an unused slot,
-    // i.e. mgr->comps[i] == AC_NULL
-    for (ac_u32 i = 0; i < dtp->max_comps; i++) {
-      AcComp** pcomp = dtp->comps[i];
-      AcComp* null_comp = AC_NULL;
-
-      if (__atomic_compare_exchange_n(pcomp, &null_comp, comp, AC_TRUE,
-            __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
-
-        // Found an empty entry add the component to the dispatcher
-        AcCompInfo* ci = &comp->ci;
-        ci->dc = AcDispatcher_add_comp(dtp->d, comp);
-        if (ci->dc == AC_NULL) {
-          ac_debug_printf("AcCompMgr_add_comp: %i dtp->d=%p, could not add comp=%p\n",
-              i, dtp->d, comp);
-        } else {
-          ac_debug_printf("AcCompMgr_add_comp: i=%d added *pcomp=%p comp=%s\n",
-              i, *pcomp, comp->name);
-          ci->mgr = mgr;
-          ci->comp_idx = dtp->comp_idx;
-          ci->dtp = dtp;
-          status = AC_STATUS_OK;
-          found = AC_TRUE;
-          break;
-        }
+  return AcCompMgr_add_comp_params(mgr, comp, AC_NULL);
+}
+
+/**
+ * see ac_comp_mgr.h
+ */
+AcStatus AcCompMgr_add_comp_bounded(AcCompMgr* mgr, AcComp* comp, AcU32 capacity,
+    AcU32 low_water) {
+  AcCompParams params = {
+    .capacity = capacity,
+    .low_water = low_water,
+  };
+  return AcCompMgr_add_comp_params(mgr, comp, &params);
+}
+
+/**
+ * Add comp to dtp's dispatcher. The slot in mgr->comps can be any
+ * free one, once added a component may be stolen or moved so the
+ * slots aren't tied to a thread.
+ *
+ * @return: AC_STATUS_OK or AC_STATUS_NOT_AVAILABLE if there was no room
+ */
+static AcStatus add_to_thread(AcCompMgr* mgr, DispatchThreadParams* dtp, AcComp* comp,
+    const AcCompParams* params, ac_bool pinned) {
+  ac_debug_printf("add_to_thread:+comp=%p dtp=%p dtp->d=%p dtp->max_comps=%d\n",
+      comp, dtp, dtp->d, dtp->max_comps);
+  AcStatus status = AC_STATUS_NOT_AVAILABLE;
+
+  // Reserve room on dtp before taking a slot, so we don't hold
+  // a slot another add to a thread with room could have used
+  if (__atomic_add_fetch(&dtp->comp_count, 1, __ATOMIC_ACQ_REL) > dtp->max_comps) {
+    __atomic_sub_fetch(&dtp->comp_count, 1, __ATOMIC_RELEASE);
+    goto done;
+  }
+
+  // Search the list Comps for an unused slot,
+  // i.e. mgr->comps[i] == AC_NULL
+  for (ac_u32 i = 0; i < mgr->comps_max_count; i++) {
+    AcComp** pcomp = &mgr->comps[i];
+    AcComp* null_comp = AC_NULL;
+
+    if (__atomic_compare_exchange_n(pcomp, &null_comp, comp, AC_TRUE,
+          __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+
+      // Found an empty entry add the component to the dispatcher,
+      // once it's added it may be stolen so initialize ci first
+      AcCompInfo* ci = &comp->ci;
+      ci->mgr = mgr;
+      ci->comp_idx = i;
+      ci->gen = __atomic_load_n(&mgr->gens[ci->comp_idx], __ATOMIC_SEQ_CST);
+      ci->dtp = dtp;
+      ci->pinned = pinned;
+      ci->sends = 0;
+      ac_memset(ci->peers, 0, sizeof(ci->peers));
+      ci->next_request = 0;
+      ci->dc = AcDispatcher_add_comp_params(dtp->d, comp, params);
+      if (ci->dc == AC_NULL) {
+        ac_debug_printf("add_to_thread: %i dtp->d=%p, could not add comp=%p\n",
+            i, dtp->d, comp);
+        ci->mgr = AC_NULL;
+        ci->dtp = AC_NULL;
+        __atomic_store_n(pcomp, AC_NULL, __ATOMIC_RELEASE);
+      } else {
+        ac_debug_printf("add_to_thread: i=%d added *pcomp=%p comp=%s\n",
+            i, *pcomp, comp->name);
+        index_add(mgr, comp);
+        status = AC_STATUS_OK;
+
+        // Kick the dispatch thread so AC_INIT_CMD is processed now
+        // rather than when the next message is sent
+        ring_doorbell(dtp);
       }
+      break;
+    }
+  }
+  if (status != AC_STATUS_OK) {
+    __atomic_sub_fetch(&dtp->comp_count, 1, __ATOMIC_RELEASE);
+  }
+
+done:
+  ac_debug_printf("add_to_thread:-comp=%p status=%u\n", comp, status);
+  return status;
+}
+
+/**
+ * Get the load of a dispatch thread. The windows only end between
+ * dispatches, so a thread that hasn't been idle for longer than a
+ * window, e.g. it's in one long dispatch, is busy and one that has
+ * been parked since its last window ended is idle, whatever they
+ * were doing then.
+ */
+static void get_load(DispatchThreadParams* dtp, AcCompMgrThreadLoad* load) {
+  AcU64 load_tsc = __atomic_load_n(&dtp->load_tsc, __ATOMIC_ACQUIRE);
+  AcU64 busy_since = __atomic_load_n(&dtp->busy_since, __ATOMIC_RELAXED);
+  AcU64 now = ac_tscrd();
+  load->comp_count = __atomic_load_n(&dtp->comp_count, __ATOMIC_ACQUIRE);
+  load->msgs_per_sec = __atomic_load_n(&dtp->msgs_per_sec, __ATOMIC_RELAXED);
+  load->busy_permille = __atomic_load_n(&dtp->busy_permille, __ATOMIC_RELAXED);
+  if ((busy_since != 0) && ((now - busy_since) > dtp->load_window_ticks)) {
+    load->busy_permille = 1000;
+  } else if (__atomic_load_n(&dtp->parked, __ATOMIC_ACQUIRE)
+      && ((now - load_tsc) > (2 * dtp->load_window_ticks))) {
+    load->msgs_per_sec = 0;
+    load->busy_permille = 0;
+  }
+}
+
+/**
+ * Return AC_TRUE if a is less loaded than b
+ */
+static ac_bool less_loaded(AcCompMgrThreadLoad* a, AcCompMgrThreadLoad* b) {
+  if ((a->busy_permille + AC_COMP_MGR_LOAD_BAND_PERMILLE) < b->busy_permille) {
+    return AC_TRUE;
+  }
+  if ((b->busy_permille + AC_COMP_MGR_LOAD_BAND_PERMILLE) < a->busy_permille) {
+    return AC_FALSE;
+  }
+  if (a->comp_count != b->comp_count) {
+    return a->comp_count < b->comp_count;
+  }
+  return a->msgs_per_sec < b->msgs_per_sec;
+}
+
+/**
+ * Return the least loaded thread with room for another component
+ * or AC_NULL if there are none. The search starts at a different
+ * thread each time so equally loaded threads take turns.
+ */
+static DispatchThreadParams* least_loaded(AcCompMgr* mgr) {
+  DispatchThreadParams* best = AC_NULL;
+  AcCompMgrThreadLoad best_load;
+
+  ac_u32 first = __atomic_fetch_add(&mgr->next_dtps, 1, __ATOMIC_RELEASE);
+  for (ac_u32 thrd = 0; thrd < mgr->max_dtps; thrd++) {
+    DispatchThreadParams* dtp = &mgr->dtps[(first + thrd) % mgr->max_dtps];
+    AcCompMgrThreadLoad load;
+    get_load(dtp, &load);
+    if (load.comp_count >= dtp->max_comps) {
+      continue;
+    }
+    if ((best == AC_NULL) || less_loaded(&load, &best_load)) {
+      best = dtp;
+      best_load = load;
     }
   }
+  return best;
+}
+
+/** Every this many sends to a component one is recorded, a power of 2 */
+#define COLOCATE_SAMPLE_SENDS 64
+
+/**
+ * Record a sampled send to comp. It's recorded in the peers of the
+ * component being processed on our thread, so only that thread writes
+ * them, unless we're not a dispatch thread in which case it's ignored.
+ * The peers are the heavy hitters, a peer not in the table replaces
+ * the one with the smallest count and is given its count plus one.
+ */
+static void record_send(AcCompMgr* mgr, AcComp* comp) {
+  DispatchThreadParams* dtp = cur_dtp(mgr);
+  if ((dtp == AC_NULL) || (dtp->d == AC_NULL)) {
+    return;
+  }
+  AcComp* from = AcDispatcher_current(dtp->d);
+  if ((from == AC_NULL) || (from == comp)) {
+    return;
+  }
+
+  if (__atomic_load_n(&comp->ci.dtp, __ATOMIC_RELAXED) == dtp) {
+    __atomic_store_n(&dtp->local_sends, dtp->local_sends + 1, __ATOMIC_RELAXED);
+  } else {
+    __atomic_store_n(&dtp->cross_sends, dtp->cross_sends + 1, __ATOMIC_RELAXED);
+  }
+
+  AcCompPeer* peers = from->ci.peers;
+  AcCompPeer* min = &peers[0];
+  for (AcU32 k = 0; k < AC_COMP_MGR_COLOCATE_PEERS; k++) {
+    AcCompPeer* peer = &peers[k];
+    AcU32 count = __atomic_load_n(&peer->count, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&peer->comp, __ATOMIC_RELAXED) == comp) {
+      __atomic_store_n(&peer->count, count + 1, __ATOMIC_RELAXED);
+      return;
+    }
+    if (count < __atomic_load_n(&min->count, __ATOMIC_RELAXED)) {
+      min = peer;
+    }
+  }
+  __atomic_store_n(&min->comp, comp, __ATOMIC_RELAXED);
+  __atomic_store_n(&min->count, min->count + 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Count a send to comp, every COLOCATE_SAMPLE_SENDS one is recorded.
+ * The count is racy if there are several senders, which only changes
+ * which sends are sampled.
+ */
+static inline void sample_send(AcComp* comp) {
+  AcCompMgr* mgr = comp->ci.mgr;
+  if ((mgr != AC_NULL) && (mgr->colocate_ticks != 0)) {
+    AcU32 sends = __atomic_load_n(&comp->ci.sends, __ATOMIC_RELAXED) + 1;
+    __atomic_store_n(&comp->ci.sends, sends, __ATOMIC_RELAXED);
+    if ((sends % COLOCATE_SAMPLE_SENDS) == 0) {
+      record_send(mgr, comp);
+    }
+  }
+}
+
+/**
+ * Return AC_TRUE if comp sends more than count to a peer on dtp,
+ * in which case it shouldn't be moved away from dtp.
+ */
+static ac_bool stays(AcCompMgr* mgr, AcComp* comp, DispatchThreadParams* dtp, AcU32 count) {
+  for (AcU32 k = 0; k < AC_COMP_MGR_COLOCATE_PEERS; k++) {
+    AcCompPeer* peer = &comp->ci.peers[k];
+    AcComp* pc = __atomic_load_n(&peer->comp, __ATOMIC_RELAXED);
+    if ((pc != AC_NULL)
+        && (__atomic_load_n(&peer->count, __ATOMIC_RELAXED) > count)
+        && is_managed(mgr, pc)
+        && (__atomic_load_n(&pc->ci.dtp, __ATOMIC_RELAXED) == dtp)) {
+      return AC_TRUE;
+    }
+  }
+  return AC_FALSE;
+}
+
+/**
+ * Return AC_TRUE if comp may be moved from its thread to dtp,
+ * whose load is given
+ */
+static ac_bool can_move(AcCompMgr* mgr, AcComp* comp, DispatchThreadParams* home,
+    DispatchThreadParams* dtp, AcCompMgrThreadLoad* load, AcU32 count) {
+  return !comp->ci.pinned
+    && (load->busy_permille < mgr->colocate_max_busy_permille)
+    && (load->comp_count < dtp->max_comps)
+    && !stays(mgr, comp, home, count);
+}
+
+/**
+ * Move comp from the thread from to the thread to, where peer is,
+ * we're one of them. The thread which isn't us is a stealer while
+ * we do so, so it doesn't return its dispatcher, see dispatch_thread,
+ * which is all AcDispatcher_move requires.
+ *
+ * Neither is moved once it's being removed, as like a sender its
+ * remover waits for us to finish a dispatch after bumping its
+ * generation, see wait_for_senders. AcDispatcher_move also gives
+ * up if it loses a race with a remover.
+ *
+ * @return: AC_TRUE if it was moved
+ */
+static ac_bool move(DispatchThreadParams* params, AcComp* comp, AcComp* peer,
+    DispatchThreadParams* from, DispatchThreadParams* to, AcU64 msgs_per_sec) {
+  AcCompMgr* mgr = params->mgr;
+  DispatchThreadParams* other = (from == params) ? to : from;
+  AcStatus status = AC_STATUS_NOT_AVAILABLE;
+
+  __atomic_fetch_add(&other->stealers, 1, __ATOMIC_SEQ_CST);
+  AcDispatcher* from_d = __atomic_load_n(&from->d, __ATOMIC_ACQUIRE);
+  AcDispatcher* to_d = __atomic_load_n(&to->d, __ATOMIC_ACQUIRE);
+  if ((from_d != AC_NULL) && (to_d != AC_NULL)
+      && !__atomic_load_n(&other->stop_processing_msgs, __ATOMIC_SEQ_CST)
+      && is_managed(mgr, comp) && is_managed(mgr, peer)) {
+    status = AcDispatcher_move(from_d, to_d, comp->ci.dc);
+    if (status == AC_STATUS_OK) {
+      __atomic_store_n(&comp->ci.dtp, to, __ATOMIC_SEQ_CST);
+      __atomic_sub_fetch(&from->comp_count, 1, __ATOMIC_RELEASE);
+      __atomic_add_fetch(&to->comp_count, 1, __ATOMIC_RELEASE);
+      ring_doorbell(to);
+    }
+  }
+  __atomic_fetch_sub(&other->stealers, 1, __ATOMIC_SEQ_CST);
+
+  if (status != AC_STATUS_OK) {
+    return AC_FALSE;
+  }
+  __atomic_store_n(&params->colocations, params->colocations + 1, __ATOMIC_RELAXED);
+  ac_debug_printf("move: %s from %d to %d with %s\n", comp->name,
+      from - mgr->dtps, to - mgr->dtps, peer->name);
+  if (mgr->colocated != AC_NULL) {
+    mgr->colocated(mgr, comp, peer, from - mgr->dtps, to - mgr->dtps, msgs_per_sec);
+  }
+  return AC_TRUE;
+}
+
+/**
+ * Regroup comp with the peer it sends to most if it's on another
+ * thread and they're sending enough. The less loaded of the two
+ * threads is chosen, or the one with the lower index if they're
+ * equally loaded, so if the peer is also looking at comp they
+ * both choose the same thread.
+ */
+static void regroup(DispatchThreadParams* params, AcComp* comp, AcU64 elapsed) {
+  AcCompMgr* mgr = params->mgr;
+  AcComp* peer = AC_NULL;
+  AcU32 count = 0;
+  for (AcU32 k = 0; k < AC_COMP_MGR_COLOCATE_PEERS; k++) {
+    AcCompPeer* p = &comp->ci.peers[k];
+    AcU32 c = __atomic_load_n(&p->count, __ATOMIC_RELAXED);
+    if (c > count) {
+      count = c;
+      peer = __atomic_load_n(&p->comp, __ATOMIC_RELAXED);
+    }
+  }
+  if ((peer == AC_NULL) || !is_managed(mgr, peer)) {
+    return;
+  }
+
+  AcU64 msgs_per_sec = (count * COLOCATE_SAMPLE_SENDS * ac_tsc_freq()) / elapsed;
+  DispatchThreadParams* other = __atomic_load_n(&peer->ci.dtp, __ATOMIC_SEQ_CST);
+  if ((msgs_per_sec < mgr->colocate_min_msgs_per_sec)
+      || (other == AC_NULL) || (other == params)) {
+    return;
+  }
+
+  AcCompMgrThreadLoad load;
+  AcCompMgrThreadLoad other_load;
+  get_load(params, &load);
+  get_load(other, &other_load);
+  if (less_loaded(&load, &other_load)
+      || (!less_loaded(&other_load, &load) && (params < other))) {
+    if (can_move(mgr, peer, other, params, &load, count)) {
+      move(params, peer, comp, other, params, msgs_per_sec);
+    }
+  } else if (can_move(mgr, comp, params, other, &other_load, count)) {
+    move(params, comp, peer, params, other, msgs_per_sec);
+  }
+}
+
+/**
+ * Regroup the components on our thread, their peers are then
+ * forgotten so next time only the sends since now are looked at.
+ */
+static void colocate(DispatchThreadParams* params, AcU64 now) {
+  AcCompMgr* mgr = params->mgr;
+  AcU64 elapsed = now - params->colocated;
+  params->colocated = now;
+
+  for (AcU32 j = 0; j < mgr->comps_max_count; j++) {
+    AcComp* comp = __atomic_load_n(&mgr->comps[j], __ATOMIC_ACQUIRE);
+    if ((comp != AC_NULL) && (__atomic_load_n(&comp->ci.dtp, __ATOMIC_SEQ_CST) == params)) {
+      regroup(params, comp, elapsed);
+      for (AcU32 k = 0; k < AC_COMP_MGR_COLOCATE_PEERS; k++) {
+        __atomic_store_n(&comp->ci.peers[k].count, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&comp->ci.peers[k].comp, AC_NULL, __ATOMIC_RELAXED);
+      }
+    }
+  }
+}
+
+/**
+ * Return AC_TRUE if params are valid
+ */
+static ac_bool valid_params(AcCompMgr* mgr, const AcCompParams* params) {
+  return (params == AC_NULL)
+    || !(((params->capacity != 0) && (params->low_water >= params->capacity))
+        || (params->lane_count > AC_DISPATCHER_MAX_LANES)
+        || ((params->parent != AC_NULL) && !is_managed(mgr, params->parent)));
+}
+
+/**
+ * see ac_comp_mgr.h
+ */
+AcStatus AcCompMgr_add_comp_params(AcCompMgr* mgr, AcComp* comp, const AcCompParams* params) {
+  ac_debug_printf("AcCompMgr_add_comp:+comp=%p\n", comp);
+  AcStatus status = AC_STATUS_NOT_AVAILABLE;
+
+  if (!valid_params(mgr, params)) {
+    return AC_STATUS_BAD_PARAM;
+  }
+
+  DispatchThreadParams* dtp = least_loaded(mgr);
+  if (dtp != AC_NULL) {
+    status = add_to_thread(mgr, dtp, comp, params, AC_FALSE);
+  }
+
+  // Another add may have taken the last slot on dtp, take any slot
+  for (ac_u32 thrd = 0; (status == AC_STATUS_NOT_AVAILABLE) && (thrd < mgr->max_dtps); thrd++) {
+    status = add_to_thread(mgr, &mgr->dtps[thrd], comp, params, AC_FALSE);
+  }
 
   ac_debug_printf("AcCompMgr_add_comp:-comp=%p status=%u\n", comp, status);
   return status;
 }
 
+/**
+ * see ac_comp_mgr.h
+ */
+AcStatus AcCompMgr_add_comp_on_thread(AcCompMgr* mgr, AcComp* comp, AcU32 thread,
+    const AcCompParams* params) {
+  if ((thread >= mgr->max_dtps) || !valid_params(mgr, params)) {
+    return AC_STATUS_BAD_PARAM;
+  }
+  return add_to_thread(mgr, &mgr->dtps[thread], comp, params, AC_TRUE);
+}
+
+/**
+ * see ac_comp_mgr.h
+ */
+AcStatus AcCompMgr_get_thread_load(AcCompMgr* mgr, AcU32 thread, AcCompMgrThreadLoad* load) {
+  if ((thread >= mgr->max_dtps) || (load == AC_NULL)) {
+    return AC_STATUS_BAD_PARAM;
+  }
+  get_load(&mgr->dtps[thread], load);
+  return AC_STATUS_OK;
+}
+
+/**
+ * see ac_comp_mgr.h
+ */
+AcStatus AcCompMgr_get_colocate_stats(AcCompMgr* mgr, AcCompMgrColocateStats* stats) {
+  if (stats == AC_NULL) {
+    return AC_STATUS_BAD_PARAM;
+  }
+  stats->local_sends = 0;
+  stats->cross_sends = 0;
+  stats->colocations = 0;
+  for (AcU32 i = 0; i < mgr->max_dtps; i++) {
+    DispatchThreadParams* dtp = &mgr->dtps[i];
+    stats->local_sends += __atomic_load_n(&dtp->local_sends, __ATOMIC_RELAXED) * COLOCATE_SAMPLE_SENDS;
+    stats->cross_sends += __atomic_load_n(&dtp->cross_sends, __ATOMIC_RELAXED) * COLOCATE_SAMPLE_SENDS;
+    stats->colocations += __atomic_load_n(&dtp->colocations, __ATOMIC_RELAXED);
+  }
+  return AC_STATUS_OK;
+}
+
+/**
+ * Wait until the senders which may have seen a component before it
+ * started being removed are done. Sends by components are made while
+ * dispatching, so once every other dispatch thread has started another
+ * dispatch they're done. A parked thread is woken so it does. While
+ * waiting we're not sending so if we're a dispatch thread we advance
+ * our own quiescent, others may be waiting for us.
+ */
+static void wait_for_senders(AcCompMgr* mgr) {
+  DispatchThreadParams* self = cur_dtp(mgr);
+  for (AcU32 i = 0; i < mgr->max_dtps; i++) {
+    DispatchThreadParams* dtp = &mgr->dtps[i];
+    if ((dtp == self) || !dtp->thread_started) {
+      continue;
+    }
+
+    // Like a stealer so it doesn't return its waiting receptor
+    __atomic_fetch_add(&dtp->stealers, 1, __ATOMIC_SEQ_CST);
+    AcU64 quiescent = __atomic_load_n(&dtp->quiescent, __ATOMIC_SEQ_CST);
+    while (!__atomic_load_n(&dtp->stop_processing_msgs, __ATOMIC_SEQ_CST)
+        && (__atomic_load_n(&dtp->quiescent, __ATOMIC_SEQ_CST) == quiescent)) {
+      if (self != AC_NULL) {
+        __atomic_store_n(&self->quiescent, self->quiescent + 1, __ATOMIC_SEQ_CST);
+      }
+      ring_doorbell(dtp);
+      ac_thread_yield();
+    }
+    __atomic_fetch_sub(&dtp->stealers, 1, __ATOMIC_SEQ_CST);
+  }
+}
+
+/**
+ * see ac_comp_mgr.h
+ */
+AcStatus AcCompMgr_get_handle(AcComp* comp, AcCompHandle* hdl) {
+  if ((comp == AC_NULL) || (comp->ci.mgr == AC_NULL) || (hdl == AC_NULL)) {
+    return AC_STATUS_BAD_PARAM;
+  }
+  hdl->slot = comp->ci.comp_idx;
+  hdl->gen = comp->ci.gen;
+  return AC_STATUS_OK;
+}
+
 /**
  * see ac_comp_mgr.h
  */
@@ -183,14 +1095,53 @@ AcStatus AcCompMgr_rmv_comp(AcComp* comp) {
 
   AcCompInfo* ci = &comp->ci;
 
-  AcComp** pcomp = &ci->mgr->comps[ci->comp_idx];
-  if (__atomic_compare_exchange_n(pcomp, &comp, AC_NULL, AC_TRUE, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
-    ac_debug_printf("AcCompMgr_rmv_comp: call AcDispatcher_rmv_comp(%s)\n", comp->name);
-    AcDispatcher_rmv_comp(comp->ci.dtp->d, comp);
+  AcCompMgr* mgr = ci->mgr;
+  AcComp** pcomp = &mgr->comps[ci->comp_idx];
+  AcU32 gen = ci->gen;
+  if (__atomic_compare_exchange_n(&mgr->gens[ci->comp_idx], &gen, gen + 1, AC_FALSE,
+        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+    // Handles are now stale, once the senders which saw them
+    // before are done no new messages will be sent to comp
+    index_rmv(mgr, comp);
+    wait_for_senders(mgr);
+
+    // Replies to its requests are now stale, free their entries
+    if (mgr->max_requests != 0) {
+      rmv_requests(mgr, ci->comp_idx);
+    }
+
+    // Retry if it was stolen while we were looking for it
+    AcDispatcher* d;
+    do {
+      d = AcDispatcher_owner(ci->dc);
+      ac_debug_printf("AcCompMgr_rmv_comp: call AcDispatcher_rmv_comp(%s)\n", comp->name);
+    } while ((AcDispatcher_rmv_comp(d, comp) != AC_STATUS_OK)
+        && (AcDispatcher_owner(ci->dc) != d));
+    for (ac_u32 i = 0; i < mgr->max_dtps; i++) {
+      if (mgr->dtps[i].d == d) {
+        __atomic_sub_fetch(&mgr->dtps[i].comp_count, 1, __ATOMIC_RELEASE);
+      }
+    }
     ci->dc = AC_NULL;
     ci->mgr = AC_NULL;
     ci->comp_idx = 0;
     ci->dtp = AC_NULL;
+    ci->pinned = AC_FALSE;
+
+    // Forget comp as a peer as it may be freed
+    if (mgr->colocate_ticks != 0) {
+      for (ac_u32 j = 0; j < mgr->comps_max_count; j++) {
+        AcComp* other = __atomic_load_n(&mgr->comps[j], __ATOMIC_ACQUIRE);
+        for (AcU32 k = 0; (other != AC_NULL) && (k < AC_COMP_MGR_COLOCATE_PEERS); k++) {
+          AcComp* expected = comp;
+          __atomic_compare_exchange_n(&other->ci.peers[k].comp, &expected, AC_NULL,
+              AC_FALSE, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        }
+      }
+    }
+
+    // The slot may now be reused
+    __atomic_store_n(pcomp, AC_NULL, __ATOMIC_RELEASE);
   }
 
   status = AC_STATUS_OK;
@@ -204,10 +1155,191 @@ done:
 /**
  * see ac_comp_mgr.h
  */
-void AcCompMgr_send_msg(AcComp* comp, AcMsg* msg) {
-  // TODO: Race with AcCompMgr_rmv_comp!!!!!
-  AcDispatcher_send_msg(comp->ci.dc, msg);
-  AcReceptor_signal(comp->ci.dtp->waiting);
+AcStatus AcCompMgr_send_msg(AcComp* comp, AcMsg* msg) {
+  // Components may race AcCompMgr_rmv_comp, see wait_for_senders
+  AcStatus status = AcDispatcher_send_msg(comp->ci.dc, msg);
+  if (status == AC_STATUS_OK) {
+    sample_send(comp);
+    ring_doorbell(__atomic_load_n(&comp->ci.dtp, __ATOMIC_SEQ_CST));
+  }
+  return status;
+}
+
+/**
+ * see ac_comp_mgr.h
+ */
+AcStatus AcCompMgr_send_msg_hdl(AcCompMgr* mgr, AcCompHandle hdl, AcMsg* msg) {
+  // Until the generation changes the slot holds the component, and
+  // once it's changed removal waits for component senders, see
+  // wait_for_senders, so the component isn't gone before we're done
+  if ((hdl.slot >= mgr->comps_max_count)
+      || (__atomic_load_n(&mgr->gens[hdl.slot], __ATOMIC_SEQ_CST) != hdl.gen)) {
+    return AC_STATUS_STALE_HANDLE;
+  }
+  AcComp* comp = __atomic_load_n(&mgr->comps[hdl.slot], __ATOMIC_ACQUIRE);
+  if (comp == AC_NULL) {
+    return AC_STATUS_STALE_HANDLE;
+  }
+  return AcCompMgr_send_msg(comp, msg);
+}
+
+/**
+ * see ac_comp_mgr.h
+ */
+AcStatus AcCompMgr_send_msg_lane(AcComp* comp, AcMsg* msg, AcU32 lane) {
+  // Components may race AcCompMgr_rmv_comp, see wait_for_senders
+  AcStatus status = AcDispatcher_send_msg_lane(comp->ci.dc, msg, lane);
+  if (status == AC_STATUS_OK) {
+    sample_send(comp);
+    ring_doorbell(__atomic_load_n(&comp->ci.dtp, __ATOMIC_SEQ_CST));
+  }
+  return status;
+}
+
+/**
+ * see ac_comp_mgr.h
+ */
+AcStatus AcCompMgr_request(AcComp* comp, AcMsg* msg, AcComp* reply_to) {
+  if ((comp == AC_NULL) || (msg == AC_NULL) || (reply_to == AC_NULL)) {
+    return AC_STATUS_BAD_PARAM;
+  }
+  AcCompMgr* mgr = __atomic_load_n(&reply_to->ci.mgr, __ATOMIC_ACQUIRE);
+  if ((mgr == AC_NULL) || !is_managed(mgr, reply_to)) {
+    return AC_STATUS_BAD_PARAM;
+  }
+
+  // Take a free entry, looking from after the last one taken
+  // as the oldest requests are usually the first responded to
+  AcU32 first = reply_to->ci.comp_idx * mgr->max_requests;
+  AcU32 idx = __atomic_load_n(&reply_to->ci.next_request, __ATOMIC_RELAXED);
+  AcCompRequest* req = AC_NULL;
+  AcU32 gen = 0;
+  for (AcU32 i = 0; i < mgr->max_requests; i++, idx++) {
+    if (idx >= mgr->max_requests) {
+      idx = 0;
+    }
+    gen = __atomic_load_n(&mgr->requests[first + idx].gen, __ATOMIC_RELAXED);
+    if (((gen & 1) == 0)
+        && __atomic_compare_exchange_n(&mgr->requests[first + idx].gen, &gen, gen + 1,
+              AC_FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      req = &mgr->requests[first + idx];
+      gen += 1;
+      __atomic_store_n(&reply_to->ci.next_request, idx + 1, __ATOMIC_RELAXED);
+      break;
+    }
+  }
+  if (req == AC_NULL) {
+    return AC_STATUS_QUEUE_FULL;
+  }
+
+  // The entry is published to the responder by sending msg
+  AcU64 tag = msg->tag;
+  __atomic_store_n(&req->tag, tag, __ATOMIC_RELAXED);
+  __atomic_store_n(&req->slot, reply_to->ci.comp_idx, __ATOMIC_RELAXED);
+  __atomic_store_n(&req->slot_gen, reply_to->ci.gen, __ATOMIC_RELAXED);
+  msg->tag = REQUEST_TAG(mgr->request_id, first + idx, gen);
+  AcStatus status = AcCompMgr_send_msg(comp, msg);
+  if (status != AC_STATUS_OK) {
+    msg->tag = tag;
+    rmv_request(req, gen);
+  }
+  return status;
+}
+
+/**
+ * see ac_comp_mgr.h
+ */
+AcStatus AcMsg_reply(AcMsg* msg, AcStatus status) {
+  if (msg == AC_NULL) {
+    return AC_STATUS_BAD_PARAM;
+  }
+
+  // Check the tag is one of ours before using it
+  AcU64 req_tag = msg->tag;
+  AcU32 id = REQUEST_TAG_ID(req_tag);
+  AcU32 idx = REQUEST_TAG_IDX(req_tag);
+  AcU32 gen = REQUEST_TAG_GEN(req_tag);
+  AcCompMgr* mgr = (id < REQUEST_MGRS)
+      ? __atomic_load_n(&request_mgrs[id], __ATOMIC_ACQUIRE) : AC_NULL;
+  if ((mgr == AC_NULL) || ((gen & 1) == 0)
+      || (idx >= (mgr->comps_max_count * mgr->max_requests))) {
+    return AC_STATUS_BAD_PARAM;
+  }
+
+  // Copy the entry then free it, if it was already freed, because
+  // it's been replied to or the requester was removed or cancelled
+  // it, what we copied may be from its next use so isn't used
+  AcCompRequest* req = &mgr->requests[idx];
+  AcU64 tag = __atomic_load_n(&req->tag, __ATOMIC_RELAXED);
+  AcCompHandle hdl = {
+    .slot = __atomic_load_n(&req->slot, __ATOMIC_RELAXED),
+    .gen = __atomic_load_n(&req->slot_gen, __ATOMIC_RELAXED),
+  };
+  if (!rmv_request(req, gen)) {
+    return AC_STATUS_STALE_HANDLE;
+  }
+
+  AcU64 op = msg->op;
+  AcStatus req_status = msg->status;
+  msg->op = AC_SET_BITS(AcU64, op, AC_OPTYPE_RSP, 2, 16);
+  msg->status = status;
+  msg->tag = tag;
+  AcStatus rsp_status = AcCompMgr_send_msg_hdl(mgr, hdl, msg);
+  if (rsp_status != AC_STATUS_OK) {
+    // Leave it as it was, the caller still owns it
+    msg->op = op;
+    msg->status = req_status;
+    msg->tag = req_tag;
+  }
+  return rsp_status;
+}
+
+/**
+ * see ac_comp_mgr.h
+ */
+AcU32 AcCompMgr_cancel_requests(AcComp* comp) {
+  AcCompMgr* mgr = (comp != AC_NULL) ? __atomic_load_n(&comp->ci.mgr, __ATOMIC_ACQUIRE) : AC_NULL;
+  if ((mgr == AC_NULL) || (mgr->max_requests == 0) || !is_managed(mgr, comp)) {
+    return 0;
+  }
+  return rmv_requests(mgr, comp->ci.comp_idx);
+}
+
+/**
+ * see ac_comp_mgr.h
+ */
+AcU32 AcCompMgr_get_outstanding(AcComp* comp) {
+  AcU32 count = 0;
+  AcCompMgr* mgr = (comp != AC_NULL) ? __atomic_load_n(&comp->ci.mgr, __ATOMIC_ACQUIRE) : AC_NULL;
+  if ((mgr != AC_NULL) && is_managed(mgr, comp)) {
+    AcCompRequest* requests = &mgr->requests[comp->ci.comp_idx * mgr->max_requests];
+    for (AcU32 i = 0; i < mgr->max_requests; i++) {
+      count += __atomic_load_n(&requests[i].gen, __ATOMIC_RELAXED) & 1;
+    }
+  }
+  return count;
+}
+
+/**
+ * see ac_comp_mgr.h
+ */
+AcStatus AcCompMgr_get_counters(AcComp* comp, AcCompCounters* counters) {
+  if ((comp == AC_NULL) || (comp->ci.dc == AC_NULL) || (counters == AC_NULL)) {
+    return AC_STATUS_BAD_PARAM;
+  }
+  AcDispatcher_get_counters(comp->ci.dc, counters);
+  return AC_STATUS_OK;
+}
+
+/**
+ * see ac_comp_mgr.h
+ */
+AcStatus AcCompMgr_send_msg_or_notify(AcComp* comp, AcMsg* msg, AcReceptor* space_available) {
+  AcStatus status = AcCompMgr_send_msg(comp, msg);
+  if (status == AC_STATUS_QUEUE_FULL) {
+    AcDispatcher_notify_when_not_full(comp->ci.dc, space_available);
+  }
+  return status;
 }
 
 /**
@@ -221,7 +1353,7 @@ void AcCompMgr_deinit(AcCompMgr* mgr) {
 
       if (dtp->thread_started) {
         // Stop the thread and kick it so it stops
-        __atomic_store_n(&dtp->stop_processing_msgs, AC_TRUE, __ATOMIC_RELEASE);
+        __atomic_store_n(&dtp->stop_processing_msgs, AC_TRUE, __ATOMIC_SEQ_CST);
         AcReceptor_signal(dtp->waiting);
 
         // Wait until the thread is done
@@ -230,12 +1362,6 @@ void AcCompMgr_deinit(AcCompMgr* mgr) {
         dtp->thread_started = AC_FALSE;
       }
 
-      if (dtp->comps != AC_NULL) {
-        ac_debug_printf("AcCompMgr_deinit: mgr=%p free dtp->comps=%p\n", mgr, dtp->comps);
-        ac_free(dtp->comps);
-        dtp->comps = AC_NULL;
-      }
-
       AcReceptor_ret(dtp->done);
       AcReceptor_ret(dtp->ready);
     }
@@ -252,6 +1378,25 @@ void AcCompMgr_deinit(AcCompMgr* mgr) {
       mgr->comps = AC_NULL;
     }
 
+    if (mgr->gens != AC_NULL) {
+      ac_debug_printf("AcCompMgr_deinit: mgr=%p free mgr->gens=%p\n", mgr, mgr->gens);
+      ac_free(mgr->gens);
+      mgr->gens = AC_NULL;
+    }
+
+    if (mgr->index != AC_NULL) {
+      ac_debug_printf("AcCompMgr_deinit: mgr=%p free mgr->index=%p\n", mgr, mgr->index);
+      ac_free(mgr->index);
+      mgr->index = AC_NULL;
+    }
+
+    if (mgr->requests != AC_NULL) {
+      ac_debug_printf("AcCompMgr_deinit: mgr=%p free mgr->requests=%p\n", mgr, mgr->requests);
+      __atomic_store_n(&request_mgrs[mgr->request_id], AC_NULL, __ATOMIC_RELEASE);
+      ac_free(mgr->requests);
+      mgr->requests = AC_NULL;
+    }
+
     if (mgr->dtps != AC_NULL) {
       ac_debug_printf("AcCompMgr_deinit: mgr=%p free mgr->dtps=%p\n", mgr, mgr->dtps);
       ac_free(mgr->dtps);
@@ -266,12 +1411,36 @@ void AcCompMgr_deinit(AcCompMgr* mgr) {
  */
 AcStatus AcCompMgr_init(AcCompMgr* mgr, ac_u32 max_component_threads, ac_u32 max_components_per_thread,
     ac_u32 stack_size) {
+  AcCompMgrParams params = {
+    .max_component_threads = max_component_threads,
+    .max_components_per_thread = max_components_per_thread,
+    .stack_size = stack_size,
+  };
+  return AcCompMgr_init_params(mgr, &params);
+}
+
+/**
+ * see ac_comp_mgr.h
+ */
+AcStatus AcCompMgr_init_params(AcCompMgr* mgr, const AcCompMgrParams* params) {
   AcStatus status;
+  ac_u32 max_component_threads = params->max_component_threads;
+  ac_u32 max_components_per_thread = params->max_components_per_thread;
+  ac_u32 stack_size = params->stack_size;
+  AcU64 spin_max_ticks = (params->spin_ns * ac_tsc_freq()) / AC_SEC_IN_NS;
 
   ac_memset(mgr, 0, sizeof(AcCompMgr));
   mgr->dtps = AC_NULL;
   mgr->comps = AC_NULL;
+  mgr->gens = AC_NULL;
+  mgr->index = AC_NULL;
+  mgr->requests = AC_NULL;
   mgr->max_dtps = max_component_threads;
+  mgr->colocate_ticks = (params->colocate_ns * ac_tsc_freq()) / AC_SEC_IN_NS;
+  mgr->colocate_max_busy_permille = (params->colocate_max_busy_permille != 0)
+    ? params->colocate_max_busy_permille : AC_COMP_MGR_COLOCATE_MAX_BUSY_PERMILLE;
+  mgr->colocate_min_msgs_per_sec = params->colocate_min_msgs_per_sec;
+  mgr->colocated = params->colocated;
   
 
   ac_debug_printf("AcCompMgr_init:+max_component_threads=%d max_components_per_thread=%d stack_size=%d\n",
@@ -301,29 +1470,83 @@ AcStatus AcCompMgr_init(AcCompMgr* mgr, ac_u32 max_component_threads, ac_u32 max
     status = AC_STATUS_OUT_OF_MEMORY;
     goto done;
   }
+  mgr->gens = ac_calloc(mgr->comps_max_count, sizeof(AcU32));
+  if (mgr->gens == AC_NULL) {
+    status = AC_STATUS_OUT_OF_MEMORY;
+    goto done;
+  }
+
+  // The index has at least twice as many entries as
+  // comps so probe sequences stay short
+  AcU32 index_count = 1;
+  while (index_count < (2 * mgr->comps_max_count)) {
+    index_count <<= 1;
+  }
+  mgr->index_mask = index_count - 1;
+  mgr->index = ac_calloc(index_count, sizeof(AcComp*));
+  if (mgr->index == AC_NULL) {
+    status = AC_STATUS_OUT_OF_MEMORY;
+    goto done;
+  }
+
+  // Each component's outstanding requests, see AcCompMgr_request
+  mgr->max_requests = params->max_requests_per_comp;
+  if (mgr->max_requests != 0) {
+    if (((AcU64)mgr->comps_max_count * mgr->max_requests) > REQUEST_MAX_ENTRIES) {
+      status = AC_STATUS_BAD_PARAM;
+      goto done;
+    }
+    mgr->requests = ac_calloc(mgr->comps_max_count * mgr->max_requests, sizeof(AcCompRequest));
+    if (mgr->requests == AC_NULL) {
+      status = AC_STATUS_OUT_OF_MEMORY;
+      goto done;
+    }
+    for (mgr->request_id = 0; mgr->request_id < REQUEST_MGRS; mgr->request_id++) {
+      AcCompMgr* none = AC_NULL;
+      if (__atomic_compare_exchange_n(&request_mgrs[mgr->request_id], &none, mgr,
+            AC_FALSE, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        break;
+      }
+    }
+    if (mgr->request_id == REQUEST_MGRS) {
+      ac_free(mgr->requests);
+      mgr->requests = AC_NULL;
+      status = AC_STATUS_NOT_AVAILABLE;
+      goto done;
+    }
+  }
 
   ac_debug_printf("AcCompMgr_init: loop\n");
   for (ac_u32 i = 0; i < mgr->max_dtps; i++) {
     DispatchThreadParams* dtp = &mgr->dtps[i];
     ac_debug_printf("AcCompMgr_init: dtps[%d]=%p\n", i, dtp);
     dtp->max_comps = max_components_per_thread;
-    dtp->comps = ac_calloc(dtp->max_comps, sizeof(AcComp*));
-    if (dtp->comps == AC_NULL) {
-      ac_debug_printf("AcCompMgr_init: i=%d\n dtp->cis == AC_NULL", i);
-      status = AC_STATUS_ERR;
-      goto done;
-    }
-    for (ac_u32 j = 0; j < dtp->max_comps; j++) {
-      ac_u32 comp_idx = (i * dtp->max_comps) + j;
-      AcComp** pcomp = &mgr->comps[comp_idx];
-      ac_debug_printf("AcCompMgr_init: i=%d j=%d comps_idx=%d pcomp=%p\n", i, j, comp_idx, pcomp);
-      dtp->comps[j] = pcomp;
-      dtp->comp_idx = comp_idx;
-    }
     dtp->done = AcReceptor_get();
     ac_assert(dtp->done != AC_NULL);
     dtp->ready = AcReceptor_get();
     ac_assert(dtp->ready != AC_NULL);
+    dtp->parked = AC_FALSE;
+    dtp->doorbells = 0;
+    dtp->parks = 0;
+    dtp->spin_max_ticks = spin_max_ticks;
+    dtp->spin_ticks = spin_max_ticks;
+    dtp->avg_idle_ticks = spin_max_ticks / 2;
+    dtp->adaptive_spin = params->adaptive_spin;
+    dtp->spin_wakeups = 0;
+    dtp->mgr = mgr;
+    dtp->steal_after_ticks = (params->steal_after_ns * ac_tsc_freq()) / AC_SEC_IN_NS;
+    dtp->thief_woken = 0;
+    dtp->stealers = 0;
+    dtp->steals = 0;
+    dtp->local_sends = 0;
+    dtp->cross_sends = 0;
+    dtp->colocations = 0;
+    dtp->quiescent = 0;
+    dtp->comp_count = 0;
+    dtp->busy_since = 0;
+    dtp->load_window_ticks = (AC_COMP_MGR_LOAD_WINDOW_NS * ac_tsc_freq()) / AC_SEC_IN_NS;
+    dtp->msgs_per_sec = 0;
+    dtp->busy_permille = 0;
 
     ac_thread_rslt_t rslt = ac_thread_create(stack_size, dispatch_thread, dtp);
     dtp->thread_started = rslt.status == 0;
@@ -31,4 +31,117 @@
  */
 ac_bool test_comps(AcCompMgr* cm, AcMsgPool* mp, ac_u32 comp_count);
 
+/**
+ * Test a component added with AcCompMgr_add_comp_bounded
+ * pushes back on its senders.
+ *
+ * @param: cm is AcCompMgr to use, must have a free slot
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_bounded_comp(AcCompMgr* cm);
+
+/**
+ * Test messages sent to AC_LANE_CONTROL are processed before
+ * those in AC_LANE_NORMAL, but AC_LANE_NORMAL isn't starved.
+ *
+ * @param: cm is AcCompMgr to use, must have a free slot
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_lanes(AcCompMgr* cm);
+
+/**
+ * Test a flooded component doesn't hold up its sibling
+ * beyond its msg_budget or tsc_budget.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_budget(void);
+
+/**
+ * Test messages are dispatched when the dispatch thread spins
+ * before parking and that an adaptive spin stops spinning when
+ * the time between messages is longer than spin_ns.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_spin(void);
+
+/**
+ * Test components are added to the least loaded thread and
+ * can be pinned to a thread.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_placement(void);
+
+/**
+ * Test an idle thread steals a component from a busy one and
+ * the stolen component's messages are processed in order, then
+ * components can still be added to the threads with room.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_steal(void);
+
+/**
+ * Test components removed while they're being stolen are removed
+ * once, get AC_DEINIT_CMD and aren't left in either dispatcher.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_rmv_during_steal(void);
+
+/**
+ * Test components which send each other many messages are moved
+ * to the same thread, unless they're pinned.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_colocate(void);
+
+/**
+ * Test pairs of components chatting across threads, so they're being
+ * regrouped, are removed once each, get AC_DEINIT_CMD and their
+ * messages are all returned.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_rmv_during_regroup(void);
+
+/**
+ * Test components are found by their exact name, including
+ * after others have been removed and added again.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_find(void);
+
+/**
+ * Test sends through a handle fail once its component is removed,
+ * also while a component is sending through it on another thread.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_handle(void);
+
+/**
+ * Test messages are processed by the handlers for their operation
+ * and those not processed are passed to the parent.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_handlers(void);
+
+/**
+ * Test requests are pipelined and each response is the request
+ * replied to in place, with the requester's tag. Bad tags are
+ * rejected and a reply which isn't sent, cancelled requests and
+ * a removed requester all free their entries.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_request(void);
+
 #endif
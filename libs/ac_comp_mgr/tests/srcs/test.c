@@ -63,6 +63,12 @@ ac_bool test_thread_comps(ac_u32 threads, ac_u32 comps_per_thread) {
   ac_debug_printf("test_%dx%d: second invocation of test_comps\n", threads, comps_per_thread);
   error |= AC_TEST(test_comps(&cm, &mp, threads * comps_per_thread) == AC_FALSE);
 
+  ac_debug_printf("test_%dx%d: bounded comp\n", threads, comps_per_thread);
+  error |= AC_TEST(test_bounded_comp(&cm) == AC_FALSE);
+
+  ac_debug_printf("test_%dx%d: lanes\n", threads, comps_per_thread);
+  error |= AC_TEST(test_lanes(&cm) == AC_FALSE);
+
   ac_debug_printf("test_%dx%d: deinit comp mgr\n", threads, comps_per_thread);
   AcCompMgr_deinit(&cm);
 
@@ -91,6 +97,17 @@ int main(void) {
   //error|= test_thread_comps(4, 1);
   //error|= test_thread_comps(4, 2);
   //error|= test_thread_comps(4, 4);
+  error|= test_budget();
+  error|= test_spin();
+  error|= test_placement();
+  error|= test_steal();
+  error|= test_rmv_during_steal();
+  error|= test_colocate();
+  error|= test_rmv_during_regroup();
+  error|= test_find();
+  error|= test_handle();
+  error|= test_handlers();
+  error|= test_request();
 #endif
 
   if (!error) {
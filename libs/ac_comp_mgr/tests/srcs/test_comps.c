@@ -24,11 +24,13 @@
 #include <ac_msg.h>
 #include <ac_msg_pool.h>
 #include <ac_debug_printf.h>
+#include <ac_dispatcher.h>
 #include <ac_printf.h>
 #include <ac_receptor.h>
 #include <ac_test.h>
 #include <ac_time.h>
 #include <ac_thread.h>
+#include <ac_tsc.h>
 
 typedef struct T1Comp {
   AcComp comp;
@@ -107,9 +109,13 @@ ac_bool test_comps(AcCompMgr* cm, AcMsgPool* mp, ac_u32 comp_count) {
       ac_u8 name[10];
       ac_snprintf(name, sizeof(name), "t%d", i);
       AcComp* comp = AcCompMgr_find_comp(cm, name);
-      error |=  AC_TEST(comp != AC_NULL);
+      error |=  AC_TEST(comp == &comps[i].comp);
     }
 
+    // Names must match exactly, not just a prefix
+    error |= AC_TEST(AcCompMgr_find_comp(cm, (ac_u8*)"t") == AC_NULL);
+    error |= AC_TEST(AcCompMgr_find_comp(cm, (ac_u8*)"t0x") == AC_NULL);
+
     ac_debug_printf("test_comps: send msgs\n");
     for (ac_u32 i = 0; i < comp_count; i++) {
       c = &comps[i];
@@ -136,6 +142,7 @@ ac_bool test_comps(AcCompMgr* cm, AcMsgPool* mp, ac_u32 comp_count) {
       ac_debug_printf("test_comps: remove %s\n", c->comp.name);
       AcReceptor_ret(c->done);
       error |= AC_TEST(AcCompMgr_rmv_comp(&c->comp) == AC_STATUS_OK);
+      error |= AC_TEST(AcCompMgr_find_comp(cm, c->name_buf) == AC_NULL);
     }
   }
 
@@ -145,3 +152,1784 @@ ac_bool test_comps(AcCompMgr* cm, AcMsgPool* mp, ac_u32 comp_count) {
       cm, mp, comp_count, error);
   return error;
 }
+
+typedef struct BoundedComp {
+  AcComp comp;
+  AcReceptor* ready;
+  AcReceptor* gate;
+  ac_u32 count;
+} BoundedComp;
+
+static ac_bool bounded_msg_proc(AcComp* ac, AcMsg* msg) {
+  BoundedComp* this = (BoundedComp*)ac;
+
+  if (msg->op == AC_INIT_CMD) {
+    AcReceptor_signal(this->ready);
+  } else if (msg->op != AC_DEINIT_CMD) {
+    // Hold up the dispatcher until the test opens the gate
+    AcReceptor_wait(this->gate);
+    this->count += 1;
+  }
+
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+/**
+ * Wait until comp has processed msgs messages, the depth of a
+ * bounded component has then dropped for each of them.
+ */
+static void wait_for_msgs(AcComp* comp, AcU64 msgs) {
+  AcCompCounters counters;
+  while ((AcCompMgr_get_counters(comp, &counters) == AC_STATUS_OK)
+      && (counters.msgs < msgs)) {
+    ac_thread_yield();
+  }
+}
+
+/**
+ * Test a component added with AcCompMgr_add_comp_bounded
+ * pushes back on its senders.
+ *
+ * @param: cm is AcCompMgr to use, must have a free slot
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_bounded_comp(AcCompMgr* cm) {
+  ac_debug_printf("test_bounded_comp:+cm=%p\n", cm);
+  ac_bool error = AC_FALSE;
+  const ac_u32 capacity = 4;
+  AcMsgPool mp;
+  AcMsg* msg;
+
+  BoundedComp bc = {
+    .comp.name = (ac_u8*)"bounded",
+    .comp.process_msg = bounded_msg_proc,
+    .ready = AcReceptor_get(),
+    .gate = AcReceptor_get(),
+    .count = 0,
+  };
+  AcReceptor* space_available = AcReceptor_get();
+
+  error |= AC_TEST(AcMsgPool_init(&mp, 8, 0) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_add_comp_bounded(cm, &bc.comp, 2, 2) == AC_STATUS_BAD_PARAM);
+  error |= AC_TEST(AcCompMgr_add_comp_bounded(cm, &bc.comp, capacity, 1) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+  AcReceptor_wait(bc.ready);
+  wait_for_msgs(&bc.comp, 1);
+
+  // The first message holds up the dispatcher so it and
+  // the next three fill the queue, AC_INIT_CMD isn't counted
+  for (ac_u32 i = 0; i < capacity; i++) {
+    msg = AcMsgPool_get_msg(&mp);
+    msg->op = AC_OP(0, 0, 1);
+    error |= AC_TEST(AcCompMgr_send_msg(&bc.comp, msg) == AC_STATUS_OK);
+  }
+  msg = AcMsgPool_get_msg(&mp);
+  msg->op = AC_OP(0, 0, 1);
+  error |= AC_TEST(AcCompMgr_send_msg(&bc.comp, msg) == AC_STATUS_QUEUE_FULL);
+  error |= AC_TEST(AcCompMgr_send_msg_or_notify(&bc.comp, msg, space_available)
+      == AC_STATUS_QUEUE_FULL);
+
+  // Let the messages be processed, once drained we'll be signaled
+  for (ac_u32 i = 0; i < capacity; i++) {
+    AcReceptor_signal(bc.gate);
+  }
+  AcReceptor_wait(space_available);
+  error |= AC_TEST(AcCompMgr_send_msg(&bc.comp, msg) == AC_STATUS_OK);
+  AcReceptor_signal(bc.gate);
+  wait_for_msgs(&bc.comp, capacity + 2);
+
+  error |= AC_TEST(AcCompMgr_rmv_comp(&bc.comp) == AC_STATUS_OK);
+  error |= AC_TEST(bc.count == capacity + 1);
+
+  AcMsgPool_deinit(&mp);
+
+done:
+  AcReceptor_ret(space_available);
+  AcReceptor_ret(bc.gate);
+  AcReceptor_ret(bc.ready);
+
+  ac_debug_printf("test_bounded_comp:-cm=%p error=%d\n", cm, error);
+  return error;
+}
+
+typedef struct LaneComp {
+  AcComp comp;
+  AcReceptor* ready;
+  AcReceptor* holding;
+  AcReceptor* gate;
+  AcReceptor* done;
+  ac_u32 count;
+  AcU64 tags[8];
+} LaneComp;
+
+static ac_bool lane_msg_proc(AcComp* ac, AcMsg* msg) {
+  LaneComp* this = (LaneComp*)ac;
+
+  if (msg->op == AC_INIT_CMD) {
+    AcReceptor_signal(this->ready);
+  } else if (msg->op != AC_DEINIT_CMD) {
+    if (msg->tag == 0) {
+      // Hold up the dispatcher so the other messages queue up
+      AcReceptor_signal(this->holding);
+      AcReceptor_wait(this->gate);
+    }
+    if (this->count < AC_ARRAY_COUNT(this->tags)) {
+      this->tags[this->count] = msg->tag;
+    }
+    this->count += 1;
+    if (this->count == AC_ARRAY_COUNT(this->tags)) {
+      AcReceptor_signal(this->done);
+    }
+  }
+
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+/**
+ * Test messages sent to AC_LANE_CONTROL are processed before
+ * those in AC_LANE_NORMAL, but AC_LANE_NORMAL isn't starved.
+ *
+ * @param: cm is AcCompMgr to use, must have a free slot
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_lanes(AcCompMgr* cm) {
+  ac_debug_printf("test_lanes:+cm=%p\n", cm);
+  ac_bool error = AC_FALSE;
+  AcMsgPool mp;
+
+  LaneComp lc = {
+    .comp.name = (ac_u8*)"lanes",
+    .comp.process_msg = lane_msg_proc,
+    .ready = AcReceptor_get(),
+    .holding = AcReceptor_get(),
+    .gate = AcReceptor_get(),
+    .done = AcReceptor_get(),
+    .count = 0,
+  };
+  AcCompParams params = {
+    .lane_count = 2,
+    .lane_quantum = 1,
+    .starvation_limit = 2,
+  };
+
+  // Normal messages have even tags and control messages odd ones,
+  // after the first normal message two control messages are
+  // processed and then a normal one is allowed through.
+  const AcU64 sent[] = { 0, 2, 4, 6, 1, 3, 5, 7 };
+  const AcU64 expected[] = { 0, 1, 3, 2, 5, 7, 4, 6 };
+
+  error |= AC_TEST(AcMsgPool_init(&mp, 8, 0) == AC_STATUS_OK);
+  params.lane_count = AC_DISPATCHER_MAX_LANES + 1;
+  error |= AC_TEST(AcCompMgr_add_comp_params(cm, &lc.comp, &params) == AC_STATUS_BAD_PARAM);
+  params.lane_count = 2;
+  error |= AC_TEST(AcCompMgr_add_comp_params(cm, &lc.comp, &params) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+  AcReceptor_wait(lc.ready);
+
+  for (ac_u32 i = 0; i < AC_ARRAY_COUNT(sent); i++) {
+    AcMsg* msg = AcMsgPool_get_msg(&mp);
+    msg->op = AC_OP(0, 0, 1);
+    msg->tag = sent[i];
+    AcU32 lane = ((sent[i] & 1) != 0) ? AC_LANE_CONTROL : AC_LANE_NORMAL;
+    error |= AC_TEST(AcCompMgr_send_msg_lane(&lc.comp, msg, lane) == AC_STATUS_OK);
+    if (i == 0) {
+      AcReceptor_wait(lc.holding);
+    }
+  }
+  AcReceptor_signal(lc.gate);
+  AcReceptor_wait(lc.done);
+
+  for (ac_u32 i = 0; i < AC_ARRAY_COUNT(expected); i++) {
+    error |= AC_TEST(lc.tags[i] == expected[i]);
+  }
+
+  error |= AC_TEST(AcCompMgr_rmv_comp(&lc.comp) == AC_STATUS_OK);
+
+  AcMsgPool_deinit(&mp);
+
+done:
+  AcReceptor_ret(lc.done);
+  AcReceptor_ret(lc.gate);
+  AcReceptor_ret(lc.holding);
+  AcReceptor_ret(lc.ready);
+
+  ac_debug_printf("test_lanes:-cm=%p error=%d\n", cm, error);
+  return error;
+}
+
+typedef struct FloodComp {
+  AcComp comp;
+  AcReceptor* ready;
+  AcReceptor* holding;
+  AcReceptor* gate;
+  AcReceptor* done;
+  AcU64 work_ticks;
+  ac_u32 count;
+  ac_u32 expected;
+} FloodComp;
+
+typedef struct SiblingComp {
+  AcComp comp;
+  AcReceptor* ready;
+  AcReceptor* done;
+  FloodComp* flood;
+  ac_u32 flood_count;   ///< flood->count when our message was processed
+} SiblingComp;
+
+static ac_bool flood_msg_proc(AcComp* ac, AcMsg* msg) {
+  FloodComp* this = (FloodComp*)ac;
+
+  if (msg->op == AC_INIT_CMD) {
+    AcReceptor_signal(this->ready);
+  } else if (msg->op != AC_DEINIT_CMD) {
+    if (this->count == 0) {
+      // Hold up the dispatcher so the other messages queue up
+      AcReceptor_signal(this->holding);
+      AcReceptor_wait(this->gate);
+    }
+    AcU64 start = ac_tscrd();
+    while ((ac_tscrd() - start) < this->work_ticks) {
+    }
+    this->count += 1;
+    if (this->count == this->expected) {
+      AcReceptor_signal(this->done);
+    }
+  }
+
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+static ac_bool sibling_msg_proc(AcComp* ac, AcMsg* msg) {
+  SiblingComp* this = (SiblingComp*)ac;
+
+  if (msg->op == AC_INIT_CMD) {
+    AcReceptor_signal(this->ready);
+  } else if (msg->op != AC_DEINIT_CMD) {
+    this->flood_count = this->flood->count;
+    AcReceptor_signal(this->done);
+  }
+
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+/**
+ * Flood a component with msg_count messages while a sibling on the
+ * same thread has one and return how many of the flood were processed
+ * before the sibling's message.
+ */
+static ac_bool flood_with_sibling(AcCompParams* params, AcU64 work_ticks,
+    ac_u32 msg_count, ac_u32* flood_count, AcCompCounters* counters) {
+  ac_bool error = AC_FALSE;
+  AcCompMgr cm;
+  AcMsgPool mp;
+
+  FloodComp fc = {
+    .comp.name = (ac_u8*)"flood",
+    .comp.process_msg = flood_msg_proc,
+    .ready = AcReceptor_get(),
+    .holding = AcReceptor_get(),
+    .gate = AcReceptor_get(),
+    .done = AcReceptor_get(),
+    .work_ticks = work_ticks,
+    .count = 0,
+    .expected = msg_count,
+  };
+  SiblingComp sc = {
+    .comp.name = (ac_u8*)"sibling",
+    .comp.process_msg = sibling_msg_proc,
+    .ready = AcReceptor_get(),
+    .done = AcReceptor_get(),
+    .flood = &fc,
+    .flood_count = 0,
+  };
+
+  // The pool's size must be a power of 2
+  ac_assert(msg_count < 128);
+  error |= AC_TEST(AcMsgPool_init(&mp, 128, 0) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_init(&cm, 1, 2, 0) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+  error |= AC_TEST(AcCompMgr_add_comp_params(&cm, &fc.comp, params) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_add_comp(&cm, &sc.comp) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+  AcReceptor_wait(fc.ready);
+  AcReceptor_wait(sc.ready);
+
+  // Hold the dispatcher in the first flood message while the
+  // rest of the flood and the sibling's message are queued
+  for (ac_u32 i = 0; i < msg_count; i++) {
+    AcMsg* msg = AcMsgPool_get_msg(&mp);
+    msg->op = AC_OP(0, 0, 1);
+    error |= AC_TEST(AcCompMgr_send_msg(&fc.comp, msg) == AC_STATUS_OK);
+    if (i == 0) {
+      AcReceptor_wait(fc.holding);
+    }
+  }
+  AcMsg* msg = AcMsgPool_get_msg(&mp);
+  msg->op = AC_OP(0, 0, 1);
+  error |= AC_TEST(AcCompMgr_send_msg(&sc.comp, msg) == AC_STATUS_OK);
+  AcReceptor_signal(fc.gate);
+
+  AcReceptor_wait(sc.done);
+  AcReceptor_wait(fc.done);
+  *flood_count = sc.flood_count;
+  error |= AC_TEST(AcCompMgr_get_counters(&fc.comp, counters) == AC_STATUS_OK);
+
+  error |= AC_TEST(AcCompMgr_rmv_comp(&sc.comp) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_rmv_comp(&fc.comp) == AC_STATUS_OK);
+  AcCompMgr_deinit(&cm);
+  AcMsgPool_deinit(&mp);
+
+done:
+  AcReceptor_ret(sc.done);
+  AcReceptor_ret(sc.ready);
+  AcReceptor_ret(fc.done);
+  AcReceptor_ret(fc.gate);
+  AcReceptor_ret(fc.holding);
+  AcReceptor_ret(fc.ready);
+
+  return error;
+}
+
+/**
+ * Test a flooded component doesn't hold up its sibling
+ * beyond its msg_budget or tsc_budget.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_budget(void) {
+  ac_debug_printf("test_budget:+\n");
+  ac_bool error = AC_FALSE;
+  AcCompCounters counters;
+  ac_u32 flood_count;
+
+  // Unlimited, the whole flood is processed first
+  AcCompParams params = { 0 };
+  error |= flood_with_sibling(&params, 0, 100, &flood_count, &counters);
+  error |= AC_TEST(flood_count == 100);
+  error |= AC_TEST(counters.budget_exhausted == 0);
+
+  // With a msg_budget of 10 the sibling is next after 10
+  params.msg_budget = 10;
+  error |= flood_with_sibling(&params, 0, 100, &flood_count, &counters);
+  error |= AC_TEST(flood_count == 10);
+  error |= AC_TEST(counters.budget_exhausted == 9);
+
+  // With a tsc_budget of 1ms and 100us per message the sibling
+  // is next after about 10, but allow for being preempted
+  params.msg_budget = 0;
+  params.tsc_budget = ac_tsc_freq() / 1000;
+  error |= flood_with_sibling(&params, ac_tsc_freq() / 10000, 100, &flood_count, &counters);
+  error |= AC_TEST((flood_count >= 1) && (flood_count < 100));
+  error |= AC_TEST(counters.budget_exhausted != 0);
+
+  ac_debug_printf("test_budget:-error=%d\n", error);
+  return error;
+}
+
+typedef struct SpinComp {
+  AcComp comp;
+  ac_u32 count;
+  AcReceptor* done;
+} SpinComp;
+
+static ac_bool spin_msg_proc(AcComp* ac, AcMsg* msg) {
+  SpinComp* this = (SpinComp*)ac;
+
+  if ((msg->op != AC_INIT_CMD) && (msg->op != AC_DEINIT_CMD)) {
+    this->count += 1;
+    AcReceptor_signal(this->done);
+  }
+
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+/**
+ * Test messages are dispatched when the dispatch thread spins
+ * before parking and that an adaptive spin stops spinning when
+ * the time between messages is longer than spin_ns.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_spin(void) {
+  ac_debug_printf("test_spin:+\n");
+  ac_bool error = AC_FALSE;
+  AcCompMgr cm;
+  AcMsgPool mp;
+
+  SpinComp sc = {
+    .comp.name = (ac_u8*)"spin",
+    .comp.process_msg = spin_msg_proc,
+    .count = 0,
+    .done = AcReceptor_get(),
+  };
+
+  AcCompMgrParams params = {
+    .max_component_threads = 1,
+    .max_components_per_thread = 1,
+    .spin_ns = 1000000,
+    .adaptive_spin = AC_TRUE,
+  };
+  error |= AC_TEST(AcMsgPool_init(&mp, 4, 0) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_init_params(&cm, &params) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+  error |= AC_TEST(AcCompMgr_add_comp(&cm, &sc.comp) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+  DispatchThreadParams* dtp = sc.comp.ci.dtp;
+  error |= AC_TEST(dtp->spin_max_ticks != 0);
+  error |= AC_TEST(dtp->spin_ticks == dtp->spin_max_ticks);
+
+  // Messages 5ms apart, longer than spin_ns, so spinning is stopped
+  for (ac_u32 i = 0; i < 10; i++) {
+    AcU64 start = ac_tscrd();
+    while ((ac_tscrd() - start) < (ac_tsc_freq() / 200)) {
+    }
+    AcMsg* msg = AcMsgPool_get_msg(&mp);
+    msg->op = AC_OP(0, 0, 1);
+    error |= AC_TEST(AcCompMgr_send_msg(&sc.comp, msg) == AC_STATUS_OK);
+    AcReceptor_wait(sc.done);
+  }
+  error |= AC_TEST(sc.count == 10);
+  error |= AC_TEST(__atomic_load_n(&dtp->spin_ticks, __ATOMIC_RELAXED) == 0);
+
+  error |= AC_TEST(AcCompMgr_rmv_comp(&sc.comp) == AC_STATUS_OK);
+  AcCompMgr_deinit(&cm);
+  AcMsgPool_deinit(&mp);
+
+done:
+  AcReceptor_ret(sc.done);
+
+  ac_debug_printf("test_spin:-error=%d\n", error);
+  return error;
+}
+
+static ac_bool idle_msg_proc(AcComp* ac, AcMsg* msg) {
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+typedef struct BusyComp {
+  AcComp comp;
+  AcMsgPool mp;
+  AcU64 work_ticks;
+  ac_bool stop;
+  AcReceptor* stopped;
+} BusyComp;
+
+/**
+ * Spin for work_ticks per message and send another to ourself
+ * until told to stop.
+ */
+static ac_bool busy_msg_proc(AcComp* ac, AcMsg* msg) {
+  BusyComp* this = (BusyComp*)ac;
+
+  if ((msg->op != AC_INIT_CMD) && (msg->op != AC_DEINIT_CMD)) {
+    AcU64 start = ac_tscrd();
+    while ((ac_tscrd() - start) < this->work_ticks) {
+    }
+    if (__atomic_load_n(&this->stop, __ATOMIC_ACQUIRE)) {
+      AcReceptor_signal(this->stopped);
+    } else {
+      AcCompMgr_send_msg(ac, msg);
+      return AC_TRUE;
+    }
+  }
+
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+/**
+ * Test components are added to the least loaded thread and
+ * can be pinned to a thread.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_placement(void) {
+  ac_debug_printf("test_placement:+\n");
+  ac_bool error = AC_FALSE;
+  AcCompMgr cm;
+  AcCompMgrThreadLoad load;
+
+  BusyComp busy = {
+    .comp.name = (ac_u8*)"busy",
+    .comp.process_msg = busy_msg_proc,
+    .work_ticks = ac_tsc_freq() / 100000,
+    .stop = AC_FALSE,
+    .stopped = AcReceptor_get(),
+  };
+  AcComp light1 = { .name = (ac_u8*)"light1", .process_msg = idle_msg_proc };
+  AcComp light2 = { .name = (ac_u8*)"light2", .process_msg = idle_msg_proc };
+  AcComp pinned = { .name = (ac_u8*)"pinned", .process_msg = idle_msg_proc };
+
+  error |= AC_TEST(AcMsgPool_init(&busy.mp, 4, 0) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_init(&cm, 2, 3, 0) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+  error |= AC_TEST(AcCompMgr_get_thread_load(&cm, 2, &load) == AC_STATUS_BAD_PARAM);
+  error |= AC_TEST(AcCompMgr_add_comp_on_thread(&cm, &pinned, 2, AC_NULL)
+      == AC_STATUS_BAD_PARAM);
+
+  // Start busy on thread 0 and let a few load windows pass, with
+  // a msg_budget so the dispatcher returns between its messages
+  AcCompParams params = { .msg_budget = 1 };
+  error |= AC_TEST(AcCompMgr_add_comp_on_thread(&cm, &busy.comp, 0, &params) == AC_STATUS_OK);
+  error |= AC_TEST(busy.comp.ci.dtp == &cm.dtps[0]);
+  AcMsg* msg = AcMsgPool_get_msg(&busy.mp);
+  msg->op = AC_OP(0, 0, 1);
+  error |= AC_TEST(AcCompMgr_send_msg(&busy.comp, msg) == AC_STATUS_OK);
+  AcU64 start = ac_tscrd();
+  AcU64 wait = (4 * AC_COMP_MGR_LOAD_WINDOW_NS * ac_tsc_freq()) / AC_SEC_IN_NS;
+  while ((ac_tscrd() - start) < wait) {
+  }
+
+  error |= AC_TEST(AcCompMgr_get_thread_load(&cm, 0, &load) == AC_STATUS_OK);
+  error |= AC_TEST(load.comp_count == 1);
+  error |= AC_TEST(load.busy_permille > 500);
+  error |= AC_TEST(load.msgs_per_sec != 0);
+  error |= AC_TEST(AcCompMgr_get_thread_load(&cm, 1, &load) == AC_STATUS_OK);
+  error |= AC_TEST(load.comp_count == 0);
+  error |= AC_TEST(load.busy_permille == 0);
+
+  // Round robin would put one of these on thread 0,
+  // both go to thread 1 as it isn't busy
+  error |= AC_TEST(AcCompMgr_add_comp(&cm, &light1) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_add_comp(&cm, &light2) == AC_STATUS_OK);
+  error |= AC_TEST(light1.ci.dtp == &cm.dtps[1]);
+  error |= AC_TEST(light2.ci.dtp == &cm.dtps[1]);
+
+  // Unless pinned
+  error |= AC_TEST(AcCompMgr_add_comp_on_thread(&cm, &pinned, 0, AC_NULL) == AC_STATUS_OK);
+  error |= AC_TEST(pinned.ci.dtp == &cm.dtps[0]);
+  error |= AC_TEST(pinned.ci.pinned);
+  error |= AC_TEST(AcCompMgr_get_thread_load(&cm, 0, &load) == AC_STATUS_OK);
+  error |= AC_TEST(load.comp_count == 2);
+
+  __atomic_store_n(&busy.stop, AC_TRUE, __ATOMIC_RELEASE);
+  AcReceptor_wait(busy.stopped);
+
+  error |= AC_TEST(AcCompMgr_rmv_comp(&pinned) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_rmv_comp(&light2) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_rmv_comp(&light1) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_rmv_comp(&busy.comp) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_get_thread_load(&cm, 1, &load) == AC_STATUS_OK);
+  error |= AC_TEST(load.comp_count == 0);
+  AcCompMgr_deinit(&cm);
+  AcMsgPool_deinit(&busy.mp);
+
+done:
+  AcReceptor_ret(busy.stopped);
+
+  ac_debug_printf("test_placement:-error=%d\n", error);
+  return error;
+}
+
+typedef struct SeqComp {
+  AcComp comp;
+  AcU64 work_ticks;
+  AcU64 expected;
+  AcU64 count;
+  ac_bool error;
+  AcReceptor* done;
+} SeqComp;
+
+/**
+ * Spin for work_ticks per message and check they arrive in order
+ */
+static ac_bool seq_msg_proc(AcComp* ac, AcMsg* msg) {
+  SeqComp* this = (SeqComp*)ac;
+
+  if ((msg->op != AC_INIT_CMD) && (msg->op != AC_DEINIT_CMD)) {
+    AcU64 start = ac_tscrd();
+    while ((ac_tscrd() - start) < this->work_ticks) {
+    }
+    this->error |= AC_TEST(msg->tag == this->count);
+    this->count += 1;
+    if (this->count == this->expected) {
+      AcReceptor_signal(this->done);
+    }
+  }
+
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+/**
+ * Test an idle thread steals a component from a busy one and
+ * the stolen component's messages are processed in order, then
+ * components can still be added to the threads with room.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_steal(void) {
+  ac_debug_printf("test_steal:+\n");
+  ac_bool error = AC_FALSE;
+  AcCompMgr cm;
+  AcMsgPool mp;
+  const AcU32 msg_count = 64;
+
+  BusyComp busy = {
+    .comp.name = (ac_u8*)"busy",
+    .comp.process_msg = busy_msg_proc,
+    .work_ticks = ac_tsc_freq() / 100000,
+    .stop = AC_FALSE,
+    .stopped = AcReceptor_get(),
+  };
+  SeqComp seq = {
+    .comp.name = (ac_u8*)"seq",
+    .comp.process_msg = seq_msg_proc,
+    .work_ticks = ac_tsc_freq() / 10000,
+    .expected = msg_count,
+    .count = 0,
+    .error = AC_FALSE,
+    .done = AcReceptor_get(),
+  };
+
+  AcCompMgrParams mgr_params = {
+    .max_component_threads = 2,
+    .max_components_per_thread = 2,
+    .steal_after_ns = 1000000,
+  };
+  error |= AC_TEST(AcMsgPool_init(&busy.mp, 4, 0) == AC_STATUS_OK);
+  error |= AC_TEST(AcMsgPool_init(&mp, msg_count, 0) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_init_params(&cm, &mgr_params) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  // Both on thread 0, busy is pinned so only seq can be stolen
+  AcCompParams params = { .msg_budget = 1 };
+  error |= AC_TEST(AcCompMgr_add_comp_params(&cm, &seq.comp, &params) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_add_comp_on_thread(&cm, &busy.comp, 0, &params) == AC_STATUS_OK);
+  error |= AC_TEST(seq.comp.ci.dtp == &cm.dtps[0]);
+  error |= AC_TEST(busy.comp.ci.dtp == &cm.dtps[0]);
+  if (error) {
+    goto done;
+  }
+
+  AcMsg* msg = AcMsgPool_get_msg(&busy.mp);
+  msg->op = AC_OP(0, 0, 1);
+  error |= AC_TEST(AcCompMgr_send_msg(&busy.comp, msg) == AC_STATUS_OK);
+  for (AcU32 i = 0; i < msg_count; i++) {
+    msg = AcMsgPool_get_msg(&mp);
+    msg->op = AC_OP(0, 0, 1);
+    msg->tag = i;
+    error |= AC_TEST(AcCompMgr_send_msg(&seq.comp, msg) == AC_STATUS_OK);
+  }
+  AcReceptor_wait(seq.done);
+  error |= seq.error;
+  error |= AC_TEST(seq.comp.ci.dtp == &cm.dtps[1]);
+  error |= AC_TEST(busy.comp.ci.dtp == &cm.dtps[0]);
+  error |= AC_TEST(__atomic_load_n(&cm.dtps[1].steals, __ATOMIC_RELAXED) == 1);
+
+  // The slot seq was added in doesn't stay with thread 0, so
+  // once thread 1 is full there's still room on thread 0
+  SeqComp x = { .comp.name = (ac_u8*)"x", .comp.process_msg = seq_msg_proc };
+  SeqComp y = { .comp.name = (ac_u8*)"y", .comp.process_msg = seq_msg_proc };
+  error |= AC_TEST(AcCompMgr_add_comp_on_thread(&cm, &x.comp, 1, AC_NULL) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_add_comp(&cm, &y.comp) == AC_STATUS_OK);
+  error |= AC_TEST(y.comp.ci.dtp == &cm.dtps[0]);
+
+  __atomic_store_n(&busy.stop, AC_TRUE, __ATOMIC_RELEASE);
+  AcReceptor_wait(busy.stopped);
+
+  error |= AC_TEST(AcCompMgr_rmv_comp(&y.comp) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_rmv_comp(&x.comp) == AC_STATUS_OK);
+
+  error |= AC_TEST(AcCompMgr_rmv_comp(&seq.comp) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_rmv_comp(&busy.comp) == AC_STATUS_OK);
+  AcCompMgrThreadLoad load;
+  error |= AC_TEST(AcCompMgr_get_thread_load(&cm, 0, &load) == AC_STATUS_OK);
+  error |= AC_TEST(load.comp_count == 0);
+  error |= AC_TEST(AcCompMgr_get_thread_load(&cm, 1, &load) == AC_STATUS_OK);
+  error |= AC_TEST(load.comp_count == 0);
+  AcCompMgr_deinit(&cm);
+  AcMsgPool_deinit(&mp);
+  AcMsgPool_deinit(&busy.mp);
+
+done:
+  AcReceptor_ret(seq.done);
+  AcReceptor_ret(busy.stopped);
+
+  ac_debug_printf("test_steal:-error=%d\n", error);
+  return error;
+}
+
+typedef struct RmvComp {
+  AcComp comp;
+  AcU32 deinit_count;
+  AcDispatchableComp* dc;
+} RmvComp;
+
+/**
+ * Count the AC_DEINIT_CMD's, which may arrive on the stealer's thread
+ */
+static ac_bool rmv_msg_proc(AcComp* ac, AcMsg* msg) {
+  RmvComp* this = (RmvComp*)ac;
+
+  if (msg->op == AC_DEINIT_CMD) {
+    __atomic_add_fetch(&this->deinit_count, 1, __ATOMIC_RELEASE);
+  }
+
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+typedef struct Stealer {
+  AcDispatcher* a;
+  AcDispatcher* b;
+  AcBool stop;
+  AcU32 steals;
+  AcReceptor* stopped;
+} Stealer;
+
+/**
+ * Steal back and forth between a and b until stopped, as the only
+ * thread dispatching either of them
+ */
+static void* stealer(void* param) {
+  Stealer* s = (Stealer*)param;
+
+  while (!__atomic_load_n(&s->stop, __ATOMIC_ACQUIRE)) {
+    if (AcDispatcher_steal(s->a, s->b, AC_NULL) != AC_NULL) {
+      s->steals += 1;
+    }
+    if (AcDispatcher_steal(s->b, s->a, AC_NULL) != AC_NULL) {
+      s->steals += 1;
+    }
+  }
+
+  AcReceptor_signal(s->stopped);
+  return AC_NULL;
+}
+
+/**
+ * Test components removed while they're being stolen are removed
+ * once, get AC_DEINIT_CMD and aren't left in either dispatcher.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_rmv_during_steal(void) {
+  ac_debug_printf("test_rmv_during_steal:+\n");
+  ac_bool error = AC_FALSE;
+  const AcU32 rounds = 200;
+  RmvComp comps[8];
+  const AcU32 comp_count = AC_ARRAY_COUNT(comps);
+
+  Stealer s = {
+    .a = AcDispatcher_get(comp_count),
+    .b = AcDispatcher_get(comp_count),
+    .stop = AC_FALSE,
+    .steals = 0,
+    .stopped = AcReceptor_get(),
+  };
+  error |= AC_TEST(s.a != AC_NULL);
+  error |= AC_TEST(s.b != AC_NULL);
+  if (error) {
+    goto done;
+  }
+
+  ac_thread_rslt_t rslt = ac_thread_create(0, stealer, &s);
+  error |= AC_TEST(rslt.status == 0);
+  if (error) {
+    goto done;
+  }
+
+  for (AcU32 r = 0; r < rounds; r++) {
+    // The AC_INIT_CMD each is sent makes them ready to be stolen.
+    // The adds don't fail, a steal from b only reserves a slot in a
+    // once it's claimed one of these, so there's room for the rest.
+    for (AcU32 i = 0; i < comp_count; i++) {
+      comps[i].comp.name = (ac_u8*)"rmv";
+      comps[i].comp.process_msg = rmv_msg_proc;
+      comps[i].deinit_count = 0;
+      comps[i].dc = AcDispatcher_add_comp(s.a, &comps[i].comp);
+      error |= AC_TEST(comps[i].dc != AC_NULL);
+    }
+    if (error) {
+      break;
+    }
+
+    // Remove them as AcCompMgr_rmv_comp does, retrying if stolen
+    for (AcU32 i = 0; i < comp_count; i++) {
+      AcDispatcher* d;
+      do {
+        d = AcDispatcher_owner(comps[i].dc);
+      } while ((AcDispatcher_rmv_comp(d, &comps[i].comp) != AC_STATUS_OK)
+          && (AcDispatcher_owner(comps[i].dc) != d));
+    }
+
+    // A removal the stealer finished may still be in progress
+    AcU64 start = ac_tscrd();
+    for (AcU32 i = 0; i < comp_count; i++) {
+      while ((__atomic_load_n(&comps[i].deinit_count, __ATOMIC_ACQUIRE) == 0)
+          && ((ac_tscrd() - start) < ac_tsc_freq())) {
+        ac_thread_yield();
+      }
+    }
+    for (AcU32 i = 0; i < comp_count; i++) {
+      error |= AC_TEST(__atomic_load_n(&comps[i].deinit_count, __ATOMIC_ACQUIRE) == 1);
+      error |= AC_TEST(AcDispatcher_rmv_comp(s.a, &comps[i].comp) != AC_STATUS_OK);
+      error |= AC_TEST(AcDispatcher_rmv_comp(s.b, &comps[i].comp) != AC_STATUS_OK);
+    }
+  }
+
+  __atomic_store_n(&s.stop, AC_TRUE, __ATOMIC_RELEASE);
+  AcReceptor_wait(s.stopped);
+  ac_debug_printf("test_rmv_during_steal: steals=%u\n", s.steals);
+
+done:
+  AcDispatcher_ret(s.a);
+  AcDispatcher_ret(s.b);
+  AcReceptor_ret(s.stopped);
+
+  ac_debug_printf("test_rmv_during_steal:-error=%d\n", error);
+  return error;
+}
+
+typedef struct ChatComp {
+  AcComp comp;
+  AcComp* peer;
+  ac_bool stop;
+  AcReceptor* stopped;
+} ChatComp;
+
+/**
+ * Send each message back to our peer until stopped
+ */
+static ac_bool chat_msg_proc(AcComp* ac, AcMsg* msg) {
+  ChatComp* this = (ChatComp*)ac;
+
+  if ((msg->op == AC_INIT_CMD) || (msg->op == AC_DEINIT_CMD)) {
+    AcMsgPool_ret_msg(msg);
+  } else if (__atomic_load_n(&this->stop, __ATOMIC_ACQUIRE)) {
+    AcMsgPool_ret_msg(msg);
+    AcReceptor_signal(this->stopped);
+  } else {
+    AcCompMgr_send_msg(this->peer, msg);
+  }
+  return AC_TRUE;
+}
+
+static AcU32 colocated_count;
+static AcComp* colocated_comp;
+static AcComp* colocated_peer;
+static AcU32 colocated_to;
+
+/**
+ * Remember the last move
+ */
+static void colocated(AcCompMgr* mgr, AcComp* comp, AcComp* peer,
+    AcU32 from_thread, AcU32 to_thread, AcU64 msgs_per_sec) {
+  ac_debug_printf("colocated: %s from %d to %d with %s msgs_per_sec=%lu\n",
+      comp->name, from_thread, to_thread, peer->name, msgs_per_sec);
+  colocated_comp = comp;
+  colocated_peer = peer;
+  colocated_to = to_thread;
+  __atomic_add_fetch(&colocated_count, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Have two components on different threads chat for up to a second,
+ * unless pinned they should end up on the same thread after which
+ * their sends should be local.
+ *
+ * @return: AC_TRUE if an error
+ */
+static ac_bool chat(ac_bool pinned) {
+  ac_bool error = AC_FALSE;
+  AcCompMgr cm;
+  AcMsgPool mp;
+
+  ChatComp ping = {
+    .comp.name = (ac_u8*)"ping",
+    .comp.process_msg = chat_msg_proc,
+    .stop = AC_FALSE,
+    .stopped = AcReceptor_get(),
+  };
+  ChatComp pong = {
+    .comp.name = (ac_u8*)"pong",
+    .comp.process_msg = chat_msg_proc,
+    .stop = AC_FALSE,
+    .stopped = ping.stopped,
+  };
+  ping.peer = &pong.comp;
+  pong.peer = &ping.comp;
+
+  AcCompMgrParams mgr_params = {
+    .max_component_threads = 2,
+    .max_components_per_thread = 2,
+    .colocate_ns = 2000000,
+    .colocate_min_msgs_per_sec = 1000,
+    .colocated = colocated,
+  };
+  colocated_count = 0;
+  error |= AC_TEST(AcMsgPool_init(&mp, 1, 0) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_init_params(&cm, &mgr_params) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  if (pinned) {
+    error |= AC_TEST(AcCompMgr_add_comp_on_thread(&cm, &ping.comp, 0, AC_NULL) == AC_STATUS_OK);
+    error |= AC_TEST(AcCompMgr_add_comp_on_thread(&cm, &pong.comp, 1, AC_NULL) == AC_STATUS_OK);
+  } else {
+    error |= AC_TEST(AcCompMgr_add_comp(&cm, &ping.comp) == AC_STATUS_OK);
+    error |= AC_TEST(AcCompMgr_add_comp(&cm, &pong.comp) == AC_STATUS_OK);
+  }
+  error |= AC_TEST(ping.comp.ci.dtp != pong.comp.ci.dtp);
+  if (error) {
+    goto done;
+  }
+
+  AcMsg* msg = AcMsgPool_get_msg(&mp);
+  msg->op = AC_OP(0, 0, 1);
+  error |= AC_TEST(AcCompMgr_send_msg(&ping.comp, msg) == AC_STATUS_OK);
+
+  AcU64 start = ac_tscrd();
+  while ((__atomic_load_n(&colocated_count, __ATOMIC_ACQUIRE) == 0)
+      && ((ac_tscrd() - start) < (pinned ? ac_tsc_freq() / 20 : ac_tsc_freq()))) {
+    ac_thread_wait_ns(1000000);
+  }
+
+  AcCompMgrColocateStats before;
+  AcCompMgrColocateStats after;
+  error |= AC_TEST(AcCompMgr_get_colocate_stats(&cm, &before) == AC_STATUS_OK);
+  ac_thread_wait_ns(20000000);
+  error |= AC_TEST(AcCompMgr_get_colocate_stats(&cm, &after) == AC_STATUS_OK);
+  ac_debug_printf("chat: pinned=%d local_sends=%lu cross_sends=%lu colocations=%lu\n",
+      pinned, after.local_sends, after.cross_sends, after.colocations);
+
+  if (pinned) {
+    error |= AC_TEST(colocated_count == 0);
+    error |= AC_TEST(after.colocations == 0);
+    error |= AC_TEST(ping.comp.ci.dtp == &cm.dtps[0]);
+    error |= AC_TEST(pong.comp.ci.dtp == &cm.dtps[1]);
+    error |= AC_TEST(after.cross_sends > before.cross_sends);
+  } else {
+    error |= AC_TEST(colocated_count == 1);
+    error |= AC_TEST(after.colocations == 1);
+    error |= AC_TEST(ping.comp.ci.dtp == pong.comp.ci.dtp);
+    error |= AC_TEST(colocated_comp->ci.dtp == &cm.dtps[colocated_to]);
+    error |= AC_TEST(colocated_peer->ci.dtp == &cm.dtps[colocated_to]);
+    error |= AC_TEST(after.local_sends > before.local_sends);
+    error |= AC_TEST((after.cross_sends - before.cross_sends)
+        < (after.local_sends - before.local_sends));
+  }
+
+  __atomic_store_n(&ping.stop, AC_TRUE, __ATOMIC_RELEASE);
+  __atomic_store_n(&pong.stop, AC_TRUE, __ATOMIC_RELEASE);
+  AcReceptor_wait(ping.stopped);
+
+  error |= AC_TEST(AcCompMgr_rmv_comp(&ping.comp) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_rmv_comp(&pong.comp) == AC_STATUS_OK);
+  AcCompMgr_deinit(&cm);
+  AcMsgPool_deinit(&mp);
+
+done:
+  AcReceptor_ret(ping.stopped);
+  return error;
+}
+
+/**
+ * Test components which send each other many messages are moved
+ * to the same thread, unless they're pinned.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_colocate(void) {
+  ac_debug_printf("test_colocate:+\n");
+  ac_bool error = AC_FALSE;
+
+  error |= chat(AC_TRUE);
+  error |= chat(AC_FALSE);
+
+  ac_debug_printf("test_colocate:-error=%d\n", error);
+  return error;
+}
+
+typedef struct RegroupComp {
+  AcComp comp;
+  AcCompHandle peer;
+  AcU32 deinit_count;
+} RegroupComp;
+
+/**
+ * Send each message back to our peer by handle, so once the peer is
+ * removed the message is returned instead
+ */
+static ac_bool regroup_msg_proc(AcComp* ac, AcMsg* msg) {
+  RegroupComp* this = (RegroupComp*)ac;
+
+  if (msg->op == AC_DEINIT_CMD) {
+    __atomic_add_fetch(&this->deinit_count, 1, __ATOMIC_RELEASE);
+    AcMsgPool_ret_msg(msg);
+  } else if (msg->op == AC_INIT_CMD) {
+    AcMsgPool_ret_msg(msg);
+  } else if (AcCompMgr_send_msg_hdl(this->comp.ci.mgr, this->peer, msg) != AC_STATUS_OK) {
+    AcMsgPool_ret_msg(msg);
+  }
+  return AC_TRUE;
+}
+
+/**
+ * Test pairs of components chatting across threads, so they're being
+ * regrouped, are removed once each, get AC_DEINIT_CMD and their
+ * messages are all returned.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_rmv_during_regroup(void) {
+  ac_debug_printf("test_rmv_during_regroup:+\n");
+  ac_bool error = AC_FALSE;
+  AcCompMgr cm;
+  AcMsgPool mp;
+  AcMsgPoolStats stats;
+  const AcU32 rounds = 50;
+  RegroupComp comps[8];
+  const AcU32 comp_count = AC_ARRAY_COUNT(comps);
+
+  AcCompMgrParams mgr_params = {
+    .max_component_threads = 2,
+    .max_components_per_thread = comp_count,
+    .colocate_ns = 500000,
+    .colocate_min_msgs_per_sec = 1000,
+  };
+  error |= AC_TEST(AcMsgPool_init(&mp, comp_count / 2, 0) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_init_params(&cm, &mgr_params) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  for (AcU32 r = 0; r < rounds; r++) {
+    for (AcU32 i = 0; i < comp_count; i++) {
+      comps[i].comp.name = (ac_u8*)"regroup";
+      comps[i].comp.process_msg = regroup_msg_proc;
+      comps[i].deinit_count = 0;
+      error |= AC_TEST(AcCompMgr_add_comp(&cm, &comps[i].comp) == AC_STATUS_OK);
+    }
+    if (error) {
+      break;
+    }
+    for (AcU32 i = 0; i < comp_count; i++) {
+      error |= AC_TEST(AcCompMgr_get_handle(&comps[i ^ 1].comp, &comps[i].peer)
+          == AC_STATUS_OK);
+    }
+    for (AcU32 i = 0; i < comp_count; i += 2) {
+      AcMsg* msg = AcMsgPool_get_msg(&mp);
+      msg->op = AC_OP(0, 0, 1);
+      error |= AC_TEST(AcCompMgr_send_msg(&comps[i].comp, msg) == AC_STATUS_OK);
+    }
+
+    // Chat for a varying part of a colocate period then remove them
+    ac_thread_wait_ns((r % 4) * 500000);
+    for (AcU32 i = 0; i < comp_count; i++) {
+      error |= AC_TEST(AcCompMgr_rmv_comp(&comps[i].comp) == AC_STATUS_OK);
+    }
+
+    // A removal may be finished on a dispatch thread
+    AcU64 start = ac_tscrd();
+    for (AcU32 i = 0; i < comp_count; i++) {
+      while ((__atomic_load_n(&comps[i].deinit_count, __ATOMIC_ACQUIRE) == 0)
+          && ((ac_tscrd() - start) < ac_tsc_freq())) {
+        ac_thread_yield();
+      }
+      error |= AC_TEST(__atomic_load_n(&comps[i].deinit_count, __ATOMIC_ACQUIRE) == 1);
+    }
+    AcMsgPool_get_stats(&mp, &stats);
+    error |= AC_TEST(stats.available == comp_count / 2);
+  }
+
+  AcCompMgrColocateStats colocate_stats;
+  error |= AC_TEST(AcCompMgr_get_colocate_stats(&cm, &colocate_stats) == AC_STATUS_OK);
+  ac_debug_printf("test_rmv_during_regroup: colocations=%lu\n", colocate_stats.colocations);
+  AcCompMgrThreadLoad load;
+  error |= AC_TEST(AcCompMgr_get_thread_load(&cm, 0, &load) == AC_STATUS_OK);
+  error |= AC_TEST(load.comp_count == 0);
+  error |= AC_TEST(AcCompMgr_get_thread_load(&cm, 1, &load) == AC_STATUS_OK);
+  error |= AC_TEST(load.comp_count == 0);
+  AcCompMgr_deinit(&cm);
+  AcMsgPool_deinit(&mp);
+
+done:
+  ac_debug_printf("test_rmv_during_regroup:-error=%d\n", error);
+  return error;
+}
+
+typedef struct NamedComp {
+  AcComp comp;
+  ac_u8 name_buf[10];
+} NamedComp;
+
+/**
+ * Return the number of entries in use in the index of cm
+ */
+static AcU32 index_entries(AcCompMgr* cm) {
+  AcU32 count = 0;
+  for (AcU32 i = 0; i <= cm->index_mask; i++) {
+    if (cm->index[i] != AC_NULL) {
+      count += 1;
+    }
+  }
+  return count;
+}
+
+/**
+ * Test components are found by their exact name, including
+ * after others have been removed and added again.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_find(void) {
+  ac_debug_printf("test_find:+\n");
+  ac_bool error = AC_FALSE;
+  AcCompMgr cm;
+  const AcU32 comp_count = 64;
+
+  NamedComp* comps = ac_calloc(comp_count, sizeof(NamedComp));
+  error |= AC_TEST(comps != AC_NULL);
+  error |= AC_TEST(AcCompMgr_init(&cm, 1, comp_count, 0) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  for (AcU32 i = 0; i < comp_count; i++) {
+    ac_snprintf(comps[i].name_buf, sizeof(comps[i].name_buf), "c%d", i);
+    comps[i].comp.name = comps[i].name_buf;
+    comps[i].comp.process_msg = idle_msg_proc;
+    error |= AC_TEST(AcCompMgr_add_comp(&cm, &comps[i].comp) == AC_STATUS_OK);
+  }
+  for (AcU32 i = 0; i < comp_count; i++) {
+    error |= AC_TEST(AcCompMgr_find_comp(&cm, comps[i].name_buf) == &comps[i].comp);
+  }
+  error |= AC_TEST(AcCompMgr_find_comp(&cm, (ac_u8*)"c") == AC_NULL);
+  error |= AC_TEST(AcCompMgr_find_comp(&cm, (ac_u8*)"c640") == AC_NULL);
+
+  // Remove the even ones, the odd ones are still found
+  for (AcU32 i = 0; i < comp_count; i += 2) {
+    error |= AC_TEST(AcCompMgr_rmv_comp(&comps[i].comp) == AC_STATUS_OK);
+  }
+  for (AcU32 i = 0; i < comp_count; i++) {
+    AcComp* expected = ((i & 1) == 0) ? AC_NULL : &comps[i].comp;
+    error |= AC_TEST(AcCompMgr_find_comp(&cm, comps[i].name_buf) == expected);
+  }
+
+  // Add them back, repeatedly so removed entries are reused
+  for (AcU32 n = 0; n < 4; n++) {
+    for (AcU32 i = 0; i < comp_count; i += 2) {
+      error |= AC_TEST(AcCompMgr_add_comp(&cm, &comps[i].comp) == AC_STATUS_OK);
+    }
+    for (AcU32 i = 0; i < comp_count; i++) {
+      error |= AC_TEST(AcCompMgr_find_comp(&cm, comps[i].name_buf) == &comps[i].comp);
+    }
+    for (AcU32 i = 0; i < comp_count; i += 2) {
+      error |= AC_TEST(AcCompMgr_rmv_comp(&comps[i].comp) == AC_STATUS_OK);
+      error |= AC_TEST(AcCompMgr_find_comp(&cm, comps[i].name_buf) == AC_NULL);
+    }
+    for (AcU32 i = 1; i < comp_count; i += 2) {
+      error |= AC_TEST(AcCompMgr_find_comp(&cm, comps[i].name_buf) == &comps[i].comp);
+    }
+  }
+
+  // Removal leaves nothing behind, however many names come and go
+  error |= AC_TEST(index_entries(&cm) == comp_count / 2);
+  for (AcU32 n = 0; n < 1000; n++) {
+    ac_snprintf(comps[0].name_buf, sizeof(comps[0].name_buf), "n%d", n);
+    error |= AC_TEST(AcCompMgr_add_comp(&cm, &comps[0].comp) == AC_STATUS_OK);
+    error |= AC_TEST(AcCompMgr_find_comp(&cm, comps[0].name_buf) == &comps[0].comp);
+    error |= AC_TEST(AcCompMgr_rmv_comp(&comps[0].comp) == AC_STATUS_OK);
+  }
+  error |= AC_TEST(index_entries(&cm) == comp_count / 2);
+  for (AcU32 i = 1; i < comp_count; i += 2) {
+    error |= AC_TEST(AcCompMgr_find_comp(&cm, comps[i].name_buf) == &comps[i].comp);
+  }
+
+  for (AcU32 i = 1; i < comp_count; i += 2) {
+    error |= AC_TEST(AcCompMgr_rmv_comp(&comps[i].comp) == AC_STATUS_OK);
+  }
+  AcCompMgr_deinit(&cm);
+
+done:
+  ac_free(comps);
+
+  ac_debug_printf("test_find:-error=%d\n", error);
+  return error;
+}
+
+typedef struct HandleComp {
+  AcComp comp;
+  AcMsgPool mp;
+  AcCompMgr* mgr;
+  AcCompHandle target;
+  AcU64 sent;
+  AcU64 stale;
+  ac_bool stop;
+  AcReceptor* stopped;
+} HandleComp;
+
+/**
+ * Send a message through the target handle and msg back to
+ * ourself to keep going, until stopped
+ */
+static ac_bool handle_msg_proc(AcComp* ac, AcMsg* msg) {
+  HandleComp* this = (HandleComp*)ac;
+
+  if ((msg->op != AC_INIT_CMD) && (msg->op != AC_DEINIT_CMD)) {
+    if (__atomic_load_n(&this->stop, __ATOMIC_ACQUIRE)) {
+      AcReceptor_signal(this->stopped);
+    } else {
+      AcCompHandle target;
+      __atomic_load(&this->target, &target, __ATOMIC_ACQUIRE);
+      AcMsg* to_target = AcMsgPool_get_msg(&this->mp);
+      if (to_target != AC_NULL) {
+        to_target->op = AC_OP(0, 0, 1);
+        AcStatus status = AcCompMgr_send_msg_hdl(this->mgr, target, to_target);
+        if (status == AC_STATUS_OK) {
+          this->sent += 1;
+        } else {
+          this->stale += (status == AC_STATUS_STALE_HANDLE);
+          AcMsgPool_ret_msg(to_target);
+        }
+      }
+      AcCompMgr_send_msg(ac, msg);
+      return AC_TRUE;
+    }
+  }
+
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+/**
+ * Test sends through a handle fail once its component is removed,
+ * also while a component is sending through it on another thread.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_handle(void) {
+  ac_debug_printf("test_handle:+\n");
+  ac_bool error = AC_FALSE;
+  AcCompMgr cm;
+  AcMsgPool mp;
+  AcCompHandle hdl;
+  AcCompHandle stale;
+  const AcU32 rounds = 100;
+
+  AcComp target = {
+    .name = (ac_u8*)"target",
+    .process_msg = idle_msg_proc,
+  };
+  HandleComp sender = {
+    .comp.name = (ac_u8*)"sender",
+    .comp.process_msg = handle_msg_proc,
+    .mgr = &cm,
+    .sent = 0,
+    .stale = 0,
+    .stop = AC_FALSE,
+    .stopped = AcReceptor_get(),
+  };
+
+  error |= AC_TEST(AcMsgPool_init(&mp, 1, 0) == AC_STATUS_OK);
+  error |= AC_TEST(AcMsgPool_init(&sender.mp, 16, 0) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_init(&cm, 2, 2, 0) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  // A handle works until its component is removed
+  error |= AC_TEST(AcCompMgr_get_handle(&target, &hdl) == AC_STATUS_BAD_PARAM);
+  error |= AC_TEST(AcCompMgr_add_comp_on_thread(&cm, &target, 0, AC_NULL) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_get_handle(&target, &hdl) == AC_STATUS_OK);
+  AcMsg* msg = AcMsgPool_get_msg(&mp);
+  msg->op = AC_OP(0, 0, 1);
+  error |= AC_TEST(AcCompMgr_send_msg_hdl(&cm, hdl, msg) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_rmv_comp(&target) == AC_STATUS_OK);
+  msg = AcMsgPool_get_msg(&mp);
+  error |= AC_TEST(msg != AC_NULL);
+  error |= AC_TEST(AcCompMgr_send_msg_hdl(&cm, hdl, msg) == AC_STATUS_STALE_HANDLE);
+
+  // Even if the slot is reused
+  stale = hdl;
+  error |= AC_TEST(AcCompMgr_add_comp_on_thread(&cm, &target, 0, AC_NULL) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_get_handle(&target, &hdl) == AC_STATUS_OK);
+  error |= AC_TEST(hdl.slot == stale.slot);
+  error |= AC_TEST(hdl.gen != stale.gen);
+  error |= AC_TEST(AcCompMgr_send_msg_hdl(&cm, stale, msg) == AC_STATUS_STALE_HANDLE);
+  error |= AC_TEST(AcCompMgr_send_msg_hdl(&cm, hdl, msg) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_rmv_comp(&target) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  // Remove and add the target while sender sends to it from thread 1,
+  // with a msg_budget so thread 1's dispatches end and removal proceeds
+  AcCompParams params = { .msg_budget = 1 };
+  error |= AC_TEST(AcCompMgr_add_comp_on_thread(&cm, &target, 0, AC_NULL) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_get_handle(&target, &hdl) == AC_STATUS_OK);
+  __atomic_store(&sender.target, &hdl, __ATOMIC_RELEASE);
+  error |= AC_TEST(AcCompMgr_add_comp_on_thread(&cm, &sender.comp, 1, &params) == AC_STATUS_OK);
+  msg = AcMsgPool_get_msg(&sender.mp);
+  msg->op = AC_OP(0, 0, 1);
+  error |= AC_TEST(AcCompMgr_send_msg(&sender.comp, msg) == AC_STATUS_OK);
+  for (AcU32 i = 0; i < rounds; i++) {
+    ac_thread_wait_ns(100000);
+    error |= AC_TEST(AcCompMgr_rmv_comp(&target) == AC_STATUS_OK);
+    ac_thread_wait_ns(100000);
+    error |= AC_TEST(AcCompMgr_add_comp_on_thread(&cm, &target, 0, AC_NULL) == AC_STATUS_OK);
+    error |= AC_TEST(AcCompMgr_get_handle(&target, &hdl) == AC_STATUS_OK);
+    __atomic_store(&sender.target, &hdl, __ATOMIC_RELEASE);
+  }
+  __atomic_store_n(&sender.stop, AC_TRUE, __ATOMIC_RELEASE);
+  AcReceptor_wait(sender.stopped);
+  ac_debug_printf("test_handle: sent=%lu stale=%lu\n", sender.sent, sender.stale);
+  error |= AC_TEST(sender.sent != 0);
+  error |= AC_TEST(sender.stale != 0);
+
+  error |= AC_TEST(AcCompMgr_rmv_comp(&sender.comp) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_rmv_comp(&target) == AC_STATUS_OK);
+  AcCompMgr_deinit(&cm);
+  AcMsgPool_deinit(&sender.mp);
+  AcMsgPool_deinit(&mp);
+
+done:
+  AcReceptor_ret(sender.stopped);
+
+  ac_debug_printf("test_handle:-error=%d\n", error);
+  return error;
+}
+
+#define HIER_PROTOCOL 0x10
+#define HIER_REQ1 AC_OP(HIER_PROTOCOL, AC_OPTYPE_REQ, 1)
+#define HIER_REQ2 AC_OP(HIER_PROTOCOL, AC_OPTYPE_REQ, 2)
+#define HIER_REQ3 AC_OP(HIER_PROTOCOL, AC_OPTYPE_REQ, 3)
+#define HIER_RSP2 AC_OP(HIER_PROTOCOL, AC_OPTYPE_RSP, 2)
+
+/**
+ * A component in a hierarchy counting how it processed messages
+ */
+typedef struct HierComp {
+  AcComp comp;
+  AcCompHandlers handlers;
+  AcU32 req;                    ///< Processed by hier_req
+  AcU32 declined;               ///< Passed on by hier_decline
+  AcU32 other;                  ///< Seen by process_msg
+  AcReceptor* done;             ///< Signaled when a message has been processed
+} HierComp;
+
+static AcBool hier_req(AcComp* ac, AcMsg* msg) {
+  HierComp* this = (HierComp*)ac;
+  this->req += 1;
+  AcMsgPool_ret_msg(msg);
+  AcReceptor_signal(this->done);
+  return AC_TRUE;
+}
+
+static AcBool hier_decline(AcComp* ac, AcMsg* msg) {
+  HierComp* this = (HierComp*)ac;
+  this->declined += 1;
+  return AC_FALSE;
+}
+
+static AcBool child_msg_proc(AcComp* ac, AcMsg* msg) {
+  HierComp* this = (HierComp*)ac;
+  if ((msg->op == AC_INIT_CMD) || (msg->op == AC_DEINIT_CMD)) {
+    AcMsgPool_ret_msg(msg);
+    return AC_TRUE;
+  }
+  this->other += 1;
+  return AC_FALSE;
+}
+
+static AcBool parent_msg_proc(AcComp* ac, AcMsg* msg) {
+  HierComp* this = (HierComp*)ac;
+  if ((msg->op != AC_INIT_CMD) && (msg->op != AC_DEINIT_CMD)) {
+    this->other += 1;
+    AcReceptor_signal(this->done);
+  }
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+/**
+ * Send a message with op to comp and wait for it to be processed
+ */
+static void hier_send(AcComp* comp, AcMsgPool* mp, AcU64 op, AcReceptor* done) {
+  AcMsg* msg = AcMsgPool_get_msg(mp);
+  msg->op = op;
+  AcCompMgr_send_msg(comp, msg);
+  AcReceptor_wait(done);
+}
+
+/**
+ * Test messages are processed by the handlers for their operation
+ * and those not processed are passed to the parent.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_handlers(void) {
+  ac_debug_printf("test_handlers:+\n");
+  ac_bool error = AC_FALSE;
+  AcCompMgr cm;
+  AcMsgPool mp;
+  AcReceptor* done = AcReceptor_get();
+  AcCompHandlers h = { 0 };
+
+  // The table is indexed by opcode and optype, and grows
+  error |= AC_TEST(AcCompHandlers_add(AC_NULL, HIER_REQ1, hier_req) == AC_STATUS_BAD_PARAM);
+  error |= AC_TEST(AcCompHandlers_add(&h, HIER_REQ1, AC_NULL) == AC_STATUS_BAD_PARAM);
+  error |= AC_TEST(AcCompHandlers_get(&h, HIER_REQ1) == AC_NULL);
+  error |= AC_TEST(AcCompHandlers_add(&h, HIER_REQ2, hier_req) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompHandlers_add(&h, HIER_RSP2, hier_decline) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompHandlers_add(&h, AC_OP(HIER_PROTOCOL, AC_OPTYPE_CMD, 100),
+        hier_req) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompHandlers_add(&h, AC_INIT_CMD, hier_decline) == AC_STATUS_OK);
+  error |= AC_TEST(h.protocol_count == 2);
+  error |= AC_TEST(AcCompHandlers_get(&h, HIER_REQ2) == hier_req);
+  error |= AC_TEST(AcCompHandlers_get(&h, HIER_RSP2) == hier_decline);
+  error |= AC_TEST(AcCompHandlers_get(&h, AC_OP(HIER_PROTOCOL, AC_OPTYPE_CMD, 100)) == hier_req);
+  error |= AC_TEST(AcCompHandlers_get(&h, AC_OP(HIER_PROTOCOL, AC_OPTYPE_CMD, 101)) == AC_NULL);
+  error |= AC_TEST(AcCompHandlers_get(&h, HIER_REQ1) == AC_NULL);
+  error |= AC_TEST(AcCompHandlers_get(&h, AC_INIT_CMD) == hier_decline);
+  error |= AC_TEST(AcCompHandlers_get(&h, AC_DEINIT_CMD) == AC_NULL);
+  error |= AC_TEST(AcCompHandlers_get(&h, AC_OP(HIER_PROTOCOL + 1, AC_OPTYPE_REQ, 2)) == AC_NULL);
+  error |= AC_TEST(AcCompHandlers_add(&h, HIER_RSP2, hier_req) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompHandlers_get(&h, HIER_RSP2) == hier_req);
+  AcCompHandlers_deinit(&h);
+  error |= AC_TEST(h.protocol_count == 0);
+  error |= AC_TEST(AcCompHandlers_get(&h, HIER_REQ2) == AC_NULL);
+
+  HierComp parent = {
+    .comp.name = (ac_u8*)"parent",
+    .comp.process_msg = parent_msg_proc,
+    .done = done,
+  };
+  HierComp child = {
+    .comp.name = (ac_u8*)"child",
+    .comp.process_msg = child_msg_proc,
+    .done = done,
+  };
+  AcComp neither = { .name = (ac_u8*)"neither" };
+  error |= AC_TEST(AcCompHandlers_add(&parent.handlers, HIER_REQ1, hier_req) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompHandlers_add(&child.handlers, HIER_REQ2, hier_req) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompHandlers_add(&child.handlers, HIER_REQ3, hier_decline) == AC_STATUS_OK);
+
+  error |= AC_TEST(AcMsgPool_init(&mp, 4, 0) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_init(&cm, 1, 4, 0) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  // A component needs a process_msg or handlers and its parent must be managed
+  AcCompParams parent_params = { .handlers = &parent.handlers };
+  AcCompParams child_params = { .handlers = &child.handlers, .parent = &parent.comp };
+  error |= AC_TEST(AcCompMgr_add_comp(&cm, &neither) != AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_add_comp_on_thread(&cm, &child.comp, 0, &child_params)
+      == AC_STATUS_BAD_PARAM);
+  error |= AC_TEST(AcCompMgr_add_comp_on_thread(&cm, &parent.comp, 0, &parent_params)
+      == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_add_comp_on_thread(&cm, &child.comp, 0, &child_params)
+      == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  // The child's handler processes it
+  hier_send(&child.comp, &mp, HIER_REQ2, done);
+  error |= AC_TEST(child.req == 1);
+  error |= AC_TEST(child.other == 0);
+
+  // The child's handler and process_msg decline it, the parent's process_msg has it
+  hier_send(&child.comp, &mp, HIER_REQ3, done);
+  error |= AC_TEST(child.declined == 1);
+  error |= AC_TEST(child.other == 1);
+  error |= AC_TEST(parent.other == 1);
+
+  // The child has no handler, the parent's handler processes it
+  hier_send(&child.comp, &mp, HIER_REQ1, done);
+  error |= AC_TEST(child.other == 2);
+  error |= AC_TEST(parent.req == 1);
+  error |= AC_TEST(parent.other == 1);
+
+  // The response isn't handled by the request's handler
+  hier_send(&child.comp, &mp, HIER_RSP2, done);
+  error |= AC_TEST(child.req == 1);
+  error |= AC_TEST(child.other == 3);
+  error |= AC_TEST(parent.other == 2);
+
+  error |= AC_TEST(AcCompMgr_rmv_comp(&child.comp) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_rmv_comp(&parent.comp) == AC_STATUS_OK);
+  AcCompMgr_deinit(&cm);
+  AcMsgPool_deinit(&mp);
+
+done:
+  AcCompHandlers_deinit(&child.handlers);
+  AcCompHandlers_deinit(&parent.handlers);
+  AcReceptor_ret(done);
+
+  ac_debug_printf("test_handlers:-error=%d\n", error);
+  return error;
+}
+
+#define RR_PROTOCOL 0x11
+#define RR_REQ AC_OP(RR_PROTOCOL, AC_OPTYPE_REQ, 1)
+#define RR_RSP AC_OP(RR_PROTOCOL, AC_OPTYPE_RSP, 1)
+#define RR_START AC_OP(RR_PROTOCOL, AC_OPTYPE_CMD, 2)
+#define RR_BLOCK AC_OP(RR_PROTOCOL, AC_OPTYPE_CMD, 3)
+
+/** Requests a component may have outstanding */
+#define RR_REQUESTS 8
+
+/**
+ * A component which makes requests and counts the responses
+ */
+typedef struct ReqComp {
+  AcComp comp;
+  AcMsgPool mp;
+  AcComp* server;
+  AcU32 rsps;                   ///< Responses received
+  AcU32 tags;                   ///< Bit i is set when the response tagged i is received
+  AcU32 outstanding;            ///< Outstanding once the requests were sent
+  AcStatus full;                ///< Status of a request with no entry free
+  ac_bool error;
+  AcReceptor* done;             ///< Signaled when all the responses are received
+  AcReceptor* release;          ///< Waited on for RR_BLOCK
+} ReqComp;
+
+/**
+ * A component which responds to requests, or holds them
+ */
+typedef struct RspComp {
+  AcComp comp;
+  ac_bool hold;                 ///< Keep the request in held rather than respond
+  AcMsg* held;
+  AcReceptor* done;             ///< Signaled when a request is held
+} RspComp;
+
+/**
+ * On RR_START send RR_REQUESTS requests to the server without
+ * waiting, then count the responses as they arrive
+ */
+static AcBool req_msg_proc(AcComp* ac, AcMsg* msg) {
+  ReqComp* this = (ReqComp*)ac;
+
+  if (msg->op == RR_START) {
+    for (AcU32 i = 0; i < RR_REQUESTS; i++) {
+      AcMsg* req = AcMsgPool_get_msg(&this->mp);
+      req->op = RR_REQ;
+      req->tag = i;
+      this->error |= AC_TEST(AcCompMgr_request(this->server, req, ac) == AC_STATUS_OK);
+    }
+    this->outstanding = AcCompMgr_get_outstanding(ac);
+
+    // There's no entry for another
+    AcMsg* req = AcMsgPool_get_msg(&this->mp);
+    req->op = RR_REQ;
+    req->tag = RR_REQUESTS;
+    this->full = AcCompMgr_request(this->server, req, ac);
+    this->error |= AC_TEST(req->tag == RR_REQUESTS);
+    AcMsgPool_ret_msg(req);
+  } else if (msg->op == RR_BLOCK) {
+    // Stay busy so our queue is full
+    AcReceptor_signal(this->done);
+    AcReceptor_wait(this->release);
+  } else if (msg->op == RR_RSP) {
+    this->error |= AC_TEST(msg->status == AC_STATUS_UNRECOGNIZED_OPERATION);
+    this->error |= AC_TEST(msg->tag < RR_REQUESTS);
+    this->tags |= 1 << msg->tag;
+    this->rsps += 1;
+    if (this->rsps == RR_REQUESTS) {
+      AcReceptor_signal(this->done);
+    }
+  }
+
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+static AcBool rsp_msg_proc(AcComp* ac, AcMsg* msg) {
+  RspComp* this = (RspComp*)ac;
+
+  if (msg->op == RR_REQ) {
+    if (this->hold) {
+      this->held = msg;
+      AcReceptor_signal(this->done);
+    } else if (AcMsg_reply(msg, AC_STATUS_UNRECOGNIZED_OPERATION) != AC_STATUS_OK) {
+      AcMsgPool_ret_msg(msg);
+    }
+    return AC_TRUE;
+  }
+
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+/**
+ * Test requests are pipelined and each response is the request
+ * replied to in place, with the requester's tag. Bad tags are
+ * rejected and a reply which isn't sent, cancelled requests and
+ * a removed requester all free their entries.
+ *
+ * @return: AC_TRUE if an error
+ */
+ac_bool test_request(void) {
+  ac_debug_printf("test_request:+\n");
+  ac_bool error = AC_FALSE;
+  AcCompMgr cm;
+  AcMsgPool mp;
+  AcMsg* msg;
+  AcU64 tag;
+  AcReceptor* done = AcReceptor_get();
+  AcReceptor* release = AcReceptor_get();
+
+  RspComp server = {
+    .comp.name = (ac_u8*)"server",
+    .comp.process_msg = rsp_msg_proc,
+    .hold = AC_FALSE,
+    .held = AC_NULL,
+    .done = done,
+  };
+  ReqComp client = {
+    .comp.name = (ac_u8*)"client",
+    .comp.process_msg = req_msg_proc,
+    .server = &server.comp,
+    .rsps = 0,
+    .tags = 0,
+    .error = AC_FALSE,
+    .done = done,
+    .release = release,
+  };
+  AcCompMgrParams params = {
+    .max_component_threads = 1,
+    .max_components_per_thread = 4,
+    .max_requests_per_comp = RR_REQUESTS,
+  };
+
+  error |= AC_TEST(AcMsgPool_init(&mp, 2, 0) == AC_STATUS_OK);
+  error |= AC_TEST(AcMsgPool_init(&client.mp, 16, 0) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_init_params(&cm, &params) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  // The reply_to must be managed
+  error |= AC_TEST(AcCompMgr_add_comp_on_thread(&cm, &server.comp, 0, AC_NULL) == AC_STATUS_OK);
+  msg = AcMsgPool_get_msg(&mp);
+  msg->op = RR_REQ;
+  msg->tag = 42;
+  error |= AC_TEST(AcCompMgr_request(&server.comp, msg, &client.comp) == AC_STATUS_BAD_PARAM);
+  error |= AC_TEST(msg->tag == 42);
+  error |= AC_TEST(AcCompMgr_add_comp_on_thread(&cm, &client.comp, 0, AC_NULL) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  // The requests are all outstanding before the first response
+  // as the client and server are on the same thread
+  msg->op = RR_START;
+  error |= AC_TEST(AcCompMgr_send_msg(&client.comp, msg) == AC_STATUS_OK);
+  AcReceptor_wait(done);
+  error |= client.error;
+  error |= AC_TEST(client.outstanding == RR_REQUESTS);
+  error |= AC_TEST(client.full == AC_STATUS_QUEUE_FULL);
+  error |= AC_TEST(client.rsps == RR_REQUESTS);
+  error |= AC_TEST(client.tags == ((1 << RR_REQUESTS) - 1));
+  error |= AC_TEST(AcCompMgr_get_outstanding(&client.comp) == 0);
+
+  // Tags which aren't an outstanding request's are rejected
+  server.hold = AC_TRUE;
+  msg = AcMsgPool_get_msg(&mp);
+  msg->op = RR_REQ;
+  msg->tag = 42;
+  error |= AC_TEST(AcCompMgr_request(&server.comp, msg, &client.comp) == AC_STATUS_OK);
+  AcReceptor_wait(done);
+  error |= AC_TEST(server.held == msg);
+  error |= AC_TEST(msg->tag != 42);
+  tag = msg->tag;
+  msg->tag = 0;
+  error |= AC_TEST(AcMsg_reply(msg, AC_STATUS_OK) == AC_STATUS_BAD_PARAM);
+  msg->tag = 42;
+  error |= AC_TEST(AcMsg_reply(msg, AC_STATUS_OK) == AC_STATUS_BAD_PARAM);
+  msg->tag = tag | 0xFFFFFF;                   // Index out of range
+  error |= AC_TEST(AcMsg_reply(msg, AC_STATUS_OK) == AC_STATUS_BAD_PARAM);
+  msg->tag = tag + (2ULL << 32);               // Another generation
+  error |= AC_TEST(AcMsg_reply(msg, AC_STATUS_OK) == AC_STATUS_STALE_HANDLE);
+  msg->tag = tag;
+  error |= AC_TEST(AcCompMgr_get_outstanding(&client.comp) == 1);
+
+  // A cancelled request's reply is stale
+  error |= AC_TEST(AcCompMgr_cancel_requests(&client.comp) == 1);
+  error |= AC_TEST(AcCompMgr_get_outstanding(&client.comp) == 0);
+  error |= AC_TEST(AcMsg_reply(msg, AC_STATUS_OK) == AC_STATUS_STALE_HANDLE);
+  error |= AC_TEST(msg->op == RR_REQ);
+  error |= AC_TEST(msg->tag == tag);
+  AcMsgPool_ret_msg(msg);
+
+  // A response to a removed reply_to is stale and no longer outstanding
+  msg = AcMsgPool_get_msg(&mp);
+  msg->op = RR_REQ;
+  msg->tag = 42;
+  error |= AC_TEST(AcCompMgr_request(&server.comp, msg, &client.comp) == AC_STATUS_OK);
+  AcReceptor_wait(done);
+  error |= AC_TEST(server.held == msg);
+  error |= AC_TEST(AcCompMgr_get_outstanding(&client.comp) == 1);
+  error |= AC_TEST(AcCompMgr_rmv_comp(&client.comp) == AC_STATUS_OK);
+  tag = msg->tag;
+  error |= AC_TEST(AcMsg_reply(msg, AC_STATUS_OK) == AC_STATUS_STALE_HANDLE);
+  error |= AC_TEST(msg->op == RR_REQ);
+  error |= AC_TEST(msg->tag == tag);
+  AcMsgPool_ret_msg(msg);
+
+  // A reply to a full reply_to isn't sent but is no longer outstanding
+  error |= AC_TEST(AcCompMgr_add_comp_bounded(&cm, &client.comp, 1, 0) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_get_outstanding(&client.comp) == 0);
+  msg = AcMsgPool_get_msg(&mp);
+  msg->op = RR_REQ;
+  msg->tag = 42;
+  error |= AC_TEST(AcCompMgr_request(&server.comp, msg, &client.comp) == AC_STATUS_OK);
+  AcReceptor_wait(done);
+  error |= AC_TEST(server.held == msg);
+  AcMsg* block = AcMsgPool_get_msg(&client.mp);
+  block->op = RR_BLOCK;
+  error |= AC_TEST(AcCompMgr_send_msg(&client.comp, block) == AC_STATUS_OK);
+  AcReceptor_wait(done);
+  tag = msg->tag;
+  error |= AC_TEST(AcMsg_reply(msg, AC_STATUS_OK) == AC_STATUS_QUEUE_FULL);
+  error |= AC_TEST(msg->op == RR_REQ);
+  error |= AC_TEST(msg->tag == tag);
+  error |= AC_TEST(AcCompMgr_get_outstanding(&client.comp) == 0);
+  error |= AC_TEST(AcMsg_reply(msg, AC_STATUS_OK) == AC_STATUS_STALE_HANDLE);
+  AcMsgPool_ret_msg(msg);
+  AcReceptor_signal(release);
+
+  error |= AC_TEST(AcCompMgr_rmv_comp(&client.comp) == AC_STATUS_OK);
+  error |= AC_TEST(AcCompMgr_rmv_comp(&server.comp) == AC_STATUS_OK);
+  AcCompMgr_deinit(&cm);
+  AcMsgPool_deinit(&client.mp);
+  AcMsgPool_deinit(&mp);
+
+done:
+  AcReceptor_ret(release);
+  AcReceptor_ret(done);
+
+  ac_debug_printf("test_request:-error=%d\n", error);
+  return error;
+}
@@ -18,19 +18,90 @@
 #define SADIE_LIBS_AC_DISPATCHER_H
 
 #include <ac_msg.h>
+#include <ac_receptor.h>
 #include <ac_status.h>
 
 typedef struct AcComp AcComp;
+typedef struct AcCompHandlers AcCompHandlers;
 typedef struct AcDispatchableComp AcDispatchableComp;
 
 // The opaque ac_dipatcher
 typedef struct AcDispatcher AcDispatcher;
 
+/** Maximum number of lanes a component may have */
+#define AC_DISPATCHER_MAX_LANES 4
+
+/** Lane used by AcDispatcher_send_msg */
+#define AC_LANE_NORMAL 0
+
+/** Highest priority lane, lanes above a component's lane_count use its highest */
+#define AC_LANE_CONTROL (AC_DISPATCHER_MAX_LANES - 1)
+
+/** Default for AcCompParams.lane_quantum */
+#define AC_LANE_QUANTUM_DEFAULT 16
+
+/** Default for AcCompParams.starvation_limit */
+#define AC_LANE_STARVATION_LIMIT_DEFAULT 64
+
 /**
- * Dispatch messages to asynchronous components
+ * Parameters for a component, zero for the default
+ */
+typedef struct AcCompParams {
+  AcU32 capacity;         ///< If !0 maximum messages in AC_LANE_NORMAL
+  AcU32 low_water;        ///< Senders waiting for space are signaled at this depth, < capacity
+  AcU32 lane_count;       ///< Number of lanes, higher lanes are processed first, default 1
+  AcU32 lane_quantum;     ///< Messages taken from a lane before looking at higher lanes
+  AcU32 starvation_limit; ///< Messages from higher lanes before a waiting lower lane runs
+  AcU32 msg_budget;       ///< Messages processed before moving to the next component
+  AcU64 tsc_budget;       ///< Ticks processing before moving to the next component
+  const AcCompHandlers* handlers; ///< Handlers called before process_msg, see AcCompHandlers
+  AcComp* parent;         ///< Processes the messages the component doesn't
+} AcCompParams;
+
+/**
+ * Counters for a component, see AcDispatcher_get_counters
+ */
+typedef struct AcCompCounters {
+  AcU64 dispatched;       ///< Times the component's messages were processed
+  AcU64 msgs;             ///< Messages processed
+  AcU64 budget_exhausted; ///< Times its budget ran out with messages left
+} AcCompCounters;
+
+/**
+ * Dispatch messages to asynchronous components, only the components
+ * which have been sent messages since they were last dispatched are
+ * visited so idle components cost nothing.
+ *
+ * @return AC_TRUE if any messages were processed
  */
 ac_bool AcDispatcher_dispatch(AcDispatcher* d);
 
+/**
+ * Return AC_TRUE if any components may have messages to dispatch,
+ * this is cheap enough to be polled.
+ */
+AcBool AcDispatcher_ready(AcDispatcher* d);
+
+/**
+ * Return the number of messages AcDispatcher_dispatch has processed,
+ * it may be read while dispatching.
+ */
+AcU64 AcDispatcher_get_msgs(AcDispatcher* d);
+
+/**
+ * Return the number of components which may have messages to
+ * dispatch plus one if a component is being processed, which may
+ * also have been sent messages while being processed.
+ */
+AcU32 AcDispatcher_ready_count(AcDispatcher* d);
+
+/**
+ * Return the component AcDispatcher_dispatch is processing or AC_NULL
+ * if none. Called from a component's process_msg on the thread
+ * dispatching d it's the component doing the processing.
+ */
+AcComp* AcDispatcher_current(AcDispatcher* d);
+
 /**
  * Get a dispatcher able to support max_count AcComp's.
  */
@@ -49,6 +120,54 @@ void AcDispatcher_ret(AcDispatcher* d);
  */
 AcDispatchableComp* AcDispatcher_add_comp(AcDispatcher* d, AcComp* comp);
 
+/**
+ * Add the AcComp to this dispatcher with a bounded queue. Once
+ * capacity messages are queued or being processed
+ * AcDispatcher_send_msg returns AC_STATUS_QUEUE_FULL.
+ *
+ * @param: capacity is the maximum number of messages, 0 is unbounded
+ * @param: low_water senders waiting for space are signaled when the
+ *         number of messages drops to low_water, must be < capacity
+ *
+ * @return: AcDispatableComp* or AC_NULL if an error,
+ * this will occur if there are to many AcComp's registered.
+ */
+AcDispatchableComp* AcDispatcher_add_comp_bounded(AcDispatcher* d, AcComp* comp,
+    AcU32 capacity, AcU32 low_water);
+
+/**
+ * Add the AcComp to this dispatcher with the given parameters.
+ *
+ * When a component has more than one lane the messages in the highest
+ * non-empty lane are processed first. Only lane_quantum messages are
+ * taken from a lane before the higher lanes are looked at again, and
+ * after starvation_limit messages from higher lanes the lowest waiting
+ * lane is given a turn. Only AC_LANE_NORMAL is bounded by capacity so
+ * control messages may always be sent.
+ *
+ * A component which has processed msg_budget messages, or has been
+ * processing for tsc_budget ticks, is left with its remaining messages
+ * until the other components on the dispatcher have had a turn. This
+ * bounds how long a flooded component holds up its siblings, at least
+ * one message is processed each turn. Zero is unlimited.
+ *
+ * A message is first given to the handler in handlers for its
+ * operation, if there is one, then to the component's process_msg,
+ * which may be AC_NULL if there are handlers. If neither returns
+ * AC_TRUE the parent, which must already have been added to an
+ * AcCompMgr and removed after its children, is given the message the same
+ * way and so on up the hierarchy. The parent's handlers run on
+ * the child's thread, add them to the same thread unless they're
+ * safe to call concurrently.
+ *
+ * @param: params for the component, AC_NULL for the defaults
+ *
+ * @return: AcDispatableComp* or AC_NULL if an error,
+ * this will occur if there are to many AcComp's registered.
+ */
+AcDispatchableComp* AcDispatcher_add_comp_params(AcDispatcher* d, AcComp* comp,
+    const AcCompParams* params);
+
 /**
  * Remove all instances associated with the dispatchable component
  *
@@ -61,7 +180,90 @@ AcStatus AcDispatcher_rmv_comp(AcDispatcher* d, AcComp* comp);
  *
  * @param: dc is the dispatchable component previously added.
  * @param: msg is the message to send
+ *
+ * @return AC_STATUS_OK if sent or AC_STATUS_QUEUE_FULL in which
+ * case the caller still owns msg.
+ */
+AcStatus AcDispatcher_send_msg(AcDispatchableComp* dc, AcMsg* msg);
+
+/**
+ * Send a message to a lane of a dispatchable component
+ *
+ * @param: dc is the dispatchable component previously added.
+ * @param: msg is the message to send
+ * @param: lane to use, lanes at or above the components lane_count
+ *         use its highest lane
+ *
+ * @return AC_STATUS_OK if sent or AC_STATUS_QUEUE_FULL in which
+ * case the caller still owns msg.
+ */
+AcStatus AcDispatcher_send_msg_lane(AcDispatchableComp* dc, AcMsg* msg, AcU32 lane);
+
+/**
+ * Get the counters of a dispatchable component, they may be read
+ * while it is being dispatched.
+ *
+ * @param: dc is the dispatchable component previously added.
+ * @param: counters is filled in
+ */
+void AcDispatcher_get_counters(AcDispatchableComp* dc, AcCompCounters* counters);
+
+/**
+ * Signal space_available once the number of messages on a bounded
+ * dispatchable component is at or below its low_water. If it already
+ * is, or there is no room to register another waiter, space_available
+ * is signaled immediately. Each call results in exactly one signal.
+ *
+ * @param: dc is the dispatchable component previously added.
+ * @param: space_available is the receptor to signal
+ */
+void AcDispatcher_notify_when_not_full(AcDispatchableComp* dc, AcReceptor* space_available);
+
+/**
+ * Return AC_TRUE if comp may be stolen, see AcDispatcher_steal
+ */
+typedef AcBool (*AcDispatcherStealFilter)(AcComp* comp);
+
+/**
+ * Move a component which has messages to dispatch, and isn't being
+ * processed, from victim to thief. Only one dispatcher processes a
+ * component at a time so the order of its messages is preserved and
+ * its lanes keep a single consumer, senders need not know it's moved.
+ * It must be called from the thread dispatching thief and victim must
+ * not be returned while it's called.
+ *
+ * @param: victim is the dispatcher to steal from
+ * @param: thief is the dispatcher to move the component to
+ * @param: can_steal if not AC_NULL is called for each candidate
+ *
+ * @return: the component stolen or AC_NULL if none, or if the one
+ * being stolen was removed meanwhile in which case it's removed here.
+ */
+AcComp* AcDispatcher_steal(AcDispatcher* victim, AcDispatcher* thief,
+    AcDispatcherStealFilter can_steal);
+
+/**
+ * Move a particular component from one dispatcher to another if it
+ * isn't being processed, like AcDispatcher_steal its messages are
+ * still processed in order. It may be called from any thread, such
+ * as the one dispatching from or to, but neither from nor to may be
+ * returned while it's called.
+ *
+ * @param: from is the dispatcher the component is in
+ * @param: to is the dispatcher to move the component to
+ * @param: dc is the dispatchable component to move
+ *
+ * @return: AC_STATUS_OK if moved, AC_STATUS_NOT_AVAILABLE if it's not
+ * in from, is being processed or to is full. Also if it was removed
+ * while being moved, in which case it's removed here and dc is gone.
+ */
+AcStatus AcDispatcher_move(AcDispatcher* from, AcDispatcher* to, AcDispatchableComp* dc);
+
+/**
+ * Return the dispatcher a dispatchable component is in, this changes
+ * if it's stolen. If AcDispatcher_rmv_comp doesn't find a component
+ * and its owner has changed it should be retried with the new owner.
  */
-void AcDispatcher_send_msg(AcDispatchableComp* dc, AcMsg* msg);
+AcDispatcher* AcDispatcher_owner(AcDispatchableComp* dc);
 
 #endif
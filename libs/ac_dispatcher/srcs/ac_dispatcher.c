@@ -27,22 +27,64 @@
 #include <ac_msg.h>
 #include <ac_msg_pool.h>
 #include <ac_memmgr.h>
+#include <ac_next_ptr_mgr.h>
+#include <ac_receptor.h>
 #include <ac_string.h>
+#include <ac_tsc.h>
+
+/** Maximum number of senders waiting for space on a bounded AcDispatchableComp */
+#define DC_MAX_FULL_WAITERS 4
+
+/** Process all of the messages in a batch */
+#define DC_NO_QUANTUM (~(AcU32)0)
+
+/** Number of bits in each word of AcDispatcher.ready */
+#define READY_BITS (sizeof(AcUint) * 8)
+
+/**
+ * Where the ready bit of a slot in AcDispatcher.dcs is
+ */
+typedef struct ReadySlot {
+  AcUint* word;     ///< Word of AcDispatcher.ready holding the bit
+  AcUint bit;       ///< The bit in word
+} ReadySlot;
 
 /**
  * A Dispatchable Component
  */
 typedef struct AcDispatchableComp {
     AcComp* comp;     ///< The component
+    const AcCompHandlers* handlers; ///< Called before comp->process_msg, AC_NULL if none
+    AcDispatchableComp* parent; ///< Processes what comp doesn't, AC_NULL if none
+    AcDispatcher* owner; ///< Dispatcher we're in, changes if stolen
+    ReadySlot* ready_slot; ///< Our ready bit, changes if stolen
     AcMsgPool mp;     ///< Msg pool to send AC_INIT/AC_DEINIT commands
-    AcMpscLinkList q; ///< mpsc link list to which message are sent
+    AcU32 lane_count; ///< Number of lanes in use
+    AcU32 lane_quantum; ///< Messages processed from a lane before checking higher lanes
+    AcU32 starvation_limit; ///< Messages processed from higher lanes while a lower lane waits
+    AcU32 msg_budget; ///< Messages processed per turn, DC_NO_QUANTUM if unlimited
+    AcU64 tsc_budget; ///< Ticks processing per turn, 0 if unlimited
+    AcCompCounters counters; ///< Written only while dispatching
+    AcMpscLinkList lanes[AC_DISPATCHER_MAX_LANES]; ///< mpsc link lists to which message are sent
+    AcU32 capacity;   ///< If !0 the maximum depth of AC_LANE_NORMAL
+    AcU32 low_water;  ///< full_waiters are signaled when depth drops to low_water
+    AcU32 depth;      ///< Messages queued or being processed, only if capacity != 0
+    AcU32 waiter_count; ///< Number of full_waiters registered
+    AcReceptor* full_waiters[DC_MAX_FULL_WAITERS]; ///< Senders waiting for space
 } AcDispatchableComp;
 
 /**
  * A dispatcher
  */
 typedef struct AcDispatcher {
+  AcNextPtrMgrParticipant participant; ///< Keeps AcNextPtr's we use from being reused
   ac_u32 max_count;
+  AcU32 resume;       ///< Index of the dcs to start the next dispatch at
+  AcU64 msgs;         ///< Messages processed by AcDispatcher_dispatch
+  AcComp* current;    ///< Component AcDispatcher_dispatch is processing, if any
+  AcU32 ready_count;  ///< Number of words in ready
+  AcUint* ready;      ///< Bit i is set when dcs[i] may have messages
+  ReadySlot* ready_slots; ///< ready_slots[i] is where the bit for dcs[i] is
   AcDispatchableComp* dcs[];
 } AcDispatcher;
 
@@ -52,10 +94,34 @@ typedef struct AcDispatcher {
 /** d->AcDispatchableComp[i] messages are being processed by AcDispatcher */
 #define DC_PROCESSING  ((AcDispatchableComp*)(1))
 
+/**
+ * Deinit the first count lanes of a dc
+ */
+static void deinit_lanes(AcDispatchableComp* dc, AcU32 count) {
+  for (AcU32 lane = 0; lane < count; lane++) {
+    AcMpscLinkList_deinit(&dc->lanes[lane]);
+  }
+}
+
+/**
+ * Init lane_count lanes of a dc
+ */
+static AcStatus init_lanes(AcDispatchableComp* dc, AcU32 lane_count) {
+  for (AcU32 lane = 0; lane < lane_count; lane++) {
+    AcStatus status = AcMpscLinkList_init(&dc->lanes[lane]);
+    if (status != AC_STATUS_OK) {
+      deinit_lanes(dc, lane);
+      return status;
+    }
+  }
+  dc->lane_count = lane_count;
+  return AC_STATUS_OK;
+}
+
 /**
  * Get a AcDispatchableComp aka dc
  */
-static AcDispatchableComp* get_dc() {
+static AcDispatchableComp* get_dc(AcU32 lane_count) {
   AcDispatchableComp* dc = ac_malloc(sizeof(AcDispatchableComp));
   if (dc != AC_NULL) {
     // Allocate the msgs AC_INIT_CMD and AC_DEINIT_CMD
@@ -63,18 +129,82 @@ static AcDispatchableComp* get_dc() {
       ac_free(dc);
       dc = AC_NULL;
     } else {
-      if (AcMpscLinkList_init(&dc->q) != AC_STATUS_OK) {
+      if (init_lanes(dc, lane_count) != AC_STATUS_OK) {
         AcMsgPool_deinit(&dc->mp);
-        ac_free(&dc);
+        ac_free(dc);
         dc = AC_NULL;
       } else {
         // All is well
+        dc->lane_quantum = AC_LANE_QUANTUM_DEFAULT;
+        dc->starvation_limit = AC_LANE_STARVATION_LIMIT_DEFAULT;
+        dc->msg_budget = DC_NO_QUANTUM;
+        dc->tsc_budget = 0;
+        dc->handlers = AC_NULL;
+        dc->parent = AC_NULL;
+        dc->counters.dispatched = 0;
+        dc->counters.msgs = 0;
+        dc->counters.budget_exhausted = 0;
+        dc->capacity = 0;
+        dc->low_water = 0;
+        dc->depth = 0;
+        dc->waiter_count = 0;
+        for (AcU32 i = 0; i < DC_MAX_FULL_WAITERS; i++) {
+          dc->full_waiters[i] = AC_NULL;
+        }
       }
     }
   }
   return dc;
 }
 
+/**
+ * Signal all of the registered full_waiters
+ */
+static void wake_full_waiters(AcDispatchableComp* dc) {
+  for (AcU32 i = 0; i < DC_MAX_FULL_WAITERS; i++) {
+    AcReceptor* r = __atomic_exchange_n(&dc->full_waiters[i], AC_NULL, __ATOMIC_ACQ_REL);
+    if (r != AC_NULL) {
+      __atomic_fetch_sub(&dc->waiter_count, 1, __ATOMIC_RELEASE);
+      AcReceptor_signal(r);
+    }
+  }
+}
+
+/**
+ * The depth of a bounded dc has decreased to depth,
+ * wake the full_waiters if its at or below low_water.
+ */
+static inline void depth_decreased(AcDispatchableComp* dc, AcU32 depth) {
+  if ((depth <= dc->low_water)
+      && (__atomic_load_n(&dc->waiter_count, __ATOMIC_SEQ_CST) != 0)) {
+    wake_full_waiters(dc);
+  }
+}
+
+/**
+ * Have dc's component process msg, first with its handler for
+ * msg->op, if any, then its process_msg. If neither processes it
+ * the parent is given msg and so on up the hierarchy.
+ *
+ * @return AC_TRUE if msg was processed
+ */
+static inline AcBool dispatch_msg(AcDispatchableComp* dc, AcMsg* msg) {
+  do {
+    AcComp* comp = dc->comp;
+    if (dc->handlers != AC_NULL) {
+      AcCompMsgProcessor handler = AcCompHandlers_get(dc->handlers, msg->op);
+      if ((handler != AC_NULL) && handler(comp, msg)) {
+        return AC_TRUE;
+      }
+    }
+    if ((comp->process_msg != AC_NULL) && comp->process_msg(comp, msg)) {
+      return AC_TRUE;
+    }
+    dc = dc->parent;
+  } while (dc != AC_NULL);
+  return AC_FALSE;
+}
+
 /**
  * Return a AcDispatchableComp aka dc
  */
@@ -84,11 +214,14 @@ static void ret_dc(AcDispatchableComp* dc, ac_bool aborting) {
     if (!aborting) {
       AcMsg* msg = AcMsgPool_get_msg(&dc->mp);
       msg->op = AC_DEINIT_CMD;
-      dc->comp->process_msg(dc->comp, msg);
+      dispatch_msg(dc, msg);
       ac_debug_printf("ret_dc:  processed AC_DEINIT_CMD dc=%p\n", dc);
     }
 
-    AcMpscLinkList_deinit(&dc->q);
+    // Don't leave any senders waiting for space forever
+    wake_full_waiters(dc);
+
+    deinit_lanes(dc, dc->lane_count);
     AcMsgPool_deinit(&dc->mp);
     ac_free(dc);
   }
@@ -103,6 +236,9 @@ static void ret_dispatcher(AcDispatcher* d) {
   ac_debug_printf("ret_dispatcher:+ d=%p\n", d);
 
   if (d != AC_NULL) {
+    AcNextPtrMgr_unregister(&d->participant);
+    ac_free(d->ready_slots);
+    ac_free(d->ready);
     ac_free(d);
   }
 
@@ -118,9 +254,26 @@ static AcDispatcher* get_dispatcher(ac_u32 max_count) {
    AcDispatcher* d = ac_malloc(sizeof(AcDispatcher)
                           + (max_count * sizeof(AcDispatchableComp*)));
   if (d != AC_NULL) {
-      d->max_count = max_count;
-  } else {
-    ret_dispatcher(d);
+    d->max_count = max_count;
+    d->resume = 0;
+    d->msgs = 0;
+    d->current = AC_NULL;
+    d->ready_count = (max_count + READY_BITS - 1) / READY_BITS;
+    d->ready = ac_calloc(d->ready_count, sizeof(AcUint));
+    d->ready_slots = ac_malloc(max_count * sizeof(ReadySlot));
+    if (((d->ready == AC_NULL) && (d->ready_count != 0))
+        || ((d->ready_slots == AC_NULL) && (max_count != 0))) {
+      ac_free(d->ready_slots);
+      ac_free(d->ready);
+      ac_free(d);
+      d = AC_NULL;
+    } else {
+      for (AcU32 i = 0; i < max_count; i++) {
+        d->ready_slots[i].word = &d->ready[i / READY_BITS];
+        d->ready_slots[i].bit = (AcUint)1 << (i % READY_BITS);
+      }
+      AcNextPtrMgr_register(&d->participant);
+    }
   }
 
   ac_debug_printf("get_dispatcher:- d=%p\n", d);
@@ -129,27 +282,148 @@ static AcDispatcher* get_dispatcher(ac_u32 max_count) {
 
 
 /*
- * Process all of the messages on the AcDispatchableComp
- * return AC_TRUE if one or more were processed.
+ * Process up to max_count messages from a batch of a lane, stopping
+ * early if deadline is !0 and has passed. Return the number processed.
+ * The depth of a bounded dc drops as each message is processed, except
+ * for AC_INIT_CMD from dc->mp which isn't counted, see
+ * AcDispatcher_add_comp_params.
  */
-static ac_bool process_msgs(AcDispatchableComp* dc) {
+static AcU32 process_lane(AcDispatchableComp* dc, AcU32 lane, AcMpscLinkListBatch* batch,
+    AcU32 max_count, AcU64 deadline) {
+  AcMpscLinkList* q = &dc->lanes[lane];
+  AcBool bounded = (lane == AC_LANE_NORMAL) && (dc->capacity != 0);
+  AcMsg* pmsg;
+  AcU32 count = 0;
+  while ((count < max_count) && ((pmsg = AcMpscLinkList_batch_rmv(q, batch)) != AC_NULL)) {
+    ac_debug_printf("process_lane:  dc=%p lane=%d msg=%p\n", dc, lane, pmsg);
+    AcBool counted = bounded && (pmsg->mp != &dc->mp);
+    dispatch_msg(dc, pmsg);
+    if (counted) {
+      depth_decreased(dc, __atomic_sub_fetch(&dc->depth, 1, __ATOMIC_SEQ_CST));
+    }
+    count += 1;
+    if ((deadline != 0) && (ac_tscrd() >= deadline)) {
+      break;
+    }
+  }
+  return count;
+}
+
+/**
+ * A message has been added to one of dc's lanes, mark it ready if
+ * it isn't already. AcMpscLinkList_add and this load are SEQ_CST as are
+ * AcDispatcher_dispatch claiming the bits and AcMpscLinkList_rmv_all
+ * looking at the lanes afterwards. So either we see the bit still set
+ * and the dispatcher will see our message or we see it clear and set it.
+ * If we see the ready_slot from before dc was stolen the thief sets
+ * its bit after changing ready_slot, see AcDispatcher_steal.
+ */
+static inline void set_ready(AcDispatchableComp* dc) {
+  ReadySlot* rs = __atomic_load_n(&dc->ready_slot, __ATOMIC_SEQ_CST);
+  if ((__atomic_load_n(rs->word, __ATOMIC_SEQ_CST) & rs->bit) == 0) {
+    __atomic_fetch_or(rs->word, rs->bit, __ATOMIC_SEQ_CST);
+  }
+}
+
+/*
+ * Return AC_TRUE if any of the lanes of dc have messages
+ */
+static AcBool has_msgs(AcDispatchableComp* dc) {
+  for (AcU32 lane = 0; lane < dc->lane_count; lane++) {
+    AcMpscLinkListBatch batch;
+    if (AcMpscLinkList_rmv_all(&dc->lanes[lane], &batch)) {
+      return AC_TRUE;
+    }
+  }
+  return AC_FALSE;
+}
+
+/*
+ * Process the messages on the AcDispatchableComp until there are
+ * none or its budget is exhausted, in which case it's marked ready
+ * so it's processed again after the other components.
+ * return the number of messages processed.
+ */
+static AcU32 process_msgs(AcDispatchableComp* dc) {
   ac_debug_printf("process_msgs:+ dc=%p\n", dc);
-  AcMpscLinkList_debug_print("process_msgs: q", &dc->q);
+  AcMpscLinkList_debug_print("process_msgs: q", &dc->lanes[AC_LANE_NORMAL]);
+
+  AcU32 msgs = 0;
+  AcU32 budget = dc->msg_budget;
+  AcU64 deadline = (dc->tsc_budget != 0) ? ac_tscrd() + dc->tsc_budget : 0;
+  AcBool exhausted = AC_FALSE;
+  if (dc->lane_count == 1) {
+    AcMpscLinkListBatch batch;
+    while (!exhausted && AcMpscLinkList_rmv_all(&dc->lanes[AC_LANE_NORMAL], &batch)) {
+      AcU32 count = process_lane(dc, AC_LANE_NORMAL, &batch, budget, deadline);
+      msgs += count;
+      if (budget != DC_NO_QUANTUM) {
+        budget -= count;
+        exhausted = (budget == 0);
+      }
+      exhausted |= (deadline != 0) && (ac_tscrd() >= deadline);
+    }
+  } else {
+    // Messages processed from higher lanes while a lower lane waited
+    AcU32 passed_over = 0;
+    while (!exhausted) {
+      // Find the highest and lowest lanes with messages
+      AcMpscLinkListBatch batches[AC_DISPATCHER_MAX_LANES];
+      AcU32 highest = 0;
+      AcU32 lowest = 0;
+      AcBool found = AC_FALSE;
+      for (AcU32 lane = 0; lane < dc->lane_count; lane++) {
+        if (AcMpscLinkList_rmv_all(&dc->lanes[lane], &batches[lane])) {
+          if (!found) {
+            lowest = lane;
+            found = AC_TRUE;
+          }
+          highest = lane;
+        }
+      }
+      if (!found) {
+        break;
+      }
 
-  ac_bool processed_a_msg = AC_FALSE;
-  AcMsg* pmsg = AcMpscLinkList_rmv(&dc->q);
-  while (pmsg != AC_NULL) {
-    ac_debug_printf("process_msgs:  dc=%p msg=%p msg->arg1=%lx\n", dc, pmsg, pmsg->arg1);
-    dc->comp->process_msg(dc->comp, pmsg);
+      // Usually the highest lane, but give the lowest a turn
+      // if its been waiting too long. The batches not processed
+      // are abandoned and their messages stay on the lanes.
+      AcU32 lane = highest;
+      if (highest == lowest) {
+        passed_over = 0;
+      } else if (passed_over >= dc->starvation_limit) {
+        lane = lowest;
+        passed_over = 0;
+      }
+      AcU32 quantum = (dc->lane_quantum < budget) ? dc->lane_quantum : budget;
+      AcU32 count = process_lane(dc, lane, &batches[lane], quantum, deadline);
+      if (lane != lowest) {
+        passed_over += count;
+      }
+      msgs += count;
+      if (budget != DC_NO_QUANTUM) {
+        budget -= count;
+        exhausted = (budget == 0);
+      }
+      exhausted |= (deadline != 0) && (ac_tscrd() >= deadline);
+    }
+  }
 
-    // Get next message
-    pmsg = AcMpscLinkList_rmv(&dc->q);
-    processed_a_msg = AC_TRUE;
+  if (msgs != 0) {
+    __atomic_store_n(&dc->counters.dispatched, dc->counters.dispatched + 1,
+        __ATOMIC_RELAXED);
+    __atomic_store_n(&dc->counters.msgs, dc->counters.msgs + msgs,
+        __ATOMIC_RELAXED);
+  }
+  if (exhausted && has_msgs(dc)) {
+    __atomic_store_n(&dc->counters.budget_exhausted, dc->counters.budget_exhausted + 1,
+        __ATOMIC_RELAXED);
+    set_ready(dc);
   }
 
-  ac_debug_printf("process_msgs:- dc=%p processed_a_msg=%d\n",
-      dc, processed_a_msg);
-  return processed_a_msg;
+  ac_debug_printf("process_msgs:- dc=%p msgs=%d exhausted=%d\n",
+      dc, msgs, exhausted);
+  return msgs;
 }
 
 /*
@@ -169,8 +443,9 @@ static void rmv_dc(AcDispatcher* d, int dc_idx) {
   // and ac_dispatch will not change it back.
   if ((dc != DC_EMPTY) && (dc != DC_PROCESSING)) {
     // Process the messages as its not empty and ac_dispatch
-    // isn't alreday process.
-    process_msgs(dc);
+    // isn't alreday process, ignoring its budget.
+    while (process_msgs(dc)) {
+    }
 
     ret_dc(dc, AC_FALSE);
 
@@ -198,51 +473,130 @@ ac_bool AcDispatcher_dispatch(AcDispatcher* d) {
     return processed_msgs;
   }
 
-  for (int i = 0; i < d->max_count; i++) {
-    // Mark this AcDispatchableComp that we're processing
-    AcDispatchableComp** pq = &d->dcs[i];
-    AcDispatchableComp* q = __atomic_exchange_n(pq, DC_PROCESSING,__ATOMIC_ACQUIRE);
-
-    // If q == DC_EMPTY then this entry is already removed or
-    // will be so we're just store DC_EMPTY
-    //
-    // If q == DC_PROCESSING then someone else is processing
-    // this and we should do nothing.
-    //
-    // If q is nither than we're going to process the AcDispatchableComp.
-    if (q == DC_EMPTY) {
-      ac_debug_printf("ac_dispatch: skip empty entry d=%p i=%d\n",
-          d, i);
-       __atomic_store_n(pq, DC_EMPTY, __ATOMIC_RELEASE);
-    } else if (q == DC_PROCESSING) {
-      ac_debug_printf("ac_dispatch: skip busy entry d=%p i=%d\n",
-          d, i);
+  AcNextPtrMgr_enter(&d->participant);
+
+  // Only visit the dcs whose bit is set in ready, round robin starting
+  // after the last one processed. The bits of the first word below the
+  // starting point are held back and visited last.
+  AcU32 first = (d->resume < d->max_count) ? d->resume : 0;
+  AcU32 first_w = first / READY_BITS;
+  AcUint below_first = ((AcUint)1 << (first % READY_BITS)) - 1;
+  AcUint held_back = 0;
+  for (AcU32 n = 0; n <= d->ready_count; n++) {
+    AcU32 w;
+    AcUint bits;
+    if (n == d->ready_count) {
+      w = first_w;
+      bits = held_back;
     } else {
-      ac_debug_printf("ac_dispatch: process msgs d=%p i=%d\n",
-          d, i);
-      processed_msgs = process_msgs(q);
-      /*const*/ AcDispatchableComp* dc_processing = DC_PROCESSING;
-
-      // Now restore the previous q if it is still DC_PROCESSING.
-      ac_bool restored = __atomic_compare_exchange_n(
-                          pq, &dc_processing, q,
-                          AC_TRUE, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE);
-      if (!restored) {
-        // It wasn't restored the only possibility is that while
-        // we were processing rmv_dc was invoked and the q is
-        // now DC_EMPTY so we need to finish the removal.
-        ac_debug_printf("ac_dispatch: ret_acq as we won race with rmv_dc"
-            " d=%p i=%d\n", d, i);
-        ret_dc(q, AC_FALSE);
+      w = (first_w + n) % d->ready_count;
+      // SEQ_CST as a dispatch thread parks and then calls us to check
+      // for messages, while senders check if it's parked after sending
+      if (__atomic_load_n(&d->ready[w], __ATOMIC_SEQ_CST) == 0) {
+        continue;
+      }
+      // Claim the bits before looking at the lanes, see set_ready
+      bits = __atomic_exchange_n(&d->ready[w], 0, __ATOMIC_SEQ_CST);
+      if (n == 0) {
+        held_back = bits & below_first;
+        bits &= ~below_first;
+      }
+    }
+
+    while (bits != 0) {
+      AcU32 i = (w * READY_BITS) + __builtin_ctzll((AcU64)bits);
+      bits &= bits - 1;
+
+      // Mark this AcDispatchableComp that we're processing
+      AcDispatchableComp** pq = &d->dcs[i];
+      AcDispatchableComp* q = __atomic_exchange_n(pq, DC_PROCESSING,__ATOMIC_ACQUIRE);
+
+      // If q == DC_EMPTY then this entry is already removed or
+      // will be so we're just store DC_EMPTY
+      //
+      // If q == DC_PROCESSING then someone else is processing
+      // this, leave it ready so it's looked at again.
+      //
+      // If q is nither than we're going to process the AcDispatchableComp.
+      if (q == DC_EMPTY) {
+        ac_debug_printf("ac_dispatch: skip empty entry d=%p i=%d\n",
+            d, i);
+         __atomic_store_n(pq, DC_EMPTY, __ATOMIC_RELEASE);
+      } else if (q == DC_PROCESSING) {
+        ac_debug_printf("ac_dispatch: skip busy entry d=%p i=%d\n",
+            d, i);
+        __atomic_fetch_or(&d->ready[w], (AcUint)1 << (i % READY_BITS), __ATOMIC_SEQ_CST);
+      } else {
+        ac_debug_printf("ac_dispatch: process msgs d=%p i=%d\n",
+            d, i);
+        __atomic_store_n(&d->current, q->comp, __ATOMIC_RELAXED);
+        AcU32 msgs = process_msgs(q);
+        __atomic_store_n(&d->current, AC_NULL, __ATOMIC_RELAXED);
+        processed_msgs |= (msgs != 0);
+        __atomic_store_n(&d->msgs, d->msgs + msgs, __ATOMIC_RELAXED);
+        d->resume = i + 1;
+        /*const*/ AcDispatchableComp* dc_processing = DC_PROCESSING;
+
+        // Now restore the previous q if it is still DC_PROCESSING.
+        ac_bool restored = __atomic_compare_exchange_n(
+                            pq, &dc_processing, q,
+                            AC_TRUE, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE);
+        if (!restored) {
+          // It wasn't restored the only possibility is that while
+          // we were processing rmv_dc was invoked and the q is
+          // now DC_EMPTY so we need to finish the removal.
+          ac_debug_printf("ac_dispatch: ret_acq as we won race with rmv_dc"
+              " d=%p i=%d\n", d, i);
+          ret_dc(q, AC_FALSE);
+        }
       }
     }
   }
 
+  AcNextPtrMgr_exit(&d->participant);
+
   ac_debug_printf("ac_dispatch:- d=%p processed_msgs=%d\n",
       d, processed_msgs);
   return processed_msgs;
 }
 
+/**
+ * @see ac_dispatcher.h
+ */
+AcBool AcDispatcher_ready(AcDispatcher* d) {
+  for (AcU32 w = 0; w < d->ready_count; w++) {
+    if (__atomic_load_n(&d->ready[w], __ATOMIC_RELAXED) != 0) {
+      return AC_TRUE;
+    }
+  }
+  return AC_FALSE;
+}
+
+/**
+ * @see ac_dispatcher.h
+ */
+AcU64 AcDispatcher_get_msgs(AcDispatcher* d) {
+  return __atomic_load_n(&d->msgs, __ATOMIC_RELAXED);
+}
+
+/**
+ * @see ac_dispatcher.h
+ */
+AcU32 AcDispatcher_ready_count(AcDispatcher* d) {
+  AcU32 count = (__atomic_load_n(&d->current, __ATOMIC_RELAXED) != AC_NULL) ? 1 : 0;
+  for (AcU32 w = 0; w < d->ready_count; w++) {
+    count += __builtin_popcountll((AcU64)__atomic_load_n(&d->ready[w], __ATOMIC_RELAXED));
+  }
+  return count;
+}
+
+/**
+ * @see ac_dispatcher.h
+ */
+AcComp* AcDispatcher_current(AcDispatcher* d) {
+  return __atomic_load_n(&d->current, __ATOMIC_RELAXED);
+}
+
 /**
  * Get a dispatcher ready to be used and that can support
  * upto max_count AcDispatchableComp's.
@@ -285,8 +639,38 @@ void AcDispatcher_ret(AcDispatcher* d) {
  * this will occur if there are to many AcComp's registered.
  */
 AcDispatchableComp* AcDispatcher_add_comp(AcDispatcher* d, AcComp* comp) {
-  ac_debug_printf("AcDispatcher_add_comp:+ d=%p d->max_count=%d comp=%p\n",
-      d, d->max_count, comp);
+  return AcDispatcher_add_comp_params(d, comp, AC_NULL);
+}
+
+/**
+ * Add the AcComp to this dispatcher with a bounded queue
+ *
+ * @return: AcDispatableComp* or AC_NULL if an error,
+ * this will occur if there are to many AcComp's registered.
+ */
+AcDispatchableComp* AcDispatcher_add_comp_bounded(AcDispatcher* d, AcComp* comp,
+    AcU32 capacity, AcU32 low_water) {
+  AcCompParams params = {
+    .capacity = capacity,
+    .low_water = low_water,
+  };
+  return AcDispatcher_add_comp_params(d, comp, &params);
+}
+
+/**
+ * Add the AcComp to this dispatcher with the given parameters
+ *
+ * @return: AcDispatableComp* or AC_NULL if an error,
+ * this will occur if there are to many AcComp's registered.
+ */
+AcDispatchableComp* AcDispatcher_add_comp_params(AcDispatcher* d, AcComp* comp,
+    const AcCompParams* params) {
+  static const AcCompParams default_params = { 0 };
+  if (params == AC_NULL) {
+    params = &default_params;
+  }
+  ac_debug_printf("AcDispatcher_add_comp:+ d=%p d->max_count=%d comp=%p capacity=%u"
+      " lane_count=%u\n", d, d->max_count, comp, params->capacity, params->lane_count);
 
   if (d == AC_NULL) {
     ac_debug_printf("AcDispatcher_add_comp:- ERR no d"
@@ -300,8 +684,8 @@ AcDispatchableComp* AcDispatcher_add_comp(AcDispatcher* d, AcComp* comp) {
     return AC_NULL;
   }
 
-  if (comp->process_msg == AC_NULL) {
-    ac_debug_printf("AcDispatcher_add_comp:- ERR no comp->process_msg"
+  if ((comp->process_msg == AC_NULL) && (params->handlers == AC_NULL)) {
+    ac_debug_printf("AcDispatcher_add_comp:- ERR no comp->process_msg or handlers"
         " d=%p comp=%p\n", d, comp);
     return AC_NULL;
   }
@@ -312,8 +696,26 @@ AcDispatchableComp* AcDispatcher_add_comp(AcDispatcher* d, AcComp* comp) {
     return AC_NULL;
   }
 
+  if ((params->capacity != 0) && (params->low_water >= params->capacity)) {
+    ac_debug_printf("AcDispatcher_add_comp:- ERR low_water >= capacity"
+        " d=%p comp=%p\n", d, comp);
+    return AC_NULL;
+  }
+
+  if (params->lane_count > AC_DISPATCHER_MAX_LANES) {
+    ac_debug_printf("AcDispatcher_add_comp:- ERR lane_count > AC_DISPATCHER_MAX_LANES"
+        " d=%p comp=%p\n", d, comp);
+    return AC_NULL;
+  }
+
+  if ((params->parent != AC_NULL) && (params->parent->ci.dc == AC_NULL)) {
+    ac_debug_printf("AcDispatcher_add_comp:- ERR parent not added"
+        " d=%p comp=%p\n", d, comp);
+    return AC_NULL;
+  }
+
   // Get the AcDispatchableComp and initialize
-  AcDispatchableComp* dc = get_dc();
+  AcDispatchableComp* dc = get_dc((params->lane_count != 0) ? params->lane_count : 1);
   if (dc == AC_NULL) {
     ac_debug_printf("AcDispatcher_add_comp:- ERR no AcDispatchableComp's"
         " d=%p comp=%p\n", d, comp);
@@ -321,6 +723,20 @@ AcDispatchableComp* AcDispatcher_add_comp(AcDispatcher* d, AcComp* comp) {
   }
   // BUG: This is coping a pointer to the name the name maybe removed!!!!
   dc->comp = comp;
+  dc->capacity = params->capacity;
+  dc->low_water = params->low_water;
+  if (params->lane_quantum != 0) {
+    dc->lane_quantum = params->lane_quantum;
+  }
+  if (params->starvation_limit != 0) {
+    dc->starvation_limit = params->starvation_limit;
+  }
+  if (params->msg_budget != 0) {
+    dc->msg_budget = params->msg_budget;
+  }
+  dc->tsc_budget = params->tsc_budget;
+  dc->handlers = params->handlers;
+  dc->parent = (params->parent != AC_NULL) ? params->parent->ci.dc : AC_NULL;
 
   // Find a slot in the array to save the dc
   for (int i = 0; i < d->max_count; i++) {
@@ -328,6 +744,8 @@ AcDispatchableComp* AcDispatcher_add_comp(AcDispatcher* d, AcComp* comp) {
     AcDispatchableComp* dc_empty = DC_EMPTY;
     ac_debug_printf("AcDispatcher_add_comp: i=%d *pdc=%p dc_empty=%p\n",
           i, *pdc, dc_empty);
+    dc->owner = d;
+    dc->ready_slot = &d->ready_slots[i];
     if (__atomic_compare_exchange_n(
            pdc, &dc_empty, dc,
            AC_TRUE, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
@@ -335,7 +753,11 @@ AcDispatchableComp* AcDispatcher_add_comp(AcDispatcher* d, AcComp* comp) {
       AcMsg* msg = AcMsgPool_get_msg(&dc->mp);
       ac_debug_printf("AcDispatcher_add_comp:  got msg for AC_INIT_CMD msg=%p\n", msg);
       msg->op = AC_INIT_CMD;
-      AcDispatcher_send_msg(dc, msg);
+
+      // Not counted in the depth of a bounded dc, so it doesn't
+      // take the place of a sender's message
+      AcMpscLinkList_add(&dc->lanes[AC_LANE_NORMAL], msg);
+      set_ready(dc);
       ac_debug_printf("AcDispatcher_add_comp:- OK d=%p comp=%p dc=%p msg=%p msg->arg1=%lx\n",
           d, comp, dc, msg, msg->arg1);
       return dc;
@@ -400,7 +822,238 @@ done:
  *
  * @param: dc1 is the dispatchable component previously added.
  * @param: msg is the message to send
+ *
+ * @return AC_STATUS_OK or AC_STATUS_QUEUE_FULL
+ */
+AcStatus AcDispatcher_send_msg(AcDispatchableComp* dc, AcMsg* msg) {
+  return AcDispatcher_send_msg_lane(dc, msg, AC_LANE_NORMAL);
+}
+
+/**
+ * @see ac_dispatcher.h
+ */
+AcStatus AcDispatcher_send_msg_lane(AcDispatchableComp* dc, AcMsg* msg, AcU32 lane) {
+  if (lane >= dc->lane_count) {
+    lane = dc->lane_count - 1;
+  }
+  if (lane != AC_LANE_NORMAL) {
+    AcMpscLinkList_add(&dc->lanes[lane], msg);
+    set_ready(dc);
+    return AC_STATUS_OK;
+  }
+
+  if (dc->capacity != 0) {
+    // Reserve our place, backing out if there wasn't one. Backing out
+    // may be what takes the depth to low_water so check for waiters.
+    if (__atomic_fetch_add(&dc->depth, 1, __ATOMIC_SEQ_CST) >= dc->capacity) {
+      depth_decreased(dc, __atomic_sub_fetch(&dc->depth, 1, __ATOMIC_SEQ_CST));
+      return AC_STATUS_QUEUE_FULL;
+    }
+  }
+  AcMpscLinkList_add(&dc->lanes[AC_LANE_NORMAL], msg);
+  set_ready(dc);
+  return AC_STATUS_OK;
+}
+
+/**
+ * @see ac_dispatcher.h
+ */
+void AcDispatcher_notify_when_not_full(AcDispatchableComp* dc, AcReceptor* space_available) {
+  if (dc->capacity == 0) {
+    AcReceptor_signal(space_available);
+    return;
+  }
+
+  // Count ourselves first so a consumer that decreases the depth
+  // after this will look at full_waiters.
+  __atomic_fetch_add(&dc->waiter_count, 1, __ATOMIC_SEQ_CST);
+  AcBool registered = AC_FALSE;
+  for (AcU32 i = 0; !registered && (i < DC_MAX_FULL_WAITERS); i++) {
+    AcReceptor* empty = AC_NULL;
+    registered = __atomic_compare_exchange_n(&dc->full_waiters[i], &empty,
+        space_available, AC_FALSE, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+  }
+  if (!registered) {
+    // No room, let the caller retry
+    __atomic_fetch_sub(&dc->waiter_count, 1, __ATOMIC_RELEASE);
+    AcReceptor_signal(space_available);
+    return;
+  }
+
+  // The depth may have dropped before we were registered
+  if (__atomic_load_n(&dc->depth, __ATOMIC_SEQ_CST) <= dc->low_water) {
+    wake_full_waiters(dc);
+  }
+}
+
+/**
+ * @see ac_dispatcher.h
+ */
+void AcDispatcher_get_counters(AcDispatchableComp* dc, AcCompCounters* counters) {
+  counters->dispatched = __atomic_load_n(&dc->counters.dispatched, __ATOMIC_RELAXED);
+  counters->msgs = __atomic_load_n(&dc->counters.msgs, __ATOMIC_RELAXED);
+  counters->budget_exhausted =
+    __atomic_load_n(&dc->counters.budget_exhausted, __ATOMIC_RELAXED);
+}
+
+/**
+ * @see ac_dispatcher.h
+ */
+AcDispatcher* AcDispatcher_owner(AcDispatchableComp* dc) {
+  return __atomic_load_n(&dc->owner, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * Reserve a slot in thief, it's ours as long as it's DC_PROCESSING
+ *
+ * @return: index of the slot or thief->max_count if it's full
+ */
+static AcU32 reserve_slot(AcDispatcher* thief) {
+  AcU32 j;
+  for (j = 0; j < thief->max_count; j++) {
+    AcDispatchableComp* dc_empty = DC_EMPTY;
+    if (__atomic_compare_exchange_n(&thief->dcs[j], &dc_empty, DC_PROCESSING,
+          AC_TRUE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      break;
+    }
+  }
+  return j;
+}
+
+/**
+ * Give back dc, which we've marked DC_PROCESSING at *pdc, without
+ * moving it. If rmv_dc emptied the slot while we held it, it left
+ * the removal to us, so dc is removed here.
+ *
+ * @return: AC_TRUE if dc was given back, AC_FALSE if it was removed
+ */
+static AcBool unclaim_dc(AcDispatchableComp** pdc, AcDispatchableComp* dc) {
+  AcDispatchableComp* dc_processing = DC_PROCESSING;
+  if (!__atomic_compare_exchange_n(pdc, &dc_processing, dc,
+        AC_FALSE, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+    ac_debug_printf("unclaim_dc: lost race with rmv_dc dc=%p\n", dc);
+    while (process_msgs(dc)) {
+    }
+    ret_dc(dc, AC_FALSE);
+    return AC_FALSE;
+  }
+
+  // Senders may have seen it ready while we held it
+  set_ready(dc);
+  return AC_TRUE;
+}
+
+/**
+ * Move dc, which we've marked DC_PROCESSING at *pdc, to the slot j
+ * reserved in thief.
+ *
+ * The owner changes before the victim's slot is emptied so
+ * AcDispatcher_rmv_comp callers can tell they need to retry.
+ * Senders which saw the old ready_slot added their messages
+ * before we set the bit in the new one, so we'll see them.
+ *
+ * If rmv_dc emptied the victim's slot while we held it, it left the
+ * removal to us just as it does to AcDispatcher_dispatch, so the move
+ * is abandoned, slot j is given back and dc is removed here.
+ *
+ * @return: AC_TRUE if dc was moved
  */
-void AcDispatcher_send_msg(AcDispatchableComp* dc, AcMsg* msg) {
-  AcMpscLinkList_add(&dc->q, msg);
+static AcBool move_dc(AcDispatchableComp** pdc, AcDispatchableComp* dc,
+    AcDispatcher* thief, AcU32 j) {
+  __atomic_store_n(&dc->owner, thief, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&dc->ready_slot, &thief->ready_slots[j], __ATOMIC_SEQ_CST);
+  AcDispatchableComp* dc_processing = DC_PROCESSING;
+  if (!__atomic_compare_exchange_n(pdc, &dc_processing, DC_EMPTY,
+        AC_FALSE, __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE)) {
+    ac_debug_printf("move_dc: lost race with rmv_dc dc=%p\n", dc);
+    __atomic_store_n(&thief->dcs[j], DC_EMPTY, __ATOMIC_RELEASE);
+    while (process_msgs(dc)) {
+    }
+    ret_dc(dc, AC_FALSE);
+    return AC_FALSE;
+  }
+  __atomic_store_n(&thief->dcs[j], dc, __ATOMIC_RELEASE);
+  set_ready(dc);
+  return AC_TRUE;
+}
+
+/**
+ * @see ac_dispatcher.h
+ */
+AcComp* AcDispatcher_steal(AcDispatcher* victim, AcDispatcher* thief,
+    AcDispatcherStealFilter can_steal) {
+  ac_debug_printf("AcDispatcher_steal:+ victim=%p thief=%p\n", victim, thief);
+  AcComp* comp = AC_NULL;
+
+  // The slot in thief is only reserved once a candidate is claimed, so
+  // thief doesn't look full to those adding to it while we look
+  for (AcU32 w = 0; (comp == AC_NULL) && (w < victim->ready_count); w++) {
+    AcUint bits = __atomic_load_n(&victim->ready[w], __ATOMIC_SEQ_CST);
+    while ((comp == AC_NULL) && (bits != 0)) {
+      AcU32 i = (w * READY_BITS) + __builtin_ctzll((AcU64)bits);
+      bits &= bits - 1;
+
+      // Only a dc which isn't being processed, the victim's dispatcher
+      // skips it while it's DC_PROCESSING just as if it were being
+      // processed by another dispatcher, so it has a single consumer
+      AcDispatchableComp** pdc = &victim->dcs[i];
+      AcDispatchableComp* dc = __atomic_load_n(pdc, __ATOMIC_ACQUIRE);
+      if ((dc == DC_EMPTY) || (dc == DC_PROCESSING)
+          || ((can_steal != AC_NULL) && !can_steal(dc->comp))
+          || !__atomic_compare_exchange_n(pdc, &dc, DC_PROCESSING,
+                AC_FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        continue;
+      }
+
+      AcU32 j = reserve_slot(thief);
+      if (j == thief->max_count) {
+        unclaim_dc(pdc, dc);
+        ac_debug_printf("AcDispatcher_steal:- thief full\n");
+        return AC_NULL;
+      }
+      if (!move_dc(pdc, dc, thief, j)) {
+        // It was removed and slot j given back, so we're done
+        ac_debug_printf("AcDispatcher_steal:- victim=%p thief=%p removed\n", victim, thief);
+        return AC_NULL;
+      }
+      comp = dc->comp;
+    }
+  }
+
+  ac_debug_printf("AcDispatcher_steal:- victim=%p thief=%p comp=%p\n", victim, thief, comp);
+  return comp;
+}
+
+/**
+ * @see ac_dispatcher.h
+ */
+AcStatus AcDispatcher_move(AcDispatcher* from, AcDispatcher* to, AcDispatchableComp* dc) {
+  ac_debug_printf("AcDispatcher_move:+ from=%p to=%p dc=%p\n", from, to, dc);
+  AcStatus status = AC_STATUS_NOT_AVAILABLE;
+
+  if (__atomic_load_n(&dc->owner, __ATOMIC_SEQ_CST) != from) {
+    goto done;
+  }
+
+  // Our ready_slot is where we are in from, and
+  // we can only be moved if we're not being processed
+  AcU32 i = __atomic_load_n(&dc->ready_slot, __ATOMIC_SEQ_CST) - from->ready_slots;
+  AcDispatchableComp* expected = dc;
+  if ((i >= from->max_count)
+      || !__atomic_compare_exchange_n(&from->dcs[i], &expected, DC_PROCESSING,
+            AC_FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+    goto done;
+  }
+
+  // Like AcDispatcher_steal reserve the slot in to once dc is claimed
+  AcU32 j = reserve_slot(to);
+  if (j == to->max_count) {
+    unclaim_dc(&from->dcs[i], dc);
+  } else if (move_dc(&from->dcs[i], dc, to, j)) {
+    status = AC_STATUS_OK;
+  }
+
+done:
+  ac_debug_printf("AcDispatcher_move:- from=%p to=%p dc=%p status=%d\n", from, to, dc, status);
+  return status;
 }
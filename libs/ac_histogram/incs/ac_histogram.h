@@ -0,0 +1,109 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * An AcHistogram records AcU64 values, typically ac_tscrd ticks, in
+ * log linear buckets. Each power of 2 is split into
+ * AC_HISTOGRAM_SUB_BUCKETS so a value is reported with an error of at
+ * most 1/AC_HISTOGRAM_SUB_BUCKETS. Recording is a few instructions so
+ * it may be used in perf loops. An AcHistogram is not thread safe,
+ * each thread should record into its own and use AcHistogram_add to
+ * combine them.
+ */
+
+#ifndef SADIE_LIBS_AC_HISTOGRAM_INCS_AC_HISTOGRAM_H
+#define SADIE_LIBS_AC_HISTOGRAM_INCS_AC_HISTOGRAM_H
+
+#include <ac_inttypes.h>
+
+#define AC_HISTOGRAM_SUB_BUCKET_BITS 4
+#define AC_HISTOGRAM_SUB_BUCKETS (1 << AC_HISTOGRAM_SUB_BUCKET_BITS)
+#define AC_HISTOGRAM_BUCKETS \
+  ((64 - AC_HISTOGRAM_SUB_BUCKET_BITS + 1) * AC_HISTOGRAM_SUB_BUCKETS)
+
+typedef struct AcHistogram {
+  AcU64 count;                        ///< Number of values recorded
+  AcU64 min;                          ///< Smallest value recorded
+  AcU64 max;                          ///< Largest value recorded
+  AcU64 sum;                          ///< Sum of the values recorded
+  AcU64 buckets[AC_HISTOGRAM_BUCKETS];
+} AcHistogram;
+
+/**
+ * Index of the bucket for value
+ */
+static inline AcU32 AcHistogram_bucket_idx(AcU64 value) {
+  if (value < AC_HISTOGRAM_SUB_BUCKETS) {
+    return (AcU32)value;
+  }
+  AcU32 msb = 63 - __builtin_clzll(value);
+  AcU32 shift = msb - AC_HISTOGRAM_SUB_BUCKET_BITS;
+  return ((shift + 1) * AC_HISTOGRAM_SUB_BUCKETS)
+    + (AcU32)((value >> shift) & (AC_HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+/**
+ * Record a value
+ */
+static inline void AcHistogram_record(AcHistogram* h, AcU64 value) {
+  h->buckets[AcHistogram_bucket_idx(value)] += 1;
+  h->count += 1;
+  h->sum += value;
+  if (value < h->min) {
+    h->min = value;
+  }
+  if (value > h->max) {
+    h->max = value;
+  }
+}
+
+/**
+ * Smallest value that is placed in bucket idx
+ */
+AcU64 AcHistogram_bucket_lo(AcU32 idx);
+
+/**
+ * Add the values recorded in src to dst
+ */
+void AcHistogram_add(AcHistogram* dst, const AcHistogram* src);
+
+/**
+ * Return the value per_mille/1000 of the recorded values are less than
+ * or equal to, so 500 is the median and 999 is p99.9. The value is the
+ * top of the bucket it falls in, but never more than max.
+ *
+ * @return the value or 0 if nothing has been recorded
+ */
+AcU64 AcHistogram_percentile(const AcHistogram* h, AcU32 per_mille);
+
+/**
+ * Print count, min, p50, p99, p99.9 and max on one line with
+ * leader prefixed, the values are ticks printed as times.
+ */
+void AcHistogram_print_summary(const char* leader, const AcHistogram* h);
+
+/**
+ * Print the non-empty buckets one per line with leader prefixed,
+ * the values are ticks printed as times.
+ */
+void AcHistogram_print_buckets(const char* leader, const AcHistogram* h);
+
+/**
+ * Initialize a histogram with nothing recorded
+ */
+void AcHistogram_init(AcHistogram* h);
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define NDEBUG
+
+#include <ac_histogram.h>
+
+#include <ac_debug_printf.h>
+#include <ac_inttypes.h>
+#include <ac_memset.h>
+#include <ac_printf.h>
+
+/**
+ * @see ac_histogram.h
+ */
+AcU64 AcHistogram_bucket_lo(AcU32 idx) {
+  if (idx < AC_HISTOGRAM_SUB_BUCKETS) {
+    return idx;
+  }
+  AcU32 shift = (idx / AC_HISTOGRAM_SUB_BUCKETS) - 1;
+  AcU64 sub = idx & (AC_HISTOGRAM_SUB_BUCKETS - 1);
+  return (AC_HISTOGRAM_SUB_BUCKETS + sub) << shift;
+}
+
+/**
+ * Largest value that is placed in bucket idx
+ */
+static AcU64 bucket_hi(AcU32 idx) {
+  if (idx == (AC_HISTOGRAM_BUCKETS - 1)) {
+    return ~(AcU64)0;
+  }
+  return AcHistogram_bucket_lo(idx + 1) - 1;
+}
+
+/**
+ * @see ac_histogram.h
+ */
+void AcHistogram_add(AcHistogram* dst, const AcHistogram* src) {
+  for (AcU32 i = 0; i < AC_HISTOGRAM_BUCKETS; i++) {
+    dst->buckets[i] += src->buckets[i];
+  }
+  dst->count += src->count;
+  dst->sum += src->sum;
+  if (src->min < dst->min) {
+    dst->min = src->min;
+  }
+  if (src->max > dst->max) {
+    dst->max = src->max;
+  }
+}
+
+/**
+ * @see ac_histogram.h
+ */
+AcU64 AcHistogram_percentile(const AcHistogram* h, AcU32 per_mille) {
+  if (h->count == 0) {
+    return 0;
+  }
+
+  // Number of values which must be <= the result, at least one
+  AcU64 needed = ((h->count * per_mille) + 999) / 1000;
+  if (needed == 0) {
+    needed = 1;
+  }
+
+  AcU64 seen = 0;
+  for (AcU32 i = 0; i < AC_HISTOGRAM_BUCKETS; i++) {
+    seen += h->buckets[i];
+    if (seen >= needed) {
+      AcU64 hi = bucket_hi(i);
+      return (hi < h->max) ? hi : h->max;
+    }
+  }
+  return h->max;
+}
+
+/**
+ * @see ac_histogram.h
+ */
+void AcHistogram_print_summary(const char* leader, const AcHistogram* h) {
+  AcU64 min = (h->count != 0) ? h->min : 0;
+  ac_printf("%s count=%lu min=%.9t p50=%.9t p99=%.9t p99.9=%.9t max=%.9t\n",
+      leader, h->count, min, AcHistogram_percentile(h, 500),
+      AcHistogram_percentile(h, 990), AcHistogram_percentile(h, 999), h->max);
+}
+
+/**
+ * @see ac_histogram.h
+ */
+void AcHistogram_print_buckets(const char* leader, const AcHistogram* h) {
+  for (AcU32 i = 0; i < AC_HISTOGRAM_BUCKETS; i++) {
+    if (h->buckets[i] != 0) {
+      ac_printf("%s %.9t..%.9t %lu\n", leader, AcHistogram_bucket_lo(i), bucket_hi(i),
+          h->buckets[i]);
+    }
+  }
+}
+
+/**
+ * @see ac_histogram.h
+ */
+void AcHistogram_init(AcHistogram* h) {
+  ac_debug_printf("AcHistogram_init:+h=%p\n", h);
+
+  ac_memset(h, 0, sizeof(*h));
+  h->min = ~(AcU64)0;
+
+  ac_debug_printf("AcHistogram_init:-h=%p\n", h);
+}
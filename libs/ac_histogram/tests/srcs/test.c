@@ -0,0 +1,117 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ac_histogram.h>
+
+#include <ac_inttypes.h>
+#include <ac_printf.h>
+#include <ac_test.h>
+#include <ac_time.h>
+
+/**
+ * Test values map to buckets whose range contains them
+ *
+ * return !0 if an error.
+ */
+AcBool test_buckets(void) {
+  AcBool error = AC_FALSE;
+
+  ac_printf("test_buckets:+\n");
+
+  for (AcU64 v = 0; v < 100000; v++) {
+    AcU32 idx = AcHistogram_bucket_idx(v);
+    error |= AC_TEST(AcHistogram_bucket_lo(idx) <= v);
+    error |= AC_TEST(AcHistogram_bucket_lo(idx + 1) > v);
+    if (error) {
+      break;
+    }
+  }
+
+  // Small values have their own bucket
+  error |= AC_TEST(AcHistogram_bucket_idx(0) == 0);
+  error |= AC_TEST(AcHistogram_bucket_idx(31) == 31);
+  error |= AC_TEST(AcHistogram_bucket_idx(32) == AcHistogram_bucket_idx(33));
+
+  // The largest value fits
+  error |= AC_TEST(AcHistogram_bucket_idx(~(AcU64)0) == AC_HISTOGRAM_BUCKETS - 1);
+  error |= AC_TEST(AcHistogram_bucket_lo(AC_HISTOGRAM_BUCKETS - 1) <= ~(AcU64)0);
+
+  ac_printf("test_buckets:-error=%d\n", error);
+  return error;
+}
+
+/**
+ * Test percentiles and add
+ *
+ * return !0 if an error.
+ */
+AcBool test_percentiles(void) {
+  AcBool error = AC_FALSE;
+  AcHistogram h;
+  AcHistogram h2;
+
+  ac_printf("test_percentiles:+\n");
+
+  AcHistogram_init(&h);
+  error |= AC_TEST(h.count == 0);
+  error |= AC_TEST(AcHistogram_percentile(&h, 500) == 0);
+
+  // 1..1000 so pN is N within the bucket error
+  for (AcU64 v = 1; v <= 1000; v++) {
+    AcHistogram_record(&h, v);
+  }
+  error |= AC_TEST(h.count == 1000);
+  error |= AC_TEST(h.min == 1);
+  error |= AC_TEST(h.max == 1000);
+  error |= AC_TEST(h.sum == 500500);
+
+  AcU64 p50 = AcHistogram_percentile(&h, 500);
+  error |= AC_TEST((p50 >= 500) && (p50 < 500 + (500 / AC_HISTOGRAM_SUB_BUCKETS)));
+  AcU64 p99 = AcHistogram_percentile(&h, 990);
+  error |= AC_TEST((p99 >= 990) && (p99 <= 1000));
+  error |= AC_TEST(AcHistogram_percentile(&h, 1000) == 1000);
+  error |= AC_TEST(AcHistogram_percentile(&h, 0) == 1);
+
+  // A single large outlier only shows at the top
+  AcHistogram_init(&h2);
+  AcHistogram_record(&h2, 1000000);
+  AcHistogram_add(&h, &h2);
+  error |= AC_TEST(h.count == 1001);
+  error |= AC_TEST(h.max == 1000000);
+  error |= AC_TEST(AcHistogram_percentile(&h, 999) < 1000 + (1000 / AC_HISTOGRAM_SUB_BUCKETS));
+  error |= AC_TEST(AcHistogram_percentile(&h, 1000) == 1000000);
+
+  AcHistogram_print_summary("test_percentiles:", &h);
+
+  ac_printf("test_percentiles:-error=%d\n", error);
+  return error;
+}
+
+int main(void) {
+  AcBool error = AC_FALSE;
+
+  AcTime_init();
+
+  error |= test_buckets();
+  error |= test_percentiles();
+
+  if (!error) {
+    // Succeeded
+    ac_printf("OK\n");
+  }
+
+  return error;
+}
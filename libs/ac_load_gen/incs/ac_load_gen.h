@@ -0,0 +1,148 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * An AcLoadGen is a component which sends messages to a target
+ * component at a fixed rate and measures their latency. It is open
+ * loop, each message has an intended send time on a fixed schedule
+ * and its latency is measured from that time rather than from when it
+ * was actually sent. So if the target, its queue or the load generator
+ * itself falls behind the delay is included in the latency and is not
+ * hidden by the generator slowing down (coordinated omission).
+ *
+ * The target receives messages with AcLoadGenParams.op and must pass
+ * each one to AcLoadGen_rsp once it has been handled. The load
+ * generator spins its dispatch thread while running, so it should
+ * normally be the only component on its thread.
+ */
+
+#ifndef SADIE_LIBS_AC_LOAD_GEN_INCS_AC_LOAD_GEN_H
+#define SADIE_LIBS_AC_LOAD_GEN_INCS_AC_LOAD_GEN_H
+
+#include <ac_comp_mgr.h>
+#include <ac_histogram.h>
+#include <ac_inttypes.h>
+#include <ac_msg.h>
+#include <ac_msg_pool.h>
+#include <ac_receptor.h>
+#include <ac_status.h>
+
+/**
+ * The protocol of the messages used by AcLoadGen
+ */
+#define AC_LOAD_GEN_PROTOCOL 0x4c47
+
+/**
+ * Default op of the messages sent to the target
+ */
+#define AC_LOAD_GEN_REQ AC_OP(AC_LOAD_GEN_PROTOCOL, AC_OPTYPE_REQ, 1)
+
+/**
+ * Op of the messages returned by AcLoadGen_rsp
+ */
+#define AC_LOAD_GEN_RSP AC_OP(AC_LOAD_GEN_PROTOCOL, AC_OPTYPE_RSP, 1)
+
+/**
+ * Sent by an AcLoadGen to itself to drive the schedule
+ */
+#define AC_LOAD_GEN_TICK_CMD AC_OP(AC_LOAD_GEN_PROTOCOL, AC_OPTYPE_CMD, 2)
+
+typedef struct AcLoadGen AcLoadGen;
+
+/**
+ * The start of the extra data of messages sent to the target,
+ * the target may use the len_extra bytes of payload.
+ */
+typedef struct AcLoadGenExtra {
+  AcLoadGen* lg;                  ///< The load generator to respond to
+  AcU8 payload[];                 ///< AcLoadGenParams.len_extra bytes
+} AcLoadGenExtra;
+
+typedef struct AcLoadGenParams {
+  ac_u8* target_name;             ///< Name of the target, see AcCompMgr_find_comp
+  AcU64 op;                       ///< op of messages sent, 0 for AC_LOAD_GEN_REQ
+  AcU32 len_extra;                ///< Bytes of payload in each message
+  AcU32 max_outstanding;          ///< Messages sent but not responded to, 0 for 1024
+  AcU64 msgs_per_sec;             ///< Rate messages are sent, must not be 0
+  AcU64 msg_count;                ///< Number of messages to send, must not be 0
+} AcLoadGenParams;
+
+typedef struct AcLoadGen {
+  AcComp comp;
+  AcCompHandlers handlers;        ///< For AC_LOAD_GEN_RSP and AC_LOAD_GEN_TICK_CMD
+  AcComp* target;
+  AcU64 op;
+  AcU64 msgs_per_sec;
+  AcU64 msg_count;
+  AcMsgPool mp;                   ///< Messages sent to the target
+  AcMsgPool tick_mp;              ///< The AC_LOAD_GEN_TICK_CMD
+  AcReceptor* done;
+
+  AcU64 start;                    ///< Intended send time of the first message
+  AcU64 next_send;                ///< Intended send time of the next message
+  AcU64 sent;                     ///< Messages sent
+  AcU64 completed;                ///< Responses received
+  AcU64 stalls;                   ///< Messages held up because max_outstanding
+                                  ///< was reached or the target was full
+  AcBool stalled;                 ///< The next message has been held up
+  AcU64 end;                      ///< Time the last response was received
+  AcHistogram latency;            ///< Ticks from intended send to response
+} AcLoadGen;
+
+/**
+ * Called by the target with a message it received from an AcLoadGen
+ * once it has been handled, the target no longer owns msg.
+ */
+void AcLoadGen_rsp(AcMsg* msg);
+
+/**
+ * Start sending, the first message is intended to be sent now
+ */
+void AcLoadGen_start(AcLoadGen* lg);
+
+/**
+ * Wait until all of the responses have been received,
+ * lg->latency then holds the latencies.
+ */
+void AcLoadGen_wait(AcLoadGen* lg);
+
+/**
+ * Print the requested and achieved rate and a summary of the
+ * latency histogram on one line with leader prefixed.
+ */
+void AcLoadGen_print(const char* leader, AcLoadGen* lg);
+
+/**
+ * Remove the load generator from its AcCompMgr and release its resources
+ */
+void AcLoadGen_deinit(AcLoadGen* lg);
+
+/**
+ * Initialize a load generator and add it to mgr. The target must
+ * already have been added to mgr.
+ *
+ * @param: lg is the load generator to initialize
+ * @param: mgr is the component manager the target is in
+ * @param: name of the load generator component
+ * @param: params for the load
+ *
+ * @return: AC_STATUS_OK if successful, AC_STATUS_BAD_PARAM if the params
+ * are invalid or AC_STATUS_NOT_AVAILABLE if the target isn't found.
+ */
+AcStatus AcLoadGen_init(AcLoadGen* lg, AcCompMgr* mgr, ac_u8* name,
+    const AcLoadGenParams* params);
+
+#endif
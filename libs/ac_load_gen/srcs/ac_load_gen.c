@@ -0,0 +1,268 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define NDEBUG
+
+#include <ac_load_gen.h>
+
+#include <ac_assert.h>
+#include <ac_comp_mgr.h>
+#include <ac_debug_printf.h>
+#include <ac_histogram.h>
+#include <ac_inttypes.h>
+#include <ac_msg.h>
+#include <ac_msg_pool.h>
+#include <ac_printf.h>
+#include <ac_receptor.h>
+#include <ac_status.h>
+#include <ac_tsc.h>
+
+#define DEFAULT_MAX_OUTSTANDING 1024
+
+/**
+ * Intended send time of message n, computed from start
+ * so rounding of the interval doesn't accumulate.
+ */
+static inline AcU64 intended_send(AcLoadGen* lg, AcU64 n) {
+  return lg->start + ((n * ac_tsc_freq()) / lg->msgs_per_sec);
+}
+
+/**
+ * The next message couldn't be sent, count it once
+ */
+static inline void stall(AcLoadGen* lg) {
+  if (!lg->stalled) {
+    lg->stalled = AC_TRUE;
+    lg->stalls += 1;
+  }
+}
+
+/**
+ * Send the messages whose intended time has passed. If one can't
+ * be sent its intended time is kept so the delay is in its latency.
+ */
+static void send_due(AcLoadGen* lg) {
+  AcU64 now = ac_tscrd();
+  while ((lg->sent < lg->msg_count) && (lg->next_send <= now)) {
+    AcMsg* msg = AcMsgPool_get_msg(&lg->mp);
+    if (msg == AC_NULL) {
+      stall(lg);
+      break;
+    }
+    msg->op = lg->op;
+    msg->tag = lg->next_send;
+    ((AcLoadGenExtra*)msg->extra)->lg = lg;
+    if (AcCompMgr_send_msg(lg->target, msg) != AC_STATUS_OK) {
+      AcMsgPool_ret_msg(msg);
+      stall(lg);
+      break;
+    }
+    lg->stalled = AC_FALSE;
+    lg->sent += 1;
+    lg->next_send = intended_send(lg, lg->sent);
+  }
+}
+
+static AcBool load_gen_rsp(AcComp* ac, AcMsg* msg) {
+  AcLoadGen* lg = (AcLoadGen*)ac;
+
+  AcU64 now = ac_tscrd();
+  AcHistogram_record(&lg->latency, now - msg->tag);
+  lg->completed += 1;
+  if (lg->completed == lg->msg_count) {
+    lg->end = now;
+    AcReceptor_signal(lg->done);
+  }
+
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+static AcBool load_gen_tick(AcComp* ac, AcMsg* msg) {
+  AcLoadGen* lg = (AcLoadGen*)ac;
+
+  send_due(lg);
+  if (lg->sent < lg->msg_count) {
+    // Keep ticking, other messages queued for us are processed in between
+    AcCompMgr_send_msg(&lg->comp, msg);
+  } else {
+    AcMsgPool_ret_msg(msg);
+  }
+  return AC_TRUE;
+}
+
+static AcBool load_gen_process_msg(AcComp* ac, AcMsg* msg) {
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+/**
+ * @see ac_load_gen.h
+ */
+void AcLoadGen_rsp(AcMsg* msg) {
+  AcLoadGen* lg = ((AcLoadGenExtra*)msg->extra)->lg;
+  msg->op = AC_LOAD_GEN_RSP;
+  AcCompMgr_send_msg(&lg->comp, msg);
+}
+
+/**
+ * @see ac_load_gen.h
+ */
+void AcLoadGen_start(AcLoadGen* lg) {
+  ac_debug_printf("AcLoadGen_start:+lg=%p\n", lg);
+
+  AcMsg* msg = AcMsgPool_get_msg(&lg->tick_mp);
+  ac_assert(msg != AC_NULL);
+  msg->op = AC_LOAD_GEN_TICK_CMD;
+  lg->start = ac_tscrd();
+  lg->next_send = lg->start;
+  AcCompMgr_send_msg(&lg->comp, msg);
+
+  ac_debug_printf("AcLoadGen_start:-lg=%p\n", lg);
+}
+
+/**
+ * @see ac_load_gen.h
+ */
+void AcLoadGen_wait(AcLoadGen* lg) {
+  ac_debug_printf("AcLoadGen_wait:+lg=%p\n", lg);
+
+  AcReceptor_wait(lg->done);
+
+  ac_debug_printf("AcLoadGen_wait:-lg=%p\n", lg);
+}
+
+/**
+ * @see ac_load_gen.h
+ */
+void AcLoadGen_print(const char* leader, AcLoadGen* lg) {
+  AcU64 ticks = lg->end - lg->start;
+  AcU64 achieved = (ticks != 0) ? (lg->completed * ac_tsc_freq()) / ticks : 0;
+  ac_printf("%s rate=%lu/s achieved=%lu/s stalls=%lu", leader, lg->msgs_per_sec,
+      achieved, lg->stalls);
+  AcHistogram_print_summary("", &lg->latency);
+}
+
+/**
+ * @see ac_load_gen.h
+ */
+void AcLoadGen_deinit(AcLoadGen* lg) {
+  ac_debug_printf("AcLoadGen_deinit:+lg=%p\n", lg);
+
+  AcCompMgr_rmv_comp(&lg->comp);
+  AcCompHandlers_deinit(&lg->handlers);
+  AcMsgPool_deinit(&lg->tick_mp);
+  AcMsgPool_deinit(&lg->mp);
+  AcReceptor_ret(lg->done);
+  lg->done = AC_NULL;
+
+  ac_debug_printf("AcLoadGen_deinit:-lg=%p\n", lg);
+}
+
+/**
+ * @see ac_load_gen.h
+ */
+AcStatus AcLoadGen_init(AcLoadGen* lg, AcCompMgr* mgr, ac_u8* name,
+    const AcLoadGenParams* params) {
+  AcStatus status;
+  AcBool mp_inited = AC_FALSE;
+  AcBool tick_mp_inited = AC_FALSE;
+  AcBool handlers_inited = AC_FALSE;
+
+  ac_debug_printf("AcLoadGen_init:+lg=%p name=%s\n", lg, name);
+
+  if ((lg == AC_NULL) || (mgr == AC_NULL) || (name == AC_NULL) || (params == AC_NULL)
+      || (params->target_name == AC_NULL) || (params->msgs_per_sec == 0)
+      || (params->msg_count == 0)) {
+    status = AC_STATUS_BAD_PARAM;
+    goto done;
+  }
+
+  lg->target = AcCompMgr_find_comp(mgr, params->target_name);
+  if (lg->target == AC_NULL) {
+    status = AC_STATUS_NOT_AVAILABLE;
+    goto done;
+  }
+
+  lg->comp.name = name;
+  lg->comp.process_msg = load_gen_process_msg;
+  lg->op = (params->op != 0) ? params->op : AC_LOAD_GEN_REQ;
+  lg->msgs_per_sec = params->msgs_per_sec;
+  lg->msg_count = params->msg_count;
+  lg->start = 0;
+  lg->next_send = 0;
+  lg->sent = 0;
+  lg->completed = 0;
+  lg->stalls = 0;
+  lg->stalled = AC_FALSE;
+  lg->end = 0;
+  AcHistogram_init(&lg->latency);
+
+  AcU32 max_outstanding = (params->max_outstanding != 0) ?
+    params->max_outstanding : DEFAULT_MAX_OUTSTANDING;
+  status = AcMsgPool_init(&lg->mp, max_outstanding,
+      sizeof(AcLoadGenExtra) + params->len_extra);
+  if (status != AC_STATUS_OK) {
+    goto done;
+  }
+  mp_inited = AC_TRUE;
+
+  status = AcMsgPool_init(&lg->tick_mp, 1, 0);
+  if (status != AC_STATUS_OK) {
+    goto done;
+  }
+  tick_mp_inited = AC_TRUE;
+
+  lg->handlers = (AcCompHandlers){ 0 };
+  handlers_inited = AC_TRUE;
+  status = AcCompHandlers_add(&lg->handlers, AC_LOAD_GEN_RSP, load_gen_rsp);
+  if (status != AC_STATUS_OK) {
+    goto done;
+  }
+  status = AcCompHandlers_add(&lg->handlers, AC_LOAD_GEN_TICK_CMD, load_gen_tick);
+  if (status != AC_STATUS_OK) {
+    goto done;
+  }
+
+  lg->done = AcReceptor_get();
+  if (lg->done == AC_NULL) {
+    status = AC_STATUS_NOT_AVAILABLE;
+    goto done;
+  }
+
+  AcCompParams comp_params = { .handlers = &lg->handlers };
+  status = AcCompMgr_add_comp_params(mgr, &lg->comp, &comp_params);
+  if (status != AC_STATUS_OK) {
+    AcReceptor_ret(lg->done);
+    lg->done = AC_NULL;
+  }
+
+done:
+  if (status != AC_STATUS_OK) {
+    if (handlers_inited) {
+      AcCompHandlers_deinit(&lg->handlers);
+    }
+    if (tick_mp_inited) {
+      AcMsgPool_deinit(&lg->tick_mp);
+    }
+    if (mp_inited) {
+      AcMsgPool_deinit(&lg->mp);
+    }
+  }
+
+  ac_debug_printf("AcLoadGen_init:-lg=%p status=%d\n", lg, status);
+  return status;
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define NDEBUG
+
+#include <ac_load_gen.h>
+
+#include <ac_comp_mgr.h>
+#include <ac_debug_printf.h>
+#include <ac_inttypes.h>
+#include <ac_printf.h>
+#include <ac_receptor.h>
+#include <ac_test.h>
+#include <ac_thread.h>
+#include <ac_time.h>
+#include <ac_tsc.h>
+
+typedef struct Target {
+  AcComp comp;
+  AcU64 work_ticks;               ///< Time spent handling each message
+  AcU64 handled;
+} Target;
+
+static AcBool target_process_msg(AcComp* ac, AcMsg* msg) {
+  Target* this = (Target*)ac;
+
+  if (msg->op == AC_LOAD_GEN_REQ) {
+    AcU64 start = ac_tscrd();
+    while ((ac_tscrd() - start) < this->work_ticks) {
+    }
+    this->handled += 1;
+    AcLoadGen_rsp(msg);
+  } else {
+    AcMsgPool_ret_msg(msg);
+  }
+  return AC_TRUE;
+}
+
+/**
+ * Run a load generator against a target which takes work_us per message
+ */
+static AcBool run_load(AcCompMgr* cm, Target* target, AcU64 work_us,
+    AcLoadGenParams* params, AcLoadGen* lg) {
+  AcBool error = AC_FALSE;
+
+  target->work_ticks = (work_us * ac_tsc_freq()) / 1000000;
+  target->handled = 0;
+
+  error |= AC_TEST(AcLoadGen_init(lg, cm, (ac_u8*)"load_gen", params) == AC_STATUS_OK);
+  if (!error) {
+    AcLoadGen_start(lg);
+    AcLoadGen_wait(lg);
+    AcLoadGen_print("run_load:", lg);
+    AcLoadGen_deinit(lg);
+
+    error |= AC_TEST(lg->sent == params->msg_count);
+    error |= AC_TEST(lg->completed == params->msg_count);
+    error |= AC_TEST(lg->latency.count == params->msg_count);
+    error |= AC_TEST(target->handled == params->msg_count);
+  }
+
+  return error;
+}
+
+/**
+ * Test the load generator
+ *
+ * return !0 if an error.
+ */
+AcBool test_load_gen(void) {
+  AcBool error = AC_FALSE;
+  AcCompMgr cm;
+  Target target;
+  AcLoadGen lg;
+
+  ac_printf("test_load_gen:+\n");
+
+  // The load generator is on its own thread
+  error |= AC_TEST(AcCompMgr_init(&cm, 2, 1, 0) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  target.comp.name = (ac_u8*)"target";
+  target.comp.process_msg = target_process_msg;
+  error |= AC_TEST(AcCompMgr_add_comp(&cm, &target.comp) == AC_STATUS_OK);
+
+  // Bad params and a missing target
+  AcLoadGenParams params = {
+    .target_name = (ac_u8*)"target",
+    .msgs_per_sec = 10000,
+    .msg_count = 0,
+  };
+  error |= AC_TEST(AcLoadGen_init(&lg, &cm, (ac_u8*)"load_gen", &params)
+      == AC_STATUS_BAD_PARAM);
+  params.msg_count = 1000;
+  params.target_name = (ac_u8*)"missing";
+  error |= AC_TEST(AcLoadGen_init(&lg, &cm, (ac_u8*)"load_gen", &params)
+      == AC_STATUS_NOT_AVAILABLE);
+  params.target_name = (ac_u8*)"target";
+
+  // Below saturation the messages are sent on schedule
+  error |= run_load(&cm, &target, 0, &params, &lg);
+  error |= AC_TEST((lg.end - lg.start) >= ((params.msg_count - 1) * ac_tsc_freq())
+      / params.msgs_per_sec);
+
+  // Above saturation, 1000us per message offered every 100us, the queueing
+  // delay shows up in the latency even though the target is slow. The
+  // last message is intended to be sent at 20ms but isn't handled until
+  // at least 200ms so its latency is at least 180ms.
+  params.msgs_per_sec = 10000;
+  params.msg_count = 200;
+  error |= run_load(&cm, &target, 1000, &params, &lg);
+  error |= AC_TEST(lg.latency.max >= (180 * ac_tsc_freq()) / 1000);
+
+  // Limiting the outstanding messages stalls the load generator
+  // but the latency is still measured from the intended time
+  params.max_outstanding = 4;
+  error |= run_load(&cm, &target, 1000, &params, &lg);
+  error |= AC_TEST(lg.stalls != 0);
+  error |= AC_TEST(lg.latency.max >= (180 * ac_tsc_freq()) / 1000);
+
+  AcCompMgr_rmv_comp(&target.comp);
+  AcCompMgr_deinit(&cm);
+
+done:
+  ac_printf("test_load_gen:-error=%d\n", error);
+  return error;
+}
+
+int main(void) {
+  AcBool error = AC_FALSE;
+
+  ac_thread_init(3);
+  AcReceptor_init(50);
+  AcTime_init();
+
+  error |= test_load_gen();
+
+  if (!error) {
+    // Succeeded
+    ac_printf("OK\n");
+  }
+
+  return error;
+}
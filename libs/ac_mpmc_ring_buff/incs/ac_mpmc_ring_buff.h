@@ -0,0 +1,102 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * The AcMpmcRingBuff is a wait free/thread safe multi-producer
+ * multi-consumer ring buffer. Unlike AcMpscRingBuff both add_idx
+ * and rmv_idx are advanced with a compare and exchange so any
+ * number of threads may add and remove. This algorithm is Dimitry
+ * Vyukov's MPMC bounded queue here:
+ *   http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+ */
+
+#ifndef SADIE_LIBS_AC_MPMC_RING_BUFF_INCS_AC_MPMC_RING_BUFF_H
+#define SADIE_LIBS_AC_MPMC_RING_BUFF_INCS_AC_MPMC_RING_BUFF_H
+
+#include <ac_mpmc_ring_buff_internal.h>
+#include <ac_inttypes.h>
+#include <ac_status.h>
+
+typedef struct AcMpmcRingBuff AcMpmcRingBuff;
+
+
+/**
+ * Add mem to the ring buffer. This maybe used by multiple
+ * threads and never blocks.
+ *
+ * @params rb is an iniitalized AcMpmcRingBuff
+ * @params mem is pointing to some arbitrary memory
+ *
+ * @return AC_TRUE if added AC_FALSE of full
+ */
+AcBool AcMpmcRingBuff_add_mem(AcMpmcRingBuff* rb, void* mem);
+
+/**
+ * Remove a memory from the ring buffer. This maybe used by multiple
+ * threads and never blocks, returns AC_NULL if the ring buffer is empty.
+ *
+ * @params rb is an iniitalized AcMpmcRingBuff
+ *
+ * @return The next item or AC_NULL if empty
+ */
+void* AcMpmcRingBuff_rmv_mem(AcMpmcRingBuff* rb);
+
+/**
+ * Add count mems to the ring buffer reserving the cells with a
+ * single compare and exchange of add_idx. This maybe used by
+ * multiple threads and never blocks. Either all of the mems are
+ * added or none are.
+ *
+ * @params rb is an iniitalized AcMpmcRingBuff
+ * @params mems is an array of count pointers, none may be AC_NULL
+ * @params count is the number of mems to add, must be <= size
+ *
+ * @return AC_TRUE if all were added AC_FALSE if there was not room,
+ * which includes a consumer still removing a mem from one of the cells
+ */
+AcBool AcMpmcRingBuff_add_mem_n(AcMpmcRingBuff* rb, void** mems, AcU32 count);
+
+/**
+ * Remove upto max_count mems from the ring buffer reserving the
+ * cells with a single compare and exchange of rmv_idx. This maybe
+ * used by multiple threads and never blocks.
+ *
+ * @params rb is an iniitalized AcMpmcRingBuff
+ * @params mems is an array to receive at least max_count pointers
+ * @params max_count is the maximum number of mems to remove
+ *
+ * @return The number of mems removed, 0 if empty
+ */
+AcU32 AcMpmcRingBuff_rmv_mem_n(AcMpmcRingBuff* rb, void** mems, AcU32 max_count);
+
+/**
+ * Deinitialize the AcMpmcRingBuff. Assumes the ring buffer is EMPTY.
+ *
+ * @params rb is an iniitalized with AcMpmcRingBuff_init
+ */
+void AcMpmcRingBuff_deinit(AcMpmcRingBuff* rb);
+
+/**
+ * Initialize an AcMpmcRingBuff able to manage count items
+ *
+ * @params rb is an uniniitalized AcMpmcRingBuff
+ * @params size is the number mem's to allow in the ring buffer, must be a power of 2
+ *
+ * @return 0 (AC_STATUS_OK) if successfull
+ */
+AcStatus AcMpmcRingBuff_init(AcMpmcRingBuff* rb, AcU32 size);
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * The AcMpmcRingBuff is a wait free/thread safe multi-producer
+ * multi-consumer ring buffer. This algorithm is Dimitry Vyukov's
+ * MPMC bounded queue here:
+ *   http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+ */
+
+#ifndef SADIE_LIBS_AC_MPMC_RING_BUFF_INCS_AC_MPMC_RING_BUFF_INTERNAL_H
+#define SADIE_LIBS_AC_MPMC_RING_BUFF_INCS_AC_MPMC_RING_BUFF_INTERNAL_H
+
+#include <ac_attributes.h>
+#include <ac_cache_line.h>
+#include <ac_inttypes.h>
+
+typedef struct AcMpmcRingBuffCell {
+  void* mem;
+  AcU32 seq;
+} AcMpmcRingBuffCell;
+
+
+typedef struct AcMpmcRingBuff {
+  AcU32 add_idx AC_ATTR_ALIGNED(AC_MAX_CACHE_LINE_LEN);
+  AcU32 rmv_idx AC_ATTR_ALIGNED(AC_MAX_CACHE_LINE_LEN);
+  AcU32 size AC_ATTR_ALIGNED(AC_MAX_CACHE_LINE_LEN);
+  AcU32 mask;
+  AcMpmcRingBuffCell* ring_buffer;
+} AcMpmcRingBuff;
+
+#endif
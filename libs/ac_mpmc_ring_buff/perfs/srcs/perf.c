@@ -0,0 +1,157 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define NDEBUG
+
+#include <ac_mpmc_ring_buff.h>
+
+#include <ac_assert.h>
+#include <ac_debug_printf.h>
+#include <ac_memmgr.h>
+#include <ac_receptor.h>
+#include <ac_test.h>
+#include <ac_time.h>
+#include <ac_tsc.h>
+#include <ac_thread.h>
+
+#define MAX_CONSUMERS 8
+
+typedef struct Consumer {
+  AcMpmcRingBuff* rb;
+  AcU8* stop;
+  AcU64 count;
+  AcU64 empty_count;
+  AcReceptor* done;
+} AC_ATTR_ALIGNED(AC_MAX_CACHE_LINE_LEN) Consumer;
+
+/**
+ * Remove mems until stop is received
+ */
+static void* consumer(void* param) {
+  Consumer* c = (Consumer*)param;
+
+  while (AC_TRUE) {
+    void* mem = AcMpmcRingBuff_rmv_mem(c->rb);
+    if (mem == AC_NULL) {
+      c->empty_count += 1;
+      ac_thread_yield();
+    } else if (mem == c->stop) {
+      break;
+    } else {
+      c->count += 1;
+    }
+  }
+
+  AcReceptor_signal(c->done);
+  return AC_NULL;
+}
+
+/**
+ * One producer, the main thread, adds items to a shared
+ * AcMpmcRingBuff which consumer_count threads drain.
+ */
+AcBool mpmc_ring_buff_consumers_perf(AcU32 consumer_count, AcU64 items) {
+  AcBool error = AC_FALSE;
+  AcMpmcRingBuff rb;
+  Consumer consumers[MAX_CONSUMERS];
+  AcU8 data = 0;
+  AcU8 stop = 0;
+  AcU64 full_count = 0;
+
+  ac_debug_printf("mpmc_ring_buff_consumers_perf:+consumer_count=%d items=%lu\n",
+      consumer_count, items);
+  ac_assert(consumer_count <= MAX_CONSUMERS);
+
+  error |= AC_TEST(AcMpmcRingBuff_init(&rb, 1024) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  for (AcU32 i = 0; i < consumer_count; i++) {
+    Consumer* c = &consumers[i];
+    c->rb = &rb;
+    c->stop = &stop;
+    c->count = 0;
+    c->empty_count = 0;
+    c->done = AcReceptor_get();
+    ac_assert(c->done != AC_NULL);
+  }
+
+  AcU64 start = ac_tscrd();
+
+  for (AcU32 i = 0; i < consumer_count; i++) {
+    ac_thread_rslt_t rslt = ac_thread_create(0, consumer, &consumers[i]);
+    ac_assert(rslt.status == 0);
+  }
+
+  for (AcU64 i = 0; i < items; i++) {
+    while (!AcMpmcRingBuff_add_mem(&rb, &data)) {
+      full_count += 1;
+      ac_thread_yield();
+    }
+  }
+  for (AcU32 i = 0; i < consumer_count; i++) {
+    while (!AcMpmcRingBuff_add_mem(&rb, &stop)) {
+      ac_thread_yield();
+    }
+  }
+
+  AcU64 count = 0;
+  AcU64 empty_count = 0;
+  for (AcU32 i = 0; i < consumer_count; i++) {
+    Consumer* c = &consumers[i];
+    AcReceptor_wait(c->done);
+    AcReceptor_ret(c->done);
+    count += c->count;
+    empty_count += c->empty_count;
+  }
+
+  AcU64 stop_tsc = ac_tscrd();
+  error |= AC_TEST(count == items);
+
+  AcU64 duration = stop_tsc - start;
+  AcU64 items_per_sec = (items * ac_tsc_freq()) / duration;
+  ac_printf("mpmc_ring_buff_consumers_perf: consumers=%d time=%.9t items_per_sec=%lu"
+            " full_count=%lu empty_count=%lu\n",
+      consumer_count, duration, items_per_sec, full_count, empty_count);
+
+  AcMpmcRingBuff_deinit(&rb);
+
+done:
+  ac_debug_printf("mpmc_ring_buff_consumers_perf:-error=%d\n", error);
+  return error;
+}
+
+/**
+ * main
+ */
+int main(void) {
+  AcBool error = AC_FALSE;
+
+  ac_thread_init(MAX_CONSUMERS * 2);
+  AcReceptor_init(50);
+  AcTime_init();
+
+  for (AcU32 consumer_count = 1; consumer_count <= MAX_CONSUMERS; consumer_count *= 2) {
+    error |= mpmc_ring_buff_consumers_perf(consumer_count, 10000000);
+  }
+
+  if (!error) {
+    ac_printf("OK\n");
+  }
+
+  return error;
+}
@@ -0,0 +1,242 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define NDEBUG
+
+#include <ac_mpmc_ring_buff.h>
+#include <ac_mpmc_ring_buff_dbg.h>
+#include <ac_mpmc_ring_buff_internal.h>
+
+#include <ac_intmath.h>
+#include <ac_inttypes.h>
+#include <ac_memmgr.h>
+#include <ac_debug_printf.h>
+
+/**
+ * @see ac_mpmc_ring_buff.h
+ */
+AcBool AcMpmcRingBuff_add_mem(AcMpmcRingBuff* rb, void* mem) {
+  ac_debug_printf("AcMpmcRingBuff_add_mem:+rb=%p mem=%p\n", rb, mem);
+
+  if (mem != AC_NULL) {
+    AcMpmcRingBuffCell* cell;
+    AcU32 pos = __atomic_load_n(&rb->add_idx, __ATOMIC_RELAXED);
+
+    while (AC_TRUE) {
+      cell = &rb->ring_buffer[pos & rb->mask];
+      AcU32 seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+      ac_s32 dif = seq - pos;
+
+      if (dif == 0) {
+        if (__atomic_compare_exchange_n(&rb->add_idx, &pos, pos + 1,
+              AC_TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+          break;
+        }
+      } else if (dif < 0) {
+        ac_debug_printf("AcMpmcRingBuff_add_mem:-rb=%p mem=%p FULL\n", rb, mem);
+        return AC_FALSE;
+      } else {
+        pos = __atomic_load_n(&rb->add_idx, __ATOMIC_RELAXED);
+      }
+    }
+
+    cell->mem = mem;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+  }
+
+  ac_debug_printf("AcMpmcRingBuff_add_mem:-rb=%p mem=%p\n", rb, mem);
+  return AC_TRUE;
+}
+
+/**
+ * @see ac_mpmc_ring_buff.h
+ */
+void* AcMpmcRingBuff_rmv_mem(AcMpmcRingBuff* rb) {
+  ac_debug_printf("AcMpmcRingBuff_rmv_mem:+rb=%p\n", rb);
+  AcMpmcRingBuffCell* cell;
+  AcU32 pos = __atomic_load_n(&rb->rmv_idx, __ATOMIC_RELAXED);
+
+  while (AC_TRUE) {
+    cell = &rb->ring_buffer[pos & rb->mask];
+    AcU32 seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+    ac_s32 dif = seq - (pos + 1);
+
+    if (dif == 0) {
+      if (__atomic_compare_exchange_n(&rb->rmv_idx, &pos, pos + 1,
+            AC_TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else if (dif < 0) {
+      ac_debug_printf("AcMpmcRingBuff_rmv_mem:-rb=%p mem=AC_NULL EMPTY\n", rb);
+      return AC_NULL;
+    } else {
+      pos = __atomic_load_n(&rb->rmv_idx, __ATOMIC_RELAXED);
+    }
+  }
+
+  void* mem = cell->mem;
+  __atomic_store_n(&cell->seq, pos + rb->size, __ATOMIC_RELEASE);
+
+  ac_debug_printf("AcMpmcRingBuff_rmv_mem:-rb=%p mem=%p\n", rb, mem);
+  return mem;
+}
+
+/**
+ * @see ac_mpmc_ring_buff.h
+ */
+AcBool AcMpmcRingBuff_add_mem_n(AcMpmcRingBuff* rb, void** mems, AcU32 count) {
+  ac_debug_printf("AcMpmcRingBuff_add_mem_n:+rb=%p mems=%p count=%u\n", rb, mems, count);
+
+  if ((count == 0) || (count > rb->size)) {
+    ac_debug_printf("AcMpmcRingBuff_add_mem_n:-rb=%p count=%u BAD count\n", rb, count);
+    return count == 0;
+  }
+
+  // With several consumers cells aren't freed in order, a consumer
+  // may have claimed a cell but not yet freed it while a later cell
+  // has been freed. So every cell of the range must be free before
+  // add_idx is advanced over it, once it's free only the producer
+  // which advances add_idx past it changes it.
+  AcU32 pos = __atomic_load_n(&rb->add_idx, __ATOMIC_RELAXED);
+
+  while (AC_TRUE) {
+    ac_s32 dif = 0;
+    for (AcU32 i = 0; (dif == 0) && (i < count); i++) {
+      AcMpmcRingBuffCell* cell = &rb->ring_buffer[(pos + i) & rb->mask];
+      AcU32 seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+      dif = seq - (pos + i);
+    }
+
+    if (dif == 0) {
+      if (__atomic_compare_exchange_n(&rb->add_idx, &pos, pos + count,
+            AC_TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else if (dif < 0) {
+      ac_debug_printf("AcMpmcRingBuff_add_mem_n:-rb=%p count=%u FULL\n", rb, count);
+      return AC_FALSE;
+    } else {
+      pos = __atomic_load_n(&rb->add_idx, __ATOMIC_RELAXED);
+    }
+  }
+
+  for (AcU32 i = 0; i < count; i++) {
+    AcMpmcRingBuffCell* cell = &rb->ring_buffer[(pos + i) & rb->mask];
+    cell->mem = mems[i];
+    __atomic_store_n(&cell->seq, pos + i + 1, __ATOMIC_RELEASE);
+  }
+
+  ac_debug_printf("AcMpmcRingBuff_add_mem_n:-rb=%p count=%u\n", rb, count);
+  return AC_TRUE;
+}
+
+/**
+ * @see ac_mpmc_ring_buff.h
+ */
+AcU32 AcMpmcRingBuff_rmv_mem_n(AcMpmcRingBuff* rb, void** mems, AcU32 max_count) {
+  ac_debug_printf("AcMpmcRingBuff_rmv_mem_n:+rb=%p max_count=%u\n", rb, max_count);
+  AcU32 count;
+  AcU32 pos = __atomic_load_n(&rb->rmv_idx, __ATOMIC_RELAXED);
+
+  while (AC_TRUE) {
+    // Count the ready cells, only consumers change a ready cell
+    // so they stay ready until we or another consumer claim them.
+    for (count = 0; count < max_count; count++) {
+      AcMpmcRingBuffCell* cell = &rb->ring_buffer[(pos + count) & rb->mask];
+      AcU32 seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+      if ((ac_s32)(seq - (pos + count + 1)) != 0) {
+        break;
+      }
+    }
+
+    if (count == 0) {
+      AcU32 seq = __atomic_load_n(&rb->ring_buffer[pos & rb->mask].seq, __ATOMIC_ACQUIRE);
+      if ((ac_s32)(seq - (pos + 1)) < 0) {
+        ac_debug_printf("AcMpmcRingBuff_rmv_mem_n:-rb=%p EMPTY\n", rb);
+        return 0;
+      }
+      // Another consumer took it, try again
+      pos = __atomic_load_n(&rb->rmv_idx, __ATOMIC_RELAXED);
+    } else if (__atomic_compare_exchange_n(&rb->rmv_idx, &pos, pos + count,
+            AC_TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      break;
+    }
+  }
+
+  for (AcU32 i = 0; i < count; i++) {
+    AcMpmcRingBuffCell* cell = &rb->ring_buffer[(pos + i) & rb->mask];
+    mems[i] = cell->mem;
+    __atomic_store_n(&cell->seq, pos + i + rb->size, __ATOMIC_RELEASE);
+  }
+
+  ac_debug_printf("AcMpmcRingBuff_rmv_mem_n:-rb=%p count=%u\n", rb, count);
+  return count;
+}
+
+/**
+ * @see ac_mpmc_ring_buff.h
+ */
+void AcMpmcRingBuff_deinit(AcMpmcRingBuff* rb) {
+  ac_debug_printf("AcMpmcRingBuff_deinit:+rb=%p\n", rb);
+
+  ac_free(rb->ring_buffer);
+  rb->ring_buffer = AC_NULL;
+  rb->add_idx = 0;
+  rb->rmv_idx = 0;
+  rb->size = 0;
+  rb->mask = 0;
+
+  ac_debug_printf("AcMpmcRingBuff_deinit:-rb=%p\n", rb);
+}
+
+/**
+ * @see ac_mpmc_ring_buff.h
+ */
+AcStatus AcMpmcRingBuff_init(AcMpmcRingBuff* rb, AcU32 size) {
+  AcStatus status = AC_STATUS_OK;
+
+  ac_debug_printf("AcMpmcRingBuff_init:+rb=%p size=%d\n", rb, size);
+
+  if (rb == AC_NULL) {
+    ac_debug_printf("AcMpmcRingBuff_init:-rb=%p size=%d rb is AC_NULL return BAD_PARAM\n",
+        rb, size);
+    return AC_STATUS_BAD_PARAM;
+  }
+
+  rb->add_idx = 0;
+  rb->rmv_idx = 0;
+  if (AC_COUNT_ONE_BITS(size) != 1) {
+    ac_debug_printf("AcMpmcRingBuff_init:-rb=%p size=%d not a power of 2 return BAD_PARAM\n",
+        rb, size);
+    return AC_STATUS_BAD_PARAM;
+  }
+
+  rb->size = size;
+  rb->mask = size - 1;
+  rb->ring_buffer = ac_malloc(size * sizeof(*rb->ring_buffer));
+  if (rb->ring_buffer == AC_NULL) {
+    ac_debug_printf("AcMpmcRingBuff_init:-rb=%p size=%d could not allocate ring_buffer return OUT_OF_MEMORY\n",
+        rb, size);
+    return AC_STATUS_OUT_OF_MEMORY;
+  }
+  for (AcU32 i = 0; i < rb->size; i++) {
+    rb->ring_buffer[i].seq = i;
+    rb->ring_buffer[i].mem = AC_NULL;
+  }
+
+  ac_debug_printf("AcMpmcRingBuff_init:-rb=%p size=%d status=%d\n", rb, size, status);
+  return status;
+}
@@ -0,0 +1,446 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ac_mpmc_ring_buff.h>
+#include <ac_mpmc_ring_buff_dbg.h>
+#include <ac_mpmc_ring_buff_internal.h>
+
+#include <ac_assert.h>
+#include <ac_memmgr.h>
+#include <ac_inttypes.h>
+#include <ac_receptor.h>
+#include <ac_test.h>
+#include <ac_thread.h>
+#include <ac_time.h>
+
+/**
+ * Test we can add and remove mems from a single thread
+ *
+ * return !0 if an error.
+ */
+AcBool test_add_rmv() {
+  AcBool error = AC_FALSE;
+  AcMpmcRingBuff rb;
+  AcU8 mems[3] = { 1, 2, 3 };
+  AcU8* mem;
+
+  ac_printf("test_add_rmv:+rb=%p\n", &rb);
+
+  error |= AC_TEST(AcMpmcRingBuff_init(&rb, 3) == AC_STATUS_BAD_PARAM);
+  error |= AC_TEST(AcMpmcRingBuff_init(&rb, 2) == AC_STATUS_OK);
+  AcMpmcRingBuff_print("test_add_rmv: initialized rb:", &rb);
+
+  error |= AC_TEST(AcMpmcRingBuff_rmv_mem(&rb) == AC_NULL);
+
+  error |= AC_TEST(AcMpmcRingBuff_add_mem(&rb, &mems[0]));
+  error |= AC_TEST(AcMpmcRingBuff_add_mem(&rb, &mems[1]));
+  error |= AC_TEST(AcMpmcRingBuff_add_mem(&rb, &mems[2]) == AC_FALSE);
+  AcMpmcRingBuff_print("test_add_rmv: full rb:", &rb);
+  error |= AC_TEST(rb.add_idx == 2);
+
+  mem = AcMpmcRingBuff_rmv_mem(&rb);
+  error |= AC_TEST((mem != AC_NULL) && (mem[0] == 1));
+  error |= AC_TEST(AcMpmcRingBuff_add_mem(&rb, &mems[2]));
+  mem = AcMpmcRingBuff_rmv_mem(&rb);
+  error |= AC_TEST((mem != AC_NULL) && (mem[0] == 2));
+  mem = AcMpmcRingBuff_rmv_mem(&rb);
+  error |= AC_TEST((mem != AC_NULL) && (mem[0] == 3));
+  error |= AC_TEST(AcMpmcRingBuff_rmv_mem(&rb) == AC_NULL);
+  error |= AC_TEST(rb.rmv_idx == 3);
+
+  AcMpmcRingBuff_deinit(&rb);
+
+  ac_printf("test_add_rmv:-error=%d\n", error);
+  return error;
+}
+
+/**
+ * Test we can add and remove multiple mems with one call
+ *
+ * return !0 if an error.
+ */
+AcBool test_add_rmv_n() {
+  AcBool error = AC_FALSE;
+  AcMpmcRingBuff rb;
+  AcU8 data[6];
+  void* mems[6];
+  void* rmvd[6];
+
+  ac_printf("test_add_rmv_n:+rb=%p\n", &rb);
+
+  for (AcU32 i = 0; i < AC_ARRAY_COUNT(data); i++) {
+    data[i] = i;
+    mems[i] = &data[i];
+  }
+
+  error |= AC_TEST(AcMpmcRingBuff_init(&rb, 4) == AC_STATUS_OK);
+
+  error |= AC_TEST(AcMpmcRingBuff_add_mem_n(&rb, mems, 0));
+  error |= AC_TEST(AcMpmcRingBuff_add_mem_n(&rb, mems, 5) == AC_FALSE);
+  error |= AC_TEST(AcMpmcRingBuff_rmv_mem_n(&rb, rmvd, 4) == 0);
+
+  error |= AC_TEST(AcMpmcRingBuff_add_mem_n(&rb, &mems[0], 3));
+  error |= AC_TEST(AcMpmcRingBuff_add_mem_n(&rb, &mems[3], 2) == AC_FALSE);
+  error |= AC_TEST(rb.add_idx == 3);
+
+  error |= AC_TEST(AcMpmcRingBuff_rmv_mem_n(&rb, rmvd, 2) == 2);
+  error |= AC_TEST((*(AcU8*)rmvd[0] == 0) && (*(AcU8*)rmvd[1] == 1));
+
+  // Wraps the ring buffer
+  error |= AC_TEST(AcMpmcRingBuff_add_mem_n(&rb, &mems[3], 3));
+  AcMpmcRingBuff_print("test_add_rmv_n: after wrapping add rb:", &rb);
+
+  AcU8* mem = AcMpmcRingBuff_rmv_mem(&rb);
+  error |= AC_TEST((mem != AC_NULL) && (*mem == 2));
+
+  error |= AC_TEST(AcMpmcRingBuff_rmv_mem_n(&rb, rmvd, 6) == 3);
+  error |= AC_TEST(*(AcU8*)rmvd[0] == 3);
+  error |= AC_TEST(*(AcU8*)rmvd[1] == 4);
+  error |= AC_TEST(*(AcU8*)rmvd[2] == 5);
+  error |= AC_TEST(rb.rmv_idx == 6);
+  error |= AC_TEST(AcMpmcRingBuff_rmv_mem(&rb) == AC_NULL);
+
+  AcMpmcRingBuff_deinit(&rb);
+
+  ac_printf("test_add_rmv_n:-error=%d\n", error);
+  return error;
+}
+
+/**
+ * Test a batch isn't added over a cell a consumer has claimed but
+ * not yet freed, even though a later cell of the batch is free.
+ *
+ * return !0 if an error.
+ */
+AcBool test_add_n_unfreed() {
+  AcBool error = AC_FALSE;
+  AcMpmcRingBuff rb;
+  AcU8 data[6];
+  void* mems[6];
+
+  ac_printf("test_add_n_unfreed:+rb=%p\n", &rb);
+
+  for (AcU32 i = 0; i < AC_ARRAY_COUNT(data); i++) {
+    data[i] = i;
+    mems[i] = &data[i];
+  }
+
+  error |= AC_TEST(AcMpmcRingBuff_init(&rb, 4) == AC_STATUS_OK);
+  error |= AC_TEST(AcMpmcRingBuff_add_mem_n(&rb, &mems[0], 4));
+
+  // A consumer claims cell 0 by advancing rmv_idx, but hasn't
+  // freed it, and another consumer removes and frees cell 1
+  error |= AC_TEST(__atomic_compare_exchange_n(&rb.rmv_idx, &(AcU32){ 0 }, 1,
+        AC_FALSE, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  AcU8* mem = AcMpmcRingBuff_rmv_mem(&rb);
+  error |= AC_TEST((mem != AC_NULL) && (*mem == 1));
+
+  // Cells 0 and 1 are the next two to add to, cell 1 is free but not cell 0
+  error |= AC_TEST(AcMpmcRingBuff_add_mem_n(&rb, &mems[4], 2) == AC_FALSE);
+  error |= AC_TEST(rb.add_idx == 4);
+
+  // Once the first consumer frees cell 0 both may be added
+  error |= AC_TEST(rb.ring_buffer[0].mem == mems[0]);
+  __atomic_store_n(&rb.ring_buffer[0].seq, 0 + rb.size, __ATOMIC_RELEASE);
+  error |= AC_TEST(AcMpmcRingBuff_add_mem_n(&rb, &mems[4], 2));
+  for (AcU32 i = 2; i < AC_ARRAY_COUNT(data); i++) {
+    mem = AcMpmcRingBuff_rmv_mem(&rb);
+    error |= AC_TEST((mem != AC_NULL) && (*mem == i));
+  }
+  error |= AC_TEST(AcMpmcRingBuff_rmv_mem(&rb) == AC_NULL);
+
+  AcMpmcRingBuff_deinit(&rb);
+
+  ac_printf("test_add_n_unfreed:-error=%d\n", error);
+  return error;
+}
+
+typedef struct Consumer {
+  AcMpmcRingBuff* rb;
+  AcU8* stop;
+  AcU64 count;
+  AcU64 sum;
+  AcReceptor* done;
+} Consumer;
+
+/**
+ * Remove mems until stop is received
+ */
+static void* consumer(void* param) {
+  Consumer* c = (Consumer*)param;
+
+  while (AC_TRUE) {
+    AcU32* mem = AcMpmcRingBuff_rmv_mem(c->rb);
+    if (mem == AC_NULL) {
+      ac_thread_yield();
+    } else if ((void*)mem == (void*)c->stop) {
+      break;
+    } else {
+      c->count += 1;
+      c->sum += *mem;
+    }
+  }
+
+  AcReceptor_signal(c->done);
+  return AC_NULL;
+}
+
+/**
+ * Test multiple consumers remove every mem exactly once
+ *
+ * return !0 if an error.
+ */
+AcBool test_multiple_consumers(AcU32 consumer_count, AcU32 mem_count) {
+  AcBool error = AC_FALSE;
+  AcMpmcRingBuff rb;
+  AcU8 stop;
+
+  ac_printf("test_multiple_consumers:+consumer_count=%d mem_count=%d\n",
+      consumer_count, mem_count);
+
+  error |= AC_TEST(AcMpmcRingBuff_init(&rb, 8) == AC_STATUS_OK);
+
+  AcU32* mems = ac_malloc(mem_count * sizeof(AcU32));
+  Consumer* consumers = ac_calloc(consumer_count, sizeof(Consumer));
+  ac_assert((mems != AC_NULL) && (consumers != AC_NULL));
+
+  for (AcU32 i = 0; i < consumer_count; i++) {
+    Consumer* c = &consumers[i];
+    c->rb = &rb;
+    c->stop = &stop;
+    c->done = AcReceptor_get();
+    ac_assert(c->done != AC_NULL);
+    ac_thread_rslt_t rslt = ac_thread_create(0, consumer, c);
+    error |= AC_TEST(rslt.status == 0);
+  }
+
+  AcU64 expected_sum = 0;
+  for (AcU32 i = 0; i < mem_count; i++) {
+    mems[i] = i;
+    expected_sum += i;
+    while (!AcMpmcRingBuff_add_mem(&rb, &mems[i])) {
+      ac_thread_yield();
+    }
+  }
+  for (AcU32 i = 0; i < consumer_count; i++) {
+    while (!AcMpmcRingBuff_add_mem(&rb, &stop)) {
+      ac_thread_yield();
+    }
+  }
+
+  AcU64 count = 0;
+  AcU64 sum = 0;
+  for (AcU32 i = 0; i < consumer_count; i++) {
+    Consumer* c = &consumers[i];
+    AcReceptor_wait(c->done);
+    AcReceptor_ret(c->done);
+    ac_printf("test_multiple_consumers: consumer %d count=%ld\n", i, c->count);
+    count += c->count;
+    sum += c->sum;
+  }
+  error |= AC_TEST(count == mem_count);
+  error |= AC_TEST(sum == expected_sum);
+  error |= AC_TEST(AcMpmcRingBuff_rmv_mem(&rb) == AC_NULL);
+
+  AcMpmcRingBuff_deinit(&rb);
+  ac_free(consumers);
+  ac_free(mems);
+
+  ac_printf("test_multiple_consumers:-error=%d\n", error);
+  return error;
+}
+
+typedef struct BatchProducer {
+  AcMpmcRingBuff* rb;
+  AcU32* mems;            ///< The mems this producer adds
+  AcU32 mem_count;
+  AcU32 batch_count;      ///< Number added with each AcMpmcRingBuff_add_mem_n
+  AcReceptor* done;
+} BatchProducer;
+
+/**
+ * Add all of the mems batch_count at a time
+ */
+static void* batch_producer(void* param) {
+  BatchProducer* p = (BatchProducer*)param;
+  void* batch[8];
+  ac_assert(p->batch_count <= AC_ARRAY_COUNT(batch));
+
+  for (AcU32 i = 0; i < p->mem_count; i += p->batch_count) {
+    AcU32 count = p->mem_count - i;
+    if (count > p->batch_count) {
+      count = p->batch_count;
+    }
+    for (AcU32 j = 0; j < count; j++) {
+      batch[j] = &p->mems[i + j];
+    }
+    while (!AcMpmcRingBuff_add_mem_n(p->rb, batch, count)) {
+      ac_thread_yield();
+    }
+  }
+
+  AcReceptor_signal(p->done);
+  return AC_NULL;
+}
+
+/**
+ * Remove a few mems at a time until stop is received, yielding
+ * after each so the consumers interleave
+ */
+static void* batch_consumer(void* param) {
+  Consumer* c = (Consumer*)param;
+  void* mems[2];
+
+  while (AC_TRUE) {
+    AcU32 count = AcMpmcRingBuff_rmv_mem_n(c->rb, mems, AC_ARRAY_COUNT(mems));
+    AcBool stop = AC_FALSE;
+    for (AcU32 i = 0; i < count; i++) {
+      if (mems[i] == (void*)c->stop) {
+        // Another consumer's stop, put it back
+        if (stop) {
+          while (!AcMpmcRingBuff_add_mem(c->rb, mems[i])) {
+            ac_thread_yield();
+          }
+        }
+        stop = AC_TRUE;
+      } else {
+        c->count += 1;
+        c->sum += *(AcU32*)mems[i];
+      }
+    }
+    if (stop) {
+      break;
+    }
+    ac_thread_yield();
+  }
+
+  AcReceptor_signal(c->done);
+  return AC_NULL;
+}
+
+/**
+ * Test mems added in batches by multiple producers are removed
+ * exactly once by multiple consumers. Consumers free cells out of
+ * order so a batch may span a cell claimed but not yet freed.
+ *
+ * return !0 if an error.
+ */
+AcBool test_batch_producers(AcU32 producer_count, AcU32 consumer_count, AcU32 mem_count) {
+  AcBool error = AC_FALSE;
+  AcMpmcRingBuff rb;
+  AcU8 stop;
+
+  ac_printf("test_batch_producers:+producer_count=%d consumer_count=%d mem_count=%d\n",
+      producer_count, consumer_count, mem_count);
+
+  error |= AC_TEST(AcMpmcRingBuff_init(&rb, 8) == AC_STATUS_OK);
+
+  AcU32* mems = ac_malloc(producer_count * mem_count * sizeof(AcU32));
+  BatchProducer* producers = ac_calloc(producer_count, sizeof(BatchProducer));
+  Consumer* consumers = ac_calloc(consumer_count, sizeof(Consumer));
+  ac_assert((mems != AC_NULL) && (producers != AC_NULL) && (consumers != AC_NULL));
+
+  AcU64 expected_sum = 0;
+  for (AcU32 i = 0; i < producer_count * mem_count; i++) {
+    mems[i] = i;
+    expected_sum += i;
+  }
+
+  for (AcU32 i = 0; i < consumer_count; i++) {
+    Consumer* c = &consumers[i];
+    c->rb = &rb;
+    c->stop = &stop;
+    c->done = AcReceptor_get();
+    ac_assert(c->done != AC_NULL);
+    ac_thread_rslt_t rslt = ac_thread_create(0, batch_consumer, c);
+    error |= AC_TEST(rslt.status == 0);
+  }
+  for (AcU32 i = 0; i < producer_count; i++) {
+    BatchProducer* p = &producers[i];
+    p->rb = &rb;
+    p->mems = &mems[i * mem_count];
+    p->mem_count = mem_count;
+    p->batch_count = 3 + i;
+    p->done = AcReceptor_get();
+    ac_assert(p->done != AC_NULL);
+    ac_thread_rslt_t rslt = ac_thread_create(0, batch_producer, p);
+    error |= AC_TEST(rslt.status == 0);
+  }
+
+  for (AcU32 i = 0; i < producer_count; i++) {
+    AcReceptor_wait(producers[i].done);
+    AcReceptor_ret(producers[i].done);
+  }
+  for (AcU32 i = 0; i < consumer_count; i++) {
+    while (!AcMpmcRingBuff_add_mem(&rb, &stop)) {
+      ac_thread_yield();
+    }
+  }
+
+  AcU64 count = 0;
+  AcU64 sum = 0;
+  for (AcU32 i = 0; i < consumer_count; i++) {
+    Consumer* c = &consumers[i];
+    AcReceptor_wait(c->done);
+    AcReceptor_ret(c->done);
+    ac_printf("test_batch_producers: consumer %d count=%ld\n", i, c->count);
+    count += c->count;
+    sum += c->sum;
+  }
+  error |= AC_TEST(count == (AcU64)producer_count * mem_count);
+  error |= AC_TEST(sum == expected_sum);
+  error |= AC_TEST(AcMpmcRingBuff_rmv_mem(&rb) == AC_NULL);
+
+  AcMpmcRingBuff_deinit(&rb);
+  ac_free(consumers);
+  ac_free(producers);
+  ac_free(mems);
+
+  ac_printf("test_batch_producers:-error=%d\n", error);
+  return error;
+}
+
+int main(void) {
+  AcBool error = AC_FALSE;
+
+  ac_thread_init(8);
+  AcReceptor_init(10);
+  AcTime_init();
+
+  error |= test_add_rmv();
+  ac_printf("\n");
+  error |= test_add_rmv_n();
+  ac_printf("\n");
+  error |= test_add_n_unfreed();
+  ac_printf("\n");
+#if AC_PLATFORM == VersatilePB
+  ac_printf("test_multiple_consumers: VersatilePB threading not working, skipping\n");
+#else
+  error |= test_multiple_consumers(1, 10000);
+  ac_printf("\n");
+  error |= test_multiple_consumers(3, 10000);
+  ac_printf("\n");
+  error |= test_batch_producers(2, 3, 100000);
+  ac_printf("\n");
+#endif
+
+  if (!error) {
+    // Succeeded
+    ac_printf("OK\n");
+  }
+
+  return error;
+}
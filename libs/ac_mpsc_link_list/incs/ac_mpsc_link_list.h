@@ -19,13 +19,27 @@
 typedef struct AcMpscLinkList AcMpscLinkList;
 
 /**
- * Initialize an AcMpscLinkList. Don't forget to empty the fifo
- * and delete the stub before freeing AcMpscLinkList.
+ * A batch of messages detached by AcMpscLinkList_rmv_all
+ */
+typedef struct AcMpscLinkListBatch {
+  AcNextPtr* cur;   ///< Node preceding the next message in the batch
+  AcNextPtr* last;  ///< Node of the last message in the batch
+} AcMpscLinkListBatch;
+
+/**
+ * Initialize an AcMpscLinkList, the stub AcNextPtr is allocated
+ * from the AcNextPtr manager. Don't forget to deinit the
+ * AcMpscLinkList before freeing it.
+ *
+ * @return 0 (AC_STATUS_OK) if successful
  */
 extern AcStatus AcMpscLinkList_init(AcMpscLinkList* list);
 
 /**
- * Deinitialize the AcMpscLinkList.
+ * Deinitialize the AcMpscLinkList, the AcNextPtr at the tail is
+ * retired to the AcNextPtr manager. Messages still on the list
+ * keep their AcNextPtr's. Adds in progress, from any thread, are
+ * waited for, but no add may start once deinit has been called.
  *
  * @return number of messages removed.
  */
@@ -34,7 +48,8 @@ extern AcU64 AcMpscLinkList_deinit(AcMpscLinkList* list);
 /**
  * Add a AcMsg to the head of the link list. This maybe used by multiple
  * entities on the same or different thread. This will never
- * block as it is a wait free algorithm.
+ * block as it is a wait free algorithm. The add is a sequentially
+ * consistent atomic operation.
  */
 extern void AcMpscLinkList_add(AcMpscLinkList* list, AcMsg* msg);
 
@@ -45,4 +60,26 @@ extern void AcMpscLinkList_add(AcMpscLinkList* list, AcMsg* msg);
  */
 extern AcMsg* AcMpscLinkList_rmv(AcMpscLinkList* list);
 
+/**
+ * Detach all of the messages currently on the list with a single
+ * load of head, use AcMpscLinkList_batch_rmv to remove them from
+ * the batch. Messages added afterwards stay on the list. This maybe
+ * used only by the single consumer thread. A batch may be abandoned
+ * at any time, the messages not yet removed remain on the list. The
+ * load of head is sequentially consistent.
+ *
+ * @return AC_TRUE if the batch has one or more messages
+ */
+extern AcBool AcMpscLinkList_rmv_all(AcMpscLinkList* list, AcMpscLinkListBatch* batch);
+
+/**
+ * Remove the next AcMsg from a batch returned by AcMpscLinkList_rmv_all,
+ * the messages are returned in the order they were added. Unlike
+ * AcMpscLinkList_rmv this never loads head. It only stalls if a
+ * producer was preempted before finishing an add in the batch.
+ *
+ * @return AcMsg or AC_NULL when the batch is empty
+ */
+extern AcMsg* AcMpscLinkList_batch_rmv(AcMpscLinkList* list, AcMpscLinkListBatch* batch);
+
 #endif
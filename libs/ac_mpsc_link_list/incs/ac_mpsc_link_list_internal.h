@@ -17,7 +17,6 @@
 typedef struct AcMpscLinkList {
   AcNextPtr* head __attribute__(( aligned (64) ));
   AcNextPtr* tail __attribute__(( aligned (64) ));
-  AcNextPtr stub;
   _Atomic(AcU32) count;
   _Atomic(AcU64) msgs_processed;
 } AcMpscLinkList;
@@ -21,15 +21,21 @@
 
 #include <ac_assert.h>
 #include <ac_debug_printf.h>
+#include <ac_histogram.h>
+#include <ac_memmgr.h>
 #include <ac_msg.h>
 #include <ac_msg_pool.h>
 #include <ac_receptor.h>
 #include <ac_status.h>
+#include <ac_sysconf.h>
 #include <ac_test.h>
 #include <ac_time.h>
 #include <ac_tsc.h>
 #include <ac_thread.h>
 
+#define MAX_PRODUCERS 16
+#define PRODUCER_MSG_COUNT 64
+
 AcBool simple_mpsc_link_list_perf(AcU64 loops) {
   AcStatus status;
   AcBool error = AC_FALSE;
@@ -108,19 +114,235 @@ AcBool simple_mpsc_link_list_perf(AcU64 loops) {
   return error;
 }
 
+/**
+ * Return ticks * AC_SEC_IN_NS / count without overflowing so it
+ * can be printed with %S as nano seconds.
+ */
+static AcU64 ns_per(AcU64 ticks, AcU64 count) {
+  return ((ticks / count) * AC_SEC_IN_NS) + (((ticks % count) * AC_SEC_IN_NS) / count);
+}
+
+/**
+ * Add bursts of burst msgs and then drain them, comparing
+ * AcMpscLinkList_rmv one at a time with AcMpscLinkList_rmv_all.
+ */
+AcBool burst_mpsc_link_list_perf(AcU64 msgs, AcU32 max_burst) {
+  AcBool error = AC_FALSE;
+  ac_debug_printf("burst_mpsc_link_list_perf:+msgs=%lu max_burst=%u\n", msgs, max_burst);
+
+  AcMpscLinkList list;
+  AcMpscLinkListBatch batch;
+  AcMsgPool pool;
+  AcMsg** burst_msgs = AC_NULL;
+
+  error |= AC_TEST(AcMsgPool_init(&pool, max_burst, 0) == AC_STATUS_OK);
+  error |= AC_TEST(AcMpscLinkList_init(&list) == AC_STATUS_OK);
+  burst_msgs = ac_malloc(sizeof(*burst_msgs) * max_burst);
+  error |= AC_TEST(burst_msgs != AC_NULL);
+  if (error) {
+    goto done;
+  }
+  for (AcU32 i = 0; i < max_burst; i++) {
+    burst_msgs[i] = AcMsgPool_get_msg(&pool);
+  }
+
+  for (AcU32 burst = 1; burst <= max_burst; burst *= 2) {
+    AcU64 loops = msgs / burst;
+    AcU64 count = 0;
+
+    AcU64 start = ac_tscrd();
+    for (AcU64 loop = 0; loop < loops; loop++) {
+      for (AcU32 i = 0; i < burst; i++) {
+        AcMpscLinkList_add(&list, burst_msgs[i]);
+      }
+      while (AcMpscLinkList_rmv(&list) != AC_NULL) {
+        count += 1;
+      }
+    }
+    AcU64 single = ac_tscrd() - start;
+    error |= AC_TEST(count == loops * burst);
+
+    count = 0;
+    start = ac_tscrd();
+    for (AcU64 loop = 0; loop < loops; loop++) {
+      for (AcU32 i = 0; i < burst; i++) {
+        AcMpscLinkList_add(&list, burst_msgs[i]);
+      }
+      while (AcMpscLinkList_rmv_all(&list, &batch)) {
+        while (AcMpscLinkList_batch_rmv(&list, &batch) != AC_NULL) {
+          count += 1;
+        }
+      }
+    }
+    AcU64 batched = ac_tscrd() - start;
+    error |= AC_TEST(count == loops * burst);
+
+    ac_printf("burst_mpsc_link_list_perf: burst=%2u rmv ns_per_msg=%.4S rmv_all ns_per_msg=%.4S\n",
+        burst, ns_per(single, loops * burst), ns_per(batched, loops * burst));
+  }
+
+  for (AcU32 i = 0; i < max_burst; i++) {
+    AcMsgPool_ret_msg(burst_msgs[i]);
+  }
+  AcMpscLinkList_deinit(&list);
+  AcMsgPool_deinit(&pool);
+
+done:
+  ac_free(burst_msgs);
+
+  ac_printf("burst_mpsc_link_list_perf:-\n");
+  return error;
+}
+
+typedef struct Producer {
+  AcMpscLinkList* list;
+  AcBool* go;             ///< Producers spin until *go is AC_TRUE
+  AcU64 items;            ///< Number of messages to add
+  AcU64 pool_empty;       ///< Times all of our messages were on the list
+  AcMsgPool mp;           ///< Our messages, the consumer returns them
+  AcHistogram latency;    ///< Ticks for each add
+  AcReceptor* done;
+} AC_ATTR_ALIGNED(AC_MAX_CACHE_LINE_LEN) Producer;
+
+/**
+ * Add messages to the list recording the latency of each add
+ */
+static void* producer(void* param) {
+  Producer* p = (Producer*)param;
+
+  while (!__atomic_load_n(p->go, __ATOMIC_ACQUIRE)) {
+    ac_thread_yield();
+  }
+
+  for (AcU64 i = 0; i < p->items; i++) {
+    AcMsg* msg;
+    while ((msg = AcMsgPool_get_msg(&p->mp)) == AC_NULL) {
+      p->pool_empty += 1;
+      ac_thread_yield();
+    }
+    AcU64 start = ac_tscrd();
+    AcMpscLinkList_add(p->list, msg);
+    AcHistogram_record(&p->latency, ac_tscrd() - start);
+  }
+
+  AcReceptor_signal(p->done);
+  return AC_NULL;
+}
+
+/**
+ * producer_count threads add messages to one AcMpscLinkList which
+ * the main thread removes. There is no compare and exchange to retry
+ * in AcMpscLinkList_add, instead a consumer stall is counted when a
+ * producer was preempted between exchanging head and linking its
+ * message so AcMpscLinkList_rmv has to wait for it.
+ */
+AcBool producers_mpsc_link_list_perf(AcU32 producer_count, AcU64 items) {
+  AcBool error = AC_FALSE;
+  AcMpscLinkList list;
+  AcBool go = AC_FALSE;
+  AcHistogram latency;
+
+  ac_debug_printf("producers_mpsc_link_list_perf:+producer_count=%d items=%lu\n",
+      producer_count, items);
+  ac_assert(producer_count <= MAX_PRODUCERS);
+
+  Producer* producers = ac_malloc(sizeof(Producer) * producer_count);
+  error |= AC_TEST(producers != AC_NULL);
+  error |= AC_TEST(AcMpscLinkList_init(&list) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  for (AcU32 i = 0; i < producer_count; i++) {
+    Producer* p = &producers[i];
+    p->list = &list;
+    p->go = &go;
+    p->items = items;
+    p->pool_empty = 0;
+    error |= AC_TEST(AcMsgPool_init(&p->mp, PRODUCER_MSG_COUNT, 0) == AC_STATUS_OK);
+    AcHistogram_init(&p->latency);
+    p->done = AcReceptor_get();
+    ac_assert(p->done != AC_NULL);
+
+    ac_thread_rslt_t rslt = ac_thread_create(0, producer, p);
+    ac_assert(rslt.status == 0);
+  }
+
+  AcU64 total = items * producer_count;
+  AcU64 received = 0;
+  AcU64 stalls = 0;
+  AcU64 empty_count = 0;
+
+  AcU64 start = ac_tscrd();
+  __atomic_store_n(&go, AC_TRUE, __ATOMIC_RELEASE);
+  while (received < total) {
+    AcNextPtr* tail = list.tail;
+    if ((__atomic_load_n(&tail->next, __ATOMIC_ACQUIRE) == AC_NULL)
+        && (tail != __atomic_load_n(&list.head, __ATOMIC_ACQUIRE))) {
+      stalls += 1;
+    }
+    AcMsg* msg = AcMpscLinkList_rmv(&list);
+    if (msg != AC_NULL) {
+      AcMsgPool_ret_msg(msg);
+      received += 1;
+    } else {
+      empty_count += 1;
+      ac_thread_yield();
+    }
+  }
+  AcU64 stop = ac_tscrd();
+
+  AcHistogram_init(&latency);
+  AcU64 pool_empty = 0;
+  for (AcU32 i = 0; i < producer_count; i++) {
+    Producer* p = &producers[i];
+    AcReceptor_wait(p->done);
+    AcReceptor_ret(p->done);
+    AcHistogram_add(&latency, &p->latency);
+    pool_empty += p->pool_empty;
+    AcMsgPool_deinit(&p->mp);
+  }
+
+  AcU64 duration = stop - start;
+  ac_printf("producers_mpsc_link_list_perf: producers=%2d items_per_sec=%lu"
+            " pool_empty=%lu stalls=%lu empty=%lu\n",
+      producer_count, (total * ac_tsc_freq()) / duration, pool_empty, stalls, empty_count);
+  AcHistogram_print_summary("producers_mpsc_link_list_perf:   add latency", &latency);
+
+  AcMpscLinkList_deinit(&list);
+
+done:
+  ac_free(producers);
+
+  ac_debug_printf("producers_mpsc_link_list_perf:-error=%d\n", error);
+  return error;
+}
+
 /**
  * main
  */
 int main(void) {
   AcBool error = AC_FALSE;
 
-  ac_thread_init(10);
+  ac_thread_init(MAX_PRODUCERS + 2);
   AcReceptor_init(50);
   AcTime_init();
 
   ac_debug_printf("sizeof(AcMem)=%d\n", sizeof(AcMem));
 
   error |= simple_mpsc_link_list_perf(200000000);
+  error |= burst_mpsc_link_list_perf(50000000, 64);
+
+  // 1..ncpus producers and then twice as many as there are
+  // cpus so producers are preempted while adding.
+  AcU32 ncpus = ac_numcpus();
+  for (AcU32 n = 1; n < ncpus; n *= 2) {
+    error |= producers_mpsc_link_list_perf(n, 1000000);
+  }
+  error |= producers_mpsc_link_list_perf(ncpus, 1000000);
+  if ((ncpus * 2) <= MAX_PRODUCERS) {
+    error |= producers_mpsc_link_list_perf(ncpus * 2, 1000000);
+  }
 
   if (!error) {
     ac_printf("OK\n");
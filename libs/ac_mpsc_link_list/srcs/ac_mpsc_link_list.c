@@ -14,6 +14,7 @@
 
 #include <ac_debug_printf.h>
 #include <ac_inttypes.h>
+#include <ac_next_ptr_mgr.h>
 #include <ac_thread.h>
 
 #ifdef NDEBUG
@@ -28,15 +29,21 @@
 AcStatus AcMpscLinkList_init(AcMpscLinkList* list) {
   ac_debug_printf("AcMpscLinkList_init:+list=%p\n", list);
 
-  list->stub.next = AC_NULL;
-  list->stub.msg = AC_NULL;
-  list->head = &list->stub;
-  list->tail = &list->stub;
+  AcStatus status;
+  AcNextPtr* stub = AcNextPtrMgr_alloc();
+  if (stub == AC_NULL) {
+    status = AC_STATUS_OUT_OF_MEMORY;
+    goto done;
+  }
+  list->head = stub;
+  list->tail = stub;
   list->count = 0;
   list->msgs_processed = 0;
+  status = AC_STATUS_OK;
 
-  ac_debug_printf("AcMpscLinkList_init:-list=%p status=AC_STATUS_OK\n", list);
-  return AC_STATUS_OK;
+done:
+  ac_debug_printf("AcMpscLinkList_init:-list=%p status=%d\n", list, status);
+  return status;
 }
 
 /**
@@ -50,8 +57,21 @@ AcU64 AcMpscLinkList_deinit(AcMpscLinkList* list) {
   AcU32 count = list->count;
 #endif
 
-  AcNextPtr* next_ptr = list->head;
-  next_ptr->next = AC_NULL;
+  // A sender which has exchanged head but not yet linked prev to its
+  // message is still using prev, which may be the tail we're about to
+  // retire, so wait until every message added is linked. Senders aren't
+  // necessarily AcNextPtrMgr participants, this doesn't depend on it.
+  AcNextPtr* next_ptr = list->tail;
+  while (next_ptr != __atomic_load_n(&list->head, __ATOMIC_ACQUIRE)) {
+    AcNextPtr* next = __atomic_load_n(&next_ptr->next, __ATOMIC_ACQUIRE);
+    if (next == AC_NULL) {
+      ac_thread_yield();
+    } else {
+      next_ptr = next;
+    }
+  }
+
+  AcNextPtrMgr_retire(list->tail);
   list->head = AC_NULL;
   list->tail = AC_NULL;
   list->count = 0;
@@ -70,7 +90,8 @@ void AcMpscLinkList_add(AcMpscLinkList* list, AcMsg* msg) {
   AcNextPtr* next_ptr = msg->next_ptr;
   next_ptr->next = AC_NULL;
   next_ptr->msg = msg;
-  AcNextPtr* prev = __atomic_exchange_n(&list->head, next_ptr, __ATOMIC_ACQ_REL);
+  // SEQ_CST so a later SEQ_CST load by the caller is ordered after it
+  AcNextPtr* prev = __atomic_exchange_n(&list->head, next_ptr, __ATOMIC_SEQ_CST);
   // rmv will stall spinning if preempted at this critical spot
   __atomic_store_n(&prev->next, next_ptr, __ATOMIC_RELEASE);
 
@@ -113,3 +134,52 @@ AcMsg* AcMpscLinkList_rmv(AcMpscLinkList* list) {
     return msg;
   }
 }
+
+/**
+ * @see ac_mpsc_link_list.h
+ */
+AcBool AcMpscLinkList_rmv_all(AcMpscLinkList* list, AcMpscLinkListBatch* batch) {
+  ac_debug_printf("AcMpscLinkList_rmv_all:+list=%p\n", list);
+
+  // Producers only add after head so everything from
+  // tail to this head is private to the batch.
+  AcNextPtr* tail = list->tail;
+  AcNextPtr* last = __atomic_load_n(&list->head, __ATOMIC_SEQ_CST);
+  batch->cur = tail;
+  batch->last = last;
+
+  ac_debug_printf("AcMpscLinkList_rmv_all:-list=%p tail=%p last=%p\n", list, tail, last);
+  return tail != last;
+}
+
+/**
+ * @see ac_mpsc_link_list.h
+ */
+AcMsg* AcMpscLinkList_batch_rmv(AcMpscLinkList* list, AcMpscLinkListBatch* batch) {
+  ac_debug_printf("AcMpscLinkList_batch_rmv:+list=%p\n", list);
+
+  AcNextPtr* cur = batch->cur;
+  if (cur == batch->last) {
+    ac_debug_printf("AcMpscLinkList_batch_rmv:-list=%p EMPTY\n", list);
+    return AC_NULL;
+  }
+
+  AcNextPtr* next;
+  while ((next = __atomic_load_n(&cur->next, __ATOMIC_ACQUIRE)) == AC_NULL) {
+    // A producer was preempted between its exchange and linking
+    ac_thread_yield();
+  }
+
+  // As in AcMpscLinkList_rmv the message takes the preceding node
+  AcMsg* msg = next->msg;
+  msg->next_ptr = cur;
+  list->tail = next;
+  batch->cur = next;
+#if COUNTERS
+  list->count -= 1;
+  list->msgs_processed += 1;
+#endif
+
+  ac_debug_printf("AcMpscLinkList_batch_rmv:-list=%p msg=%p\n", list, msg);
+  return msg;
+}
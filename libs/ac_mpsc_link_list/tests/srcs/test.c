@@ -20,7 +20,11 @@
 #include <ac_msg.h>
 #include <ac_msg_pool.h>
 #include <ac_inttypes.h>
+#include <ac_next_ptr_mgr.h>
+#include <ac_receptor.h>
 #include <ac_test.h>
+#include <ac_thread.h>
+#include <ac_time.h>
 
 
 /**
@@ -38,9 +42,9 @@ AcBool test_init_and_deinit_mpscfifo() {
   error |= AC_TEST(AcMpscLinkList_init(&list) == AC_STATUS_OK);
   AcMpscLinkList_print("test_init_deinit: initialized list:", &list);
 
-  error |= AC_TEST(list.head == &list.stub);
-  error |= AC_TEST(list.tail == &list.stub);
-  error |= AC_TEST(list.stub.next == AC_NULL);
+  error |= AC_TEST(list.head != AC_NULL);
+  error |= AC_TEST(list.tail == list.head);
+  error |= AC_TEST(list.head->next == AC_NULL);
 
   // Deinitialize
   AcMpscLinkList_print("test_init_deinit: invoke deinit list:", &list);
@@ -126,13 +130,174 @@ AcBool test_add_rmv(void) {
   return error;
 }
 
+/**
+ * Test we can detach all msgs with rmv_all and that msgs
+ * added while a batch is being removed go on the list.
+ *
+ * return !0 if an error.
+ */
+AcBool test_rmv_all(void) {
+  AcBool error = AC_FALSE;
+  AcMpscLinkList list;
+  AcMpscLinkListBatch batch;
+  AcMsgPool pool;
+  AcMsg* msgs[4];
+
+  ac_printf("test_rmv_all:+list=%p\n", &list);
+
+  error |= AC_TEST(AcMpscLinkList_init(&list) == AC_STATUS_OK);
+  error |= AC_TEST(AcMsgPool_init(&pool, 4, 0) == AC_STATUS_OK);
+  for (AcU32 i = 0; i < AC_ARRAY_COUNT(msgs); i++) {
+    msgs[i] = AcMsgPool_get_msg(&pool);
+    error |= AC_TEST(msgs[i] != AC_NULL);
+  }
+
+  // Empty list
+  error |= AC_TEST(AcMpscLinkList_rmv_all(&list, &batch) == AC_FALSE);
+  error |= AC_TEST(AcMpscLinkList_batch_rmv(&list, &batch) == AC_NULL);
+
+  // Detach 3 msgs
+  for (AcU32 i = 0; i < 3; i++) {
+    AcMpscLinkList_add(&list, msgs[i]);
+  }
+  error |= AC_TEST(AcMpscLinkList_rmv_all(&list, &batch) == AC_TRUE);
+  error |= AC_TEST(batch.last == list.head);
+  error |= AC_TEST(AcMpscLinkList_batch_rmv(&list, &batch) == msgs[0]);
+
+  // Added while removing the batch goes to the list not the batch
+  AcMpscLinkList_add(&list, msgs[3]);
+  error |= AC_TEST(AcMpscLinkList_batch_rmv(&list, &batch) == msgs[1]);
+  error |= AC_TEST(AcMpscLinkList_batch_rmv(&list, &batch) == msgs[2]);
+  error |= AC_TEST(AcMpscLinkList_batch_rmv(&list, &batch) == AC_NULL);
+  error |= AC_TEST(list.tail == batch.last);
+  error |= AC_TEST(AcMpscLinkList_rmv(&list) == msgs[3]);
+  error |= AC_TEST(AcMpscLinkList_rmv(&list) == AC_NULL);
+
+  // The msgs and their next_ptrs can be reused with rmv_all and rmv
+  for (AcU32 loop = 0; loop < 3; loop++) {
+    for (AcU32 i = 0; i < AC_ARRAY_COUNT(msgs); i++) {
+      AcMpscLinkList_add(&list, msgs[i]);
+    }
+    error |= AC_TEST(AcMpscLinkList_rmv(&list) == msgs[0]);
+    error |= AC_TEST(AcMpscLinkList_rmv_all(&list, &batch) == AC_TRUE);
+    for (AcU32 i = 1; i < AC_ARRAY_COUNT(msgs); i++) {
+      error |= AC_TEST(AcMpscLinkList_batch_rmv(&list, &batch) == msgs[i]);
+    }
+    error |= AC_TEST(AcMpscLinkList_batch_rmv(&list, &batch) == AC_NULL);
+    error |= AC_TEST(AcMpscLinkList_rmv_all(&list, &batch) == AC_FALSE);
+  }
+
+  for (AcU32 i = 0; i < AC_ARRAY_COUNT(msgs); i++) {
+    AcMsgPool_ret_msg(msgs[i]);
+  }
+  AcMpscLinkList_deinit(&list);
+  AcMsgPool_deinit(&pool);
+
+  ac_printf("test_rmv_all:-error=%d\n", error);
+  return error;
+}
+
+typedef struct Deiniter {
+  AcMpscLinkList* list;
+  AcBool done;
+  AcReceptor* deinited;
+} Deiniter;
+
+/**
+ * Deinit the list
+ */
+static void* deiniter(void* param) {
+  Deiniter* d = (Deiniter*)param;
+  AcMpscLinkList_deinit(d->list);
+  __atomic_store_n(&d->done, AC_TRUE, __ATOMIC_RELEASE);
+  AcReceptor_signal(d->deinited);
+  return AC_NULL;
+}
+
+/**
+ * Test deinit waits for an add from a thread which isn't an
+ * AcNextPtrMgr participant, which has exchanged head but not
+ * yet linked the previous head, before retiring the tail.
+ *
+ * return !0 if an error.
+ */
+AcBool test_deinit_during_add(void) {
+  AcBool error = AC_FALSE;
+  AcMpscLinkList list;
+  AcMsgPool pool;
+  AcNextPtrMgrStats before;
+  AcNextPtrMgrStats stats;
+
+  ac_printf("test_deinit_during_add:+list=%p\n", &list);
+
+  error |= AC_TEST(AcMsgPool_init(&pool, 1, 0) == AC_STATUS_OK);
+  error |= AC_TEST(AcMpscLinkList_init(&list) == AC_STATUS_OK);
+  AcMsg* msg = AcMsgPool_get_msg(&pool);
+  error |= AC_TEST(msg != AC_NULL);
+  if (error) {
+    goto done;
+  }
+
+  // The first half of AcMpscLinkList_add, the sender is then preempted
+  AcNextPtr* next_ptr = msg->next_ptr;
+  next_ptr->next = AC_NULL;
+  next_ptr->msg = msg;
+  AcNextPtr* prev = __atomic_exchange_n(&list.head, next_ptr, __ATOMIC_SEQ_CST);
+  error |= AC_TEST(prev == list.tail);
+
+  AcNextPtrMgr_get_stats(&before);
+  Deiniter d = {
+    .list = &list,
+    .done = AC_FALSE,
+    .deinited = AcReceptor_get(),
+  };
+  ac_thread_rslt_t rslt = ac_thread_create(0, deiniter, &d);
+  error |= AC_TEST(rslt.status == 0);
+
+  // prev isn't retired while the sender is using it
+  ac_thread_wait_ns(10000000);
+  AcNextPtrMgr_get_stats(&stats);
+  error |= AC_TEST(__atomic_load_n(&d.done, __ATOMIC_ACQUIRE) == AC_FALSE);
+  error |= AC_TEST(stats.retired + stats.reclaimed == before.retired + before.reclaimed);
+
+  // Once the sender finishes the add it's retired
+  __atomic_store_n(&prev->next, next_ptr, __ATOMIC_RELEASE);
+  AcReceptor_wait(d.deinited);
+  AcReceptor_ret(d.deinited);
+  AcNextPtrMgr_get_stats(&stats);
+  error |= AC_TEST(__atomic_load_n(&d.done, __ATOMIC_ACQUIRE) == AC_TRUE);
+  error |= AC_TEST(stats.retired + stats.reclaimed == before.retired + before.reclaimed + 1);
+  error |= AC_TEST(list.head == AC_NULL);
+
+  // The message keeps its AcNextPtr
+  error |= AC_TEST(msg->next_ptr == next_ptr);
+  AcMsgPool_ret_msg(msg);
+  AcMsgPool_deinit(&pool);
+
+done:
+  ac_printf("test_deinit_during_add:-error=%d\n", error);
+  return error;
+}
+
 int main(void) {
   AcBool error = AC_FALSE;
 
+  ac_thread_init(2);
+  AcReceptor_init(4);
+  AcTime_init();
+
   error |= test_init_and_deinit_mpscfifo();
   ac_printf("\n");
   error |= test_add_rmv();
   ac_printf("\n");
+  error |= test_rmv_all();
+  ac_printf("\n");
+#if AC_PLATFORM == VersatilePB
+  ac_printf("test_deinit_during_add: VersatilePB threading not working, skipping\n");
+#else
+  error |= test_deinit_during_add();
+  ac_printf("\n");
+#endif
 
   if (!error) {
     // Succeeded
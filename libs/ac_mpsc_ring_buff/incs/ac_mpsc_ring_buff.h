@@ -44,6 +44,19 @@ typedef struct AcMpscRingBuff AcMpscRingBuff;
  */
 AcBool AcMpscRingBuff_add_mem(AcMpscRingBuff* rb, void* mem);
 
+/**
+ * Add mem to the ring buffer the same as AcMpscRingBuff_add_mem
+ * but also report how contended add_idx was, used by perfs.
+ *
+ * @params rb is an iniitalized AcMpscRingBuff
+ * @params mem is pointing to some arbitrary memory
+ * @params retries is set to the number of times another producer
+ *         won the race for add_idx and the add had to try again
+ *
+ * @return AC_TRUE if added AC_FALSE of full
+ */
+AcBool AcMpscRingBuff_add_mem_retries(AcMpscRingBuff* rb, void* mem, AcU32* retries);
+
 /**
  * Remove a memory from the ring buffer. This maybe used only by
  * a single thread and returns AC_NULL if the ring buffer is empty.
@@ -54,6 +67,32 @@ AcBool AcMpscRingBuff_add_mem(AcMpscRingBuff* rb, void* mem);
  */
 void* AcMpscRingBuff_rmv_mem(AcMpscRingBuff* rb);
 
+/**
+ * Add count mems to the ring buffer. The cells are reserved with
+ * a single compare and exchange of add_idx so the mems are added
+ * contiguously and in order. This maybe used by multiple threads
+ * and never blocks. Either all of the mems are added or none are.
+ *
+ * @params rb is an iniitalized AcMpscRingBuff
+ * @params mems is an array of count pointers, none may be AC_NULL
+ * @params count is the number of mems to add, must be <= size
+ *
+ * @return AC_TRUE if all were added AC_FALSE if there was not room
+ */
+AcBool AcMpscRingBuff_add_mem_n(AcMpscRingBuff* rb, void** mems, AcU32 count);
+
+/**
+ * Remove upto max_count mems from the ring buffer. This maybe
+ * used only by a single thread.
+ *
+ * @params rb is an iniitalized AcMpscRingBuff
+ * @params mems is an array to receive at least max_count pointers
+ * @params max_count is the maximum number of mems to remove
+ *
+ * @return The number of mems removed, 0 if empty
+ */
+AcU32 AcMpscRingBuff_rmv_mem_n(AcMpscRingBuff* rb, void** mems, AcU32 max_count);
+
 /**
  * Deinitialize the AcMpscRingBuff. Assumes the ring buffer is EMPTY.
  *
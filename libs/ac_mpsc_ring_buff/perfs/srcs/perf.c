@@ -22,14 +22,18 @@
 
 #include <ac_assert.h>
 #include <ac_debug_printf.h>
+#include <ac_histogram.h>
 #include <ac_memset.h>
 #include <ac_memmgr.h>
 #include <ac_receptor.h>
+#include <ac_sysconf.h>
 #include <ac_test.h>
 #include <ac_time.h>
 #include <ac_tsc.h>
 #include <ac_thread.h>
 
+#define MAX_PRODUCERS 16
+
 AcBool simple_mpsc_ring_buff_perf(AcU64 loops) {
   AcBool error = AC_FALSE;
   ac_debug_printf("simple_mpsc_ring_buff_perf:+ loops=%lu\n", loops);
@@ -78,19 +82,230 @@ AcBool simple_mpsc_ring_buff_perf(AcU64 loops) {
   return error;
 }
 
+/**
+ * Return ticks * AC_SEC_IN_NS / count without overflowing so it
+ * can be printed with %S as nano seconds.
+ */
+static AcU64 ns_per(AcU64 ticks, AcU64 count) {
+  return ((ticks / count) * AC_SEC_IN_NS) + (((ticks % count) * AC_SEC_IN_NS) / count);
+}
+
+/**
+ * Measure the cost per item of adding and removing batches
+ * of mems for batch sizes 1..max_batch in powers of 2. Each
+ * batch size is compared against the same number of items
+ * added and removed one at a time.
+ */
+AcBool batch_mpsc_ring_buff_perf(AcU64 items, AcU32 max_batch) {
+  AcBool error = AC_FALSE;
+  ac_debug_printf("batch_mpsc_ring_buff_perf:+ items=%lu max_batch=%u\n", items, max_batch);
+
+  AcMpscRingBuff rb;
+  AcU8* data = ac_malloc(max_batch * sizeof(AcU8));
+  void** mems = ac_malloc(max_batch * sizeof(void*));
+  void** rmvd = ac_malloc(max_batch * sizeof(void*));
+  error |= AC_TEST((data != AC_NULL) && (mems != AC_NULL) && (rmvd != AC_NULL));
+  if (error) {
+    goto done;
+  }
+  for (AcU32 i = 0; i < max_batch; i++) {
+    mems[i] = &data[i];
+  }
+
+  error |= AC_TEST(AcMpscRingBuff_init(&rb, max_batch) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  for (AcU32 batch = 1; batch <= max_batch; batch *= 2) {
+    AcU64 loops = items / batch;
+
+    // One at a time
+    AcU64 start = ac_tscrd();
+    for (AcU64 i = 0; i < loops; i++) {
+      for (AcU32 j = 0; j < batch; j++) {
+        AcMpscRingBuff_add_mem(&rb, mems[j]);
+      }
+      for (AcU32 j = 0; j < batch; j++) {
+        rmvd[j] = AcMpscRingBuff_rmv_mem(&rb);
+      }
+    }
+    AcU64 single = ac_tscrd() - start;
+
+    // Batched
+    start = ac_tscrd();
+    for (AcU64 i = 0; i < loops; i++) {
+      AcMpscRingBuff_add_mem_n(&rb, mems, batch);
+      AcMpscRingBuff_rmv_mem_n(&rb, rmvd, batch);
+    }
+    AcU64 batched = ac_tscrd() - start;
+
+    AcU64 single_ns_per_item = ns_per(single, loops * batch);
+    AcU64 batched_ns_per_item = ns_per(batched, loops * batch);
+    ac_printf("batch_mpsc_ring_buff_perf: batch=%2u single ns_per_item=%.4S batched ns_per_item=%.4S\n",
+        batch, single_ns_per_item, batched_ns_per_item);
+  }
+
+  AcMpscRingBuff_deinit(&rb);
+
+done:
+  ac_free(data);
+  ac_free(mems);
+  ac_free(rmvd);
+
+  ac_printf("batch_mpsc_ring_buff_perf:-\n");
+  return error;
+}
+
+typedef struct Producer {
+  AcMpscRingBuff* rb;
+  AcBool* go;             ///< Producers spin until *go is AC_TRUE
+  AcU64 items;            ///< Number of items to add
+  AcU64 retries;          ///< Times add_idx was lost to another producer
+  AcU64 full_count;       ///< Times the ring buffer was full
+  AcHistogram latency;    ///< Ticks for each successful add
+  AcReceptor* done;
+} AC_ATTR_ALIGNED(AC_MAX_CACHE_LINE_LEN) Producer;
+
+/**
+ * Add items to the ring buffer recording the latency of each add
+ */
+static void* producer(void* param) {
+  Producer* p = (Producer*)param;
+
+  while (!__atomic_load_n(p->go, __ATOMIC_ACQUIRE)) {
+    ac_thread_yield();
+  }
+
+  for (AcU64 i = 0; i < p->items; i++) {
+    AcU32 retries;
+    AcU64 start = ac_tscrd();
+    while (!AcMpscRingBuff_add_mem_retries(p->rb, p, &retries)) {
+      p->retries += retries;
+      p->full_count += 1;
+      ac_thread_yield();
+      start = ac_tscrd();
+    }
+    AcHistogram_record(&p->latency, ac_tscrd() - start);
+    p->retries += retries;
+  }
+
+  AcReceptor_signal(p->done);
+  return AC_NULL;
+}
+
+/**
+ * producer_count threads add items to one AcMpscRingBuff which the
+ * main thread removes. A consumer stall is when the ring buffer
+ * looks empty because a producer has reserved a cell but not yet
+ * filled it.
+ */
+AcBool producers_mpsc_ring_buff_perf(AcU32 producer_count, AcU64 items) {
+  AcBool error = AC_FALSE;
+  AcMpscRingBuff rb;
+  AcBool go = AC_FALSE;
+  AcHistogram latency;
+
+  ac_debug_printf("producers_mpsc_ring_buff_perf:+producer_count=%d items=%lu\n",
+      producer_count, items);
+  ac_assert(producer_count <= MAX_PRODUCERS);
+
+  Producer* producers = ac_malloc(sizeof(Producer) * producer_count);
+  error |= AC_TEST(producers != AC_NULL);
+  error |= AC_TEST(AcMpscRingBuff_init(&rb, 1024) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  for (AcU32 i = 0; i < producer_count; i++) {
+    Producer* p = &producers[i];
+    p->rb = &rb;
+    p->go = &go;
+    p->items = items;
+    p->retries = 0;
+    p->full_count = 0;
+    AcHistogram_init(&p->latency);
+    p->done = AcReceptor_get();
+    ac_assert(p->done != AC_NULL);
+
+    ac_thread_rslt_t rslt = ac_thread_create(0, producer, p);
+    ac_assert(rslt.status == 0);
+  }
+
+  AcU64 total = items * producer_count;
+  AcU64 received = 0;
+  AcU64 stalls = 0;
+  AcU64 empty_count = 0;
+
+  AcU64 start = ac_tscrd();
+  __atomic_store_n(&go, AC_TRUE, __ATOMIC_RELEASE);
+  while (received < total) {
+    if (AcMpscRingBuff_rmv_mem(&rb) != AC_NULL) {
+      received += 1;
+    } else {
+      if (__atomic_load_n(&rb.add_idx, __ATOMIC_ACQUIRE) != rb.rmv_idx) {
+        stalls += 1;
+      } else {
+        empty_count += 1;
+      }
+      ac_thread_yield();
+    }
+  }
+  AcU64 stop = ac_tscrd();
+
+  AcHistogram_init(&latency);
+  AcU64 retries = 0;
+  AcU64 full_count = 0;
+  for (AcU32 i = 0; i < producer_count; i++) {
+    Producer* p = &producers[i];
+    AcReceptor_wait(p->done);
+    AcReceptor_ret(p->done);
+    AcHistogram_add(&latency, &p->latency);
+    retries += p->retries;
+    full_count += p->full_count;
+  }
+
+  AcU64 duration = stop - start;
+  ac_printf("producers_mpsc_ring_buff_perf: producers=%2d items_per_sec=%lu"
+            " retries=%lu full=%lu stalls=%lu empty=%lu\n",
+      producer_count, (total * ac_tsc_freq()) / duration, retries, full_count,
+      stalls, empty_count);
+  AcHistogram_print_summary("producers_mpsc_ring_buff_perf:   add latency", &latency);
+
+  AcMpscRingBuff_deinit(&rb);
+
+done:
+  ac_free(producers);
+
+  ac_debug_printf("producers_mpsc_ring_buff_perf:-error=%d\n", error);
+  return error;
+}
+
 /**
  * main
  */
 int main(void) {
   AcBool error = AC_FALSE;
 
-  ac_thread_init(10);
+  ac_thread_init(MAX_PRODUCERS + 2);
   AcReceptor_init(50);
   AcTime_init();
 
   ac_debug_printf("sizeof(AcMem)=%d\n", sizeof(AcMem));
 
   error |= simple_mpsc_ring_buff_perf(200000000);
+  error |= batch_mpsc_ring_buff_perf(200000000, 64);
+
+  // 1..ncpus producers and then twice as many as there are
+  // cpus so producers are preempted while adding.
+  AcU32 ncpus = ac_numcpus();
+  for (AcU32 n = 1; n < ncpus; n *= 2) {
+    error |= producers_mpsc_ring_buff_perf(n, 1000000);
+  }
+  error |= producers_mpsc_ring_buff_perf(ncpus, 1000000);
+  if ((ncpus * 2) <= MAX_PRODUCERS) {
+    error |= producers_mpsc_ring_buff_perf(ncpus * 2, 1000000);
+  }
 
   if (!error) {
     ac_printf("OK\n");
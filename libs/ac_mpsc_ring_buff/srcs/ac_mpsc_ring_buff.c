@@ -32,11 +32,13 @@
 #define SEQ_CST 0 // 1 for memory order to be __ATOMIC_SEQ_CST for all atomics
 
 /**
- * @see ac_mpsc_ring_buff.h
+ * Add mem to the ring buffer, if retries isn't AC_NULL it's
+ * set to the number of times the compare and exchange failed.
  */
-AcBool AcMpscRingBuff_add_mem(AcMpscRingBuff* rb, void* mem) {
+static inline AcBool add_mem(AcMpscRingBuff* rb, void* mem, AcU32* retries) {
   ac_debug_printf("AcMpscRingBuff_add_mem:+rb=%p mem=%p\n", rb, mem);
 
+  AcU32 failed = 0;
   if (mem != AC_NULL) {
     RingBuffCell* cell;
     AcU32 pos = rb->add_idx;
@@ -51,11 +53,16 @@ AcBool AcMpscRingBuff_add_mem(AcMpscRingBuff* rb, void* mem) {
               AC_TRUE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
           break;
         }
+        failed += 1;
       } else if (dif < 0) {
+        if (retries != AC_NULL) {
+          *retries = failed;
+        }
         ac_debug_printf("AcMpscRingBuff_add_mem:-rb=%p mem=%p FULL\n", rb, mem);
         return AC_FALSE;
       } else {
         pos = rb->add_idx;
+        failed += 1;
       }
     }
 
@@ -66,10 +73,27 @@ AcBool AcMpscRingBuff_add_mem(AcMpscRingBuff* rb, void* mem) {
 #endif
   }
 
+  if (retries != AC_NULL) {
+    *retries = failed;
+  }
   ac_debug_printf("AcMpscRingBuff_add_mem:-rb=%p mem=%p\n", rb, mem);
   return AC_TRUE;
 }
 
+/**
+ * @see ac_mpsc_ring_buff.h
+ */
+AcBool AcMpscRingBuff_add_mem(AcMpscRingBuff* rb, void* mem) {
+  return add_mem(rb, mem, AC_NULL);
+}
+
+/**
+ * @see ac_mpsc_ring_buff.h
+ */
+AcBool AcMpscRingBuff_add_mem_retries(AcMpscRingBuff* rb, void* mem, AcU32* retries) {
+  return add_mem(rb, mem, retries);
+}
+
 /**
  * @see ac_mpsc_ring_buff.h
  */
@@ -101,6 +125,82 @@ void* AcMpscRingBuff_rmv_mem(AcMpscRingBuff* rb) {
   return mem;
 }
 
+/**
+ * @see ac_mpsc_ring_buff.h
+ */
+AcBool AcMpscRingBuff_add_mem_n(AcMpscRingBuff* rb, void** mems, AcU32 count) {
+  ac_debug_printf("AcMpscRingBuff_add_mem_n:+rb=%p mems=%p count=%u\n", rb, mems, count);
+
+  if ((count == 0) || (count > rb->size)) {
+    ac_debug_printf("AcMpscRingBuff_add_mem_n:-rb=%p count=%u BAD count\n", rb, count);
+    return count == 0;
+  }
+
+  // The consumer frees cells in order, so if the last cell of
+  // the range is free all of the cells before it are also free.
+  AcU32 last = count - 1;
+  AcU32 pos = rb->add_idx;
+
+  while (AC_TRUE) {
+    RingBuffCell* cell = &rb->ring_buffer[(pos + last) & rb->mask];
+    AcU32 seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+    ac_s32 dif = seq - (pos + last);
+
+    if (dif == 0) {
+      if (__atomic_compare_exchange_n((AcU32*)&rb->add_idx, &pos, pos + count,
+            AC_TRUE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        break;
+      }
+    } else if (dif < 0) {
+      ac_debug_printf("AcMpscRingBuff_add_mem_n:-rb=%p count=%u FULL\n", rb, count);
+      return AC_FALSE;
+    } else {
+      pos = rb->add_idx;
+    }
+  }
+
+  for (AcU32 i = 0; i < count; i++) {
+    RingBuffCell* cell = &rb->ring_buffer[(pos + i) & rb->mask];
+    cell->mem = mems[i];
+    __atomic_store_n(&cell->seq, pos + i + 1, __ATOMIC_RELEASE);
+  }
+#ifndef NDEBUG
+  rb->count += count;
+#endif
+
+  ac_debug_printf("AcMpscRingBuff_add_mem_n:-rb=%p count=%u\n", rb, count);
+  return AC_TRUE;
+}
+
+/**
+ * @see ac_mpsc_ring_buff.h
+ */
+AcU32 AcMpscRingBuff_rmv_mem_n(AcMpscRingBuff* rb, void** mems, AcU32 max_count) {
+  ac_debug_printf("AcMpscRingBuff_rmv_mem_n:+rb=%p max_count=%u\n", rb, max_count);
+  AcU32 pos = rb->rmv_idx;
+  AcU32 count;
+
+  for (count = 0; count < max_count; count++) {
+    RingBuffCell* cell = &rb->ring_buffer[(pos + count) & rb->mask];
+    AcU32 seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+    ac_s32 dif = seq - (pos + count + 1);
+    if (dif < 0) {
+      break;
+    }
+    mems[count] = cell->mem;
+    __atomic_store_n(&cell->seq, pos + count + rb->size, __ATOMIC_RELEASE);
+  }
+
+  rb->rmv_idx = pos + count;
+#ifndef NDEBUG
+  rb->processed += count;
+  rb->count -= count;
+#endif
+
+  ac_debug_printf("AcMpscRingBuff_rmv_mem_n:-rb=%p count=%u\n", rb, count);
+  return count;
+}
+
 /**
  * @see ac_mpsc_ring_buff.h
  */
@@ -156,6 +156,121 @@ AcBool test_add_rmv() {
   return error;
 }
 
+/**
+ * Test we can add and remove multiple mems with one call.
+ *
+ * return !0 if an error.
+ */
+AcBool test_add_rmv_n() {
+  AcBool error = AC_FALSE;
+  AcMpscRingBuff rb;
+  AcU8 data[6];
+  void* mems[6];
+  void* rmvd[6];
+
+  ac_printf("test_add_rmv_n:+rb=%p\n", &rb);
+
+  for (AcU32 i = 0; i < AC_ARRAY_COUNT(data); i++) {
+    data[i] = i;
+    mems[i] = &data[i];
+  }
+
+  // Initialize
+  error |= AC_TEST(AcMpscRingBuff_init(&rb, 4) == AC_STATUS_OK);
+
+  // Adding zero is a noop, adding more than size fails
+  error |= AC_TEST(AcMpscRingBuff_add_mem_n(&rb, mems, 0));
+  error |= AC_TEST(AcMpscRingBuff_add_mem_n(&rb, mems, 5) == AC_FALSE);
+  error |= AC_TEST(rb.add_idx == 0);
+
+  // Remove from empty returns 0
+  error |= AC_TEST(AcMpscRingBuff_rmv_mem_n(&rb, rmvd, 4) == 0);
+
+  // Add three
+  error |= AC_TEST(AcMpscRingBuff_add_mem_n(&rb, &mems[0], 3));
+  AcMpscRingBuff_print("test_add_rmv_n: after add 3 rb:", &rb);
+  error |= AC_TEST(rb.add_idx == 3);
+  error |= AC_TEST(rb.rmv_idx == 0);
+
+  // Adding two more won't fit and nothing is added
+  error |= AC_TEST(AcMpscRingBuff_add_mem_n(&rb, &mems[3], 2) == AC_FALSE);
+  error |= AC_TEST(rb.add_idx == 3);
+
+  // Remove two
+  error |= AC_TEST(AcMpscRingBuff_rmv_mem_n(&rb, rmvd, 2) == 2);
+  error |= AC_TEST(*(AcU8*)rmvd[0] == 0);
+  error |= AC_TEST(*(AcU8*)rmvd[1] == 1);
+  error |= AC_TEST(rb.rmv_idx == 2);
+
+  // Now there is room for three which wraps the ring buffer
+  error |= AC_TEST(AcMpscRingBuff_add_mem_n(&rb, &mems[3], 3));
+  AcMpscRingBuff_print("test_add_rmv_n: after wrapping add rb:", &rb);
+  error |= AC_TEST(rb.add_idx == 6);
+
+  // Single remove interoperates with the batch add
+  AcU8* mem = AcMpscRingBuff_rmv_mem(&rb);
+  error |= AC_TEST(mem != AC_NULL);
+  error |= AC_TEST(*mem == 2);
+
+  // Remove all remaining, asking for more than are available
+  error |= AC_TEST(AcMpscRingBuff_rmv_mem_n(&rb, rmvd, 6) == 3);
+  error |= AC_TEST(*(AcU8*)rmvd[0] == 3);
+  error |= AC_TEST(*(AcU8*)rmvd[1] == 4);
+  error |= AC_TEST(*(AcU8*)rmvd[2] == 5);
+  error |= AC_TEST(rb.rmv_idx == 6);
+  error |= AC_TEST(AcMpscRingBuff_rmv_mem(&rb) == AC_NULL);
+
+  // Deinitialize
+  AcMpscRingBuff_deinit(&rb);
+
+  ac_printf("test_add_rmv_n:-error=%d\n", error);
+  return error;
+}
+
+/**
+ * Test AcMpscRingBuff_add_mem_retries adds as AcMpscRingBuff_add_mem
+ * does and, as there is no other producer, reports no retries.
+ *
+ * return !0 if an error.
+ */
+AcBool test_add_mem_retries() {
+  AcBool error = AC_FALSE;
+  AcMpscRingBuff rb;
+  AcU8 data[3] = { 1, 2, 3 };
+  AcU32 retries;
+
+  ac_printf("test_add_mem_retries:+rb=%p\n", &rb);
+
+  // Initialize
+  error |= AC_TEST(AcMpscRingBuff_init(&rb, 2) == AC_STATUS_OK);
+
+  // Add until full
+  retries = 1;
+  error |= AC_TEST(AcMpscRingBuff_add_mem_retries(&rb, &data[0], &retries));
+  error |= AC_TEST(retries == 0);
+  retries = 1;
+  error |= AC_TEST(AcMpscRingBuff_add_mem_retries(&rb, &data[1], &retries));
+  error |= AC_TEST(retries == 0);
+  retries = 1;
+  error |= AC_TEST(AcMpscRingBuff_add_mem_retries(&rb, &data[2], &retries) == AC_FALSE);
+  error |= AC_TEST(retries == 0);
+  AcMpscRingBuff_print("test_add_mem_retries: after adds rb:", &rb);
+  error |= AC_TEST(rb.add_idx == 2);
+
+  // They're removed in order
+  AcU8* mem = AcMpscRingBuff_rmv_mem(&rb);
+  error |= AC_TEST((mem != AC_NULL) && (*mem == 1));
+  mem = AcMpscRingBuff_rmv_mem(&rb);
+  error |= AC_TEST((mem != AC_NULL) && (*mem == 2));
+  error |= AC_TEST(AcMpscRingBuff_rmv_mem(&rb) == AC_NULL);
+
+  // Deinitialize
+  AcMpscRingBuff_deinit(&rb);
+
+  ac_printf("test_add_mem_retries:-error=%d\n", error);
+  return error;
+}
+
 int main(void) {
   AcBool error = AC_FALSE;
 
@@ -163,6 +278,10 @@ int main(void) {
   ac_printf("\n");
   error |= test_add_rmv();
   ac_printf("\n");
+  error |= test_add_rmv_n();
+  ac_printf("\n");
+  error |= test_add_mem_retries();
+  ac_printf("\n");
 
   if (!error) {
     // Succeeded
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * An AcMsgMagazine is a small LIFO stack of messages owned by a
+ * single thread which sits in front of an AcMsgPool. Messages are
+ * moved between the magazine and the pool batch_count at a time so
+ * most gets and rets never touch the shared pool.
+ *
+ * A magazine holds upto 2 * batch_count messages so the pool must
+ * have enough messages for every magazine plus those in flight.
+ */
+
+#ifndef SADIE_LIBS_AC_MSG_POOL_INCS_AC_MSG_MAGAZINE_H
+#define SADIE_LIBS_AC_MSG_POOL_INCS_AC_MSG_MAGAZINE_H
+
+#include <ac_inttypes.h>
+#include <ac_msg.h>
+#include <ac_msg_pool.h>
+#include <ac_status.h>
+
+typedef struct AcMsgMagazine {
+  AcMsgPool* mp;          ///< Pool the magazine caches messages for
+  AcU32 batch_count;      ///< Number of messages moved to/from mp at a time
+  AcU32 max_count;        ///< Capacity of msgs, 2 * batch_count
+  AcU32 count;            ///< Number of messages in msgs
+  AcMsg** msgs;           ///< Stack of cached messages
+} AcMsgMagazine;
+
+/**
+ * Refill an empty magazine from its pool, internal use only
+ *
+ * @return a message or AC_NULL if the pool is empty
+ */
+AcMsg* AcMsgMagazine_refill(AcMsgMagazine* mag);
+
+/**
+ * Flush batch_count messages from a full magazine
+ * back to its pool, internal use only
+ */
+void AcMsgMagazine_flush_batch(AcMsgMagazine* mag);
+
+/**
+ * Get a message from a magazine, refilling from the pool if empty.
+ * Must only be called by the thread which owns the magazine.
+ *
+ * @param mag is an initialized magazine
+ *
+ * @return a message or AC_NULL if none available, if !AC_NULL
+ * the msg->len_extra will be initialized as AcMsgPool_get_msg does.
+ */
+static inline AcMsg* AcMsgMagazine_get_msg(AcMsgMagazine* mag) {
+  AcMsg* msg;
+  if (mag->count > 0) {
+    msg = mag->msgs[--mag->count];
+  } else {
+    msg = AcMsgMagazine_refill(mag);
+    if (msg == AC_NULL) {
+      return AC_NULL;
+    }
+  }
+  msg->len_extra = mag->mp->len_extra;
+  return msg;
+}
+
+/**
+ * Ret a message to a magazine, flushing a batch to the pool if full.
+ * A message from a different pool is returned directly to its own pool.
+ * Must only be called by the thread which owns the magazine.
+ *
+ * @param mag is an initialized magazine
+ * @param msg a message to return, AC_NULL is ignored
+ */
+static inline void AcMsgMagazine_ret_msg(AcMsgMagazine* mag, AcMsg* msg) {
+  if (msg == AC_NULL) {
+    return;
+  }
+  if (msg->mp != mag->mp) {
+    AcMsgPool_ret_msg(msg);
+    return;
+  }
+  if (mag->count >= mag->max_count) {
+    AcMsgMagazine_flush_batch(mag);
+  }
+  mag->msgs[mag->count++] = msg;
+}
+
+/**
+ * Return all of the cached messages to the pool
+ *
+ * @param mag is an initialized magazine
+ */
+void AcMsgMagazine_flush(AcMsgMagazine* mag);
+
+/**
+ * Initialize a magazine
+ *
+ * @params mag to initialize
+ * @params mp is the pool to cache messages from
+ * @params batch_count is the number of messages moved to/from the pool at a time, > 0
+ *
+ * @return 0 (AC_STATUS_OK) if successful
+ */
+AcStatus AcMsgMagazine_init(AcMsgMagazine* mag, AcMsgPool* mp, AcU32 batch_count);
+
+/**
+ * Deinitialize a magazine returning all cached messages to the pool
+ *
+ * @params mag is an initialized magazine
+ */
+void AcMsgMagazine_deinit(AcMsgMagazine* mag);
+
+#endif
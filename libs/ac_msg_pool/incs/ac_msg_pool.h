@@ -16,9 +16,10 @@
 
 /**
  * An ac_msg_pool contains AcMsg's which can be used for sending
- * information between components. The routine AcMsg_get_msg may only
- * be called from a single thread, but the AcMsg_ret_msg may be called
- * by any thread.
+ * information between components. Both AcMsgPool_get_msg and
+ * AcMsgPool_ret_msg may be called by any thread. Threads which get
+ * and return many messages should use an AcMsgMagazine to cache
+ * messages locally and reduce contention on the pool.
  */
 
 #ifndef SADIE_LIBS_AC_MSG_POOL_INCS_AC_MSG_POOL_H
@@ -26,18 +27,74 @@
 
 #include <ac_inttypes.h>
 #include <ac_msg.h>
-#include <ac_mpsc_ring_buff.h>
+#include <ac_mpmc_ring_buff.h>
 #include <ac_status.h>
+#include <ac_thread.h>
+
+typedef struct AcMsgPoolSlab AcMsgPoolSlab;
+
+/**
+ * A contiguous array of slab_msg_count messages
+ */
+typedef struct AcMsgPoolSlab {
+  AcMsgPoolSlab* next;    ///< Next slab, AC_NULL if last
+  void* msgs_raw;         ///< If !AC_NULL raw ponter to pass to ac_free
+  AcMsg* msgs;            ///< msgs aligned to sizeof(AcU64)
+} AcMsgPoolSlab;
 
 typedef struct AcMsgPool {
-  AcMpscRingBuff rb;      ///< Ring buffer to hold the messages
+  AcMpmcRingBuff rb;      ///< Ring buffer to hold the messages, sized for max_msg_count
   AcU32 len_extra;         ///< Length of the data array in each message
-  void* msgs_raw;         ///< If !AC_NULL raw ponter to pass to ac_free
-  AcMsg* msgs;            ///< msgs aligned to AC_MAC_CACHE_LINE_LEN
-  void* next_ptrs_raw;    ///< if !AC_NULL raw pointer to pass to ac_free
-  AcNextPtr* next_ptrs;   ///< next_ptrs for each message
+  AcU32 size_entry;       ///< Size of each entry in msgs
+  AcU32 slab_msg_count;   ///< Number of messages in each slab
+  AcU32 msg_count;        ///< Number of messages in all slabs
+  AcU32 max_msg_count;    ///< Ceiling msg_count may grow to
+  AcU32 grow_count;       ///< Number of slabs added after the first
+  AcU32 high_water;       ///< Most messages in use, updated as they're gotten
+  AcBool growing;         ///< Held while checking for or adding a slab
+  AcMsgPoolSlab slab;     ///< The first slab
 } AcMsgPool;
 
+/**
+ * Statistics for a message pool
+ */
+typedef struct AcMsgPoolStats {
+  AcU32 msg_count;        ///< Number of messages allocated
+  AcU32 max_msg_count;    ///< Ceiling msg_count may grow to
+  AcU32 available;        ///< Number of messages in the pool
+  AcU32 grow_count;       ///< Number of slabs added after the first
+  AcU32 high_water;       ///< Most messages seen in use
+} AcMsgPoolStats;
+
+/**
+ * Get a message from a growable pool which appears empty,
+ * adding a slab if below max_msg_count. Internal use only.
+ *
+ * @return a message or AC_NULL if none available
+ */
+AcMsg* AcMsgPool_grow_and_get_msg(AcMsgPool* mp);
+
+/**
+ * Raise high_water to the number of messages now in use, called
+ * each time messages are gotten. Internal use only. rmv_idx is read
+ * before add_idx so a racing get or ret can only make in_use low,
+ * and the compare and exchange only happens at a new peak.
+ *
+ * @return the number of messages in use
+ */
+static inline AcU32 AcMsgPool_update_high_water(AcMsgPool* mp) {
+  AcU32 msg_count = __atomic_load_n(&mp->msg_count, __ATOMIC_RELAXED);
+  AcU32 rmv_idx = __atomic_load_n(&mp->rb.rmv_idx, __ATOMIC_RELAXED);
+  AcU32 add_idx = __atomic_load_n(&mp->rb.add_idx, __ATOMIC_RELAXED);
+  AcU32 available = add_idx - rmv_idx;
+  AcU32 in_use = (available < msg_count) ? msg_count - available : 0;
+  AcU32 high_water = __atomic_load_n(&mp->high_water, __ATOMIC_RELAXED);
+  while ((in_use > high_water) && !__atomic_compare_exchange_n(&mp->high_water,
+        &high_water, in_use, AC_TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+  return in_use;
+}
+
 /**
  * Get a message from a pool
  *
@@ -51,10 +108,18 @@ static inline AcMsg* AcMsgPool_get_msg(AcMsgPool* mp) {
   if (mp == AC_NULL) {
     return AC_NULL;
   }
-  AcMsg* msg = AcMpscRingBuff_rmv_mem(&mp->rb);
-  if (msg != AC_NULL) {
-    msg->len_extra = mp->len_extra;
+  AcMsg* msg = AcMpmcRingBuff_rmv_mem(&mp->rb);
+  if (msg == AC_NULL) {
+    if (__atomic_load_n(&mp->msg_count, __ATOMIC_RELAXED) == mp->max_msg_count) {
+      return AC_NULL;
+    }
+    msg = AcMsgPool_grow_and_get_msg(mp);
+    if (msg == AC_NULL) {
+      return AC_NULL;
+    }
   }
+  AcMsgPool_update_high_water(mp);
+  msg->len_extra = mp->len_extra;
   return msg;
 }
 
@@ -68,7 +133,11 @@ static inline void AcMsgPool_ret_msg(AcMsg* msg) {
   if (msg == AC_NULL || msg->mp == AC_NULL) {
     return;
   }
-  AcMpscRingBuff_add_mem(&msg->mp->rb, msg);
+  // The ring buffer holds every message so it is only full while
+  // another thread is between reserving and releasing a cell.
+  while (!AcMpmcRingBuff_add_mem(&msg->mp->rb, msg)) {
+    ac_thread_yield();
+  }
 }
 
 
@@ -84,7 +153,34 @@ static inline void AcMsgPool_ret_msg(AcMsg* msg) {
 AcStatus AcMsgPool_init(AcMsgPool* pool, AcU32 msg_count, AcU32 len_extra);
 
 /**
- * Deinitialize the message pool
+ * Initialize a growable message pool. It starts with one slab of
+ * msg_count messages and when empty AcMsgPool_get_msg adds another
+ * slab of msg_count messages until there are max_msg_count.
+ *
+ * @params pool to initialize
+ * @params msg_count is number of messages in each slab, must be power of 2 and > 0
+ * @params max_msg_count is maximum number of messages, must be power of 2 and >= msg_count
+ * @params len_extra is number of bytes to allocate for the messages data array, 0 is OK
+ *
+ * @return 0 (AC_STATUS_OK) if successful
+ */
+AcStatus AcMsgPool_init_growable(AcMsgPool* pool, AcU32 msg_count, AcU32 max_msg_count,
+    AcU32 len_extra);
+
+/**
+ * Get the statistics of a pool, available is sampled so may be
+ * stale if the pool is being used. high_water is updated each time
+ * messages are gotten so includes peaks between calls.
+ *
+ * @params pool is an initialized pool
+ * @params stats is filled in with the current values
+ */
+void AcMsgPool_get_stats(AcMsgPool* pool, AcMsgPoolStats* stats);
+
+/**
+ * Deinitialize the message pool, all of the messages must have
+ * been returned. The messages' AcNextPtr's are retired to the
+ * AcNextPtr manager.
  *
  * @params pool is a pool created by AcMsgPool_alloc
  */
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * An AcMsgPoolSet is a set of AcMsgPool's whose len_extra are power
+ * of 2 size classes, from min_len_extra to max_len_extra. Messages
+ * are gotten from the smallest class that fits and are returned
+ * with AcMsgPool_ret_msg as msg->mp is the class's pool.
+ */
+
+#ifndef SADIE_LIBS_AC_MSG_POOL_INCS_AC_MSG_POOL_SET_H
+#define SADIE_LIBS_AC_MSG_POOL_INCS_AC_MSG_POOL_SET_H
+
+#include <ac_inttypes.h>
+#include <ac_msg.h>
+#include <ac_msg_pool.h>
+#include <ac_status.h>
+
+#define AC_MSG_POOL_SET_MAX_CLASSES 16
+
+typedef struct AcMsgPoolSet {
+  AcU32 min_shift;        ///< log2 of the smallest class's len_extra
+  AcU32 class_count;      ///< Number of classes in pools
+  AcMsgPool pools[AC_MSG_POOL_SET_MAX_CLASSES]; ///< pools[i].len_extra == 1 << (min_shift + i)
+} AcMsgPoolSet;
+
+/**
+ * Get the index of the smallest class which fits needed_len
+ *
+ * @return index, which is >= set->class_count if too large
+ */
+static inline AcU32 AcMsgPoolSet_class_idx(AcMsgPoolSet* set, AcU32 needed_len) {
+  if (needed_len <= (1U << set->min_shift)) {
+    return 0;
+  }
+  return (32 - __builtin_clz(needed_len - 1)) - set->min_shift;
+}
+
+/**
+ * Get a message with at least needed_len bytes of extra data. If
+ * the smallest fitting class is empty the next larger is tried.
+ *
+ * @param set is an initialized set
+ * @param needed_len is the number of extra data bytes needed
+ *
+ * @return a message or AC_NULL if none available, if !AC_NULL
+ * msg->len_extra is the len_extra of the class, >= needed_len.
+ */
+static inline AcMsg* AcMsgPoolSet_get_msg(AcMsgPoolSet* set, AcU32 needed_len) {
+  for (AcU32 idx = AcMsgPoolSet_class_idx(set, needed_len); idx < set->class_count; idx++) {
+    AcMsg* msg = AcMsgPool_get_msg(&set->pools[idx]);
+    if (msg != AC_NULL) {
+      return msg;
+    }
+  }
+  return AC_NULL;
+}
+
+/**
+ * Initialize a message pool set
+ *
+ * @params set to initialize
+ * @params min_len_extra is the len_extra of the smallest class, a power of 2 > 0
+ * @params max_len_extra is the len_extra of the largest class, a power of 2 >= min_len_extra
+ * @params msg_counts is an array with the msg_count for each class smallest
+ *         first, each must be a power of 2 and > 0
+ *
+ * @return 0 (AC_STATUS_OK) if successful
+ */
+AcStatus AcMsgPoolSet_init(AcMsgPoolSet* set, AcU32 min_len_extra, AcU32 max_len_extra,
+    const AcU32* msg_counts);
+
+/**
+ * Deinitialize the message pool set
+ *
+ * @params set is a set initialized by AcMsgPoolSet_init
+ */
+void AcMsgPoolSet_deinit(AcMsgPoolSet* set);
+
+#endif
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define NDEBUG
+
+#include <ac_msg_magazine.h>
+#include <ac_msg_pool.h>
+
+#include <ac_assert.h>
+#include <ac_debug_printf.h>
+#include <ac_receptor.h>
+#include <ac_test.h>
+#include <ac_time.h>
+#include <ac_tsc.h>
+#include <ac_thread.h>
+
+#define MAX_THREADS 8
+#define MSGS_PER_BURST 4
+
+typedef struct Worker {
+  AcMsgPool* mp;
+  AcU32 batch_count;      ///< 0 to use the pool directly
+  AcU64 loops;
+  AcU64 count;
+  AcU64 empty_count;
+  AcReceptor* done;
+} AC_ATTR_ALIGNED(AC_MAX_CACHE_LINE_LEN) Worker;
+
+/**
+ * Get MSGS_PER_BURST messages and return them loops times,
+ * either directly from the shared pool or through a magazine.
+ */
+static void* worker(void* param) {
+  Worker* w = (Worker*)param;
+  AcMsgMagazine mag;
+  AcMsg* msgs[MSGS_PER_BURST];
+
+  if (w->batch_count != 0) {
+    AcStatus status = AcMsgMagazine_init(&mag, w->mp, w->batch_count);
+    ac_assert(status == AC_STATUS_OK);
+  }
+
+  for (AcU64 loop = 0; loop < w->loops; loop++) {
+    for (AcU32 i = 0; i < MSGS_PER_BURST; i++) {
+      AcMsg* msg;
+      while (AC_TRUE) {
+        msg = (w->batch_count != 0) ? AcMsgMagazine_get_msg(&mag) : AcMsgPool_get_msg(w->mp);
+        if (msg != AC_NULL) {
+          break;
+        }
+        w->empty_count += 1;
+        ac_thread_yield();
+      }
+      msgs[i] = msg;
+    }
+    for (AcU32 i = 0; i < MSGS_PER_BURST; i++) {
+      if (w->batch_count != 0) {
+        AcMsgMagazine_ret_msg(&mag, msgs[i]);
+      } else {
+        AcMsgPool_ret_msg(msgs[i]);
+      }
+    }
+    w->count += MSGS_PER_BURST;
+  }
+
+  if (w->batch_count != 0) {
+    AcMsgMagazine_deinit(&mag);
+  }
+
+  AcReceptor_signal(w->done);
+  return AC_NULL;
+}
+
+/**
+ * thread_count threads get and return messages to a shared AcMsgPool,
+ * batch_count == 0 uses the pool directly otherwise each thread uses an
+ * AcMsgMagazine with that batch_count.
+ */
+AcBool msg_pool_perf(AcU32 thread_count, AcU32 batch_count, AcU64 loops) {
+  AcBool error = AC_FALSE;
+  AcMsgPool mp;
+  Worker workers[MAX_THREADS];
+
+  ac_debug_printf("msg_pool_perf:+thread_count=%d batch_count=%d loops=%lu\n",
+      thread_count, batch_count, loops);
+  ac_assert(thread_count <= MAX_THREADS);
+
+  // Enough messages for every magazine to be full and a burst in flight
+  AcU32 msg_count = 1;
+  while (msg_count < thread_count * ((batch_count * 2) + MSGS_PER_BURST)) {
+    msg_count *= 2;
+  }
+  error |= AC_TEST(AcMsgPool_init(&mp, msg_count, 0) == AC_STATUS_OK);
+  if (error) {
+    goto done;
+  }
+
+  for (AcU32 i = 0; i < thread_count; i++) {
+    Worker* w = &workers[i];
+    w->mp = &mp;
+    w->batch_count = batch_count;
+    w->loops = loops;
+    w->count = 0;
+    w->empty_count = 0;
+    w->done = AcReceptor_get();
+    ac_assert(w->done != AC_NULL);
+  }
+
+  AcU64 start = ac_tscrd();
+
+  for (AcU32 i = 0; i < thread_count; i++) {
+    ac_thread_rslt_t rslt = ac_thread_create(0, worker, &workers[i]);
+    ac_assert(rslt.status == 0);
+  }
+
+  AcU64 count = 0;
+  AcU64 empty_count = 0;
+  for (AcU32 i = 0; i < thread_count; i++) {
+    Worker* w = &workers[i];
+    AcReceptor_wait(w->done);
+    AcReceptor_ret(w->done);
+    count += w->count;
+    empty_count += w->empty_count;
+  }
+
+  AcU64 stop = ac_tscrd();
+  error |= AC_TEST(count == thread_count * loops * MSGS_PER_BURST);
+
+  // All of the messages must be back in the pool
+  AcU32 in_pool = 0;
+  while (AcMsgPool_get_msg(&mp) != AC_NULL) {
+    in_pool += 1;
+  }
+  error |= AC_TEST(in_pool == msg_count);
+
+  AcU64 duration = stop - start;
+  AcU64 msgs_per_sec = (count * ac_tsc_freq()) / duration;
+  ac_printf("msg_pool_perf: threads=%d batch_count=%d time=%.9t msgs_per_sec=%lu"
+            " empty_count=%lu\n",
+      thread_count, batch_count, duration, msgs_per_sec, empty_count);
+
+  AcMsgPool_deinit(&mp);
+
+done:
+  ac_debug_printf("msg_pool_perf:-error=%d\n", error);
+  return error;
+}
+
+/**
+ * main
+ */
+int main(void) {
+  AcBool error = AC_FALSE;
+
+  ac_thread_init(MAX_THREADS * 2);
+  AcReceptor_init(50);
+  AcTime_init();
+
+  static const AcU32 batch_counts[] = { 0, 8, 32 };
+  for (AcU32 thread_count = 1; thread_count <= MAX_THREADS; thread_count *= 2) {
+    for (AcU32 i = 0; i < AC_ARRAY_COUNT(batch_counts); i++) {
+      error |= msg_pool_perf(thread_count, batch_counts[i], 1000000);
+    }
+  }
+
+  if (!error) {
+    ac_printf("OK\n");
+  }
+
+  return error;
+}
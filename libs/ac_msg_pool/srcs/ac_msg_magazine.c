@@ -0,0 +1,121 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define NDEBUG
+
+#include <ac_msg_magazine.h>
+
+#include <ac_debug_printf.h>
+#include <ac_memmgr.h>
+#include <ac_mpmc_ring_buff.h>
+#include <ac_thread.h>
+
+/**
+ * @see ac_msg_magazine.h
+ */
+AcMsg* AcMsgMagazine_refill(AcMsgMagazine* mag) {
+  ac_debug_printf("AcMsgMagazine_refill:+mag=%p\n", mag);
+
+  mag->count = AcMpmcRingBuff_rmv_mem_n(&mag->mp->rb,
+      (void**)mag->msgs, mag->batch_count);
+  AcMsg* msg;
+  if (mag->count > 0) {
+    AcMsgPool_update_high_water(mag->mp);
+    msg = mag->msgs[--mag->count];
+  } else {
+    // Let the pool grow if it can
+    msg = AcMsgPool_get_msg(mag->mp);
+  }
+
+  ac_debug_printf("AcMsgMagazine_refill:-mag=%p count=%u msg=%p\n",
+      mag, mag->count, msg);
+  return msg;
+}
+
+/**
+ * @see ac_msg_magazine.h
+ */
+void AcMsgMagazine_flush_batch(AcMsgMagazine* mag) {
+  ac_debug_printf("AcMsgMagazine_flush_batch:+mag=%p count=%u\n", mag, mag->count);
+
+  AcU32 count = mag->count < mag->batch_count ? mag->count : mag->batch_count;
+  mag->count -= count;
+
+  // As in AcMsgPool_ret_msg the pool is only full transiently
+  while (!AcMpmcRingBuff_add_mem_n(&mag->mp->rb, (void**)&mag->msgs[mag->count], count)) {
+    ac_thread_yield();
+  }
+
+  ac_debug_printf("AcMsgMagazine_flush_batch:-mag=%p count=%u\n", mag, mag->count);
+}
+
+/**
+ * @see ac_msg_magazine.h
+ */
+void AcMsgMagazine_flush(AcMsgMagazine* mag) {
+  ac_debug_printf("AcMsgMagazine_flush:+mag=%p count=%u\n", mag, mag->count);
+
+  while (mag->count > 0) {
+    AcMsgMagazine_flush_batch(mag);
+  }
+
+  ac_debug_printf("AcMsgMagazine_flush:-mag=%p\n", mag);
+}
+
+/**
+ * @see ac_msg_magazine.h
+ */
+AcStatus AcMsgMagazine_init(AcMsgMagazine* mag, AcMsgPool* mp, AcU32 batch_count) {
+  ac_debug_printf("AcMsgMagazine_init:+mag=%p mp=%p batch_count=%u\n",
+      mag, mp, batch_count);
+  AcStatus status;
+
+  if ((mag == AC_NULL) || (mp == AC_NULL) || (batch_count == 0)) {
+    status = AC_STATUS_BAD_PARAM;
+    goto done;
+  }
+
+  mag->mp = mp;
+  mag->batch_count = batch_count;
+  mag->max_count = batch_count * 2;
+  mag->count = 0;
+  mag->msgs = ac_malloc(sizeof(*mag->msgs) * mag->max_count);
+  if (mag->msgs == AC_NULL) {
+    status = AC_STATUS_OUT_OF_MEMORY;
+    goto done;
+  }
+
+  status = AC_STATUS_OK;
+
+done:
+  ac_debug_printf("AcMsgMagazine_init:-mag=%p status=%d\n", mag, status);
+  return status;
+}
+
+/**
+ * @see ac_msg_magazine.h
+ */
+void AcMsgMagazine_deinit(AcMsgMagazine* mag) {
+  ac_debug_printf("AcMsgMagazine_deinit:+mag=%p\n", mag);
+
+  if (mag != AC_NULL) {
+    AcMsgMagazine_flush(mag);
+    ac_free(mag->msgs);
+    mag->msgs = AC_NULL;
+  }
+
+  ac_debug_printf("AcMsgMagazine_deinit:-mag=%p\n", mag);
+}
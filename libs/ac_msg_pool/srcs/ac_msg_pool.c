@@ -23,6 +23,7 @@
 #include <ac_debug_printf.h>
 #include <ac_intmath.h>
 #include <ac_memmgr.h>
+#include <ac_next_ptr_mgr.h>
 
 /**
  * Allocate count elements each at least size long and each aligned
@@ -82,85 +83,201 @@ done:
   return status;
 }
 
+/**
+ * Allocate the messages of a slab and their AcNextPtr's,
+ * the messages are not added to the ring buffer.
+ */
+static AcStatus init_slab(AcMsgPool* mp, AcMsgPoolSlab* slab) {
+  ac_debug_printf("init_slab:+mp=%p slab=%p\n", mp, slab);
+  AcStatus status;
+
+  slab->next = AC_NULL;
+  slab->msgs_raw = AC_NULL;
+  slab->msgs = AC_NULL;
+
+  // Allocate and align the messages
+  status = ac_calloc_align(mp->slab_msg_count, sizeof(AcMsg) + mp->len_extra, sizeof(AcU64),
+      &slab->msgs_raw, (void**)&slab->msgs, &mp->size_entry);
+  ac_debug_printf("init_slab: mp=%p msgs_raw=%p msgs=%p size_entry=%u status=%u\n",
+      mp, slab->msgs_raw, slab->msgs, mp->size_entry, status);
+  if (status != AC_STATUS_OK) {
+    goto done;
+  }
+
+  void* base = slab->msgs;
+  for (AcU32 i = 0; i < mp->slab_msg_count; i++) {
+    AcMsg* msg = (AcMsg*)base;
+
+    // Init msg fields
+    msg->mp = mp;
+    msg->next_ptr = AcNextPtrMgr_alloc();
+    if (msg->next_ptr == AC_NULL) {
+      status = AC_STATUS_OUT_OF_MEMORY;
+      goto done;
+    }
+
+    // Advance to next entry
+    base += mp->size_entry;
+  }
+
+done:
+  if ((status != AC_STATUS_OK) && (slab->msgs != AC_NULL)) {
+    // msgs was zeroed so unallocated next_ptrs are AC_NULL
+    void* base = slab->msgs;
+    for (AcU32 i = 0; i < mp->slab_msg_count; i++) {
+      AcNextPtrMgr_retire(((AcMsg*)base)->next_ptr);
+      base += mp->size_entry;
+    }
+    ac_free(slab->msgs_raw);
+    slab->msgs_raw = AC_NULL;
+    slab->msgs = AC_NULL;
+  }
+  ac_debug_printf("init_slab:-mp=%p slab=%p status=%d\n", mp, slab, status);
+  return status;
+}
+
+/**
+ * Add the messages of slab, starting at first, to the ring buffer
+ */
+static void add_slab_msgs(AcMsgPool* mp, AcMsgPoolSlab* slab, AcU32 first) {
+  void* base = (void*)slab->msgs + (first * mp->size_entry);
+  for (AcU32 i = first; i < mp->slab_msg_count; i++) {
+    if (!AcMpmcRingBuff_add_mem(&mp->rb, base)) {
+      ac_fail("add_slab_msgs: WTF should always be able to add msg");
+    }
+    base += mp->size_entry;
+  }
+}
+
+/**
+ * Retire the AcNextPtr's of a slab's messages and free them
+ */
+static void deinit_slab(AcMsgPool* mp, AcMsgPoolSlab* slab) {
+  // The next_ptrs aren't necessarily the ones allocated in
+  // init_slab, they may have been swapped with those of a
+  // AcMpscLinkList, so they're retired rather than freed. All of
+  // the messages have been returned so no sender is adding them.
+  void* base = slab->msgs;
+  for (AcU32 i = 0; i < mp->slab_msg_count; i++) {
+    AcMsg* msg = (AcMsg*)base;
+    AcNextPtrMgr_retire(msg->next_ptr);
+    msg->next_ptr = AC_NULL;
+    base += mp->size_entry;
+  }
+  ac_free(slab->msgs_raw);
+}
+
 /**
  * @see ac_msg_pool.h
  */
-AcStatus AcMsgPool_init(AcMsgPool* mp, AcU32 msg_count, AcU32 len_extra) {
-  ac_debug_printf("AcMsgPool_init:+mp=%p msg_count=%u len_extra=%u\n",
-      mp, msg_count, len_extra);
+AcMsg* AcMsgPool_grow_and_get_msg(AcMsgPool* mp) {
+  ac_debug_printf("AcMsgPool_grow_and_get_msg:+mp=%p\n", mp);
+
+  while (__atomic_test_and_set(&mp->growing, __ATOMIC_ACQUIRE)) {
+    // Another thread is growing, we'll use what it adds
+    ac_thread_yield();
+  }
+
+  AcMsg* msg = AcMpmcRingBuff_rmv_mem(&mp->rb);
+  if (msg == AC_NULL) {
+    // Empty so all of the messages are in use
+    AcU32 msg_count = __atomic_load_n(&mp->msg_count, __ATOMIC_RELAXED);
+    if (msg_count < mp->max_msg_count) {
+      AcMsgPoolSlab* slab = ac_malloc(sizeof(AcMsgPoolSlab));
+      if ((slab != AC_NULL) && (init_slab(mp, slab) == AC_STATUS_OK)) {
+        slab->next = mp->slab.next;
+        mp->slab.next = slab;
+        mp->grow_count += 1;
+
+        // Keep the first message and make the rest available
+        msg = slab->msgs;
+        add_slab_msgs(mp, slab, 1);
+        __atomic_store_n(&mp->msg_count, msg_count + mp->slab_msg_count, __ATOMIC_RELEASE);
+      } else {
+        ac_free(slab);
+      }
+    }
+  }
+  AcMsgPool_update_high_water(mp);
+
+  __atomic_clear(&mp->growing, __ATOMIC_RELEASE);
+
+  ac_debug_printf("AcMsgPool_grow_and_get_msg:-mp=%p msg=%p\n", mp, msg);
+  return msg;
+}
+
+/**
+ * @see ac_msg_pool.h
+ */
+AcStatus AcMsgPool_init_growable(AcMsgPool* mp, AcU32 msg_count, AcU32 max_msg_count,
+    AcU32 len_extra) {
+  ac_debug_printf("AcMsgPool_init_growable:+mp=%p msg_count=%u max_msg_count=%u len_extra=%u\n",
+      mp, msg_count, max_msg_count, len_extra);
   AcStatus status;
 
   if (mp == AC_NULL) {
     status = AC_STATUS_BAD_PARAM;
     goto done;
   }
-  mp->msgs_raw = AC_NULL;
-  mp->next_ptrs_raw = AC_NULL;
-  mp->msgs = AC_NULL;
+  mp->slab.next = AC_NULL;
+  mp->slab.msgs_raw = AC_NULL;
+  mp->slab.msgs = AC_NULL;
   mp->len_extra = len_extra;
-  
-  // Allocate and align the messages
-  AcU32 size_entry;
-  status = ac_calloc_align(msg_count, sizeof(AcMsg) + len_extra, sizeof(AcU64),
-      &mp->msgs_raw, (void**)&mp->msgs, &size_entry);
-  ac_debug_printf("AcMsgPool_init: mp=%p msgs_raw=%p msgs=%p size_entry=%u status=%u\n",
-      mp, mp->msgs_raw, mp->msgs, size_entry, status);
-  if (status != AC_STATUS_OK) {
+  mp->size_entry = 0;
+  mp->slab_msg_count = msg_count;
+  mp->msg_count = msg_count;
+  mp->max_msg_count = max_msg_count;
+  mp->grow_count = 0;
+  mp->high_water = 0;
+  mp->growing = AC_FALSE;
+
+  if ((AC_COUNT_ONE_BITS(msg_count) != 1) || (msg_count > max_msg_count)) {
+    status = AC_STATUS_BAD_PARAM;
     goto done;
   }
 
-  // Allocate and align the AcNextPtrs
-  // BUG These AcNextPtrs need to be managed globally.
-  AcU32 size_next_entry;
-  status = ac_calloc_align(msg_count, sizeof(AcNextPtr), AC_MAX_CACHE_LINE_LEN,
-      &mp->next_ptrs_raw, (void**)&mp->next_ptrs, &size_next_entry);
-  ac_debug_printf("AcMsgPool_init: mp=%p next_ptrs_raw=%p next_ptrs=%p size_next_entry=%u status=%u\n",
-      mp, mp->next_ptrs_raw, mp->msgs, size_next_entry, status);
+  // Init the ring buffer large enough for every message we may grow to
+  status = AcMpmcRingBuff_init(&mp->rb, max_msg_count);
   if (status != AC_STATUS_OK) {
     goto done;
   }
 
-  // Init the ring buffer
-  status = AcMpscRingBuff_init(&mp->rb, msg_count);
+  status = init_slab(mp, &mp->slab);
   if (status != AC_STATUS_OK) {
+    AcMpmcRingBuff_deinit(&mp->rb);
     goto done;
   }
+  add_slab_msgs(mp, &mp->slab, 0);
 
-  // Add messages
-  void* base = mp->msgs;
-  void* base_np = mp->next_ptrs;
-  for (AcU32 i = 0; i < msg_count; i++) {
-    AcMsg* msg = (AcMsg*)base;
-    AcNextPtr* np = (AcNextPtr*)base_np;
-
-    // Init next_ptr fields
-    np->next = AC_NULL;
-    np->msg = AC_NULL;
-
-    // Init msg fields
-    msg->mp = mp;
-    msg->next_ptr = np;
+done:
+  ac_debug_printf("AcMsgPool_init_growable:-mp=%p msg_count=%u max_msg_count=%u"
+      " len_extra=%u status=%d\n", mp, msg_count, max_msg_count, len_extra, status);
+  return status;
+}
 
-    // Add msg to ring buffer
-    if (!AcMpscRingBuff_add_mem(&mp->rb, msg)) {
-      ac_fail("AcMsgPool_init: WTF should always be able to add msg");
-      status = AC_STATUS_ERR;
-      goto done;
-    }
+/**
+ * @see ac_msg_pool.h
+ */
+AcStatus AcMsgPool_init(AcMsgPool* mp, AcU32 msg_count, AcU32 len_extra) {
+  return AcMsgPool_init_growable(mp, msg_count, msg_count, len_extra);
+}
 
-    // Advance to next entries
-    base += size_entry;
-    base_np += size_next_entry;
+/**
+ * @see ac_msg_pool.h
+ */
+void AcMsgPool_get_stats(AcMsgPool* mp, AcMsgPoolStats* stats) {
+  AcU32 msg_count = __atomic_load_n(&mp->msg_count, __ATOMIC_ACQUIRE);
+  AcU32 in_use = AcMsgPool_update_high_water(mp);
+  if (in_use > msg_count) {
+    // The pool grew after msg_count was read
+    in_use = msg_count;
   }
 
-done:
-  if (status != AC_STATUS_OK && mp != AC_NULL) {
-    ac_free(mp->msgs_raw);
-    ac_free(mp->next_ptrs_raw);
-  }
-  ac_debug_printf("AcMsgPool_init:-mp=%p msg_count=%u len_extra=%u status=%d\n",
-      mp, msg_count, len_extra, status);
-  return status;
+  stats->msg_count = msg_count;
+  stats->max_msg_count = mp->max_msg_count;
+  stats->available = msg_count - in_use;
+  stats->grow_count = __atomic_load_n(&mp->grow_count, __ATOMIC_RELAXED);
+  stats->high_water = __atomic_load_n(&mp->high_water, __ATOMIC_RELAXED);
 }
 
 /**
@@ -170,13 +287,17 @@ void AcMsgPool_deinit(AcMsgPool* mp) {
   if (mp == AC_NULL) {
     return;
   }
-  AcMpscRingBuff_deinit(&mp->rb);
 
   // We ASSUME none of the message are being used!!!
-  ac_free(mp->msgs_raw);
+  deinit_slab(mp, &mp->slab);
+  AcMsgPoolSlab* slab = mp->slab.next;
+  while (slab != AC_NULL) {
+    AcMsgPoolSlab* next = slab->next;
+    deinit_slab(mp, slab);
+    ac_free(slab);
+    slab = next;
+  }
+  mp->slab.next = AC_NULL;
 
-  // BUG: We can't free next_ptrs because they could still be in use!!!
-  // These can only be freed when all components have stopped. We will
-  // need a "global" manager to free them
-  //ac_free(mp->next_ptrs_raw);
+  AcMpmcRingBuff_deinit(&mp->rb);
 }
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define NDEBUG
+
+#include <ac_msg_pool_set.h>
+
+#include <ac_debug_printf.h>
+#include <ac_intmath.h>
+
+/**
+ * @see ac_msg_pool_set.h
+ */
+AcStatus AcMsgPoolSet_init(AcMsgPoolSet* set, AcU32 min_len_extra, AcU32 max_len_extra,
+    const AcU32* msg_counts) {
+  ac_debug_printf("AcMsgPoolSet_init:+set=%p min_len_extra=%u max_len_extra=%u\n",
+      set, min_len_extra, max_len_extra);
+  AcStatus status;
+
+  if (set == AC_NULL) {
+    status = AC_STATUS_BAD_PARAM;
+    goto done;
+  }
+  set->class_count = 0;
+
+  if ((msg_counts == AC_NULL) || (min_len_extra > max_len_extra)
+      || (AC_COUNT_ONE_BITS(min_len_extra) != 1)
+      || (AC_COUNT_ONE_BITS(max_len_extra) != 1)) {
+    status = AC_STATUS_BAD_PARAM;
+    goto done;
+  }
+
+  set->min_shift = __builtin_ctz(min_len_extra);
+  AcU32 class_count = __builtin_ctz(max_len_extra) - set->min_shift + 1;
+  if (class_count > AC_MSG_POOL_SET_MAX_CLASSES) {
+    status = AC_STATUS_BAD_PARAM;
+    goto done;
+  }
+
+  for (AcU32 i = 0; i < class_count; i++) {
+    status = AcMsgPool_init(&set->pools[i], msg_counts[i], min_len_extra << i);
+    if (status != AC_STATUS_OK) {
+      goto done;
+    }
+    set->class_count += 1;
+  }
+
+  status = AC_STATUS_OK;
+
+done:
+  if ((status != AC_STATUS_OK) && (set != AC_NULL)) {
+    AcMsgPoolSet_deinit(set);
+  }
+  ac_debug_printf("AcMsgPoolSet_init:-set=%p status=%d\n", set, status);
+  return status;
+}
+
+/**
+ * @see ac_msg_pool_set.h
+ */
+void AcMsgPoolSet_deinit(AcMsgPoolSet* set) {
+  ac_debug_printf("AcMsgPoolSet_deinit:+set=%p\n", set);
+
+  if (set != AC_NULL) {
+    for (AcU32 i = 0; i < set->class_count; i++) {
+      AcMsgPool_deinit(&set->pools[i]);
+    }
+    set->class_count = 0;
+  }
+
+  ac_debug_printf("AcMsgPoolSet_deinit:-set=%p\n", set);
+}
@@ -16,7 +16,9 @@
 
 #define NDEBUG
 
+#include <ac_msg_magazine.h>
 #include <ac_msg_pool.h>
+#include <ac_msg_pool_set.h>
 #include <ac_msg_pool/tests/incs/test.h>
 
 #include <ac_printf.h>
@@ -120,6 +122,201 @@ AcBool simple_message_pool_test(void) {
   return error;
 }
 
+AcBool growable_pool_test(void) {
+  AcBool error = AC_FALSE;
+  AcMsgPool mp;
+  AcMsgPoolStats stats;
+  AcMsg* msgs[8];
+  ac_debug_printf("growable_pool_test:+\n");
+
+  error |= AC_TEST(AcMsgPool_init_growable(&mp, 4, 2, 0) != AC_STATUS_OK);
+  error |= AC_TEST(AcMsgPool_init_growable(&mp, 3, 8, 0) != AC_STATUS_OK);
+  error |= AC_TEST(AcMsgPool_init_growable(&mp, 2, 8, 1) == AC_STATUS_OK);
+
+  AcMsgPool_get_stats(&mp, &stats);
+  error |= AC_TEST(stats.msg_count == 2);
+  error |= AC_TEST(stats.max_msg_count == 8);
+  error |= AC_TEST(stats.available == 2);
+  error |= AC_TEST(stats.grow_count == 0);
+  error |= AC_TEST(stats.high_water == 0);
+
+  // Getting more than msg_count grows the pool upto max_msg_count
+  for (AcU32 i = 0; i < AC_ARRAY_COUNT(msgs); i++) {
+    msgs[i] = AcMsgPool_get_msg(&mp);
+    error |= AC_TEST(msgs[i] != AC_NULL);
+    error |= AC_TEST((msgs[i] != AC_NULL) && (msgs[i]->len_extra == 1));
+    error |= AC_TEST((msgs[i] != AC_NULL) && (msgs[i]->mp == &mp));
+  }
+  error |= AC_TEST(AcMsgPool_get_msg(&mp) == AC_NULL);
+
+  AcMsgPool_get_stats(&mp, &stats);
+  error |= AC_TEST(stats.msg_count == 8);
+  error |= AC_TEST(stats.available == 0);
+  error |= AC_TEST(stats.grow_count == 3);
+  error |= AC_TEST(stats.high_water == 8);
+
+  for (AcU32 i = 0; i < AC_ARRAY_COUNT(msgs); i++) {
+    AcMsgPool_ret_msg(msgs[i]);
+  }
+  AcMsgPool_get_stats(&mp, &stats);
+  error |= AC_TEST(stats.available == 8);
+  error |= AC_TEST(stats.high_water == 8);
+
+  AcMsgPool_deinit(&mp);
+
+  // A fixed pool never grows
+  error |= AC_TEST(AcMsgPool_init(&mp, 2, 0) == AC_STATUS_OK);
+  msgs[0] = AcMsgPool_get_msg(&mp);
+  msgs[1] = AcMsgPool_get_msg(&mp);
+  error |= AC_TEST(AcMsgPool_get_msg(&mp) == AC_NULL);
+  AcMsgPool_get_stats(&mp, &stats);
+  error |= AC_TEST((stats.msg_count == 2) && (stats.grow_count == 0));
+  error |= AC_TEST(stats.high_water == 2);
+  AcMsgPool_ret_msg(msgs[0]);
+  AcMsgPool_ret_msg(msgs[1]);
+  AcMsgPool_deinit(&mp);
+
+  // A peak between two calls to get_stats is still seen
+  error |= AC_TEST(AcMsgPool_init(&mp, 8, 0) == AC_STATUS_OK);
+  AcMsgPool_get_stats(&mp, &stats);
+  error |= AC_TEST(stats.high_water == 0);
+  for (AcU32 i = 0; i < 6; i++) {
+    msgs[i] = AcMsgPool_get_msg(&mp);
+    error |= AC_TEST(msgs[i] != AC_NULL);
+  }
+  for (AcU32 i = 0; i < 6; i++) {
+    AcMsgPool_ret_msg(msgs[i]);
+  }
+  AcMsgPool_get_stats(&mp, &stats);
+  error |= AC_TEST(stats.available == 8);
+  error |= AC_TEST(stats.high_water == 6);
+  AcMsgPool_deinit(&mp);
+
+  ac_debug_printf("growable_pool_test:-error=%d\n", error);
+  return error;
+}
+
+AcBool simple_magazine_test(void) {
+  AcBool error = AC_FALSE;
+  AcMsgPool mp;
+  AcMsgPool other_mp;
+  AcMsgMagazine mag;
+  AcMsg* msgs[8];
+  ac_debug_printf("simple_magazine_test:+\n");
+
+  error |= AC_TEST(AcMsgPool_init(&mp, 8, 1) == AC_STATUS_OK);
+  error |= AC_TEST(AcMsgPool_init(&other_mp, 2, 0) == AC_STATUS_OK);
+
+  error |= AC_TEST(AcMsgMagazine_init(AC_NULL, &mp, 2) != AC_STATUS_OK);
+  error |= AC_TEST(AcMsgMagazine_init(&mag, AC_NULL, 2) != AC_STATUS_OK);
+  error |= AC_TEST(AcMsgMagazine_init(&mag, &mp, 0) != AC_STATUS_OK);
+  error |= AC_TEST(AcMsgMagazine_init(&mag, &mp, 2) == AC_STATUS_OK);
+  error |= AC_TEST(mag.count == 0);
+
+  // First get refills batch_count msgs from the pool
+  msgs[0] = AcMsgMagazine_get_msg(&mag);
+  error |= AC_TEST(msgs[0] != AC_NULL);
+  error |= AC_TEST(msgs[0]->len_extra == 1);
+  error |= AC_TEST(mag.count == 1);
+
+  // We can get all of the messages and then none
+  for (AcU32 i = 1; i < AC_ARRAY_COUNT(msgs); i++) {
+    msgs[i] = AcMsgMagazine_get_msg(&mag);
+    error |= AC_TEST(msgs[i] != AC_NULL);
+  }
+  error |= AC_TEST(AcMsgMagazine_get_msg(&mag) == AC_NULL);
+  error |= AC_TEST(AcMsgPool_get_msg(&mp) == AC_NULL);
+
+  // Magazine holds at most 2 * batch_count, the rest go to the pool
+  for (AcU32 i = 0; i < AC_ARRAY_COUNT(msgs); i++) {
+    AcMsgMagazine_ret_msg(&mag, msgs[i]);
+    error |= AC_TEST(mag.count <= mag.max_count);
+  }
+  AcMsgMagazine_ret_msg(&mag, AC_NULL);
+
+  // LIFO, the last returned is the first gotten
+  AcMsg* msg = AcMsgMagazine_get_msg(&mag);
+  error |= AC_TEST(msg == msgs[AC_ARRAY_COUNT(msgs) - 1]);
+  AcMsgMagazine_ret_msg(&mag, msg);
+
+  // A msg from another pool goes back to its own pool
+  AcU32 count = mag.count;
+  msg = AcMsgPool_get_msg(&other_mp);
+  error |= AC_TEST(msg != AC_NULL);
+  AcMsgMagazine_ret_msg(&mag, msg);
+  error |= AC_TEST(mag.count == count);
+  AcMsg* other_msg = AcMsgPool_get_msg(&other_mp);
+  error |= AC_TEST((other_msg != AC_NULL) && (other_msg != msg));
+  error |= AC_TEST(AcMsgPool_get_msg(&other_mp) == msg);
+  AcMsgPool_ret_msg(other_msg);
+  AcMsgPool_ret_msg(msg);
+
+  // Deinit returns everything to the pool
+  AcMsgMagazine_deinit(&mag);
+  for (AcU32 i = 0; i < AC_ARRAY_COUNT(msgs); i++) {
+    msgs[i] = AcMsgPool_get_msg(&mp);
+    error |= AC_TEST(msgs[i] != AC_NULL);
+  }
+  error |= AC_TEST(AcMsgPool_get_msg(&mp) == AC_NULL);
+  for (AcU32 i = 0; i < AC_ARRAY_COUNT(msgs); i++) {
+    AcMsgPool_ret_msg(msgs[i]);
+  }
+
+  AcMsgPool_deinit(&other_mp);
+  AcMsgPool_deinit(&mp);
+
+  ac_debug_printf("simple_magazine_test:-error=%d\n", error);
+  return error;
+}
+
+AcBool simple_pool_set_test(void) {
+  AcBool error = AC_FALSE;
+  AcMsgPoolSet set;
+  const AcU32 msg_counts[] = { 4, 2, 1 };
+  ac_debug_printf("simple_pool_set_test:+\n");
+
+  error |= AC_TEST(AcMsgPoolSet_init(AC_NULL, 16, 64, msg_counts) != AC_STATUS_OK);
+  error |= AC_TEST(AcMsgPoolSet_init(&set, 16, 64, AC_NULL) != AC_STATUS_OK);
+  error |= AC_TEST(AcMsgPoolSet_init(&set, 24, 64, msg_counts) != AC_STATUS_OK);
+  error |= AC_TEST(AcMsgPoolSet_init(&set, 64, 16, msg_counts) != AC_STATUS_OK);
+  error |= AC_TEST(AcMsgPoolSet_init(&set, 16, 64, msg_counts) == AC_STATUS_OK);
+  error |= AC_TEST(set.class_count == 3);
+
+  // Smallest fitting class
+  error |= AC_TEST(AcMsgPoolSet_class_idx(&set, 0) == 0);
+  error |= AC_TEST(AcMsgPoolSet_class_idx(&set, 16) == 0);
+  error |= AC_TEST(AcMsgPoolSet_class_idx(&set, 17) == 1);
+  error |= AC_TEST(AcMsgPoolSet_class_idx(&set, 32) == 1);
+  error |= AC_TEST(AcMsgPoolSet_class_idx(&set, 64) == 2);
+  error |= AC_TEST(AcMsgPoolSet_get_msg(&set, 65) == AC_NULL);
+
+  AcMsg* msg = AcMsgPoolSet_get_msg(&set, 1);
+  error |= AC_TEST((msg != AC_NULL) && (msg->mp == &set.pools[0]));
+  error |= AC_TEST((msg != AC_NULL) && (msg->len_extra == 16));
+  AcMsgPool_ret_msg(msg);
+
+  // The 64 byte class has one message, when empty there are none
+  AcMsg* big = AcMsgPoolSet_get_msg(&set, 33);
+  error |= AC_TEST((big != AC_NULL) && (big->len_extra == 64));
+  error |= AC_TEST(AcMsgPoolSet_get_msg(&set, 33) == AC_NULL);
+
+  // When a class is empty the next larger is used
+  AcMsg* mid[2];
+  mid[0] = AcMsgPoolSet_get_msg(&set, 17);
+  mid[1] = AcMsgPoolSet_get_msg(&set, 17);
+  AcMsgPool_ret_msg(big);
+  msg = AcMsgPoolSet_get_msg(&set, 17);
+  error |= AC_TEST((msg != AC_NULL) && (msg->len_extra == 64));
+  AcMsgPool_ret_msg(msg);
+  AcMsgPool_ret_msg(mid[0]);
+  AcMsgPool_ret_msg(mid[1]);
+
+  AcMsgPoolSet_deinit(&set);
+
+  ac_debug_printf("simple_pool_set_test:-error=%d\n", error);
+  return error;
+}
+
 int main(void) {
   AcBool error = AC_FALSE;
 
@@ -130,6 +327,9 @@ int main(void) {
   ac_debug_printf("sizeof(AcMsg)=%d\n", sizeof(AcMsg));
 
   error |= simple_message_pool_test();
+  error |= growable_pool_test();
+  error |= simple_magazine_test();
+  error |= simple_pool_set_test();
   error |= test_msg_pool_multiple_threads(1, 1);
   error |= test_msg_pool_multiple_threads(1, 8);
   error |= test_msg_pool_multiple_threads(8, 1);
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * The global manager of AcNextPtr's. AcMpscLinkList_rmv swaps a
+ * message's next_ptr with the list's tail so AcNextPtr's migrate
+ * between messages and lists and can't be owned by any one pool.
+ *
+ * Instead every AcNextPtr is allocated here and retired when its
+ * owning message pool or list is deinitialized. Retired AcNextPtr's
+ * are reused only after every participant, i.e. each AcDispatcher,
+ * has passed through a critical section since it was retired. This
+ * is epoch based reclamation, a retired AcNextPtr is safe once the
+ * global epoch has advanced twice.
+ *
+ * Senders which add to a list aren't participants, they may be any
+ * thread. Instead whoever retires an AcNextPtr must guarantee no
+ * sender is still using it, AcMpscLinkList_deinit waits for adds in
+ * progress and AcMsgPool_deinit requires all of its messages have
+ * been returned.
+ */
+
+#ifndef SADIE_LIBS_AC_NEXT_PTR_MGR_INCS_AC_NEXT_PTR_MGR_H
+#define SADIE_LIBS_AC_NEXT_PTR_MGR_INCS_AC_NEXT_PTR_MGR_H
+
+#include <ac_inttypes.h>
+#include <ac_msg.h>
+#include <ac_status.h>
+
+/**
+ * A participant in epoch based reclamation, typically
+ * embedded in the object which references AcNextPtr's.
+ * Each participant may only be used by one thread at a time.
+ */
+typedef struct AcNextPtrMgrParticipant AcNextPtrMgrParticipant;
+typedef struct AcNextPtrMgrParticipant {
+  AcU64 state;                    ///< (epoch << 1) | 1 while in a critical section, 0 otherwise
+  AcNextPtrMgrParticipant* next;  ///< Next registered participant
+} AcNextPtrMgrParticipant;
+
+/**
+ * Statistics for the AcNextPtr manager
+ */
+typedef struct AcNextPtrMgrStats {
+  AcU64 epoch;        ///< Current global epoch
+  AcU32 allocated;    ///< AcNextPtr's allocated from the memory manager
+  AcU32 free;         ///< AcNextPtr's available for reuse
+  AcU32 retired;      ///< AcNextPtr's waiting for the epoch to advance
+  AcU64 reclaimed;    ///< Total AcNextPtr's moved from retired to free
+} AcNextPtrMgrStats;
+
+/**
+ * Allocate an AcNextPtr, reusing a reclaimed one if possible.
+ * The returned AcNextPtr is on its own cache line and next
+ * and msg are AC_NULL.
+ *
+ * @return AcNextPtr or AC_NULL if out of memory
+ */
+AcNextPtr* AcNextPtrMgr_alloc(void);
+
+/**
+ * Retire an AcNextPtr which is no longer reachable by new
+ * critical sections, it will be reused once it is safe. It
+ * must not be in use by a sender, which isn't a participant.
+ *
+ * @param next_ptr to retire, AC_NULL is ignored
+ */
+void AcNextPtrMgr_retire(AcNextPtr* next_ptr);
+
+/**
+ * Try to advance the epoch and reclaim retired AcNextPtr's. This
+ * never blocks, if another thread is collecting it does nothing.
+ */
+void AcNextPtrMgr_collect(void);
+
+/**
+ * Register a participant, must be done before AcNextPtrMgr_enter.
+ *
+ * @param p is the participant to register
+ */
+void AcNextPtrMgr_register(AcNextPtrMgrParticipant* p);
+
+/**
+ * Unregister a participant, it must not be in a critical section.
+ *
+ * @param p is a registered participant
+ */
+void AcNextPtrMgr_unregister(AcNextPtrMgrParticipant* p);
+
+/**
+ * Get the current statistics
+ *
+ * @param stats is filled in with the current values
+ */
+void AcNextPtrMgr_get_stats(AcNextPtrMgrStats* stats);
+
+/**
+ * Global epoch, internal use only
+ */
+extern AcU64 AcNextPtrMgr_epoch;
+
+/**
+ * Number of retired AcNextPtr's, internal use only
+ */
+extern AcU32 AcNextPtrMgr_retired_count;
+
+/**
+ * Enter a critical section, AcNextPtr's seen while in the
+ * critical section will not be reused until it is exited.
+ *
+ * @param p is a registered participant
+ */
+static inline void AcNextPtrMgr_enter(AcNextPtrMgrParticipant* p) {
+  AcU64 epoch = __atomic_load_n(&AcNextPtrMgr_epoch, __ATOMIC_ACQUIRE);
+  __atomic_store_n(&p->state, (epoch << 1) | 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/**
+ * Exit a critical section and collect if anything is retired.
+ *
+ * @param p is a participant which has entered a critical section
+ */
+static inline void AcNextPtrMgr_exit(AcNextPtrMgrParticipant* p) {
+  __atomic_store_n(&p->state, 0, __ATOMIC_RELEASE);
+  if (__atomic_load_n(&AcNextPtrMgr_retired_count, __ATOMIC_ACQUIRE) != 0) {
+    AcNextPtrMgr_collect();
+  }
+}
+
+#endif
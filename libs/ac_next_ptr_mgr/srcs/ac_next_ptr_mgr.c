@@ -0,0 +1,223 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define NDEBUG
+
+#include <ac_next_ptr_mgr.h>
+
+#include <ac_cache_line.h>
+#include <ac_debug_printf.h>
+#include <ac_memmgr.h>
+#include <ac_thread.h>
+
+extern AcStatus ac_calloc_align(AcU32 count, AcU32 size, AcU32 alignment,
+    void** pRaw, void** pAligned, AcU32* pElemSize);
+
+/**
+ * An AcNextPtr and the raw pointer it was allocated with
+ */
+typedef struct Node {
+  AcNextPtr next_ptr;   ///< Must be first
+  void* raw;            ///< Raw pointer to pass to ac_free
+} AC_ATTR_ALIGNED(AC_MAX_CACHE_LINE_LEN) Node;
+
+#define EPOCHS 3
+
+AcU64 AcNextPtrMgr_epoch;
+AcU32 AcNextPtrMgr_retired_count;
+
+static AcBool lock;
+static AcNextPtrMgrParticipant* participants;
+static AcNextPtr* free_list;
+static AcNextPtr* limbo[EPOCHS];
+static AcU32 allocated_count;
+static AcU32 free_count;
+static AcU64 reclaimed_count;
+
+static inline void lock_acquire(void) {
+  while (__atomic_test_and_set(&lock, __ATOMIC_ACQUIRE)) {
+    ac_thread_yield();
+  }
+}
+
+static inline AcBool lock_try_acquire(void) {
+  return !__atomic_test_and_set(&lock, __ATOMIC_ACQUIRE);
+}
+
+static inline void lock_release(void) {
+  __atomic_clear(&lock, __ATOMIC_RELEASE);
+}
+
+/**
+ * Advance the epoch if every participant in a critical section
+ * has seen the current epoch, must be called with the lock held.
+ *
+ * @return AC_TRUE if the epoch was advanced
+ */
+static AcBool advance(void) {
+  AcU64 epoch = __atomic_load_n(&AcNextPtrMgr_epoch, __ATOMIC_RELAXED);
+
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  for (AcNextPtrMgrParticipant* p = participants; p != AC_NULL; p = p->next) {
+    AcU64 state = __atomic_load_n(&p->state, __ATOMIC_ACQUIRE);
+    if (((state & 1) != 0) && ((state >> 1) != epoch)) {
+      ac_debug_printf("advance: epoch=%lu p=%p state=%lx busy\n", epoch, p, state);
+      return AC_FALSE;
+    }
+  }
+  __atomic_store_n(&AcNextPtrMgr_epoch, epoch + 1, __ATOMIC_SEQ_CST);
+
+  // Nothing can reference what was retired two epochs ago
+  AcNextPtr** pold = &limbo[(epoch + 2) % EPOCHS];
+  AcU32 count = 0;
+  while (*pold != AC_NULL) {
+    AcNextPtr* next_ptr = *pold;
+    *pold = next_ptr->next;
+    next_ptr->next = free_list;
+    free_list = next_ptr;
+    count += 1;
+  }
+  free_count += count;
+  reclaimed_count += count;
+  __atomic_sub_fetch(&AcNextPtrMgr_retired_count, count, __ATOMIC_RELEASE);
+
+  ac_debug_printf("advance: epoch=%lu reclaimed=%u\n", epoch + 1, count);
+  return AC_TRUE;
+}
+
+/**
+ * @see ac_next_ptr_mgr.h
+ */
+AcNextPtr* AcNextPtrMgr_alloc(void) {
+  ac_debug_printf("AcNextPtrMgr_alloc:+\n");
+  AcNextPtr* next_ptr;
+
+  lock_acquire();
+  next_ptr = free_list;
+  if (next_ptr != AC_NULL) {
+    free_list = next_ptr->next;
+    free_count -= 1;
+  }
+  lock_release();
+
+  if (next_ptr == AC_NULL) {
+    void* raw;
+    Node* node;
+    AcU32 size;
+    if (ac_calloc_align(1, sizeof(Node), AC_MAX_CACHE_LINE_LEN,
+          &raw, (void**)&node, &size) != AC_STATUS_OK) {
+      ac_debug_printf("AcNextPtrMgr_alloc:-OUT_OF_MEMORY\n");
+      return AC_NULL;
+    }
+    node->raw = raw;
+    next_ptr = &node->next_ptr;
+    __atomic_add_fetch(&allocated_count, 1, __ATOMIC_RELAXED);
+  }
+  next_ptr->next = AC_NULL;
+  next_ptr->msg = AC_NULL;
+
+  ac_debug_printf("AcNextPtrMgr_alloc:-next_ptr=%p\n", next_ptr);
+  return next_ptr;
+}
+
+/**
+ * @see ac_next_ptr_mgr.h
+ */
+void AcNextPtrMgr_retire(AcNextPtr* next_ptr) {
+  ac_debug_printf("AcNextPtrMgr_retire:+next_ptr=%p\n", next_ptr);
+
+  if (next_ptr != AC_NULL) {
+    lock_acquire();
+    AcU64 epoch = __atomic_load_n(&AcNextPtrMgr_epoch, __ATOMIC_RELAXED);
+    AcNextPtr** plimbo = &limbo[epoch % EPOCHS];
+    next_ptr->msg = AC_NULL;
+    next_ptr->next = *plimbo;
+    *plimbo = next_ptr;
+    __atomic_add_fetch(&AcNextPtrMgr_retired_count, 1, __ATOMIC_RELEASE);
+    lock_release();
+  }
+
+  ac_debug_printf("AcNextPtrMgr_retire:-next_ptr=%p\n", next_ptr);
+}
+
+/**
+ * @see ac_next_ptr_mgr.h
+ */
+void AcNextPtrMgr_collect(void) {
+  ac_debug_printf("AcNextPtrMgr_collect:+\n");
+
+  if (lock_try_acquire()) {
+    // Two advances reclaim everything retired before the first
+    for (AcU32 i = 0; (i < EPOCHS - 1)
+        && (__atomic_load_n(&AcNextPtrMgr_retired_count, __ATOMIC_ACQUIRE) != 0)
+        && advance(); i++) {
+    }
+    lock_release();
+  }
+
+  ac_debug_printf("AcNextPtrMgr_collect:-\n");
+}
+
+/**
+ * @see ac_next_ptr_mgr.h
+ */
+void AcNextPtrMgr_register(AcNextPtrMgrParticipant* p) {
+  ac_debug_printf("AcNextPtrMgr_register:+p=%p\n", p);
+
+  p->state = 0;
+  lock_acquire();
+  p->next = participants;
+  participants = p;
+  lock_release();
+
+  ac_debug_printf("AcNextPtrMgr_register:-p=%p\n", p);
+}
+
+/**
+ * @see ac_next_ptr_mgr.h
+ */
+void AcNextPtrMgr_unregister(AcNextPtrMgrParticipant* p) {
+  ac_debug_printf("AcNextPtrMgr_unregister:+p=%p\n", p);
+
+  lock_acquire();
+  for (AcNextPtrMgrParticipant** pcur = &participants; *pcur != AC_NULL;
+      pcur = &(*pcur)->next) {
+    if (*pcur == p) {
+      *pcur = p->next;
+      p->next = AC_NULL;
+      break;
+    }
+  }
+  lock_release();
+
+  // Without p the epoch may now be able to advance
+  AcNextPtrMgr_collect();
+
+  ac_debug_printf("AcNextPtrMgr_unregister:-p=%p\n", p);
+}
+
+/**
+ * @see ac_next_ptr_mgr.h
+ */
+void AcNextPtrMgr_get_stats(AcNextPtrMgrStats* stats) {
+  lock_acquire();
+  stats->epoch = __atomic_load_n(&AcNextPtrMgr_epoch, __ATOMIC_RELAXED);
+  stats->allocated = __atomic_load_n(&allocated_count, __ATOMIC_RELAXED);
+  stats->free = free_count;
+  stats->retired = __atomic_load_n(&AcNextPtrMgr_retired_count, __ATOMIC_RELAXED);
+  stats->reclaimed = reclaimed_count;
+  lock_release();
+}
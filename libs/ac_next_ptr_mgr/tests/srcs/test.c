@@ -0,0 +1,198 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define NDEBUG
+
+#include <ac_next_ptr_mgr.h>
+
+#include <ac_debug_printf.h>
+#include <ac_inttypes.h>
+#include <ac_mpsc_link_list.h>
+#include <ac_mpsc_link_list_internal.h>
+#include <ac_msg_pool.h>
+#include <ac_receptor.h>
+#include <ac_test.h>
+#include <ac_thread.h>
+#include <ac_time.h>
+
+/**
+ * Test retired AcNextPtr's are reused
+ *
+ * return !0 if an error.
+ */
+AcBool test_alloc_retire() {
+  AcBool error = AC_FALSE;
+  AcNextPtrMgrStats before;
+  AcNextPtrMgrStats after;
+
+  ac_printf("test_alloc_retire:+\n");
+
+  AcNextPtrMgr_get_stats(&before);
+  AcNextPtr* np = AcNextPtrMgr_alloc();
+  error |= AC_TEST(np != AC_NULL);
+  error |= AC_TEST((np->next == AC_NULL) && (np->msg == AC_NULL));
+  error |= AC_TEST(((AcUptr)np & (AC_MAX_CACHE_LINE_LEN - 1)) == 0);
+
+  AcNextPtrMgr_retire(AC_NULL);
+  AcNextPtrMgr_retire(np);
+  AcNextPtrMgr_get_stats(&after);
+  error |= AC_TEST(after.retired == before.retired + 1);
+
+  // With no participants collect reclaims it
+  AcNextPtrMgr_collect();
+  AcNextPtrMgr_get_stats(&after);
+  error |= AC_TEST(after.retired == 0);
+  error |= AC_TEST(after.epoch >= before.epoch + 2);
+  error |= AC_TEST(after.free >= 1);
+
+  // And it's reused
+  AcNextPtr* np2 = AcNextPtrMgr_alloc();
+  error |= AC_TEST(np2 == np);
+  AcNextPtrMgr_get_stats(&before);
+  error |= AC_TEST(before.allocated == after.allocated);
+  AcNextPtrMgr_retire(np2);
+  AcNextPtrMgr_collect();
+
+  ac_printf("test_alloc_retire:-error=%d\n", error);
+  return error;
+}
+
+/**
+ * Test a participant in a critical section prevents reclamation
+ *
+ * return !0 if an error.
+ */
+AcBool test_participants() {
+  AcBool error = AC_FALSE;
+  AcNextPtrMgrParticipant p1;
+  AcNextPtrMgrParticipant p2;
+  AcNextPtrMgrStats stats;
+
+  ac_printf("test_participants:+\n");
+
+  AcNextPtrMgr_register(&p1);
+  AcNextPtrMgr_register(&p2);
+
+  // p2 is registered but not in a critical section so doesn't block
+  AcNextPtrMgr_enter(&p1);
+  AcNextPtr* np = AcNextPtrMgr_alloc();
+  error |= AC_TEST(np != AC_NULL);
+  AcNextPtrMgr_retire(np);
+
+  AcNextPtrMgr_collect();
+  AcNextPtrMgr_get_stats(&stats);
+  error |= AC_TEST(stats.retired == 1);
+
+  // Once p1 exits both advances can happen
+  AcNextPtrMgr_exit(&p1);
+  AcNextPtrMgr_get_stats(&stats);
+  error |= AC_TEST(stats.retired == 0);
+
+  // p1 in a critical section from an old epoch blocks
+  // reclamation no matter what p2 does
+  AcNextPtrMgr_enter(&p1);
+  AcNextPtrMgr_enter(&p2);
+  np = AcNextPtrMgr_alloc();
+  AcNextPtrMgr_retire(np);
+  AcNextPtrMgr_exit(&p2);
+  AcNextPtrMgr_get_stats(&stats);
+  error |= AC_TEST(stats.retired == 1);
+  AcNextPtrMgr_enter(&p2);
+  AcNextPtrMgr_exit(&p2);
+  AcNextPtrMgr_get_stats(&stats);
+  error |= AC_TEST(stats.retired == 1);
+
+  AcNextPtrMgr_exit(&p1);
+  AcNextPtrMgr_get_stats(&stats);
+  error |= AC_TEST(stats.retired == 0);
+
+  AcNextPtrMgr_unregister(&p1);
+  AcNextPtrMgr_unregister(&p2);
+
+  ac_printf("test_participants:-error=%d\n", error);
+  return error;
+}
+
+/**
+ * Test initializing and deinitializing AcMsgPool's and
+ * AcMpscLinkList's, with messages passing through the lists,
+ * doesn't allocate more AcNextPtr's after the first time.
+ *
+ * return !0 if an error.
+ */
+AcBool test_flat_footprint() {
+  AcBool error = AC_FALSE;
+  AcNextPtrMgrStats first = { 0 };
+  AcNextPtrMgrStats stats;
+
+  ac_printf("test_flat_footprint:+\n");
+
+  for (AcU32 loop = 0; loop < 10; loop++) {
+    AcMsgPool mp;
+    AcMpscLinkList list;
+
+    error |= AC_TEST(AcMsgPool_init(&mp, 4, 0) == AC_STATUS_OK);
+    error |= AC_TEST(AcMpscLinkList_init(&list) == AC_STATUS_OK);
+
+    // The messages and list swap AcNextPtr's
+    for (AcU32 i = 0; i < 3; i++) {
+      AcMsg* msg = AcMsgPool_get_msg(&mp);
+      error |= AC_TEST(msg != AC_NULL);
+      AcMpscLinkList_add(&list, msg);
+    }
+    AcMsg* msg;
+    while ((msg = AcMpscLinkList_rmv(&list)) != AC_NULL) {
+      AcMsgPool_ret_msg(msg);
+    }
+
+    AcMpscLinkList_deinit(&list);
+    AcMsgPool_deinit(&mp);
+    AcNextPtrMgr_collect();
+
+    AcNextPtrMgr_get_stats(&stats);
+    error |= AC_TEST(stats.retired == 0);
+    if (loop == 0) {
+      first = stats;
+    } else {
+      error |= AC_TEST(stats.allocated == first.allocated);
+      error |= AC_TEST(stats.free == first.free);
+    }
+  }
+
+  ac_printf("test_flat_footprint:-error=%d allocated=%u reclaimed=%lu\n",
+      error, stats.allocated, stats.reclaimed);
+  return error;
+}
+
+int main(void) {
+  AcBool error = AC_FALSE;
+
+  ac_thread_init(1);
+  AcReceptor_init(10);
+  AcTime_init();
+
+  error |= test_alloc_retire();
+  ac_printf("\n");
+  error |= test_participants();
+  ac_printf("\n");
+  error |= test_flat_footprint();
+
+  if (!error) {
+    ac_printf("OK\n");
+  }
+
+  return error;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * The AcSpscRingBuff is a wait free single-producer single
+ * consumer ring buffer. The producer and consumer indexes are on
+ * separate cache lines and each side keeps a cached copy of the
+ * other side's index, so the shared line is only read when the
+ * cached view says the ring buffer is full or empty.
+ *
+ * It has the same shape as AcMpscRingBuff and can be used in its
+ * place when there is only one thread adding.
+ */
+
+#ifndef SADIE_LIBS_AC_SPSC_RING_BUFF_INCS_AC_SPSC_RING_BUFF_H
+#define SADIE_LIBS_AC_SPSC_RING_BUFF_INCS_AC_SPSC_RING_BUFF_H
+
+#include <ac_spsc_ring_buff_internal.h>
+#include <ac_inttypes.h>
+#include <ac_status.h>
+
+typedef struct AcSpscRingBuff AcSpscRingBuff;
+
+
+/**
+ * Add mem to the ring buffer. This maybe used only by
+ * a single thread and never blocks.
+ *
+ * @params rb is an iniitalized AcSpscRingBuff
+ * @params mem is pointing to some arbitrary memory
+ *
+ * @return AC_TRUE if added AC_FALSE of full
+ */
+AcBool AcSpscRingBuff_add_mem(AcSpscRingBuff* rb, void* mem);
+
+/**
+ * Remove a memory from the ring buffer. This maybe used only by
+ * a single thread and returns AC_NULL if the ring buffer is empty.
+ *
+ * @params rb is an iniitalized AcSpscRingBuff
+ *
+ * @return The next item or AC_NULL if empty
+ */
+void* AcSpscRingBuff_rmv_mem(AcSpscRingBuff* rb);
+
+/**
+ * Deinitialize the AcSpscRingBuff. Assumes the ring buffer is EMPTY.
+ *
+ * @params rb is an iniitalized with AcSpscRingBuff_init
+ * @returns number of items added/removed from ring buffer
+ */
+AcU64 AcSpscRingBuff_deinit(AcSpscRingBuff* rb);
+
+/**
+ * Initialize an AcSpscRingBuff able to manage count items
+ *
+ * @params rb is an uniniitalized AcSpscRingBuff
+ * @params size is the number mem's to allow in the ring buffer, must be a power of 2
+ *
+ * @return 0 (AC_STATUS_OK) if successfull
+ */
+AcStatus AcSpscRingBuff_init(AcSpscRingBuff* rb, AcU32 size);
+
+#endif
@@ -0,0 +1,37 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Debug code for spsc ring buffer
+ */
+
+#ifndef SADIE_LIBS_AC_SPSC_RING_BUFF_INCS_AC_SPSC_RING_BUFF_DBG_H
+#define SADIE_LIBS_AC_SPSC_RING_BUFF_INCS_AC_SPSC_RING_BUFF_DBG_H
+
+#include <ac_spsc_ring_buff.h>
+
+/**
+ * Print a AcSpscRingBuff
+ */
+void AcSpscRingBuff_print(const char* leader, AcSpscRingBuff* rb);
+
+#ifdef NDEBUG
+  #define AcSpscRingBuff_debug_print(leader, rb) ((void)(0))
+#else
+  #define AcSpscRingBuff_debug_print(leader, rb) AcSpscRingBuff_print(leader, rb)
+#endif
+
+#endif
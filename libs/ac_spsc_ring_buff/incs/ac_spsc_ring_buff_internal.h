@@ -0,0 +1,47 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * The AcSpscRingBuff is a wait free single-producer single
+ * consumer ring buffer.
+ */
+
+#ifndef SADIE_LIBS_AC_SPSC_RING_BUFF_INCS_AC_SPSC_RING_BUFF_INTERNAL_H
+#define SADIE_LIBS_AC_SPSC_RING_BUFF_INCS_AC_SPSC_RING_BUFF_INTERNAL_H
+
+#include <ac_attributes.h>
+#include <ac_cache_line.h>
+#include <ac_inttypes.h>
+
+typedef struct AcSpscRingBuff {
+  // Read only after init, shared by producer and consumer
+  AcU32 size;
+  AcU32 mask;
+  void** ring_buffer;
+
+  // Producer's cache line
+  AcU32 add_idx AC_ATTR_ALIGNED(AC_MAX_CACHE_LINE_LEN);
+  AcU32 rmv_idx_cache;    ///< Producer's last view of rmv_idx
+
+  // Consumer's cache line
+  AcU32 rmv_idx AC_ATTR_ALIGNED(AC_MAX_CACHE_LINE_LEN);
+  AcU32 add_idx_cache;    ///< Consumer's last view of add_idx
+
+  // Used for debugging and not always valid
+  AcU64 processed;
+} AcSpscRingBuff;
+
+#endif
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define NDEBUG
+
+#include <ac_spsc_ring_buff.h>
+#include <ac_mpsc_ring_buff.h>
+
+#include <ac_assert.h>
+#include <ac_debug_printf.h>
+#include <ac_memmgr.h>
+#include <ac_receptor.h>
+#include <ac_test.h>
+#include <ac_time.h>
+#include <ac_tsc.h>
+#include <ac_thread.h>
+
+/**
+ * A ping-pong between two threads over two ring buffers,
+ * add/rmv are the ring buffer's routines.
+ */
+typedef struct PingPong {
+  AcBool (*add)(void* rb, void* mem);
+  void* (*rmv)(void* rb);
+  void* ping;
+  void* pong;
+  AcU64 loops;
+  AcReceptor* done;
+} PingPong;
+
+/**
+ * Wait for a mem on rb
+ */
+static inline void* wait_mem(PingPong* pp, void* rb) {
+  void* mem;
+  while ((mem = pp->rmv(rb)) == AC_NULL) {
+    ac_thread_yield();
+  }
+  return mem;
+}
+
+/**
+ * Echo every mem received on ping back on pong
+ */
+static void* echo(void* param) {
+  PingPong* pp = (PingPong*)param;
+
+  for (AcU64 i = 0; i < pp->loops; i++) {
+    void* mem = wait_mem(pp, pp->ping);
+    pp->add(pp->pong, mem);
+  }
+
+  AcReceptor_signal(pp->done);
+  return AC_NULL;
+}
+
+/**
+ * Run the ping-pong and return the number of ticks it took
+ */
+static AcU64 ping_pong(PingPong* pp) {
+  AcU8 data = 0;
+
+  pp->done = AcReceptor_get();
+  ac_assert(pp->done != AC_NULL);
+
+  ac_thread_rslt_t rslt = ac_thread_create(0, echo, pp);
+  ac_assert(rslt.status == 0);
+
+  AcU64 start = ac_tscrd();
+  for (AcU64 i = 0; i < pp->loops; i++) {
+    pp->add(pp->ping, &data);
+    wait_mem(pp, pp->pong);
+  }
+  AcU64 stop = ac_tscrd();
+
+  AcReceptor_wait(pp->done);
+  AcReceptor_ret(pp->done);
+  return stop - start;
+}
+
+/**
+ * Return ticks * AC_SEC_IN_NS / count without overflowing so it
+ * can be printed with %S as nano seconds.
+ */
+static AcU64 ns_per(AcU64 ticks, AcU64 count) {
+  return ((ticks / count) * AC_SEC_IN_NS) + (((ticks % count) * AC_SEC_IN_NS) / count);
+}
+
+/**
+ * Compare AcSpscRingBuff with AcMpscRingBuff using a ping-pong
+ * between two threads.
+ */
+AcBool ping_pong_perf(AcU64 loops) {
+  AcBool error = AC_FALSE;
+  ac_printf("ping_pong_perf:+loops=%lu\n", loops);
+
+  AcSpscRingBuff spsc_ping;
+  AcSpscRingBuff spsc_pong;
+  error |= AC_TEST(AcSpscRingBuff_init(&spsc_ping, 2) == AC_STATUS_OK);
+  error |= AC_TEST(AcSpscRingBuff_init(&spsc_pong, 2) == AC_STATUS_OK);
+
+  AcMpscRingBuff mpsc_ping;
+  AcMpscRingBuff mpsc_pong;
+  error |= AC_TEST(AcMpscRingBuff_init(&mpsc_ping, 2) == AC_STATUS_OK);
+  error |= AC_TEST(AcMpscRingBuff_init(&mpsc_pong, 2) == AC_STATUS_OK);
+
+  if (!error) {
+    PingPong pp = {
+      .add = (AcBool (*)(void*, void*))AcSpscRingBuff_add_mem,
+      .rmv = (void* (*)(void*))AcSpscRingBuff_rmv_mem,
+      .ping = &spsc_ping,
+      .pong = &spsc_pong,
+      .loops = loops,
+    };
+    AcU64 duration = ping_pong(&pp);
+    AcU64 ns_per_round_trip = ns_per(duration, loops);
+    ac_printf("ping_pong_perf: spsc duration=%lu time=%.9t ns_per_round_trip=%.4S\n",
+        duration, duration, ns_per_round_trip);
+
+    pp.add = (AcBool (*)(void*, void*))AcMpscRingBuff_add_mem;
+    pp.rmv = (void* (*)(void*))AcMpscRingBuff_rmv_mem;
+    pp.ping = &mpsc_ping;
+    pp.pong = &mpsc_pong;
+    duration = ping_pong(&pp);
+    ns_per_round_trip = ns_per(duration, loops);
+    ac_printf("ping_pong_perf: mpsc duration=%lu time=%.9t ns_per_round_trip=%.4S\n",
+        duration, duration, ns_per_round_trip);
+  }
+
+  AcSpscRingBuff_deinit(&spsc_ping);
+  AcSpscRingBuff_deinit(&spsc_pong);
+  AcMpscRingBuff_deinit(&mpsc_ping);
+  AcMpscRingBuff_deinit(&mpsc_pong);
+
+  ac_printf("ping_pong_perf:-error=%d\n", error);
+  return error;
+}
+
+/**
+ * main
+ */
+int main(void) {
+  AcBool error = AC_FALSE;
+
+  ac_thread_init(10);
+  AcReceptor_init(50);
+  AcTime_init();
+
+  error |= ping_pong_perf(1000000);
+
+  if (!error) {
+    ac_printf("OK\n");
+  }
+
+  return error;
+}
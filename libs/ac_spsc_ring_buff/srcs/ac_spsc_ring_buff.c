@@ -0,0 +1,138 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define NDEBUG
+
+#include <ac_spsc_ring_buff.h>
+#include <ac_spsc_ring_buff_dbg.h>
+#include <ac_spsc_ring_buff_internal.h>
+
+#include <ac_intmath.h>
+#include <ac_inttypes.h>
+#include <ac_memmgr.h>
+#include <ac_debug_printf.h>
+
+/**
+ * @see ac_spsc_ring_buff.h
+ */
+AcBool AcSpscRingBuff_add_mem(AcSpscRingBuff* rb, void* mem) {
+  ac_debug_printf("AcSpscRingBuff_add_mem:+rb=%p mem=%p\n", rb, mem);
+
+  if (mem != AC_NULL) {
+    AcU32 pos = rb->add_idx;
+
+    if ((pos - rb->rmv_idx_cache) == rb->size) {
+      // Looks full, refresh our view of the consumer
+      rb->rmv_idx_cache = __atomic_load_n(&rb->rmv_idx, __ATOMIC_ACQUIRE);
+      if ((pos - rb->rmv_idx_cache) == rb->size) {
+        ac_debug_printf("AcSpscRingBuff_add_mem:-rb=%p mem=%p FULL\n", rb, mem);
+        return AC_FALSE;
+      }
+    }
+
+    rb->ring_buffer[pos & rb->mask] = mem;
+    __atomic_store_n(&rb->add_idx, pos + 1, __ATOMIC_RELEASE);
+  }
+
+  ac_debug_printf("AcSpscRingBuff_add_mem:-rb=%p mem=%p\n", rb, mem);
+  return AC_TRUE;
+}
+
+/**
+ * @see ac_spsc_ring_buff.h
+ */
+void* AcSpscRingBuff_rmv_mem(AcSpscRingBuff* rb) {
+  ac_debug_printf("AcSpscRingBuff_rmv_mem:+rb=%p\n", rb);
+  void* mem;
+  AcU32 pos = rb->rmv_idx;
+
+  if (pos == rb->add_idx_cache) {
+    // Looks empty, refresh our view of the producer
+    rb->add_idx_cache = __atomic_load_n(&rb->add_idx, __ATOMIC_ACQUIRE);
+    if (pos == rb->add_idx_cache) {
+      ac_debug_printf("AcSpscRingBuff_rmv_mem:-rb=%p mem=AC_NULL EMPTY\n", rb);
+      return AC_NULL;
+    }
+  }
+
+  mem = rb->ring_buffer[pos & rb->mask];
+  __atomic_store_n(&rb->rmv_idx, pos + 1, __ATOMIC_RELEASE);
+#ifndef NDEBUG
+  rb->processed += 1;
+#endif
+
+  ac_debug_printf("AcSpscRingBuff_rmv_mem:-rb=%p mem=%p\n", rb, mem);
+  return mem;
+}
+
+/**
+ * @see ac_spsc_ring_buff.h
+ */
+AcU64 AcSpscRingBuff_deinit(AcSpscRingBuff* rb) {
+  ac_debug_printf("AcSpscRingBuff_deinit:+rb=%p\n", rb);
+
+  AcU64 processed = rb->processed;
+  ac_free(rb->ring_buffer);
+  rb->ring_buffer = AC_NULL;
+  rb->add_idx = 0;
+  rb->rmv_idx_cache = 0;
+  rb->rmv_idx = 0;
+  rb->add_idx_cache = 0;
+  rb->size = 0;
+  rb->mask = 0;
+  rb->processed = 0;
+
+  ac_debug_printf("AcSpscRingBuff_deinit:-rb=%p processed=%lu\n", rb, processed);
+  return processed;
+}
+
+/**
+ * @see ac_spsc_ring_buff.h
+ */
+AcStatus AcSpscRingBuff_init(AcSpscRingBuff* rb, AcU32 size) {
+  AcStatus status = AC_STATUS_OK;
+
+  ac_debug_printf("AcSpscRingBuff_init:+rb=%p size=%d\n", rb, size);
+
+  if (rb == AC_NULL) {
+    ac_debug_printf("AcSpscRingBuff_init:-rb=%p size=%d rb is AC_NULL return BAD_PARAM\n",
+        rb, size);
+    return AC_STATUS_BAD_PARAM;
+  }
+
+  rb->add_idx = 0;
+  rb->rmv_idx_cache = 0;
+  rb->rmv_idx = 0;
+  rb->add_idx_cache = 0;
+  if (AC_COUNT_ONE_BITS(size) != 1) {
+    ac_debug_printf("AcSpscRingBuff_init:-rb=%p size=%d not a power of 2 return BAD_PARAM\n",
+        rb, size);
+    return AC_STATUS_BAD_PARAM;
+  }
+
+  rb->size = size;
+  rb->mask = size - 1;
+  rb->processed = 0;
+  rb->ring_buffer = ac_calloc(size, sizeof(*rb->ring_buffer));
+  if (rb->ring_buffer == AC_NULL) {
+    ac_debug_printf("AcSpscRingBuff_init:-rb=%p size=%d could not allocate ring_buffer return OUT_OF_MEMORY\n",
+        rb, size);
+    return AC_STATUS_OUT_OF_MEMORY;
+  }
+
+  ac_debug_printf("AcSpscRingBuff_init:-rb=%p size=%d status=%d\n", rb, size, status);
+  return status;
+}
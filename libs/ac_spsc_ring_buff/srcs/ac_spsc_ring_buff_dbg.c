@@ -0,0 +1,55 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Debug code for spsc ring buffer
+ */
+
+#define NDEBUG
+
+#include <ac_spsc_ring_buff.h>
+#include <ac_spsc_ring_buff_dbg.h>
+#include <ac_spsc_ring_buff_internal.h>
+
+#include <ac_printf.h>
+
+/**
+ * @see ac_spsc_ring_buff_dbg.h
+ */
+void AcSpscRingBuff_print(const char* leader, AcSpscRingBuff* rb) {
+  if (rb != AC_NULL) {
+    if (leader != AC_NULL) {
+      ac_printf("%s\n", leader);
+    }
+
+    AcU32 add_idx = __atomic_load_n(&rb->add_idx, __ATOMIC_ACQUIRE);
+    AcU32 rmv_idx = __atomic_load_n(&rb->rmv_idx, __ATOMIC_ACQUIRE);
+
+    ac_printf("rb=%p add_idx=%d rmv_idx=%d rmv_idx_cache=%d add_idx_cache=%d processed=%lu ",
+        rb, add_idx, rmv_idx, rb->rmv_idx_cache, rb->add_idx_cache, rb->processed);
+
+    if (add_idx == rmv_idx) {
+      ac_printf("empty\n");
+    } else {
+      ac_printf("\n");
+      for (AcU32 pos = rmv_idx; pos != add_idx; pos++) {
+        ac_printf(" ring_buffer[%d]=%p\n", pos & rb->mask, rb->ring_buffer[pos & rb->mask]);
+      }
+    }
+  } else {
+    ac_printf("rb == AC_NULL");
+  }
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2016 Wink Saville
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ac_spsc_ring_buff.h>
+#include <ac_spsc_ring_buff_dbg.h>
+#include <ac_spsc_ring_buff_internal.h>
+
+#include <ac_memmgr.h>
+#include <ac_inttypes.h>
+#include <ac_test.h>
+
+
+/**
+ * Test we can initialize and deinitialize AcSpscRingBuff
+ *
+ * return !0 if an error.
+ */
+AcBool test_init_and_deinit_spsc_ring_buff() {
+  AcBool error = AC_FALSE;
+  AcSpscRingBuff rb;
+
+  ac_printf("test_init_and_deinit_spsc_ring_buff:+rb=%p\n", &rb);
+
+  // Size must be a power of 2
+  error |= AC_TEST(AcSpscRingBuff_init(&rb, 3) == AC_STATUS_BAD_PARAM);
+
+  // Initialize
+  error |= AC_TEST(AcSpscRingBuff_init(&rb, 2) == AC_STATUS_OK);
+  AcSpscRingBuff_print("test_init_and_deinit_spsc_ring_buff: initialized rb:", &rb);
+
+  error |= AC_TEST(rb.add_idx == 0);
+  error |= AC_TEST(rb.rmv_idx == 0);
+  error |= AC_TEST(rb.size == 2);
+  error |= AC_TEST(rb.ring_buffer != AC_NULL);
+
+  // The producer and consumer indexes are on different cache lines
+  error |= AC_TEST(((AcUptr)&rb.add_idx / AC_MAX_CACHE_LINE_LEN)
+      != ((AcUptr)&rb.rmv_idx / AC_MAX_CACHE_LINE_LEN));
+
+  // Deinitialize
+  AcSpscRingBuff_deinit(&rb);
+
+  error |= AC_TEST(rb.add_idx == 0);
+  error |= AC_TEST(rb.rmv_idx == 0);
+  error |= AC_TEST(rb.ring_buffer == AC_NULL);
+
+  ac_printf("test_init_and_deinit_spsc_ring_buff:-error=%d\n", error);
+  return error;
+}
+
+/**
+ * Test we can add and remove mems, including wrapping and
+ * the full and empty cases.
+ *
+ * return !0 if an error.
+ */
+AcBool test_add_rmv() {
+  AcBool error = AC_FALSE;
+  AcSpscRingBuff rb;
+  AcU8 mems[3] = { 1, 2, 3 };
+  AcU8* mem;
+
+  ac_printf("test_add_rmv:+rb=%p\n", &rb);
+
+  AcSpscRingBuff_init(&rb, 2);
+
+  // Remove from empty
+  error |= AC_TEST(AcSpscRingBuff_rmv_mem(&rb) == AC_NULL);
+
+  // Fill it
+  error |= AC_TEST(AcSpscRingBuff_add_mem(&rb, &mems[0]));
+  error |= AC_TEST(AcSpscRingBuff_add_mem(&rb, &mems[1]));
+  AcSpscRingBuff_print("test_add_rmv: after two adds rb:", &rb);
+  error |= AC_TEST(rb.add_idx == 2);
+
+  // Full, the producer refreshes its cached rmv_idx and still fails
+  error |= AC_TEST(AcSpscRingBuff_add_mem(&rb, &mems[2]) == AC_FALSE);
+  error |= AC_TEST(rb.add_idx == 2);
+
+  // Remove first
+  mem = AcSpscRingBuff_rmv_mem(&rb);
+  error |= AC_TEST(mem != AC_NULL);
+  error |= AC_TEST(mem[0] == 1);
+  error |= AC_TEST(rb.rmv_idx == 1);
+  error |= AC_TEST(rb.add_idx_cache == 2);
+
+  // Now there is room, add wraps the ring buffer
+  error |= AC_TEST(AcSpscRingBuff_add_mem(&rb, &mems[2]));
+  error |= AC_TEST(rb.rmv_idx_cache == 1);
+
+  // Second comes from the cached add_idx, third needs a refresh
+  mem = AcSpscRingBuff_rmv_mem(&rb);
+  error |= AC_TEST((mem != AC_NULL) && (mem[0] == 2));
+  error |= AC_TEST(rb.add_idx_cache == 2);
+  mem = AcSpscRingBuff_rmv_mem(&rb);
+  error |= AC_TEST((mem != AC_NULL) && (mem[0] == 3));
+  error |= AC_TEST(rb.add_idx_cache == 3);
+
+  // Empty again
+  error |= AC_TEST(AcSpscRingBuff_rmv_mem(&rb) == AC_NULL);
+
+  AcSpscRingBuff_deinit(&rb);
+
+  ac_printf("test_add_rmv:-error=%d\n", error);
+  return error;
+}
+
+int main(void) {
+  AcBool error = AC_FALSE;
+
+  error |= test_init_and_deinit_spsc_ring_buff();
+  ac_printf("\n");
+  error |= test_add_rmv();
+  ac_printf("\n");
+
+  if (!error) {
+    // Succeeded
+    ac_printf("OK\n");
+  }
+
+  return error;
+}
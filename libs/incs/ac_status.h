@@ -40,5 +40,7 @@ typedef ac_u32 AcStatus;
 #define AC_STATUS_UNRECOGNIZED_PROTOCOL         AC_STATUS(5, 0)
 #define AC_STATUS_UNRECOGNIZED_OPERATION        AC_STATUS(6, 0)
 #define AC_STATUS_LINUX_ERR(errno)              AC_STATUS(7, (errno))
+#define AC_STATUS_QUEUE_FULL                    AC_STATUS(8, 0)
+#define AC_STATUS_STALE_HANDLE                  AC_STATUS(9, 0)
 
 #endif
@@ -67,6 +67,12 @@ typedef struct {
  */
 //void ac_thread_wait_ticks(ac_u64 ticks);
 
+/**
+ * Get current thread handle, the same handle as returned
+ * by ac_thread_create for the thread.
+ */
+//ac_thread_hdl_t ac_thread_get_cur_hdl(void);
+
 /**
  * Create a thread and invoke the entry passing entry_arg. If
  * the entry routine returns the thread is considered dead
@@ -54,6 +54,7 @@
 
 typedef struct {
   AcComp comp;                        ///< The component
+  AcCompHandlers handlers;            ///< Our AC_INET_LINK_PROTOCOL handlers
   ac_thread_rslt_t reader_thread_rslt;///< Result of creating the reader thread
   AcInt fd;                           ///< File descriptor for the interface
   AcU32 ifname_idx;                   ///< Index to the current ifname[ifname_idx]
@@ -326,7 +327,15 @@ AcStatus send_arp(AcCompIpv4LinkLayer* this, AcU16 protocol, AcU32 proto_addr_le
   return status;
 }
 
-static void send_error_rsp(AcComp* comp, AcMsg* msg, AcStatus status) {
+/**
+ * Reply to a request with status, otherwise there's no
+ * response and msg is returned to its pool
+ */
+static void send_rsp(AcMsg* msg, AcStatus status) {
+  if ((AC_GET_BITS(AcU64, msg->op, 2, 16) != AC_OPTYPE_REQ)
+      || (AcMsg_reply(msg, status) != AC_STATUS_OK)) {
+    AcMsgPool_ret_msg(msg);
+  }
 }
 
 void* reader_thread(void* param) {
@@ -482,23 +491,10 @@ static ac_bool comp_ipv4_ll_process_msg(AcComp* comp, AcMsg* msg) {
       ac_debug_printf("%s: AC_DEINIT_CMD\n", this->comp.name);
       break;
     }
-    case (AC_INET_SEND_ARP_CMD): {
-      AcInetSendArpExtra* send_arp_extra = (AcInetSendArpExtra*)msg->extra;
-      ac_printf("%s: AC_INET_SEND_ARP_CMD proto=%x", this->comp.name, send_arp_extra->proto);
-      ac_println_dec(" proto_addr=", send_arp_extra->proto_addr, send_arp_extra->proto_addr_len, ".");
-
-      send_arp(this, send_arp_extra->proto, send_arp_extra->proto_addr_len, send_arp_extra-> proto_addr);
-
-      break;
-    }
-    case (AC_INET_SEND_PACKET_CMD): {
-      ac_debug_printf("%s: AC_INET_SEND_PACKET_CMD\n", this->comp.name);
-      break;
-    }
     default: {
       ac_debug_printf("%s: AC_STATUS_UNRECOGNIZED_PROTOCOL send error rsp\n", this->comp.name);
-      send_error_rsp(comp, msg, AC_STATUS_UNRECOGNIZED_PROTOCOL);
-      break;
+      send_rsp(msg, AC_STATUS_UNRECOGNIZED_PROTOCOL);
+      return AC_TRUE;
     }
   }
 
@@ -508,6 +504,36 @@ static ac_bool comp_ipv4_ll_process_msg(AcComp* comp, AcMsg* msg) {
   return AC_TRUE;
 }
 
+static ac_bool comp_ipv4_ll_send_arp(AcComp* comp, AcMsg* msg) {
+  AcCompIpv4LinkLayer* this = (AcCompIpv4LinkLayer*)comp;
+  AcInetSendArpExtra* send_arp_extra = AcInetSendArp_extra(msg);
+
+  ac_printf("%s: AC_INET_SEND_ARP_CMD proto=%x", this->comp.name, send_arp_extra->proto);
+  ac_println_dec(" proto_addr=", send_arp_extra->proto_addr, send_arp_extra->proto_addr_len, ".");
+
+  AcStatus status = send_arp(this, send_arp_extra->proto, send_arp_extra->proto_addr_len,
+      send_arp_extra->proto_addr);
+
+  send_rsp(msg, status);
+  return AC_TRUE;
+}
+
+static ac_bool comp_ipv4_ll_send_packet(AcComp* comp, AcMsg* msg) {
+  AcCompIpv4LinkLayer* this = (AcCompIpv4LinkLayer*)comp;
+  AC_UNUSED(this);
+
+  ac_debug_printf("%s: AC_INET_SEND_PACKET_CMD\n", this->comp.name);
+
+  AcMsgPool_ret_msg(msg);
+  return AC_TRUE;
+}
+
+static const AcInetLinkHandlers comp_ipv4_ll_handlers = {
+  .send_arp_cmd = comp_ipv4_ll_send_arp,
+  .send_arp_req = comp_ipv4_ll_send_arp,
+  .send_packet_cmd = comp_ipv4_ll_send_packet,
+};
+
 static AcCompIpv4LinkLayer comp_ipv4_ll = {
   .comp.name=(ac_u8*)INET_LINK_COMP_IPV4_NAME,
   .comp.process_msg = comp_ipv4_ll_process_msg,
@@ -527,6 +553,7 @@ void AcInetLink_deinit(AcCompMgr* cm) {
   ac_debug_printf("AcInetLink_deinit:+cm=%p\n", cm);
 
   ac_assert(AcCompMgr_rmv_comp(&comp_ipv4_ll.comp) == AC_STATUS_OK);
+  AcCompHandlers_deinit(&comp_ipv4_ll.handlers);
 
   ac_debug_printf("AcInetLink_deinit:-cm=%p\n", cm);
 }
@@ -570,7 +597,10 @@ void AcInetLink_init(AcCompMgr* cm) {
   };
   ac_printf("sockaddr_ll=%{sockaddr_ll}\nethhdr=%{ethhdr}\n", &sock_addr, &ether_hdr);
 
-  ac_assert(AcCompMgr_add_comp(cm, &comp_ipv4_ll.comp) == AC_STATUS_OK);
+  ac_assert(AcInetLink_add_handlers(&comp_ipv4_ll.handlers, &comp_ipv4_ll_handlers)
+      == AC_STATUS_OK);
+  AcCompParams params = { .handlers = &comp_ipv4_ll.handlers };
+  ac_assert(AcCompMgr_add_comp_params(cm, &comp_ipv4_ll.comp, &params) == AC_STATUS_OK);
 
   ac_debug_printf("AcInetLink_init:-cm=%p\n", cm);
 }
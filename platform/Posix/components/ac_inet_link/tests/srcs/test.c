@@ -25,6 +25,7 @@
 #include <ac_memcpy.h>
 #include <ac_msg.h>
 #include <ac_msg_pool.h>
+#include <ac_msg_pool_set.h>
 #include <ac_printf.h>
 #include <ac_debug_printf.h>
 #include <ac_receptor.h>
@@ -47,7 +48,7 @@ typedef struct {
   AcU8* target_comp_name;
   AcCompMgr* cm;
   AcReceptor* waiting;
-  AcMsgPool mp;
+  AcMsgPoolSet mps;
   AcStatus status;
   AcEtherArpIpv4 arp_packet;
 } TestComp;
@@ -78,8 +79,11 @@ ac_bool initial_state(AcComp* comp, AcMsg* msg) {
     case (AC_INIT_CMD): {
       ac_debug_printf(LDR "AC_INIT_CMD\n", ldr);
 
-      // Create a message pool
-      status = AcMsgPool_init(&this->mp, 8, AC_INET_LINK_PROTOCOL_EXTRA_MAX_LEN);
+      // Create a message pool set, most messages are small so
+      // only a few are sized for AC_INET_LINK_PROTOCOL_EXTRA_MAX_LEN
+      const AcU32 msg_counts[] = { 8, 8, 4, 2 };
+      status = AcMsgPoolSet_init(&this->mps, 32, AC_INET_LINK_PROTOCOL_EXTRA_MAX_LEN,
+          msg_counts);
       if (status != AC_STATUS_OK) {
         ac_printf(LDR "AC_INIT_CMD could not allocates messages", ldr);
         this->status = status;
@@ -126,9 +130,8 @@ ac_bool work_state(AcComp* comp, AcMsg* msg) {
     case SEND_ARP_REQ: {
       ac_printf(LDR "SEND_ARP_REQ\n", ldr);
 
-      AcMsg* m = AcMsgPool_get_msg(&this->mp);
-      m->op = AC_INET_SEND_ARP_CMD;
-      AcInetSendArpExtra* send_arp_extra = (AcInetSendArpExtra*)m->extra;
+      AcMsg* m = AcInetSendArpCmd_get_msg(&this->mps);
+      AcInetSendArpExtra* send_arp_extra = AcInetSendArp_extra(m);
       send_arp_extra->proto = AC_ETHER_PROTO_IPV4;
       send_arp_extra->proto_addr_len = AC_IPV4_ADDR_LEN;
       send_arp_extra->proto_addr[0] = 10;
@@ -65,6 +65,12 @@ void ac_thread_wait_ns(ac_u64 nanosecs);
  */
 void ac_thread_wait_ticks(ac_u64 ticks);
 
+/**
+ * Get current thread handle
+ *
+ */
+ac_thread_hdl_t ac_thread_get_cur_hdl(void);
+
 /**
  * The current thread yeilds the CPU to the next
  * ready thread.
@@ -54,6 +54,10 @@ static ac_threads* pthreads;
 static void* entry_trampoline(void* param) {
   // Invoke the entry point
   ac_tcb* ptcb = (ac_tcb*)param;
+
+  // pthread_create may not have stored our thread_id yet,
+  // store it so ac_thread_get_cur_hdl finds us
+  __atomic_store_n(&ptcb->thread_id, pthread_self(), __ATOMIC_RELEASE);
   ptcb->entry(ptcb->entry_arg);
 
   // Mark AC_THREAD_ID_EMPTY
@@ -134,6 +138,24 @@ void ac_thread_wait_ns(ac_u64 nanosecs) {
   thread_wait_timespec(&time);
 }
 
+/**
+ * Get current thread handle, the tcb whose thread_id is ours.
+ * Threads not created by ac_thread_create, other than the
+ * main thread, have no handle and 0 is returned.
+ */
+ac_thread_hdl_t ac_thread_get_cur_hdl(void) {
+  pthread_t self = pthread_self();
+  for (ac_u32 i = 0; i < pthreads->max_count; i++) {
+    ac_tcb* ptcb = &pthreads->tcbs[i];
+    pthread_t thread_id = __atomic_load_n(&ptcb->thread_id, __ATOMIC_ACQUIRE);
+    if ((thread_id != AC_THREAD_ID_EMPTY) && (thread_id != AC_THREAD_ID_NOT_EMPTY)
+        && pthread_equal(thread_id, self)) {
+      return (ac_thread_hdl_t)ptcb;
+    }
+  }
+  return 0;
+}
+
 
 /**
  * The current thread waits for some number of ticks.
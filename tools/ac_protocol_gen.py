@@ -0,0 +1,250 @@
+#!/usr/bin/env python3
+# Copyright 2016 wink saville
+#
+# licensed under the apache license, version 2.0 (the "license");
+# you may not use this file except in compliance with the license.
+# you may obtain a copy of the license at
+#
+#     http://www.apache.org/licenses/license-2.0
+#
+# unless required by applicable law or agreed to in writing, software
+# distributed under the license is distributed on an "as is" basis,
+# without warranties or conditions of any kind, either express or implied.
+# see the license for the specific language governing permissions and
+# limitations under the license.
+
+"""
+Generate a protocol header from a protocol description.
+
+  ac_protocol_gen.py <description> <header>
+
+A description is a list of directives, blank lines and lines starting
+with '#' are ignored:
+
+  protocol <NAME> <number> <Type>  The AC_OP protocol, NAME is #defined as
+                                   number and Type prefixes the handlers
+  extra_max_len <NAME> <len>       Every extra struct is asserted to fit
+                                   in len bytes, NAME is #defined as len
+  op_prefix <PREFIX>               Operations are PREFIX_<MSG>_<OPTYPE>
+  type_prefix <Prefix>             Extras are <Prefix><Msg>Extra
+  include <file>                   Emits #include <file>
+  /// <text>                       Documents the next msg
+  msg <name> <opcode> <optype>...  A message, optypes are cmd, req and
+                                   rsp. Followed by the C fields of its
+                                   extra struct, if any, and 'end'.
+
+For each msg the header has its AC_OP's, its extra struct, a static
+assert it fits in extra_max_len and inline helpers:
+
+  AcMsg* <Prefix><Msg><Optype>_get_msg(AcMsgPoolSet* set), one per optype
+  <Prefix><Msg>Extra* <Prefix><Msg>_extra(AcMsg* msg)
+
+The size is known at compile time so there are no length checks
+when getting or using a message and the extra is filled in place.
+Each get_msg sets its own operation, so a message can't be gotten
+for an operation of another msg or protocol.
+For the protocol there's a <Type>Handlers struct with a member for
+each operation and <Type>_add_handlers to add them to an
+AcCompHandlers, the dispatcher's dense table for the protocol.
+"""
+
+import os
+import re
+import sys
+
+OPTYPES = {'cmd': 'AC_OPTYPE_CMD', 'req': 'AC_OPTYPE_REQ', 'rsp': 'AC_OPTYPE_RSP'}
+
+
+class DescriptionError(Exception):
+  pass
+
+
+class Msg:
+  def __init__(self, name, opcode, optypes, doc):
+    self.name = name
+    self.opcode = opcode
+    self.optypes = optypes
+    self.doc = doc
+    self.fields = []
+
+
+def camel(name):
+  return ''.join(w.capitalize() for w in name.split('_'))
+
+
+def parse(path):
+  desc = {'includes': [], 'msgs': []}
+  doc = []
+  msg = None
+  for line_num, line in enumerate(open(path), 1):
+    s = line.strip()
+
+    def err(text):
+      raise DescriptionError('{}:{}: {}'.format(path, line_num, text))
+
+    if msg is not None:
+      if s == 'end':
+        desc['msgs'].append(msg)
+        msg = None
+      elif s and not s.startswith('#'):
+        msg.fields.append(line.rstrip())
+      continue
+    if not s or s.startswith('#'):
+      continue
+    if s.startswith('///'):
+      doc.append(s[3:].strip())
+      continue
+
+    words = s.split()
+    directive, args = words[0], words[1:]
+    if directive == 'protocol' and len(args) == 3:
+      desc['protocol'] = args
+    elif directive == 'extra_max_len' and len(args) == 2:
+      desc['extra_max_len'] = args
+    elif directive == 'op_prefix' and len(args) == 1:
+      desc['op_prefix'] = args[0]
+    elif directive == 'type_prefix' and len(args) == 1:
+      desc['type_prefix'] = args[0]
+    elif directive == 'include' and len(args) == 1:
+      desc['includes'].append(args[0])
+    elif directive == 'msg' and len(args) >= 3:
+      name, opcode, optypes = args[0], args[1], args[2:]
+      if not re.match(r'^[a-z][a-z0-9_]*$', name):
+        err('msg name must be lower case, {}'.format(name))
+      try:
+        value = int(opcode, 0)
+      except ValueError:
+        err('opcode is not a number, {}'.format(opcode))
+      if not (0 < value <= 0xFFFF):
+        err('opcode must be 1..0xFFFF, {}'.format(opcode))
+      for optype in optypes:
+        if optype not in OPTYPES:
+          err('unknown optype {}, expecting one of {}'.format(optype, ' '.join(OPTYPES)))
+      if value in [int(m.opcode, 0) for m in desc['msgs']]:
+        err('opcode {} is already used'.format(opcode))
+      msg = Msg(name, opcode, optypes, doc)
+      doc = []
+    else:
+      err('unknown directive or wrong number of arguments, {}'.format(s))
+
+  if msg is not None:
+    raise DescriptionError('{}: msg {} has no end'.format(path, msg.name))
+  for required in ['protocol', 'extra_max_len', 'op_prefix', 'type_prefix']:
+    if required not in desc:
+      raise DescriptionError('{}: no {} directive'.format(path, required))
+  return desc
+
+
+def generate(desc, src_name, hdr_name):
+  protocol, protocol_num, handlers_type = desc['protocol']
+  max_len_name, max_len = desc['extra_max_len']
+  op_prefix = desc['op_prefix']
+  type_prefix = desc['type_prefix']
+  guard = 'SADIE_GENERATED_{}'.format(re.sub(r'\W', '_', hdr_name).upper())
+
+  out = []
+  w = out.append
+  w('/*')
+  w(' * Generated by tools/ac_protocol_gen.py from {}, do not edit.'.format(src_name))
+  w(' */')
+  w('')
+  w('#ifndef {}'.format(guard))
+  w('#define {}'.format(guard))
+  w('')
+  for inc in ['ac_assert.h', 'ac_comp_mgr.h', 'ac_inttypes.h', 'ac_msg.h',
+              'ac_msg_pool_set.h', 'ac_status.h'] + desc['includes']:
+    w('#include <{}>'.format(inc))
+  w('')
+  w('#define {} {}'.format(protocol, protocol_num))
+  w('#define {} {}'.format(max_len_name, max_len))
+
+  for msg in desc['msgs']:
+    ops = ['{}_{}_{}'.format(op_prefix, msg.name.upper(), optype.upper())
+        for optype in msg.optypes]
+    prefix = '{}{}'.format(type_prefix, camel(msg.name))
+    extra = '{}Extra'.format(prefix)
+
+    w('')
+    if msg.doc:
+      w('/**')
+      for text in msg.doc:
+        w(' * {}'.format(text).rstrip())
+      w(' */')
+    for op, optype in zip(ops, msg.optypes):
+      w('#define {} AC_OP({}, {}, {})'.format(op, protocol, OPTYPES[optype], msg.opcode))
+
+    if not msg.fields:
+      continue
+    w('')
+    w('typedef struct {')
+    for field in msg.fields:
+      w(field)
+    w('}} {};'.format(extra))
+    w('ac_static_assert(sizeof({}) <= {},'.format(extra, max_len_name))
+    w('    L"sizeof({}) > {}");'.format(extra, max_len_name))
+    w('')
+    for op, optype in zip(ops, msg.optypes):
+      w('/**')
+      w(' * Get a {} message from set with room for an {},'.format(op, extra))
+      w(' * AC_NULL if there are none.')
+      w(' */')
+      w('static inline AcMsg* {}{}_get_msg(AcMsgPoolSet* set) {{'.format(prefix, camel(optype)))
+      w('  AcMsg* msg = AcMsgPoolSet_get_msg(set, sizeof({}));'.format(extra))
+      w('  if (msg != AC_NULL) {')
+      w('    msg->op = {};'.format(op))
+      w('  }')
+      w('  return msg;')
+      w('}')
+      w('')
+    w('/**')
+    w(' * The {} of a message gotten with one of the {}*_get_msg'.format(extra, prefix))
+    w(' */')
+    w('static inline {}* {}_extra(AcMsg* msg) {{'.format(extra, prefix))
+    w('  return ({}*)msg->extra;'.format(extra))
+    w('}')
+
+  members = [('{}_{}'.format(msg.name, optype), '{}_{}_{}'.format(
+      op_prefix, msg.name.upper(), optype.upper()))
+      for msg in desc['msgs'] for optype in msg.optypes]
+  w('')
+  w('/**')
+  w(' * Handlers for the {} operations, AC_NULL if not handled'.format(protocol))
+  w(' */')
+  w('typedef struct {}Handlers {{'.format(handlers_type))
+  for member, op in members:
+    w('  AcCompMsgProcessor {};'.format(member).ljust(48) + '///< {}'.format(op))
+  w('}} {}Handlers;'.format(handlers_type))
+  w('')
+  w('/**')
+  w(' * Add the handlers which aren\'t AC_NULL to a component\'s handlers')
+  w(' *')
+  w(' * @return: AC_STATUS_OK if successful')
+  w(' */')
+  w('static inline AcStatus {0}_add_handlers(AcCompHandlers* handlers,'.format(handlers_type))
+  w('    const {}Handlers* h) {{'.format(handlers_type))
+  w('  AcStatus status = AC_STATUS_OK;')
+  for member, op in members:
+    w('  if ((status == AC_STATUS_OK) && (h->{} != AC_NULL)) {{'.format(member))
+    w('    status = AcCompHandlers_add(handlers, {}, h->{});'.format(op, member))
+    w('  }')
+  w('  return status;')
+  w('}')
+  w('')
+  w('#endif')
+  return '\n'.join(out) + '\n'
+
+
+def main(argv):
+  if len(argv) != 3:
+    sys.exit('Usage: {} <description> <header>'.format(argv[0]))
+  src, hdr = argv[1], argv[2]
+  try:
+    desc = parse(src)
+  except DescriptionError as e:
+    sys.exit(str(e))
+  with open(hdr, 'w') as f:
+    f.write(generate(desc, os.path.basename(src), os.path.basename(hdr)))
+
+
+if __name__ == '__main__':
+  main(sys.argv)